@@ -0,0 +1,91 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <cassert>
+#include "AddressWindows.h"
+
+AddressWindows::AddressWindows() :
+	m_bases(),
+	m_numWindows(0)
+{
+}
+
+AddressWindows::~AddressWindows()
+{
+}
+
+uint8_t AddressWindows::Register(uint64_t address, uint64_t size)
+{
+	if (!IsInOneWindow(address, size)) return InvalidWindow;
+
+	const auto window = FindWindow(address);
+	if (window != InvalidWindow || m_numWindows >= MaxWindows) return window;
+
+	m_bases[m_numWindows] = GetWindowBaseOf(address);
+
+	return m_numWindows++;
+}
+
+void AddressWindows::Reset()
+{
+	m_numWindows = 0;
+}
+
+uint64_t AddressWindows::Translate(uint64_t address) const
+{
+	const auto window = FindWindow(address);
+
+	return window != InvalidWindow ? (static_cast<uint64_t>(window) << 32) | (address & (WindowSize - 1)) : UINT64_MAX;
+}
+
+uint8_t AddressWindows::FindWindow(uint64_t address) const
+{
+	const auto base = GetWindowBaseOf(address);
+	for (uint8_t i = 0; i < m_numWindows; ++i)
+		if (m_bases[i] == base) return i;
+
+	return InvalidWindow;
+}
+
+uint64_t AddressWindows::GetWindowBase(uint8_t window) const
+{
+	assert(window < m_numWindows);
+
+	return m_bases[window];
+}
+
+uint8_t AddressWindows::GetNumWindows() const
+{
+	return m_numWindows;
+}
+
+uint64_t AddressWindows::GetWindowBaseOf(uint64_t address)
+{
+	return address & ~(WindowSize - 1);
+}
+
+bool AddressWindows::IsInOneWindow(uint64_t address, uint64_t size)
+{
+	// An empty range is in the window of its address; the end must not wrap around.
+	return size == 0 || (address + (size - 1) >= address &&
+		GetWindowBaseOf(address) == GetWindowBaseOf(address + (size - 1)));
+}
+
+bool AddressWindows::PlaceRange(uint64_t base, uint64_t& offset, uint64_t size, uint64_t alignment, uint64_t limit)
+{
+	assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+	if (size > WindowSize) return false;
+
+	// Align the address, not only the offset
+	const auto alignUp = [alignment](uint64_t address) { return (address + alignment - 1) & ~(alignment - 1); };
+	auto address = alignUp(base + offset);
+
+	// Skip to the next window if the range would cross the boundary
+	if (!IsInOneWindow(address, size)) address = alignUp(GetWindowBaseOf(address) + WindowSize);
+
+	if (address < base || address - base > limit || size > limit - (address - base)) return false;
+	offset = address - base;
+
+	return true;
+}
@@ -0,0 +1,47 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+
+// Host side of the 64-bit addressing in BufferAddress.hlsli. Shaders reach memory
+// through up to MaxWindows root-bound 4 GB windows, and take window addresses: the
+// window index in the high 32 bits and the offset into the window in the low ones.
+// A range is addressable as long as it does not cross a window boundary.
+class AddressWindows
+{
+public:
+	static const uint8_t MaxWindows = 4;	// ADDR_WINDOW_COUNT in the shaders
+	static const uint8_t InvalidWindow = 0xff;
+	static const uint64_t WindowSize = 1ull << 32;
+
+	AddressWindows();
+	virtual ~AddressWindows();
+
+	// Maps the window containing the range, or reuses it; returns InvalidWindow if
+	// the range crosses a window boundary or all windows are taken.
+	uint8_t Register(uint64_t address, uint64_t size);
+	void Reset();
+
+	// Returns UINT64_MAX if the address is in no registered window.
+	uint64_t Translate(uint64_t address) const;
+	uint8_t FindWindow(uint64_t address) const;
+
+	// Base virtual address of a window, for binding it as a root UAV
+	uint64_t GetWindowBase(uint8_t window) const;
+	uint8_t GetNumWindows() const;
+
+	static uint64_t GetWindowBaseOf(uint64_t address);
+	static bool IsInOneWindow(uint64_t address, uint64_t size);
+
+	// Places a range of size bytes at or after offset, aligned relative to the 64-bit
+	// base, so that base + offset does not cross a window boundary; the skipped tail
+	// of a window is wasted. Returns false if the range cannot end by limit.
+	static bool PlaceRange(uint64_t base, uint64_t& offset, uint64_t size, uint64_t alignment, uint64_t limit);
+
+protected:
+	uint64_t	m_bases[MaxWindows];
+	uint8_t		m_numWindows;
+};
@@ -0,0 +1,169 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include "ArrayBatchFilter.h"
+#define _ENABLE_STB_IMAGE_LOADER_ONLY_
+#include "Advanced/XUSGTextureLoader.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace XUSG;
+
+ArrayBatchFilter::ArrayBatchFilter() :
+	m_pipelineLayout(nullptr),
+	m_pipeline(nullptr),
+	m_record(UINT32_MAX),
+	m_sourceSlot(SlotAllocator::InvalidHandle),
+	m_resultSlot(SlotAllocator::InvalidHandle),
+	m_samplerSlot(SlotAllocator::InvalidHandle),
+	m_imageSize(1, 1),
+	m_numImages(0)
+{
+	m_shaderLib = ShaderLib::MakeUnique();
+}
+
+ArrayBatchFilter::~ArrayBatchFilter()
+{
+	if (m_bindlessHeap)
+	{
+		// The GPU is idle by now.
+		m_bindlessHeap->Free(CBV_SRV_UAV_HEAP, m_sourceSlot, 0);
+		m_bindlessHeap->Free(CBV_SRV_UAV_HEAP, m_resultSlot, 0);
+		m_bindlessHeap->Free(SAMPLER_HEAP, m_samplerSlot, 0);
+	}
+
+	if (m_recordTable && m_record != UINT32_MAX) m_recordTable->Free(m_record);
+}
+
+bool ArrayBatchFilter::Init(const Device* pDevice, const shared_ptr<BindlessHeap>& bindlessHeap,
+	const shared_ptr<RecordTable>& recordTable, UploadManager* pUploadManager,
+	const vector<string>& fileNames)
+{
+	XUSG_C_RETURN(fileNames.empty() || fileNames.size() > UINT16_MAX, false);
+
+	m_computePipelineLib = Compute::PipelineLib::MakeUnique(pDevice);
+	m_pipelineLayoutLib = PipelineLayoutLib::MakeUnique(pDevice);
+	m_bindlessHeap = bindlessHeap;
+	m_recordTable = recordTable;
+	m_numImages = static_cast<uint32_t>(fileNames.size());
+
+	// Load the images into the slices of the source
+	int channels = 0;
+	for (auto i = 0u; i < m_numImages; ++i)
+	{
+		int width, height, reqChannels;
+		const auto pTexData = LoadImageFromFile(fileNames[i].c_str(), width, height, reqChannels);
+		XUSG_N_RETURN(pTexData, false);
+		const unique_ptr<uint8_t, decltype(&stbi_image_free)> data(pTexData, stbi_image_free);
+
+		if (i == 0)
+		{
+			m_imageSize = XMUINT2(width, height);
+			channels = reqChannels;
+			m_source = Texture::MakeUnique();
+			XUSG_N_RETURN(m_source->Create(pDevice, width, height, GetImageFormat(channels),
+				static_cast<uint16_t>(m_numImages), ResourceFlag::NONE, 1, 1, false, MemoryFlag::NONE,
+				L"ArraySource"), false);
+		}
+		else XUSG_C_RETURN(static_cast<uint32_t>(width) != m_imageSize.x ||
+			static_cast<uint32_t>(height) != m_imageSize.y || reqChannels != channels, false);
+
+		XUSG_N_RETURN(pUploadManager->Upload(m_source.get(), data.get(), width * reqChannels, i), false);
+	}
+
+	m_result = Buffer::MakeUnique();
+	XUSG_N_RETURN(m_result->Create(pDevice, static_cast<size_t>(GetResultSize()), ResourceFlag::ALLOW_UNORDERED_ACCESS,
+		MemoryType::DEFAULT, 0, nullptr, 1, nullptr, MemoryFlag::NONE, L"ArrayResult"), false);
+
+	// One record of resource indices
+	XUSG_C_RETURN(m_recordTable->GetRecordSize() != sizeof(ResourceIndices), false);
+	m_record = m_recordTable->Allocate();
+	XUSG_C_RETURN(m_record == UINT32_MAX, false);
+
+	m_sourceSlot = m_bindlessHeap->AllocateCbvSrvUav(m_source->GetSRV());
+	m_resultSlot = m_bindlessHeap->AllocateCbvSrvUav(m_result->GetUAV());
+	m_samplerSlot = m_bindlessHeap->AllocateSampler(POINT_CLAMP);
+
+	ResourceIndices resIndices;
+	resIndices.TexIn = m_bindlessHeap->GetIndex(CBV_SRV_UAV_HEAP, m_sourceSlot);
+	resIndices.BufOut = m_bindlessHeap->GetIndex(CBV_SRV_UAV_HEAP, m_resultSlot);
+	resIndices.SmpLinear = m_bindlessHeap->GetIndex(SAMPLER_HEAP, m_samplerSlot);
+	XUSG_C_RETURN(resIndices.TexIn == UINT32_MAX || resIndices.BufOut == UINT32_MAX ||
+		resIndices.SmpLinear == UINT32_MAX, false);
+	m_recordTable->Write(m_record, &resIndices, sizeof(ResourceIndices));
+
+	XUSG_N_RETURN(createPipelineLayout(), false);
+
+	return createPipeline();
+}
+
+void ArrayBatchFilter::Process(CommandList* pCommandList, ResourceStateTracker& stateTracker)
+{
+	// The source is promoted implicitly on read.
+	stateTracker.Transition(m_result.get(), ResourceState::UNORDERED_ACCESS);
+	stateTracker.Flush(pCommandList);
+
+	// Unused window slots repeat the last window, so that every root parameter is set.
+	const auto pAddressWindows = m_recordTable->GetAddressWindows();
+	const auto numWindows = pAddressWindows->GetNumWindows();
+	pCommandList->SetComputePipelineLayout(m_pipelineLayout);
+	pCommandList->SetPipelineState(m_pipeline);
+	for (uint8_t i = 0; i < AddressWindows::MaxWindows; ++i)
+		pCommandList->SetComputeRootUnorderedAccessView(1 + i,
+			pAddressWindows->GetWindowBase((min)(i, static_cast<uint8_t>(numWindows - 1))));
+
+	const auto resIdxAddress = m_recordTable->GetShaderAddress(m_record);
+	pCommandList->SetCompute32BitConstants(0, XUSG_UINT32_SIZE_OF(uint64_t), &resIdxAddress);
+	pCommandList->Dispatch(XUSG_DIV_UP(m_imageSize.x, 8), XUSG_DIV_UP(m_imageSize.y, 8), m_numImages);
+}
+
+void ArrayBatchFilter::ReadBack(CommandList* pCommandList, ResourceStateTracker& stateTracker, Buffer* pReadBuffer)
+{
+	stateTracker.Transition(m_result.get(), ResourceState::COPY_SOURCE);
+	stateTracker.Flush(pCommandList);
+	pCommandList->CopyBufferRegion(pReadBuffer, 0, m_result.get(), 0, GetResultSize());
+}
+
+void ArrayBatchFilter::GetImageSize(uint32_t& width, uint32_t& height) const
+{
+	width = m_imageSize.x;
+	height = m_imageSize.y;
+}
+
+uint32_t ArrayBatchFilter::GetNumImages() const
+{
+	return m_numImages;
+}
+
+uint64_t ArrayBatchFilter::GetResultSize() const
+{
+	return sizeof(uint32_t) * static_cast<uint64_t>(m_imageSize.x) * m_imageSize.y * m_numImages;
+}
+
+bool ArrayBatchFilter::createPipelineLayout()
+{
+	// Same as the one of BindlessFilter
+	const auto utilPipelineLayout = Util::PipelineLayout::MakeUnique();
+	utilPipelineLayout->SetConstants(0, XUSG_UINT32_SIZE_OF(uint64_t), 0);
+	for (uint8_t i = 0; i < AddressWindows::MaxWindows; ++i)
+		utilPipelineLayout->SetRootUAV(1 + i, i);
+
+	XUSG_X_RETURN(m_pipelineLayout, utilPipelineLayout->GetPipelineLayout(
+		m_pipelineLayoutLib.get(), PipelineLayoutFlag::CBV_SRV_UAV_HEAP_DIRECTLY_INDEXED |
+		PipelineLayoutFlag::SAMPLER_HEAP_DIRECTLY_INDEXED, L"ImageProcArrayLayout"), false);
+
+	return true;
+}
+
+bool ArrayBatchFilter::createPipeline()
+{
+	XUSG_N_RETURN(m_shaderLib->CreateShader(Shader::Stage::CS, 0, L"CSImageProcArray.cso"), false);
+
+	const auto state = Compute::State::MakeUnique();
+	state->SetPipelineLayout(m_pipelineLayout);
+	state->SetShader(m_shaderLib->GetShader(Shader::Stage::CS, 0));
+	XUSG_X_RETURN(m_pipeline, state->GetPipeline(m_computePipelineLib.get(), L"ImageProcArray"), false);
+
+	return true;
+}
@@ -0,0 +1,69 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Core/XUSG.h"
+#include "UploadManager.h"
+#include "BindlessHeap.h"
+#include "RecordTable.h"
+#include "ResourceStateTracker.h"
+
+// Filters many images of the same size at once: the images are the slices of one
+// texture array, a single dispatch covers all slices (SV_GroupID.z selects the slice),
+// and the results of all slices are packed into one buffer as RGBA8, so that a
+// single copy reads them back. The blur is the one of BindlessFilter.
+class ArrayBatchFilter
+{
+public:
+	ArrayBatchFilter();
+	virtual ~ArrayBatchFilter();
+
+	// Fails if the images differ in size or channels. Uploads are only staged; the caller
+	// submits them on the upload manager. The record table takes one record.
+	bool Init(const XUSG::Device* pDevice, const std::shared_ptr<BindlessHeap>& bindlessHeap,
+		const std::shared_ptr<RecordTable>& recordTable, UploadManager* pUploadManager,
+		const std::vector<std::string>& fileNames);
+
+	// Transitions are requested from the state tracker of the command list.
+	void Process(XUSG::CommandList* pCommandList, ResourceStateTracker& stateTracker);
+	// Copies the results of all slices, rows packed, to the read-back buffer, which must
+	// hold GetResultSize() bytes.
+	void ReadBack(XUSG::CommandList* pCommandList, ResourceStateTracker& stateTracker, XUSG::Buffer* pReadBuffer);
+
+	void GetImageSize(uint32_t& width, uint32_t& height) const;
+	uint32_t GetNumImages() const;
+	uint64_t GetResultSize() const;
+
+protected:
+	struct ResourceIndices
+	{
+		uint32_t TexIn;
+		uint32_t BufOut;
+		uint32_t SmpLinear;
+	};
+
+	bool createPipelineLayout();
+	bool createPipeline();
+
+	XUSG::ShaderLib::uptr				m_shaderLib;
+	XUSG::Compute::PipelineLib::uptr	m_computePipelineLib;
+	XUSG::PipelineLayoutLib::uptr		m_pipelineLayoutLib;
+	std::shared_ptr<BindlessHeap>		m_bindlessHeap;
+	std::shared_ptr<RecordTable>		m_recordTable;
+
+	XUSG::PipelineLayout	m_pipelineLayout;
+	XUSG::Pipeline			m_pipeline;
+
+	XUSG::Texture::uptr					m_source;
+	XUSG::Buffer::uptr					m_result;
+
+	uint32_t							m_record;
+	BindlessHeap::Handle				m_sourceSlot;
+	BindlessHeap::Handle				m_resultSlot;
+	BindlessHeap::Handle				m_samplerSlot;
+
+	DirectX::XMUINT2					m_imageSize;
+	uint32_t							m_numImages;
+};
@@ -0,0 +1,224 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include "AtlasFilter.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace XUSG;
+
+AtlasFilter::AtlasFilter() :
+	m_pipelineLayout(nullptr),
+	m_pipeline(nullptr),
+	m_sourceSlot(SlotAllocator::InvalidHandle),
+	m_resultSlot(SlotAllocator::InvalidHandle),
+	m_samplerSlot(SlotAllocator::InvalidHandle),
+	m_atlasSize(1, 1),
+	m_numGroups(0),
+	m_occupancy(0.0)
+{
+	m_shaderLib = ShaderLib::MakeUnique();
+}
+
+AtlasFilter::~AtlasFilter()
+{
+	if (m_bindlessHeap)
+	{
+		// The GPU is idle by now.
+		m_bindlessHeap->Free(CBV_SRV_UAV_HEAP, m_sourceSlot, 0);
+		m_bindlessHeap->Free(CBV_SRV_UAV_HEAP, m_resultSlot, 0);
+		m_bindlessHeap->Free(SAMPLER_HEAP, m_samplerSlot, 0);
+	}
+}
+
+bool AtlasFilter::Init(const Device* pDevice, const shared_ptr<BindlessHeap>& bindlessHeap,
+	const shared_ptr<AddressWindows>& addressWindows, UploadManager* pUploadManager,
+	const Image* pImages, uint32_t numImages)
+{
+	XUSG_C_RETURN(numImages == 0, false);
+
+	m_computePipelineLib = Compute::PipelineLib::MakeUnique(pDevice);
+	m_pipelineLayoutLib = PipelineLayoutLib::MakeUnique(pDevice);
+	m_bindlessHeap = bindlessHeap;
+
+	// Pack the images with their aprons
+	vector<uint32_t> widths(numImages), heights(numImages);
+	for (auto i = 0u; i < numImages; ++i)
+	{
+		XUSG_C_RETURN(pImages[i].Width == 0 || pImages[i].Height == 0, false);
+		widths[i] = pImages[i].Width;
+		heights[i] = pImages[i].Height;
+	}
+
+	AtlasPacker packer;
+	const auto atlasWidth = AtlasPacker::GetSquareWidth(widths.data(), heights.data(), numImages, Apron, MaxSize);
+	XUSG_N_RETURN(packer.Pack(widths.data(), heights.data(), numImages, atlasWidth, Apron, MaxSize, m_tiles), false);
+	m_atlasSize = XMUINT2(packer.GetWidth(), packer.GetHeight());
+	m_occupancy = packer.GetOccupancy();
+
+	// Compose the atlas, repeating the edges of each image over its apron
+	const auto atlasPitch = static_cast<size_t>(m_atlasSize.x);
+	vector<uint32_t> atlas(atlasPitch * m_atlasSize.y);
+	for (auto i = 0u; i < numImages; ++i)
+	{
+		const auto& image = pImages[i];
+		const auto& tile = m_tiles[i];
+		for (auto y = 0u; y < tile.Height + 2 * Apron; ++y)
+		{
+			const auto srcY = y < Apron ? 0 : (min)(y - Apron, tile.Height - 1);
+			const auto pSrc = reinterpret_cast<const uint32_t*>(&image.pData[static_cast<size_t>(image.RowPitch) * srcY]);
+			const auto pDst = &atlas[atlasPitch * (tile.Y - Apron + y) + tile.X - Apron];
+			fill(pDst, pDst + Apron, pSrc[0]);
+			memcpy(pDst + Apron, pSrc, sizeof(uint32_t) * tile.Width);
+			fill(pDst + Apron + tile.Width, pDst + 2 * Apron + tile.Width, pSrc[tile.Width - 1]);
+		}
+	}
+
+	m_source = Texture::MakeUnique();
+	XUSG_N_RETURN(m_source->Create(pDevice, m_atlasSize.x, m_atlasSize.y, Format::R8G8B8A8_UNORM, 1,
+		ResourceFlag::NONE, 1, 1, false, MemoryFlag::NONE, L"AtlasSource"), false);
+	XUSG_N_RETURN(pUploadManager->Upload(m_source.get(), atlas.data(),
+		static_cast<uint32_t>(sizeof(uint32_t) * atlasPitch)), false);
+
+	m_result = Texture::MakeUnique();
+	XUSG_N_RETURN(m_result->Create(pDevice, m_atlasSize.x, m_atlasSize.y, Format::R8G8B8A8_UNORM, 1,
+		ResourceFlag::ALLOW_UNORDERED_ACCESS, 1, 1, false, MemoryFlag::NONE, L"AtlasResult"), false);
+
+	m_sourceSlot = m_bindlessHeap->AllocateCbvSrvUav(m_source->GetSRV());
+	m_resultSlot = m_bindlessHeap->AllocateCbvSrvUav(m_result->GetUAV());
+	m_samplerSlot = m_bindlessHeap->AllocateSampler(POINT_CLAMP);
+
+	TileRecord record;
+	record.TexIn = m_bindlessHeap->GetIndex(CBV_SRV_UAV_HEAP, m_sourceSlot);
+	record.TexOut = m_bindlessHeap->GetIndex(CBV_SRV_UAV_HEAP, m_resultSlot);
+	record.SmpLinear = m_bindlessHeap->GetIndex(SAMPLER_HEAP, m_samplerSlot);
+	XUSG_C_RETURN(record.TexIn == UINT32_MAX || record.TexOut == UINT32_MAX ||
+		record.SmpLinear == UINT32_MAX, false);
+
+	// One record per tile, consecutive in a table of their own, so that the shader can
+	// search them by first group
+	m_recordTable = make_unique<RecordTable>();
+	XUSG_N_RETURN(m_recordTable->Init(pDevice, sizeof(TileRecord), numImages, addressWindows, L"AtlasTiles"), false);
+	m_numGroups = 0;
+	for (auto i = 0u; i < numImages; ++i)
+	{
+		const auto& tile = m_tiles[i];
+		record.Origin = XMUINT2(tile.X, tile.Y);
+		record.Size = XMUINT2(tile.Width, tile.Height);
+		record.FirstGroup = m_numGroups;
+		const auto numGroups = static_cast<uint64_t>(XUSG_DIV_UP(tile.Width, 8)) * XUSG_DIV_UP(tile.Height, 8);
+		XUSG_C_RETURN(m_numGroups + numGroups > UINT32_MAX, false);
+		m_numGroups += static_cast<uint32_t>(numGroups);
+
+		XUSG_C_RETURN(m_recordTable->Allocate() != i, false);
+		m_recordTable->Write(i, &record, sizeof(TileRecord));
+	}
+	XUSG_N_RETURN(m_recordTable->Update(pUploadManager, nullptr, 0), false);
+
+	XUSG_N_RETURN(createPipelineLayout(), false);
+
+	return createPipeline();
+}
+
+void AtlasFilter::Process(CommandList* pCommandList, ResourceStateTracker& stateTracker)
+{
+	// The source is promoted implicitly on read.
+	stateTracker.Transition(m_result.get(), ResourceState::UNORDERED_ACCESS);
+	stateTracker.Flush(pCommandList);
+
+	// Unused window slots repeat the last window, so that every root parameter is set.
+	const auto pAddressWindows = m_recordTable->GetAddressWindows();
+	const auto numWindows = pAddressWindows->GetNumWindows();
+	pCommandList->SetComputePipelineLayout(m_pipelineLayout);
+	pCommandList->SetPipelineState(m_pipeline);
+	for (uint8_t i = 0; i < AddressWindows::MaxWindows; ++i)
+		pCommandList->SetComputeRootUnorderedAccessView(1 + i,
+			pAddressWindows->GetWindowBase((min)(i, static_cast<uint8_t>(numWindows - 1))));
+
+	// Address of the first record, the record size, and the numbers of tiles and groups
+	const auto address = m_recordTable->GetShaderAddress(0);
+	const uint32_t cb[] =
+	{
+		static_cast<uint32_t>(address), static_cast<uint32_t>(address >> 32),
+		m_recordTable->GetRecordSize(), static_cast<uint32_t>(m_tiles.size()), m_numGroups
+	};
+	pCommandList->SetCompute32BitConstants(0, static_cast<uint32_t>(size(cb)), cb);
+
+	// The groups are linear, folded into rows of up to MAX_GROUPS_X.
+	const auto maxGroupsX = 65535u;
+	pCommandList->Dispatch((min)(m_numGroups, maxGroupsX), XUSG_DIV_UP(m_numGroups, maxGroupsX), 1);
+}
+
+bool AtlasFilter::ReadBack(CommandList* pCommandList, ResourceStateTracker& stateTracker,
+	Buffer* pReadBuffer, uint32_t& rowPitch)
+{
+	stateTracker.Transition(m_result.get(), ResourceState::COPY_SOURCE);
+	stateTracker.Flush(pCommandList);
+
+	return m_result->ReadBack(pCommandList, pReadBuffer, &rowPitch, 1, 0, 0, ResourceState::COPY_SOURCE);
+}
+
+void AtlasFilter::Unpack(uint8_t* pDst, const uint8_t* pAtlas, uint32_t rowPitch, uint32_t image) const
+{
+	assert(image < m_tiles.size());
+	const auto& tile = m_tiles[image];
+	const auto rowSize = sizeof(uint32_t) * tile.Width;
+	for (auto y = 0u; y < tile.Height; ++y)
+		memcpy(&pDst[rowSize * y], &pAtlas[static_cast<size_t>(rowPitch) * (tile.Y + y) + sizeof(uint32_t) * tile.X], rowSize);
+}
+
+void AtlasFilter::GetAtlasSize(uint32_t& width, uint32_t& height) const
+{
+	width = m_atlasSize.x;
+	height = m_atlasSize.y;
+}
+
+const AtlasPacker::Rect& AtlasFilter::GetTile(uint32_t image) const
+{
+	assert(image < m_tiles.size());
+
+	return m_tiles[image];
+}
+
+uint32_t AtlasFilter::GetNumImages() const
+{
+	return static_cast<uint32_t>(m_tiles.size());
+}
+
+uint32_t AtlasFilter::GetNumGroups() const
+{
+	return m_numGroups;
+}
+
+double AtlasFilter::GetOccupancy() const
+{
+	return m_occupancy;
+}
+
+bool AtlasFilter::createPipelineLayout()
+{
+	// The constants of BindlessFilter, followed by the tile-record layout and group count
+	const auto utilPipelineLayout = Util::PipelineLayout::MakeUnique();
+	utilPipelineLayout->SetConstants(0, XUSG_UINT32_SIZE_OF(uint64_t) + 3, 0);
+	for (uint8_t i = 0; i < AddressWindows::MaxWindows; ++i)
+		utilPipelineLayout->SetRootUAV(1 + i, i);
+
+	XUSG_X_RETURN(m_pipelineLayout, utilPipelineLayout->GetPipelineLayout(
+		m_pipelineLayoutLib.get(), PipelineLayoutFlag::CBV_SRV_UAV_HEAP_DIRECTLY_INDEXED |
+		PipelineLayoutFlag::SAMPLER_HEAP_DIRECTLY_INDEXED, L"ImageProcAtlasLayout"), false);
+
+	return true;
+}
+
+bool AtlasFilter::createPipeline()
+{
+	XUSG_N_RETURN(m_shaderLib->CreateShader(Shader::Stage::CS, 0, L"CSImageProcAtlas.cso"), false);
+
+	const auto state = Compute::State::MakeUnique();
+	state->SetPipelineLayout(m_pipelineLayout);
+	state->SetShader(m_shaderLib->GetShader(Shader::Stage::CS, 0));
+	XUSG_X_RETURN(m_pipeline, state->GetPipeline(m_computePipelineLib.get(), L"ImageProcAtlas"), false);
+
+	return true;
+}
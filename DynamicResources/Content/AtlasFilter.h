@@ -0,0 +1,95 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Core/XUSG.h"
+#include "UploadManager.h"
+#include "BindlessHeap.h"
+#include "RecordTable.h"
+#include "ResourceStateTracker.h"
+#include "AtlasPacker.h"
+#include "CPUImageProc.h"
+
+// Filters many small images of different sizes at once: the images are packed into one
+// atlas, each padded by an apron of the blur radius that repeats its edges, so that the
+// blur of a tile never reads its neighbors. Every tile has a record of its own, and a
+// single dispatch covers all tiles, whose groups follow each other in record order. The
+// results land in an atlas of the same layout, unpacked per image after read-back. The
+// blur is the one of BindlessFilter.
+class AtlasFilter
+{
+public:
+	static const uint32_t Apron = CPUImageProc::BlurRadius;
+	static const uint32_t MaxSize = 16384;
+
+	// RGBA8 pixels, which only need to live during Init()
+	struct Image
+	{
+		const uint8_t* pData;
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t RowPitch;
+	};
+
+	AtlasFilter();
+	virtual ~AtlasFilter();
+
+	// Fails if the images do not fit into an atlas of MaxSize x MaxSize, or the atlas into
+	// the staging ring. The tile records are in a table of their own, mapped through the
+	// address windows shared with the other filters. Uploads are only staged; the caller
+	// submits them on the upload manager.
+	bool Init(const XUSG::Device* pDevice, const std::shared_ptr<BindlessHeap>& bindlessHeap,
+		const std::shared_ptr<AddressWindows>& addressWindows, UploadManager* pUploadManager,
+		const Image* pImages, uint32_t numImages);
+
+	// Transitions are requested from the state tracker of the command list.
+	void Process(XUSG::CommandList* pCommandList, ResourceStateTracker& stateTracker);
+	// Reads the result atlas back; the read-back buffer is created on first use.
+	bool ReadBack(XUSG::CommandList* pCommandList, ResourceStateTracker& stateTracker,
+		XUSG::Buffer* pReadBuffer, uint32_t& rowPitch);
+	// Copies the result of an image out of the read-back atlas into tightly packed RGBA8.
+	void Unpack(uint8_t* pDst, const uint8_t* pAtlas, uint32_t rowPitch, uint32_t image) const;
+
+	void GetAtlasSize(uint32_t& width, uint32_t& height) const;
+	const AtlasPacker::Rect& GetTile(uint32_t image) const;
+	uint32_t GetNumImages() const;
+	uint32_t GetNumGroups() const;
+	double GetOccupancy() const;
+
+protected:
+	struct TileRecord
+	{
+		uint32_t TexIn;
+		uint32_t TexOut;
+		uint32_t SmpLinear;
+		DirectX::XMUINT2 Origin;
+		DirectX::XMUINT2 Size;
+		uint32_t FirstGroup;	// FIRST_GROUP_OFFSET in the shaders
+	};
+
+	bool createPipelineLayout();
+	bool createPipeline();
+
+	XUSG::ShaderLib::uptr				m_shaderLib;
+	XUSG::Compute::PipelineLib::uptr	m_computePipelineLib;
+	XUSG::PipelineLayoutLib::uptr		m_pipelineLayoutLib;
+	std::shared_ptr<BindlessHeap>		m_bindlessHeap;
+	std::unique_ptr<RecordTable>		m_recordTable;
+
+	XUSG::PipelineLayout	m_pipelineLayout;
+	XUSG::Pipeline			m_pipeline;
+
+	XUSG::Texture::uptr					m_source;
+	XUSG::Texture::uptr					m_result;
+
+	std::vector<AtlasPacker::Rect>		m_tiles;
+	BindlessHeap::Handle				m_sourceSlot;
+	BindlessHeap::Handle				m_resultSlot;
+	BindlessHeap::Handle				m_samplerSlot;
+
+	DirectX::XMUINT2					m_atlasSize;
+	uint32_t							m_numGroups;
+	double								m_occupancy;
+};
@@ -0,0 +1,149 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include "AtlasPacker.h"
+
+using namespace std;
+
+AtlasPacker::AtlasPacker() :
+	m_usedArea(0),
+	m_width(0),
+	m_height(0)
+{
+}
+
+AtlasPacker::~AtlasPacker()
+{
+}
+
+bool AtlasPacker::Pack(const uint32_t* pWidths, const uint32_t* pHeights, uint32_t numRects,
+	uint32_t width, uint32_t apron, uint32_t maxHeight, vector<Rect>& rects)
+{
+	m_skyline.assign(1, { 0, 0, width });
+	m_usedArea = 0;
+	m_width = width;
+	m_height = 0;
+	rects.resize(numRects);
+	if (width == 0) return numRects == 0;
+
+	// Tallest first, then widest, so that the skyline stays flat
+	vector<uint32_t> order(numRects);
+	for (auto i = 0u; i < numRects; ++i) order[i] = i;
+	sort(order.begin(), order.end(), [pWidths, pHeights](uint32_t a, uint32_t b)
+	{
+		return pHeights[a] != pHeights[b] ? pHeights[a] > pHeights[b] : pWidths[a] > pWidths[b];
+	});
+
+	for (const auto i : order)
+	{
+		const auto w = pWidths[i] + 2 * apron;
+		const auto h = pHeights[i] + 2 * apron;
+		if (w > width) return false;
+
+		// Lowest top edge, then leftmost
+		auto best = m_skyline.size();
+		auto bestY = UINT32_MAX;
+		for (size_t j = 0; j < m_skyline.size(); ++j)
+		{
+			uint32_t y;
+			if (fit(j, w, y) && y < bestY)
+			{
+				best = j;
+				bestY = y;
+			}
+		}
+		if (best == m_skyline.size() || bestY + h > maxHeight) return false;
+
+		rects[i] = { m_skyline[best].X + apron, bestY + apron, pWidths[i], pHeights[i] };
+		place(best, w, h, bestY);
+		m_usedArea += static_cast<uint64_t>(w) * h;
+		m_height = (max)(m_height, bestY + h);
+	}
+
+	return true;
+}
+
+uint32_t AtlasPacker::GetWidth() const
+{
+	return m_width;
+}
+
+uint32_t AtlasPacker::GetHeight() const
+{
+	return m_height;
+}
+
+double AtlasPacker::GetOccupancy() const
+{
+	const auto area = static_cast<uint64_t>(m_width) * m_height;
+
+	return area > 0 ? static_cast<double>(m_usedArea) / area : 0.0;
+}
+
+uint32_t AtlasPacker::GetSquareWidth(const uint32_t* pWidths, const uint32_t* pHeights, uint32_t numRects,
+	uint32_t apron, uint32_t maxWidth)
+{
+	uint64_t area = 0;
+	uint32_t width = 0;
+	for (auto i = 0u; i < numRects; ++i)
+	{
+		const auto w = pWidths[i] + 2 * apron;
+		area += static_cast<uint64_t>(w) * (pHeights[i] + 2 * apron);
+		width = (max)(width, w);
+	}
+
+	// The skyline wastes some area, so aim for a little more than the padded rectangles.
+	const auto squareWidth = static_cast<uint32_t>(ceil(sqrt(static_cast<double>(area) * 1.1)));
+
+	return (min)((max)(width, squareWidth), maxWidth);
+}
+
+bool AtlasPacker::fit(size_t segment, uint32_t width, uint32_t& y) const
+{
+	const auto x = m_skyline[segment].X;
+	if (x + width > m_width) return false;
+
+	// Rest on the highest segment under the rectangle
+	y = 0;
+	for (auto i = segment; i < m_skyline.size() && m_skyline[i].X < x + width; ++i)
+		y = (max)(y, m_skyline[i].Y);
+
+	return true;
+}
+
+void AtlasPacker::place(size_t segment, uint32_t width, uint32_t height, uint32_t y)
+{
+	const auto x = m_skyline[segment].X;
+	const auto right = x + width;
+
+	// Cut the segments under the rectangle away, then insert its top edge.
+	auto i = segment;
+	while (i < m_skyline.size() && m_skyline[i].X < right)
+	{
+		auto& s = m_skyline[i];
+		const auto end = s.X + s.Width;
+		if (end <= right) ++i;
+		else
+		{
+			s.Width = end - right;
+			s.X = right;
+			break;
+		}
+	}
+	m_skyline.erase(m_skyline.begin() + segment, m_skyline.begin() + i);
+	m_skyline.insert(m_skyline.begin() + segment, { x, y + height, width });
+
+	// Merge neighbors of the same height
+	for (auto j = segment > 0 ? segment - 1 : 0; j + 1 < m_skyline.size() && j <= segment + 1;)
+	{
+		if (m_skyline[j].Y == m_skyline[j + 1].Y)
+		{
+			m_skyline[j].Width += m_skyline[j + 1].Width;
+			m_skyline.erase(m_skyline.begin() + j + 1);
+		}
+		else ++j;
+	}
+}
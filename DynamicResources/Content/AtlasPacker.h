@@ -0,0 +1,60 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Skyline packer for atlases of a fixed width. The skyline is the top edge of the
+// rectangles placed so far, as segments from left to right; each rectangle goes to the
+// lowest position on it (leftmost on ties), taking the tallest rectangles first. Every
+// rectangle is padded by an apron on all sides, which is left to the caller to fill.
+class AtlasPacker
+{
+public:
+	struct Rect
+	{
+		uint32_t X;
+		uint32_t Y;
+		uint32_t Width;
+		uint32_t Height;
+	};
+
+	AtlasPacker();
+	virtual ~AtlasPacker();
+
+	// The rectangles are returned in the input order, without their aprons. Fails if a
+	// padded rectangle is wider than the atlas, or the atlas grows higher than maxHeight.
+	bool Pack(const uint32_t* pWidths, const uint32_t* pHeights, uint32_t numRects,
+		uint32_t width, uint32_t apron, uint32_t maxHeight, std::vector<Rect>& rects);
+
+	uint32_t GetWidth() const;
+	uint32_t GetHeight() const;
+	// Area of the padded rectangles over the area of the atlas
+	double GetOccupancy() const;
+
+	// Width of a roughly square atlas for the padded rectangles, within maxWidth
+	static uint32_t GetSquareWidth(const uint32_t* pWidths, const uint32_t* pHeights, uint32_t numRects,
+		uint32_t apron, uint32_t maxWidth);
+
+protected:
+	struct Segment
+	{
+		uint32_t X;
+		uint32_t Y;
+		uint32_t Width;
+	};
+
+	// Returns false if the rectangle does not fit at the segment.
+	bool fit(size_t segment, uint32_t width, uint32_t& y) const;
+	void place(size_t segment, uint32_t width, uint32_t height, uint32_t y);
+
+	std::vector<Segment> m_skyline;
+
+	uint64_t	m_usedArea;
+	uint32_t	m_width;
+	uint32_t	m_height;
+};
@@ -11,67 +11,468 @@ using namespace DirectX;
 using namespace XUSG;
 
 BindlessFilter::BindlessFilter() :
-	m_imageSize(1, 1)
+	m_pDevice(nullptr),
+	m_rtFormat(Format::UNKNOWN),
+	m_sourceId(FilterGraph::InvalidId),
+	m_resultId(FilterGraph::InvalidId),
+	m_numPasses(1),
+	m_sourceSlot(SlotAllocator::InvalidHandle),
+	m_samplerSlot(SlotAllocator::InvalidHandle),
+	m_regionRecord(UINT32_MAX),
+	m_regionResultSlot(SlotAllocator::InvalidHandle),
+	m_imageSize(1, 1),
+	m_sourceRead(),
+	m_numDispatchedGroups(0),
+	m_numFullGroups(0),
+	m_isIncremental(false)
 {
 	m_shaderLib = ShaderLib::MakeUnique();
+	for (auto& slot : m_resultSlots) slot = SlotAllocator::InvalidHandle;
 }
 
 BindlessFilter::~BindlessFilter()
 {
+	if (m_bindlessHeap)
+	{
+		// The GPU is idle by now.
+		m_bindlessHeap->Free(CBV_SRV_UAV_HEAP, m_sourceSlot, 0);
+		for (const auto& slot : m_resultSlots) m_bindlessHeap->Free(CBV_SRV_UAV_HEAP, slot, 0);
+		for (const auto& slot : m_intermediateSlots) m_bindlessHeap->Free(CBV_SRV_UAV_HEAP, slot, 0);
+		m_bindlessHeap->Free(CBV_SRV_UAV_HEAP, m_regionResultSlot, 0);
+		m_bindlessHeap->Free(SAMPLER_HEAP, m_samplerSlot, 0);
+	}
+
+	if (m_recordTable)
+	{
+		for (const auto& record : m_records) if (record != UINT32_MAX) m_recordTable->Free(record);
+		if (m_regionRecord != UINT32_MAX) m_recordTable->Free(m_regionRecord);
+	}
 }
 
-bool BindlessFilter::Init(CommandList* pCommandList, const XUSG::DescriptorTableLib::sptr& descriptorTableLib,
-	vector<Resource::uptr>& uploaders, Format rtFormat, const char* fileName)
+bool BindlessFilter::Init(const Device* pDevice, const XUSG::DescriptorTableLib::sptr& descriptorTableLib,
+	const shared_ptr<BindlessHeap>& bindlessHeap, const shared_ptr<RecordTable>& recordTable,
+	UploadManager* pUploadManager, Format rtFormat, const char* fileName, uint8_t numPasses)
 {
-	const auto pDevice = pCommandList->GetDevice();
+	XUSG_C_RETURN(numPasses < 1, false);
+
 	m_graphicsPipelineLib = Graphics::PipelineLib::MakeUnique(pDevice);
 	m_computePipelineLib = Compute::PipelineLib::MakeUnique(pDevice);
 	m_pipelineLayoutLib = PipelineLayoutLib::MakeUnique(pDevice);
 	m_descriptorTableLib = descriptorTableLib;
+	m_bindlessHeap = bindlessHeap;
+	m_recordTable = recordTable;
+	m_pDevice = pDevice;
+	m_rtFormat = rtFormat;
+	m_numPasses = numPasses;
+
+	// Load input image, and stage it on the upload manager
+	SourceImage image;
+	XUSG_N_RETURN(loadImage(image, fileName), false);
+	XUSG_N_RETURN(createSource(m_source, image), false);
+	XUSG_N_RETURN(pUploadManager->Upload(m_source.get(), image.Data.get(), image.Width * image.Channels), false);
+	setImageSize(image.Width, image.Height);
 
-	// Load input image
+	// Create resources and pipelines
+	vector<Resource::uptr> retiredResources;
+	XUSG_N_RETURN(createResults(), false);
+	XUSG_N_RETURN(createGraph(retiredResources, 0), false);
+
+	// One record of resource indices per pass and result
+	XUSG_C_RETURN(m_recordTable->GetRecordSize() != sizeof(ResourceIndices), false);
+	m_records.assign(ResultCount * m_numPasses, UINT32_MAX);
+	m_resIndexRecords.resize(m_records.size());
+	for (auto& record : m_records)
 	{
-		m_source = Texture::MakeUnique();
-		uploaders.emplace_back(Resource::MakeUnique());
-		XUSG_N_RETURN(CreateTextureFromFile(pCommandList, fileName, m_source.get(),
-			uploaders.back().get(), ResourceState::COMMON, MemoryFlag::NONE, L"Source"), false);
+		record = m_recordTable->Allocate();
+		XUSG_C_RETURN(record == UINT32_MAX, false);
 	}
 
-	// Create resources and pipelines
-	m_imageSize.x = static_cast<uint32_t>(m_source->GetWidth());
-	m_imageSize.y = m_source->GetHeight();
+	XUSG_N_RETURN(createPipelineLayouts(), false);
+	XUSG_N_RETURN(createPipelines(rtFormat), false);
 
-	m_result = Texture::MakeUnique();
-	XUSG_N_RETURN(m_result->Create(pDevice, m_imageSize.x, m_imageSize.y, rtFormat, 1,
-		ResourceFlag::ALLOW_UNORDERED_ACCESS, 1, 1, false, MemoryFlag::NONE, L"Result"), false);
+	return createDescriptorTables();
+}
 
-	m_resIndices = Buffer::MakeUnique();
-	XUSG_N_RETURN(m_resIndices->Create(pDevice, sizeof(ResourceIndices),
-		ResourceFlag::ALLOW_UNORDERED_ACCESS, MemoryType::DEFAULT, 0, nullptr,
-		1, nullptr, MemoryFlag::NONE, L"ResourceIndices"), false);
-	m_addressHi = m_resIndices->GetVirtualAddress() & ~uint64_t(UINT32_MAX);
+void BindlessFilter::SetSource(const char* fileName)
+{
+	if (m_sourceLoad.valid()) m_nextSourceFileName = fileName;
+	else m_sourceLoad = async(launch::async, [fileName = string(fileName)]()
+	{
+		SourceImage image = {};
+		if (!loadImage(image, fileName.c_str())) cerr << "Failed to load " << fileName << endl;
 
-	XUSG_N_RETURN(createPipelineLayouts(), false);
-	XUSG_N_RETURN(createPipelines(rtFormat), false);
-	XUSG_N_RETURN(createDescriptorTables(pCommandList, uploaders), false);
+		return image;
+	});
+}
+
+bool BindlessFilter::IsSourceReady() const
+{
+	return m_loadedSource.Data || (m_sourceLoad.valid() &&
+		m_sourceLoad.wait_for(chrono::seconds(0)) == future_status::ready);
+}
+
+bool BindlessFilter::UpdateSource(UploadManager* pUploadManager, vector<Resource::uptr>& retiredResources,
+	uint64_t fenceValue)
+{
+	if (!IsSourceReady()) return false;
+
+	if (!m_loadedSource.Data)
+	{
+		m_loadedSource = m_sourceLoad.get();
+
+		// Start the queued load, if any.
+		if (!m_nextSourceFileName.empty())
+		{
+			const auto fileName = move(m_nextSourceFileName);
+			m_nextSourceFileName.clear();
+			SetSource(fileName.c_str());
+		}
+
+		XUSG_N_RETURN(m_loadedSource.Data, false);
+	}
+
+	// Stage the upload before anything is replaced, into a new source if the size or format
+	// changes. If the staging ring is full, the loaded image is kept to retry on a later frame.
+	const auto image = m_loadedSource;
+	const auto isSizeChanged = image.Width != m_imageSize.x || image.Height != m_imageSize.y;
+	const auto isSourceChanged = isSizeChanged || GetImageFormat(image.Channels) != m_source->GetFormat();
+	Texture::uptr source;
+	if (isSourceChanged) XUSG_N_RETURN(createSource(source, image), false);
+	if (!pUploadManager->Upload(isSourceChanged ? source.get() : m_source.get(),
+		image.Data.get(), image.Width * image.Channels)) return false;
+	m_loadedSource = {};
+
+	// Create new resources and descriptors only if the size or format changes.
+	if (isSourceChanged)
+	{
+		retiredResources.emplace_back(move(m_source));
+		m_source = move(source);
+		setImageSize(image.Width, image.Height);
+		createSourceDescriptor(fenceValue);
+	}
+
+	if (isSizeChanged)
+	{
+		for (auto& result : m_results) retiredResources.emplace_back(move(result));
+		XUSG_N_RETURN(createResults(), false);
+		XUSG_N_RETURN(createGraph(retiredResources, fenceValue), false);
+		createResultDescriptors(fenceValue);
+	}
+
+	XUSG_N_RETURN(updateResourceIndices(), false);
+	writeRecords();
+	for (auto& dirtyRegion : m_dirtyRegions) dirtyRegion.AddAll();
+
+	return true;
+}
+
+bool BindlessFilter::UpdateSourceRegion(UploadManager* pUploadManager, const void* pData, uint32_t rowPitch,
+	const DirtyRegion::Rect& rect)
+{
+	XUSG_C_RETURN(rect.Right > m_imageSize.x || rect.Bottom > m_imageSize.y, false);
+	if (DirtyRegion::IsEmpty(rect)) return true;
+
+	XUSG_N_RETURN(pUploadManager->UploadRegion(m_source.get(), pData, rowPitch, rect.Left, rect.Top,
+		rect.Right - rect.Left, rect.Bottom - rect.Top), false);
+	for (auto& dirtyRegion : m_dirtyRegions) dirtyRegion.Add(rect);
+
+	return true;
+}
+
+void BindlessFilter::SetIncremental(bool isIncremental)
+{
+	m_isIncremental = isIncremental;
+}
+
+const DirtyRegion& BindlessFilter::GetDirtyRegion(uint8_t resultIndex) const
+{
+	assert(resultIndex < ResultCount);
+
+	return m_dirtyRegions[resultIndex];
+}
+
+void BindlessFilter::SetDirtyRegion(uint8_t resultIndex, const DirtyRegion& dirtyRegion)
+{
+	assert(resultIndex < ResultCount);
+	m_dirtyRegions[resultIndex] = dirtyRegion;
+}
+
+const DirtyRegion::Rect& BindlessFilter::GetSourceRead() const
+{
+	return m_sourceRead;
+}
+
+bool BindlessFilter::RelocateSlots(DescriptorHeapType type, const vector<BindlessHeap::Relocation>& relocations)
+{
+	auto isRelocated = false;
+	const auto relocate = [&relocations, &isRelocated](BindlessHeap::Handle& slot)
+	{
+		for (const auto& relocation : relocations)
+		{
+			if (relocation.From == slot)
+			{
+				slot = relocation.To;
+				isRelocated = true;
+
+				return;
+			}
+		}
+	};
+
+	if (type == SAMPLER_HEAP) relocate(m_samplerSlot);
+	else
+	{
+		relocate(m_sourceSlot);
+		for (auto& slot : m_resultSlots) relocate(slot);
+		for (auto& slot : m_intermediateSlots) relocate(slot);
+		relocate(m_regionResultSlot);
+	}
+
+	if (isRelocated)
+	{
+		XUSG_N_RETURN(updateResourceIndices(), false);
+		writeRecords();
+	}
 
 	return true;
 }
 
-void BindlessFilter::Process(CommandList* pCommandList)
+bool BindlessFilter::CreateRegionResult(uint32_t width, uint32_t height, vector<Resource::uptr>& retiredResources,
+	uint64_t fenceValue)
 {
-	ResourceBarrier barrier;
-	const auto numBarriers = m_result->SetBarrier(&barrier, ResourceState::UNORDERED_ACCESS);
-	pCommandList->Barrier(numBarriers, &barrier);
+	XUSG_C_RETURN(width == 0 || height == 0, false);
+	if (m_regionResult && m_regionResult->GetWidth() == width && m_regionResult->GetHeight() == height) return true;
+
+	if (m_regionRecord == UINT32_MAX)
+	{
+		m_regionRecord = m_recordTable->Allocate();
+		XUSG_C_RETURN(m_regionRecord == UINT32_MAX, false);
+	}
+
+	if (m_regionResult) retiredResources.emplace_back(move(m_regionResult));
+	m_regionResult = Texture::MakeUnique();
+	XUSG_N_RETURN(m_regionResult->Create(m_pDevice, width, height, m_rtFormat, 1,
+		ResourceFlag::ALLOW_UNORDERED_ACCESS, 1, 1, false, MemoryFlag::NONE, L"RegionResult"), false);
 
-	pCommandList->SetComputePipelineLayout(m_pipelineLayouts[IMAGE_PROC]);
-	pCommandList->SetPipelineState(m_pipelines[IMAGE_PROC]);
+	// Recycle the slot of the replaced result after the frames using it
+	m_bindlessHeap->Free(CBV_SRV_UAV_HEAP, m_regionResultSlot, fenceValue);
+	m_regionResultSlot = m_bindlessHeap->AllocateCbvSrvUav(m_regionResult->GetUAV());
 
-	const auto resIdxBufferVA = m_resIndices->GetVirtualAddress();
-	pCommandList->SetCompute32BitConstants(0, XUSG_UINT32_SIZE_OF(uint64_t), &resIdxBufferVA);
-	pCommandList->SetComputeRootUnorderedAccessView(1, m_addressHi);
+	XUSG_N_RETURN(updateResourceIndices(), false);
+	writeRecords();
 
-	pCommandList->Dispatch(XUSG_DIV_UP(m_imageSize.x, 8), XUSG_DIV_UP(m_imageSize.y, 8), 1);
+	return true;
+}
+
+void BindlessFilter::Process(CommandList* pCommandList, ResourceStateTracker& stateTracker, uint8_t resultIndex)
+{
+	const auto pThis = this;
+	ProcessBatch(pCommandList, stateTracker, &pThis, 1, resultIndex);
+}
+
+void BindlessFilter::Process(CommandList* pCommandList, ResourceStateTracker& stateTracker, const DirtyRegion::Rect& roi)
+{
+	assert(m_regionResult && m_regionRecord != UINT32_MAX);
+	const auto width = static_cast<uint32_t>(m_regionResult->GetWidth());
+	const auto height = m_regionResult->GetHeight();
+	const DirtyRegion::Rect rect =
+	{
+		roi.Left, roi.Top,
+		(min)((min)(roi.Right, roi.Left + width), m_imageSize.x),
+		(min)((min)(roi.Bottom, roi.Top + height), m_imageSize.y)
+	};
+	if (DirtyRegion::IsEmpty(rect)) return;
+
+	// The last pass covers the groups of the region, and each earlier pass what the next one reads.
+	DirtyRegion region;
+	region.Init(m_imageSize.x, m_imageSize.y);
+	region.Add(rect);
+	setPassTiles(region, 0);
+
+	m_graphExecutor.SetImported(m_sourceId, m_source.get());
+	m_graphExecutor.SetImported(m_resultId, m_regionResult.get());
+
+	const auto numSteps = m_graphExecutor.GetNumSteps();
+	for (auto step = 0u; step < numSteps; ++step)
+	{
+		m_graphExecutor.SetBarriers(pCommandList, step, stateTracker);
+		stateTracker.Flush(pCommandList);
+
+		// The intermediates are shared with the first result, whose records read and write them.
+		const auto pass = m_graphExecutor.GetPass(step);
+		const auto isLast = pass + 1u == m_numPasses;
+		const auto resIdxAddress = m_recordTable->GetShaderAddress(isLast ? m_regionRecord : m_records[pass]);
+		setPipeline(pCommandList, isLast ? IMAGE_PROC_REGION : IMAGE_PROC);
+		for (const auto& tile : m_passTiles[pass])
+		{
+			// The last pass takes the origin of the region in place of the group offset.
+			const uint32_t cb[] =
+			{
+				static_cast<uint32_t>(resIdxAddress),
+				static_cast<uint32_t>(resIdxAddress >> 32),
+				isLast ? rect.Left | (rect.Top << 16) : tile.Left | (tile.Top << 16)
+			};
+			pCommandList->SetCompute32BitConstants(0, static_cast<uint32_t>(size(cb)), cb);
+			pCommandList->Dispatch(tile.Right - tile.Left, tile.Bottom - tile.Top, 1);
+		}
+	}
+
+	m_graphExecutor.SetFinalBarriers(stateTracker);
+	stateTracker.Flush(pCommandList);
+}
+
+bool BindlessFilter::ReadBackRegion(CommandList* pCommandList, ResourceStateTracker& stateTracker,
+	Buffer* pReadBuffer, uint32_t& rowPitch)
+{
+	assert(m_regionResult);
+	stateTracker.Transition(m_regionResult.get(), ResourceState::COPY_SOURCE);
+	stateTracker.Flush(pCommandList);
+
+	return m_regionResult->ReadBack(pCommandList, pReadBuffer, &rowPitch, 1, 0, 0, ResourceState::COPY_SOURCE);
+}
+
+void BindlessFilter::ProcessBatch(CommandList* pCommandList, ResourceStateTracker& stateTracker,
+	BindlessFilter* const* ppFilters, uint32_t numFilters, uint8_t resultIndex,
+	BundleCache* pBundleCache, uint32_t bundleSlot, const IndirectBatch* pIndirectBatch)
+{
+	assert(resultIndex < ResultCount);
+	if (numFilters == 0) return;
+
+	// The pipelines of all instances are identical, and all resources are bindless.
+	const auto pFirst = ppFilters[0];
+	const auto pAddressWindows = pFirst->m_recordTable->GetAddressWindows();
+	const auto numWindows = pAddressWindows->GetNumWindows();
+	assert(numWindows > 0);
+
+	const auto dispatch = [ppFilters, numFilters, resultIndex](CommandList* pCommandList, uint32_t step)
+	{
+		for (auto i = 0u; i < numFilters; ++i)
+		{
+			const auto pFilter = ppFilters[i];
+			const auto pass = pFilter->m_graphExecutor.GetPass(step);
+			const auto record = pFilter->m_records[pFilter->m_numPasses * resultIndex + pass];
+			const auto resIdxAddress = pFilter->m_recordTable->GetShaderAddress(record);
+			for (const auto& tile : pFilter->m_passTiles[pass])
+			{
+				// The group offset is packed into one word, so that it is never taken for an address.
+				const uint32_t cb[] =
+				{
+					static_cast<uint32_t>(resIdxAddress),
+					static_cast<uint32_t>(resIdxAddress >> 32),
+					tile.Left | (tile.Top << 16)
+				};
+				pCommandList->SetCompute32BitConstants(0, static_cast<uint32_t>(size(cb)), cb);
+				pCommandList->Dispatch(tile.Right - tile.Left, tile.Bottom - tile.Top, 1);
+			}
+		}
+	};
+
+	const auto numSteps = pFirst->m_graphExecutor.GetNumSteps();
+	if (pIndirectBatch)
+	{
+		assert(pIndirectBatch->GetNumJobs() == numFilters);
+		const auto pArguments = pIndirectBatch->GetArguments();
+		const auto pCounts = pIndirectBatch->GetCounts();
+		stateTracker.Transition(pArguments, ResourceState::UNORDERED_ACCESS);
+		stateTracker.Transition(pCounts, ResourceState::UNORDERED_ACCESS);
+		stateTracker.Flush(pCommandList);
+
+		// One group per step builds the arguments of the jobs of the result.
+		pFirst->setPipeline(pCommandList, DISPATCH_ARGS);
+		pIndirectBatch->Build(pCommandList, pFirst->m_recordTable->GetShaderAddress(0),
+			pFirst->m_recordTable->GetRecordSize(), IndirectBatch::GetList(resultIndex, 0, numSteps), numSteps);
+
+		// Flushed with the barriers of the first step
+		stateTracker.Transition(pArguments, ResourceState::INDIRECT_ARGUMENT);
+		stateTracker.Transition(pCounts, ResourceState::INDIRECT_ARGUMENT);
+		pBundleCache = nullptr;
+	}
+
+	if (!pBundleCache) pFirst->setPipeline(pCommandList, IMAGE_PROC);
+
+	for (auto i = 0u; i < numFilters; ++i)
+	{
+		const auto pFilter = ppFilters[i];
+		assert(pFilter->m_recordTable->GetAddressWindows() == pAddressWindows);
+		assert(pFilter->m_graphExecutor.GetNumSteps() == pFirst->m_graphExecutor.GetNumSteps());
+		pFilter->updatePassTiles(resultIndex, pIndirectBatch != nullptr);
+		pFilter->m_graphExecutor.SetImported(pFilter->m_sourceId, pFilter->m_source.get());
+		pFilter->m_graphExecutor.SetImported(pFilter->m_resultId, pFilter->m_results[resultIndex].get());
+	}
+
+	// Each step of all instances with the barriers in one batch
+	BundleCache::Key key;
+	for (auto step = 0u; step < numSteps; ++step)
+	{
+		for (auto i = 0u; i < numFilters; ++i)
+			ppFilters[i]->m_graphExecutor.SetBarriers(pCommandList, step, stateTracker);
+		stateTracker.Flush(pCommandList);
+
+		if (pIndirectBatch)
+		{
+			pIndirectBatch->Execute(pCommandList, step);
+			continue;
+		}
+
+		if (pBundleCache)
+		{
+			// Everything the dispatches of the step are recorded from
+			key.clear();
+			key.emplace_back(reinterpret_cast<uintptr_t>(pFirst->m_pipelineLayouts[IMAGE_PROC]));
+			key.emplace_back(reinterpret_cast<uintptr_t>(pFirst->m_pipelines[IMAGE_PROC]));
+			for (uint8_t i = 0; i < numWindows; ++i) key.emplace_back(pAddressWindows->GetWindowBase(i));
+			for (auto i = 0u; i < numFilters; ++i)
+			{
+				const auto pFilter = ppFilters[i];
+				const auto pass = pFilter->m_graphExecutor.GetPass(step);
+				const auto record = pFilter->m_records[pFilter->m_numPasses * resultIndex + pass];
+				key.emplace_back(pFilter->m_recordTable->GetShaderAddress(record));
+				key.emplace_back((static_cast<uint64_t>(pFilter->m_imageSize.y) << 32) | pFilter->m_imageSize.x);
+				key.emplace_back(pFilter->m_passTiles[pass].size());
+				for (const auto& tile : pFilter->m_passTiles[pass])
+					key.emplace_back(tile.Left | (tile.Top << 16) | (static_cast<uint64_t>(tile.Right) << 32) |
+						(static_cast<uint64_t>(tile.Bottom) << 48));
+			}
+
+			// Recorded directly into the command list if the bundle fails
+			const auto record = [pFirst, &dispatch, step](CommandList* pList)
+			{
+				pFirst->setPipeline(pList, IMAGE_PROC);
+				dispatch(pList, step);
+			};
+			pBundleCache->Replay(pCommandList, bundleSlot + step, key, record);
+		}
+		else dispatch(pCommandList, step);
+	}
+
+	for (auto i = 0u; i < numFilters; ++i) ppFilters[i]->m_graphExecutor.SetFinalBarriers(stateTracker);
+	stateTracker.Flush(pCommandList);
+}
+
+bool BindlessFilter::CreateIndirectBatch(IndirectBatch& indirectBatch, BindlessFilter* const* ppFilters,
+	uint32_t numFilters, UploadManager* pUploadManager)
+{
+	XUSG_C_RETURN(numFilters == 0, false);
+	const auto pFirst = ppFilters[0];
+	const auto numSteps = pFirst->m_graphExecutor.GetNumSteps();
+
+	// The records of the steps do not change with the source, as the chain of passes is the same.
+	vector<uint32_t> jobs(ResultCount * numSteps * numFilters);
+	for (uint8_t i = 0; i < ResultCount; ++i)
+	{
+		for (auto step = 0u; step < numSteps; ++step)
+		{
+			for (auto j = 0u; j < numFilters; ++j)
+			{
+				const auto pFilter = ppFilters[j];
+				const auto pass = pFilter->m_graphExecutor.GetPass(step);
+				jobs[IndirectBatch::GetList(i, step, numSteps) * numFilters + j] = pFilter->m_records[pFilter->m_numPasses * i + pass];
+			}
+		}
+	}
+
+	return indirectBatch.Init(pFirst->m_pDevice, pFirst->m_pipelineLayouts[IMAGE_PROC], jobs,
+		numFilters, numSteps, pUploadManager);
 }
 
 void BindlessFilter::GetImageSize(uint32_t& width, uint32_t& height) const
@@ -80,9 +481,124 @@ void BindlessFilter::GetImageSize(uint32_t& width, uint32_t& height) const
 	height = m_imageSize.y;
 }
 
-Resource* BindlessFilter::GetResult() const
+void BindlessFilter::GetDispatchedGroups(uint64_t& numDispatched, uint64_t& numFull, bool reset)
 {
-	return m_result.get();
+	numDispatched = m_numDispatchedGroups;
+	numFull = m_numFullGroups;
+
+	if (reset)
+	{
+		m_numDispatchedGroups = 0;
+		m_numFullGroups = 0;
+	}
+}
+
+Resource* BindlessFilter::GetResult(uint8_t resultIndex) const
+{
+	assert(resultIndex < ResultCount);
+
+	return m_results[resultIndex].get();
+}
+
+Resource* BindlessFilter::GetRegionResult() const
+{
+	return m_regionResult.get();
+}
+
+const FilterGraphExecutor& BindlessFilter::GetGraphExecutor() const
+{
+	return m_graphExecutor;
+}
+
+void BindlessFilter::GetCaptureObjects(vector<CommandCapture::Object>& objects, const char* prefix) const
+{
+	const auto addTexture = [&objects, prefix](const Texture* pTexture, const string& name)
+	{
+		objects.push_back({ pTexture, CommandCapture::GetObjectDesc((prefix + name).c_str(), CommandCapture::OBJECT_TEXTURE,
+			static_cast<uint32_t>(pTexture->GetFormat()), static_cast<uint32_t>(pTexture->GetWidth()), pTexture->GetHeight()) });
+	};
+
+	addTexture(m_source.get(), "Source");
+	for (uint8_t i = 0; i < ResultCount; ++i) addTexture(m_results[i].get(), "Result" + to_string(i));
+	for (size_t i = 0; i < m_intermediates.size(); ++i)
+		addTexture(m_graphExecutor.GetTexture(m_intermediates[i]), "Intermediate" + to_string(i));
+
+	objects.push_back({ m_pipelines[IMAGE_PROC], CommandCapture::GetObjectDesc((string(prefix) + "ImageProc").c_str(),
+		CommandCapture::OBJECT_PIPELINE) });
+	objects.push_back({ m_pipelineLayouts[IMAGE_PROC], CommandCapture::GetObjectDesc((string(prefix) + "ImageProcLayout").c_str(),
+		CommandCapture::OBJECT_PIPELINE_LAYOUT) });
+}
+
+bool BindlessFilter::createSource(Texture::uptr& source, const SourceImage& image) const
+{
+	source = Texture::MakeUnique();
+
+	return source->Create(m_pDevice, image.Width, image.Height, GetImageFormat(image.Channels),
+		1, ResourceFlag::NONE, 1, 1, false, MemoryFlag::NONE, L"Source");
+}
+
+void BindlessFilter::setImageSize(uint32_t width, uint32_t height)
+{
+	m_imageSize.x = width;
+	m_imageSize.y = height;
+
+	// The results are stale until processed in full.
+	for (auto& dirtyRegion : m_dirtyRegions)
+	{
+		dirtyRegion.Init(m_imageSize.x, m_imageSize.y);
+		dirtyRegion.AddAll();
+	}
+}
+
+bool BindlessFilter::createResults()
+{
+	for (uint8_t i = 0; i < ResultCount; ++i)
+	{
+		m_results[i] = Texture::MakeUnique();
+		XUSG_N_RETURN(m_results[i]->Create(m_pDevice, m_imageSize.x, m_imageSize.y, m_rtFormat, 1,
+			ResourceFlag::ALLOW_UNORDERED_ACCESS, 1, 1, false, MemoryFlag::NONE,
+			(L"Result" + to_wstring(i)).c_str()), false);
+	}
+
+	return true;
+}
+
+bool BindlessFilter::createGraph(vector<Resource::uptr>& retiredResources, uint64_t fenceValue)
+{
+	FilterGraph::TextureDesc desc;
+	XUSG_N_RETURN(FilterGraphExecutor::GetTextureDesc(m_pDevice, m_imageSize.x, m_imageSize.y, m_rtFormat, desc), false);
+
+	// The source is promoted implicitly on read, so it needs no transitions.
+	FilterGraph graph;
+	m_sourceId = graph.Import("Source", FilterGraph::ACCESS_SHADER_READ, FilterGraph::ACCESS_SHADER_READ);
+	m_resultId = graph.Import("Result", FilterGraph::ACCESS_UNKNOWN);
+
+	// A chain of passes through transient intermediates
+	m_intermediates.clear();
+	auto input = m_sourceId;
+	for (uint8_t i = 0; i < m_numPasses; ++i)
+	{
+		const auto isLast = i + 1 == m_numPasses;
+		if (!isLast) m_intermediates.emplace_back(graph.CreateTexture(("Intermediate" + to_string(i)).c_str(), desc));
+		const auto output = isLast ? m_resultId : m_intermediates.back();
+		graph.AddPass("ImageProc", { input }, { output });
+		input = output;
+	}
+
+	FilterGraph::Plan plan;
+	XUSG_N_RETURN(graph.Compile(plan), false);
+	XUSG_N_RETURN(m_graphExecutor.Create(m_pDevice, graph, plan, retiredResources, L"FilterGraph"), false);
+
+	// Recycle the slots of the replaced intermediates after the frames using them
+	for (const auto& slot : m_intermediateSlots) m_bindlessHeap->Free(CBV_SRV_UAV_HEAP, slot, fenceValue);
+	m_intermediateSlots.clear();
+	for (const auto& intermediate : m_intermediates)
+	{
+		m_intermediateSlots.emplace_back(m_bindlessHeap->AllocateCbvSrvUav(m_graphExecutor.GetSRV(intermediate)));
+		m_intermediateSlots.emplace_back(m_bindlessHeap->AllocateCbvSrvUav(m_graphExecutor.GetUAV(intermediate)));
+	}
+
+	return true;
 }
 
 bool BindlessFilter::createPipelineLayouts()
@@ -90,12 +606,30 @@ bool BindlessFilter::createPipelineLayouts()
 	// Dynamic resources
 	{
 		const auto utilPipelineLayout = Util::PipelineLayout::MakeUnique();
-		utilPipelineLayout->SetConstants(0, XUSG_UINT32_SIZE_OF(uint64_t), 0);
-		utilPipelineLayout->SetRootUAV(1, 0);
+		utilPipelineLayout->SetConstants(0, XUSG_UINT32_SIZE_OF(uint64_t) + 1, 0);	// Record address, group offset
+		for (uint8_t i = 0; i < AddressWindows::MaxWindows; ++i)
+			utilPipelineLayout->SetRootUAV(1 + i, i);
 
 		XUSG_X_RETURN(m_pipelineLayouts[IMAGE_PROC], utilPipelineLayout->GetPipelineLayout(
 			m_pipelineLayoutLib.get(), PipelineLayoutFlag::CBV_SRV_UAV_HEAP_DIRECTLY_INDEXED |
 			PipelineLayoutFlag::SAMPLER_HEAP_DIRECTLY_INDEXED, L"ImageProcLayout"), false);
+
+		// The region variant takes the origin of the region in place of the group offset.
+		m_pipelineLayouts[IMAGE_PROC_REGION] = m_pipelineLayouts[IMAGE_PROC];
+	}
+
+	// Dispatch arguments
+	{
+		const auto utilPipelineLayout = Util::PipelineLayout::MakeUnique();
+		utilPipelineLayout->SetConstants(0, XUSG_UINT32_SIZE_OF(uint64_t) + 3, 0);	// Table address, record size, jobs, first list
+		for (uint8_t i = 0; i < AddressWindows::MaxWindows; ++i)
+			utilPipelineLayout->SetRootUAV(1 + i, i);
+		utilPipelineLayout->SetRootSRV(IndirectBatch::JobsRootIndex, IndirectBatch::JobsRegister);
+		utilPipelineLayout->SetRootUAV(IndirectBatch::ArgumentsRootIndex, IndirectBatch::ArgumentsRegister, 0, DescriptorFlag::NONE);
+		utilPipelineLayout->SetRootUAV(IndirectBatch::CountsRootIndex, IndirectBatch::CountsRegister, 0, DescriptorFlag::NONE);
+
+		XUSG_X_RETURN(m_pipelineLayouts[DISPATCH_ARGS], utilPipelineLayout->GetPipelineLayout(
+			m_pipelineLayoutLib.get(), PipelineLayoutFlag::CBV_SRV_UAV_HEAP_DIRECTLY_INDEXED, L"DispatchArgsLayout"), false);
 	}
 
 	return true;
@@ -115,39 +649,51 @@ bool BindlessFilter::createPipelines(Format rtFormat)
 		XUSG_X_RETURN(m_pipelines[IMAGE_PROC], state->GetPipeline(m_computePipelineLib.get(), L"ImageProc"), false);
 	}
 
+	// Region of interest
+	{
+		XUSG_N_RETURN(m_shaderLib->CreateShader(Shader::Stage::CS, csIndex, L"CSImageProcRegion.cso"), false);
+
+		const auto state = Compute::State::MakeUnique();
+		state->SetPipelineLayout(m_pipelineLayouts[IMAGE_PROC_REGION]);
+		state->SetShader(m_shaderLib->GetShader(Shader::Stage::CS, csIndex++));
+		XUSG_X_RETURN(m_pipelines[IMAGE_PROC_REGION], state->GetPipeline(m_computePipelineLib.get(), L"ImageProcRegion"), false);
+	}
+
+	// Dispatch arguments of indirect batches
+	{
+		XUSG_N_RETURN(m_shaderLib->CreateShader(Shader::Stage::CS, csIndex, L"CSDispatchArgs.cso"), false);
+
+		const auto state = Compute::State::MakeUnique();
+		state->SetPipelineLayout(m_pipelineLayouts[DISPATCH_ARGS]);
+		state->SetShader(m_shaderLib->GetShader(Shader::Stage::CS, csIndex++));
+		XUSG_X_RETURN(m_pipelines[DISPATCH_ARGS], state->GetPipeline(m_computePipelineLib.get(), L"DispatchArgs"), false);
+	}
+
 	return true;
 }
 
-bool BindlessFilter::createDescriptorTables(CommandList* pCommandList, vector<Resource::uptr>& uploaders)
+bool BindlessFilter::createDescriptorTables()
 {
-	ResourceIndices resIndices;
-
 #if 1
-	// Use GetCbvSrvUavTableIndex
-	auto descriptorTable = Util::DescriptorTable::MakeUnique();
-	descriptorTable->SetDescriptors(0, 1, &m_source->GetSRV());
-	resIndices.TexIn = descriptorTable->GetCbvSrvUavTableIndex(m_descriptorTableLib.get());
-	XUSG_C_RETURN(resIndices.TexIn == UINT32_MAX, false);
-
-	descriptorTable = Util::DescriptorTable::MakeUnique();
-	descriptorTable->SetDescriptors(0, 1, &m_result->GetUAV());
-	resIndices.TexOut = descriptorTable->GetCbvSrvUavTableIndex(m_descriptorTableLib.get());
-	XUSG_C_RETURN(resIndices.TexOut == UINT32_MAX, false);
-
-	// Use GetSamplerTableIndex
-	descriptorTable = Util::DescriptorTable::MakeUnique();
-	const auto sampler = POINT_CLAMP;
-	descriptorTable->SetSamplers(0, 1, &sampler, m_descriptorTableLib.get());
-	resIndices.SmpLinear = descriptorTable->GetSamplerTableIndex(m_descriptorTableLib.get());
-	XUSG_C_RETURN(resIndices.SmpLinear == UINT32_MAX, false);
+	// Use freeable slots of the bindless heap
+	createSourceDescriptor(0);
+	createResultDescriptors(0);
+	m_samplerSlot = m_bindlessHeap->AllocateSampler(POINT_CLAMP);
+	XUSG_N_RETURN(updateResourceIndices(), false);
 #else
+	auto& resIndices = m_resIndexRecords;
+
 	// Create a resource table with all used CBVs/SRVs/UAVs
 	{
 		const auto descriptorTable = Util::DescriptorTable::MakeUnique();
 
-		Descriptor descriptors[2];
-		descriptors[resIndices.TexIn] = m_source->GetSRV();
-		descriptors[resIndices.TexOut] = m_result->GetUAV();
+		Descriptor descriptors[1 + ResultCount];
+		descriptors[resIndices[0].TexIn] = m_source->GetSRV();
+		for (uint8_t i = 0; i < ResultCount; ++i)
+		{
+			resIndices[i].TexOut = resIndices[0].TexOut + i;
+			descriptors[resIndices[i].TexOut] = m_results[i]->GetUAV();
+		}
 
 		descriptorTable->SetDescriptors(0, static_cast<uint32_t>(size(descriptors)), descriptors);
 		const auto table = descriptorTable->GetCbvSrvUavTable(m_descriptorTableLib.get());
@@ -159,7 +705,7 @@ bool BindlessFilter::createDescriptorTables(CommandList* pCommandList, vector<Re
 		const auto descriptorTable = Util::DescriptorTable::MakeUnique();
 
 		SamplerPreset samplers[1];
-		samplers[resIndices.SmpLinear] = POINT_CLAMP;
+		samplers[resIndices[0].SmpLinear] = POINT_CLAMP;
 
 		descriptorTable->SetSamplers(0, static_cast<uint32_t>(size(samplers)), samplers, m_descriptorTableLib.get());
 		const auto table = descriptorTable->GetSamplerTable(m_descriptorTableLib.get());
@@ -167,7 +713,123 @@ bool BindlessFilter::createDescriptorTables(CommandList* pCommandList, vector<Re
 	}
 #endif
 
-	uploaders.emplace_back(Resource::MakeUnique());
+	writeRecords();
+
+	return true;
+}
+
+void BindlessFilter::createSourceDescriptor(uint64_t fenceValue)
+{
+	// Recycle the slot of the replaced source after the frames reading it
+	m_bindlessHeap->Free(CBV_SRV_UAV_HEAP, m_sourceSlot, fenceValue);
+	m_sourceSlot = m_bindlessHeap->AllocateCbvSrvUav(m_source->GetSRV());
+}
+
+void BindlessFilter::createResultDescriptors(uint64_t fenceValue)
+{
+	for (uint8_t i = 0; i < ResultCount; ++i)
+	{
+		m_bindlessHeap->Free(CBV_SRV_UAV_HEAP, m_resultSlots[i], fenceValue);
+		m_resultSlots[i] = m_bindlessHeap->AllocateCbvSrvUav(m_results[i]->GetUAV());
+	}
+}
+
+bool BindlessFilter::updateResourceIndices()
+{
+	// Each pass reads the output of the previous one, and the last pass writes the result.
+	const auto texIn = m_bindlessHeap->GetIndex(CBV_SRV_UAV_HEAP, m_sourceSlot);
+	const auto smpLinear = m_bindlessHeap->GetIndex(SAMPLER_HEAP, m_samplerSlot);
+	for (uint8_t i = 0; i < ResultCount; ++i)
+	{
+		for (uint8_t j = 0; j < m_numPasses; ++j)
+		{
+			auto& resIndices = m_resIndexRecords[m_numPasses * i + j];
+			resIndices.TexIn = j > 0 ? m_bindlessHeap->GetIndex(CBV_SRV_UAV_HEAP, m_intermediateSlots[2 * (j - 1)]) : texIn;
+			resIndices.TexOut = m_bindlessHeap->GetIndex(CBV_SRV_UAV_HEAP,
+				j + 1 < m_numPasses ? m_intermediateSlots[2 * j + 1] : m_resultSlots[i]);
+			resIndices.SmpLinear = smpLinear;
+			XUSG_C_RETURN(resIndices.TexIn == UINT32_MAX || resIndices.TexOut == UINT32_MAX ||
+				resIndices.SmpLinear == UINT32_MAX, false);
+		}
+	}
+
+	// The last pass into the region result reads what the one into the first result does.
+	if (m_regionRecord != UINT32_MAX)
+	{
+		m_regionResIndices = m_resIndexRecords[m_numPasses - 1];
+		m_regionResIndices.TexOut = m_bindlessHeap->GetIndex(CBV_SRV_UAV_HEAP, m_regionResultSlot);
+		XUSG_C_RETURN(m_regionResIndices.TexOut == UINT32_MAX, false);
+	}
+
+	return true;
+}
+
+void BindlessFilter::writeRecords()
+{
+	for (size_t i = 0; i < m_records.size(); ++i)
+		m_recordTable->Write(m_records[i], &m_resIndexRecords[i], sizeof(ResourceIndices));
+	if (m_regionRecord != UINT32_MAX)
+		m_recordTable->Write(m_regionRecord, &m_regionResIndices, sizeof(ResourceIndices));
+}
+
+void BindlessFilter::updatePassTiles(uint8_t resultIndex, bool isFull)
+{
+	auto& dirtyRegion = m_dirtyRegions[resultIndex];
+	if (!m_isIncremental || isFull) dirtyRegion.AddAll();
+
+	// The last pass covers the texels that the changes reach through all passes.
+	setPassTiles(dirtyRegion, BlurRadius * m_numPasses);
+	dirtyRegion.Clear();
+
+	for (const auto& tiles : m_passTiles)
+		for (const auto& tile : tiles)
+			m_numDispatchedGroups += DirtyRegion::GetArea(tile);
+	m_numFullGroups += static_cast<uint64_t>(dirtyRegion.GetNumTiles()) * m_numPasses;
+}
 
-	return m_resIndices->Upload(pCommandList, uploaders.back().get(), &resIndices, sizeof(resIndices));
+void BindlessFilter::setPassTiles(const DirtyRegion& region, uint32_t radius)
+{
+	// The last pass covers the region dilated by the radius, and each earlier pass covers
+	// what the tiles of the next one read, as intermediates are transient.
+	m_passTiles.resize(m_numPasses);
+	region.GetTiles(m_passTiles[m_numPasses - 1], radius, MaxTiles);
+	for (auto pass = m_numPasses - 1u; pass > 0; --pass)
+	{
+		DirtyRegion reach;
+		reach.Init(m_imageSize.x, m_imageSize.y);
+		for (const auto& tiles : m_passTiles[pass]) reach.Add(reach.GetTexels(tiles));
+		reach.GetTiles(m_passTiles[pass - 1], BlurRadius, MaxTiles);
+	}
+
+	// The first pass reads the source around its tiles.
+	m_sourceRead = {};
+	for (const auto& tiles : m_passTiles[0])
+		m_sourceRead = DirtyRegion::Union(m_sourceRead,
+			DirtyRegion::Dilate(region.GetTexels(tiles), BlurRadius, m_imageSize.x, m_imageSize.y));
+}
+
+void BindlessFilter::setPipeline(CommandList* pCommandList, PipelineIndex pipeline) const
+{
+	// Unused window slots repeat the last window, so that every root parameter is set.
+	const auto pAddressWindows = m_recordTable->GetAddressWindows();
+	const auto numWindows = pAddressWindows->GetNumWindows();
+	pCommandList->SetComputePipelineLayout(m_pipelineLayouts[pipeline]);
+	pCommandList->SetPipelineState(m_pipelines[pipeline]);
+	for (uint8_t i = 0; i < AddressWindows::MaxWindows; ++i)
+		pCommandList->SetComputeRootUnorderedAccessView(1 + i,
+			pAddressWindows->GetWindowBase((min)(i, static_cast<uint8_t>(numWindows - 1))));
+}
+
+bool BindlessFilter::loadImage(SourceImage& image, const char* fileName)
+{
+	int width, height, reqChannels;
+	const auto pTexData = LoadImageFromFile(fileName, width, height, reqChannels);
+	XUSG_N_RETURN(pTexData, false);
+
+	image.Data = shared_ptr<uint8_t>(pTexData, stbi_image_free);
+	image.Width = width;
+	image.Height = height;
+	image.Channels = static_cast<uint8_t>(reqChannels);
+
+	return true;
 }
@@ -6,58 +6,202 @@
 
 #include "DXFramework.h"
 #include "Core/XUSG.h"
+#include "UploadManager.h"
+#include "BindlessHeap.h"
+#include "RecordTable.h"
+#include "FilterGraphExecutor.h"
+#include "CommandCapture.h"
+#include "BundleCache.h"
+#include "IndirectBatch.h"
+#include "DirtyRegion.h"
+#include "CPUImageProc.h"
 
 class BindlessFilter
 {
 public:
+	// Results are double-buffered, so that the filter of the next frame may
+	// overlap the consumption of the current one on another queue.
+	static const uint8_t ResultCount = 2;
+	static const uint32_t BlurRadius = CPUImageProc::BlurRadius;
+	static const uint32_t MaxTiles = 8;		// Dispatches per pass of an incremental update
+
+	// One record per pass and result in the shared record table
+	struct ResourceIndices
+	{
+		uint32_t TexIn = 0;
+		uint32_t TexOut = TexIn + 1;
+		uint32_t SmpLinear = 0;
+	};
+
 	BindlessFilter();
 	virtual ~BindlessFilter();
 
-	bool Init(XUSG::CommandList* pCommandList, const XUSG::DescriptorTableLib::sptr& descriptorTableLib,
-		std::vector<XUSG::Resource::uptr>& uploaders, XUSG::Format rtFormat, const char* fileName);
-
-	void Process(XUSG::CommandList* pCommandList);
+	// Uploads are only staged; the caller submits them on the upload manager. Instances may
+	// share one record table, whose address windows are bound at each dispatch. The filter
+	// runs numPasses times in a chain, whose intermediates alias in one heap.
+	bool Init(const XUSG::Device* pDevice, const XUSG::DescriptorTableLib::sptr& descriptorTableLib,
+		const std::shared_ptr<BindlessHeap>& bindlessHeap, const std::shared_ptr<RecordTable>& recordTable,
+		UploadManager* pUploadManager, XUSG::Format rtFormat, const char* fileName, uint8_t numPasses = 1);
+
+	// Hot-swaps the source: the image is loaded on a worker thread, and a request made
+	// while a load is in flight replaces any previously queued one.
+	void SetSource(const char* fileName);
+	bool IsSourceReady() const;
+	// Stages the loaded source and its resource indices; pipelines are untouched. The source
+	// texture is reused when the size and format match, so the caller must make the upload
+	// wait for the frames still reading it. Nothing is replaced if the staging ring is full;
+	// the loaded image is kept, and IsSourceReady() holds to retry on a later frame. Replaced
+	// resources are handed over in retiredResources, to be released once those frames are
+	// done, and replaced descriptor slots are recycled after fenceValue, the last of those frames.
+	bool UpdateSource(UploadManager* pUploadManager, std::vector<XUSG::Resource::uptr>& retiredResources,
+		uint64_t fenceValue);
+	// Stages a repaint of a region of the source, with texels in the format of the source,
+	// and marks the region dirty in all results. The caller must make the upload wait for
+	// the frames still reading the region, as told by GetSourceRead().
+	bool UpdateSourceRegion(UploadManager* pUploadManager, const void* pData, uint32_t rowPitch,
+		const DirtyRegion::Rect& rect);
+	// When incremental, a result is only re-filtered over the tiles of groups that the
+	// source changes since it was last processed reach, and keeps the rest; indirect
+	// batches always process whole images. Off by default.
+	void SetIncremental(bool isIncremental);
+	// Each processing of a result consumes its dirty region; recordings that are not executed
+	// restore it.
+	const DirtyRegion& GetDirtyRegion(uint8_t resultIndex) const;
+	void SetDirtyRegion(uint8_t resultIndex, const DirtyRegion& dirtyRegion);
+	// Bounds of the source texels that the last recorded processing reads, i.e. the reach of
+	// the tiles of its first pass. Source changes outside it need not wait for that frame.
+	const DirtyRegion::Rect& GetSourceRead() const;
+
+	// Republishes the indices of relocated descriptor slots through the record table; the next
+	// RecordTable::Update() publishes all of them at once in a new version.
+	bool RelocateSlots(XUSG::DescriptorHeapType type, const std::vector<BindlessHeap::Relocation>& relocations);
+
+	// Creates the result of Process() with a region of interest, of the size of the region,
+	// and its record, allocated on first use; the next RecordTable::Update() publishes the
+	// record. Replaced resources and slots are retired as in UpdateSource().
+	bool CreateRegionResult(uint32_t width, uint32_t height, std::vector<XUSG::Resource::uptr>& retiredResources,
+		uint64_t fenceValue);
+
+	// Transitions are requested from the state tracker of the command list.
+	void Process(XUSG::CommandList* pCommandList, ResourceStateTracker& stateTracker, uint8_t resultIndex = 0);
+	// Filters only the groups covering a region of interest, clipped to the image and to the
+	// region result, into the region result from its origin. Earlier passes only cover what
+	// the next one reads. The dirty regions of the results are left alone.
+	void Process(XUSG::CommandList* pCommandList, ResourceStateTracker& stateTracker, const DirtyRegion::Rect& roi);
+	// Reads the region result back; the read-back buffer is created on first use.
+	bool ReadBackRegion(XUSG::CommandList* pCommandList, ResourceStateTracker& stateTracker,
+		XUSG::Buffer* pReadBuffer, uint32_t& rowPitch);
+	// Records instances sharing a record table back to back: the pipeline and the address
+	// windows are bound once, and only the record address changes per dispatch. Instances
+	// must have the same number of passes, which advance in lockstep. With a bundle cache,
+	// the dispatches of each step go through the bundle at bundleSlot + step, which is
+	// re-recorded only when the pipeline, the windows, the records or the sizes change;
+	// the barriers stay on the command list, which also records the dispatches if the bundle
+	// fails. Only direct command lists execute bundles.
+	// With an indirect batch, the dispatch arguments of all steps are built on the GPU from
+	// the records first, and each step is one indirect execution; bundles are not used then.
+	static void ProcessBatch(XUSG::CommandList* pCommandList, ResourceStateTracker& stateTracker,
+		BindlessFilter* const* ppFilters, uint32_t numFilters, uint8_t resultIndex = 0,
+		BundleCache* pBundleCache = nullptr, uint32_t bundleSlot = 0,
+		const IndirectBatch* pIndirectBatch = nullptr);
+	// Stages the jobs of the instances, one list per result and step, for ProcessBatch().
+	static bool CreateIndirectBatch(IndirectBatch& indirectBatch, BindlessFilter* const* ppFilters,
+		uint32_t numFilters, UploadManager* pUploadManager);
 	void GetImageSize(uint32_t& width, uint32_t& height) const;
+	// Groups dispatched, and groups of full dispatches, since the last reset
+	void GetDispatchedGroups(uint64_t& numDispatched, uint64_t& numFull, bool reset = true);
 
-	XUSG::Resource* GetResult() const;
+	XUSG::Resource* GetResult(uint8_t resultIndex = 0) const;
+	XUSG::Resource* GetRegionResult() const;
+	const FilterGraphExecutor& GetGraphExecutor() const;
+	// Describes the objects recorded by Process() for capture and replay, named after
+	// the prefix, which tells instances apart.
+	void GetCaptureObjects(std::vector<CommandCapture::Object>& objects, const char* prefix) const;
 
 protected:
 	enum PipelineIndex : uint8_t
 	{
 		IMAGE_PROC,
+		IMAGE_PROC_REGION,
+		DISPATCH_ARGS,
 
 		NUM_PIPELINE
 	};
 
-	struct ResourceIndices
+	struct SourceImage
 	{
-		uint32_t TexIn = 0;
-		uint32_t TexOut = TexIn + 1;
-		uint32_t SmpLinear = 0;
+		std::shared_ptr<uint8_t> Data;
+		uint32_t Width;
+		uint32_t Height;
+		uint8_t Channels;
 	};
 
 	bool createPipelineLayouts();
 	bool createPipelines(XUSG::Format rtFormat);
-	bool createDescriptorTables(XUSG::CommandList* pCommandList, std::vector<XUSG::Resource::uptr>& uploaders);
+	bool createSource(XUSG::Texture::uptr& source, const SourceImage& image) const;
+	bool createResults();
+	void setImageSize(uint32_t width, uint32_t height);
+	bool createGraph(std::vector<XUSG::Resource::uptr>& retiredResources, uint64_t fenceValue);
+	bool createDescriptorTables();
+	void createSourceDescriptor(uint64_t fenceValue);
+	void createResultDescriptors(uint64_t fenceValue);
+	bool updateResourceIndices();
+	void writeRecords();
+	void updatePassTiles(uint8_t resultIndex, bool isFull);
+	void setPassTiles(const DirtyRegion& region, uint32_t radius);
+	void setPipeline(XUSG::CommandList* pCommandList, PipelineIndex pipeline) const;
+
+	static bool loadImage(SourceImage& image, const char* fileName);
+
+	const XUSG::Device*					m_pDevice;
 
 	XUSG::ShaderLib::uptr				m_shaderLib;
 	XUSG::Graphics::PipelineLib::uptr	m_graphicsPipelineLib;
 	XUSG::Compute::PipelineLib::uptr	m_computePipelineLib;
 	XUSG::PipelineLayoutLib::uptr		m_pipelineLayoutLib;
 	XUSG::DescriptorTableLib::sptr		m_descriptorTableLib;
+	std::shared_ptr<BindlessHeap>		m_bindlessHeap;
 
 	XUSG::PipelineLayout	m_pipelineLayouts[NUM_PIPELINE];
 	XUSG::Pipeline			m_pipelines[NUM_PIPELINE];
 
 	XUSG::Texture::uptr					m_source;
-	XUSG::Texture::uptr					m_result;
-
-	XUSG::Buffer::uptr					m_resIndices;
+	XUSG::Texture::uptr					m_results[ResultCount];
+
+	FilterGraphExecutor					m_graphExecutor;
+	FilterGraph::ResourceId				m_sourceId;
+	FilterGraph::ResourceId				m_resultId;
+	std::vector<FilterGraph::ResourceId> m_intermediates;
+	uint8_t								m_numPasses;
+
+	// Records and their resource indices, indexed by resultIndex * m_numPasses + pass
+	std::shared_ptr<RecordTable>		m_recordTable;
+	std::vector<uint32_t>				m_records;
+	std::vector<ResourceIndices>		m_resIndexRecords;
+	BindlessHeap::Handle				m_sourceSlot;
+	BindlessHeap::Handle				m_resultSlots[ResultCount];
+	BindlessHeap::Handle				m_samplerSlot;
+	std::vector<BindlessHeap::Handle>	m_intermediateSlots;	// SRV and UAV per intermediate
+	XUSG::Format						m_rtFormat;
+
+	// Result of the region of interest, written by the last pass through a record of its own
+	XUSG::Texture::uptr					m_regionResult;
+	uint32_t							m_regionRecord;
+	ResourceIndices						m_regionResIndices;
+	BindlessHeap::Handle				m_regionResultSlot;
+
+	std::future<SourceImage>			m_sourceLoad;
+	SourceImage							m_loadedSource;	// Loaded, but not yet staged
+	std::string							m_nextSourceFileName;
 
 	DirectX::XMUINT2					m_imageSize;
 
-	XUSG::ResourceBarrier				m_barriers[2];
-	uint32_t							m_numBarriers;
-
-	uint64_t							m_addressHi;
+	// Source changes since each result was last processed, and the tiles of groups that
+	// each pass dispatches, indexed by pass
+	DirtyRegion							m_dirtyRegions[ResultCount];
+	std::vector<std::vector<DirtyRegion::Rect>> m_passTiles;
+	DirtyRegion::Rect					m_sourceRead;
+	uint64_t							m_numDispatchedGroups;
+	uint64_t							m_numFullGroups;
+	bool								m_isIncremental;
 };
@@ -0,0 +1,164 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include "BindlessHeap.h"
+
+using namespace std;
+using namespace XUSG;
+
+BindlessHeap::BindlessHeap() :
+	m_baseTables(),
+	m_baseIndices()
+{
+}
+
+BindlessHeap::~BindlessHeap()
+{
+}
+
+bool BindlessHeap::Init(const Device* pDevice, const DescriptorTableLib::sptr& descriptorTableLib,
+	uint32_t numCbvSrvUavs, uint32_t numSamplers)
+{
+	m_descriptorTableLib = descriptorTableLib;
+
+	XUSG_N_RETURN(m_slotAllocators[CBV_SRV_UAV_HEAP].Init(numCbvSrvUavs), false);
+	XUSG_N_RETURN(m_slotAllocators[SAMPLER_HEAP].Init(numSamplers), false);
+	m_descriptors.assign(numCbvSrvUavs, XUSG_NULL);
+	m_samplerPresets.assign(numSamplers, POINT_CLAMP);
+
+	// Reserve the CBV/SRV/UAV range, filled with a placeholder SRV
+	{
+		m_placeholder = Texture::MakeUnique();
+		XUSG_N_RETURN(m_placeholder->Create(pDevice, 1, 1, Format::R8G8B8A8_UNORM, 1,
+			ResourceFlag::NONE, 1, 1, false, MemoryFlag::NONE, L"BindlessPlaceholder"), false);
+
+		const vector<Descriptor> descriptors(numCbvSrvUavs, m_placeholder->GetSRV());
+		const auto descriptorTable = Util::DescriptorTable::MakeUnique();
+		descriptorTable->SetDescriptors(0, numCbvSrvUavs, descriptors.data());
+		m_baseTables[CBV_SRV_UAV_HEAP] = descriptorTable->CreateCbvSrvUavTable(m_descriptorTableLib.get());
+		XUSG_N_RETURN(m_baseTables[CBV_SRV_UAV_HEAP], false);
+		m_baseIndices[CBV_SRV_UAV_HEAP] = descriptorTable->GetDescriptorTableIndex(m_descriptorTableLib.get(),
+			CBV_SRV_UAV_HEAP, m_baseTables[CBV_SRV_UAV_HEAP]);
+	}
+
+	// Reserve the sampler range
+	{
+		const vector<SamplerPreset> samplers(numSamplers, POINT_CLAMP);
+		const auto descriptorTable = Util::DescriptorTable::MakeUnique();
+		descriptorTable->SetSamplers(0, numSamplers, samplers.data(), m_descriptorTableLib.get());
+		m_baseTables[SAMPLER_HEAP] = descriptorTable->CreateSamplerTable(m_descriptorTableLib.get());
+		XUSG_N_RETURN(m_baseTables[SAMPLER_HEAP], false);
+		m_baseIndices[SAMPLER_HEAP] = descriptorTable->GetDescriptorTableIndex(m_descriptorTableLib.get(),
+			SAMPLER_HEAP, m_baseTables[SAMPLER_HEAP]);
+	}
+
+	return true;
+}
+
+BindlessHeap::Handle BindlessHeap::AllocateCbvSrvUav(const Descriptor& descriptor)
+{
+	auto& slotAllocator = m_slotAllocators[CBV_SRV_UAV_HEAP];
+	const auto handle = slotAllocator.Allocate();
+	if (handle == SlotAllocator::InvalidHandle) return handle;
+
+	// Overwrite the slot in place
+	const auto slot = slotAllocator.GetIndex(handle);
+	m_descriptors[slot] = descriptor;
+	writeCbvSrvUav(slot);
+
+	return handle;
+}
+
+BindlessHeap::Handle BindlessHeap::AllocateSampler(SamplerPreset preset)
+{
+	auto& slotAllocator = m_slotAllocators[SAMPLER_HEAP];
+	const auto handle = slotAllocator.Allocate();
+	if (handle == SlotAllocator::InvalidHandle) return handle;
+
+	// Overwrite the slot in place
+	const auto slot = slotAllocator.GetIndex(handle);
+	m_samplerPresets[slot] = preset;
+	writeSampler(slot);
+
+	return handle;
+}
+
+bool BindlessHeap::Free(DescriptorHeapType type, Handle handle, uint64_t fenceValue)
+{
+	assert(type < NUM_SHADER_VISIBLE_DESCRIPTOR_HEAP);
+
+	return m_slotAllocators[type].Free(handle, fenceValue);
+}
+
+void BindlessHeap::Recycle(uint64_t completedFenceValue)
+{
+	for (auto& slotAllocator : m_slotAllocators) slotAllocator.Recycle(completedFenceValue);
+}
+
+uint32_t BindlessHeap::Compact(DescriptorHeapType type, uint64_t fenceValue, vector<Relocation>& relocations)
+{
+	assert(type < NUM_SHADER_VISIBLE_DESCRIPTOR_HEAP);
+	m_slotAllocators[type].Compact(fenceValue, relocations);
+
+	// Shader-visible heaps are no copy source, so rewrite from the CPU-side descriptors.
+	for (const auto& relocation : relocations)
+	{
+		const auto from = static_cast<uint32_t>(relocation.From);
+		const auto to = static_cast<uint32_t>(relocation.To);
+		if (type == SAMPLER_HEAP)
+		{
+			m_samplerPresets[to] = m_samplerPresets[from];
+			writeSampler(to);
+		}
+		else
+		{
+			m_descriptors[to] = m_descriptors[from];
+			writeCbvSrvUav(to);
+		}
+	}
+
+	return static_cast<uint32_t>(relocations.size());
+}
+
+float BindlessHeap::GetFragmentation(DescriptorHeapType type) const
+{
+	assert(type < NUM_SHADER_VISIBLE_DESCRIPTOR_HEAP);
+
+	return m_slotAllocators[type].GetFragmentation();
+}
+
+uint32_t BindlessHeap::GetIndex(DescriptorHeapType type, Handle handle) const
+{
+	assert(type < NUM_SHADER_VISIBLE_DESCRIPTOR_HEAP);
+	const auto slot = m_slotAllocators[type].GetIndex(handle);
+
+	return slot != UINT32_MAX ? m_baseIndices[type] + slot : UINT32_MAX;
+}
+
+const SlotAllocator& BindlessHeap::GetSlotAllocator(DescriptorHeapType type) const
+{
+	assert(type < NUM_SHADER_VISIBLE_DESCRIPTOR_HEAP);
+
+	return m_slotAllocators[type];
+}
+
+void BindlessHeap::writeCbvSrvUav(uint32_t slot)
+{
+	// The lib copies the descriptor into the reserved table.
+	const auto descriptorTable = Util::DescriptorTable::MakeUnique();
+	descriptorTable->SetDescriptors(0, 1, &m_descriptors[slot]);
+	descriptorTable->CreateCbvSrvUavTable(m_descriptorTableLib.get(), getSlotTable(CBV_SRV_UAV_HEAP, slot));
+}
+
+void BindlessHeap::writeSampler(uint32_t slot)
+{
+	const auto descriptorTable = Util::DescriptorTable::MakeUnique();
+	descriptorTable->SetSamplers(0, 1, &m_samplerPresets[slot], m_descriptorTableLib.get());
+	descriptorTable->CreateSamplerTable(m_descriptorTableLib.get(), getSlotTable(SAMPLER_HEAP, slot));
+}
+
+DescriptorTable BindlessHeap::getSlotTable(DescriptorHeapType type, uint32_t slot) const
+{
+	return m_baseTables[type] + static_cast<uint64_t>(m_descriptorTableLib->GetDescriptorStride(type)) * slot;
+}
@@ -0,0 +1,59 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Core/XUSG.h"
+#include "SlotAllocator.h"
+
+// Freeable bindless descriptor slots in the shader-visible heaps. A contiguous range
+// of each heap is reserved from the descriptor-table lib up front, and its slots are
+// managed by SlotAllocator; descriptors are written in place into the reserved table.
+class BindlessHeap
+{
+public:
+	using Handle = SlotAllocator::Handle;
+	using Relocation = SlotAllocator::Relocation;
+
+	BindlessHeap();
+	virtual ~BindlessHeap();
+
+	bool Init(const XUSG::Device* pDevice, const XUSG::DescriptorTableLib::sptr& descriptorTableLib,
+		uint32_t numCbvSrvUavs, uint32_t numSamplers);
+
+	// Return SlotAllocator::InvalidHandle when the reserved range is exhausted.
+	Handle AllocateCbvSrvUav(const XUSG::Descriptor& descriptor);
+	Handle AllocateSampler(XUSG::SamplerPreset preset);
+
+	// The slot is recycled once fenceValue, the last frame that may read it, has completed.
+	bool Free(XUSG::DescriptorHeapType type, Handle handle, uint64_t fenceValue);
+	void Recycle(uint64_t completedFenceValue);
+
+	// Relocates live descriptors to a dense prefix by rewriting them from their CPU-side
+	// copies. The owners must republish the indices of the moved handles before the next
+	// frame; the vacated slots are recycled after fenceValue, the last frame reading them.
+	uint32_t Compact(XUSG::DescriptorHeapType type, uint64_t fenceValue, std::vector<Relocation>& relocations);
+	float GetFragmentation(XUSG::DescriptorHeapType type) const;
+
+	// Heap index for the shaders; UINT32_MAX for stale handles
+	uint32_t GetIndex(XUSG::DescriptorHeapType type, Handle handle) const;
+	const SlotAllocator& GetSlotAllocator(XUSG::DescriptorHeapType type) const;
+
+protected:
+	void writeCbvSrvUav(uint32_t slot);
+	void writeSampler(uint32_t slot);
+	XUSG::DescriptorTable getSlotTable(XUSG::DescriptorHeapType type, uint32_t slot) const;
+
+	XUSG::DescriptorTableLib::sptr m_descriptorTableLib;
+
+	XUSG::Texture::uptr		m_placeholder;	// Fills the reserved CBV/SRV/UAV range
+
+	SlotAllocator			m_slotAllocators[XUSG::NUM_SHADER_VISIBLE_DESCRIPTOR_HEAP];
+
+	// Sources of the slots, for relocation
+	std::vector<XUSG::Descriptor>		m_descriptors;
+	std::vector<XUSG::SamplerPreset>	m_samplerPresets;
+	XUSG::DescriptorTable	m_baseTables[XUSG::NUM_SHADER_VISIBLE_DESCRIPTOR_HEAP];
+	uint32_t				m_baseIndices[XUSG::NUM_SHADER_VISIBLE_DESCRIPTOR_HEAP];
+};
@@ -0,0 +1,116 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <cassert>
+#include <chrono>
+#include "BundleCache.h"
+
+using namespace std;
+using namespace XUSG;
+
+BundleCache::BundleCache() :
+	m_pDevice(nullptr),
+	m_stats()
+{
+}
+
+BundleCache::~BundleCache()
+{
+}
+
+bool BundleCache::Init(const Device* pDevice, const wchar_t* name)
+{
+	m_pDevice = pDevice;
+	m_name = name ? name : L"Bundle";
+	m_bundles.clear();
+	m_stats = {};
+
+	return true;
+}
+
+bool BundleCache::Execute(CommandList* pCommandList, uint32_t slot, const Key& key, const RecordFunc& record)
+{
+	const auto startTime = chrono::steady_clock::now();
+
+	// Slots are created on first use.
+	if (slot >= m_bundles.size()) m_bundles.resize(slot + 1);
+	auto& bundle = m_bundles[slot];
+	if (!bundle.CommandList) XUSG_N_RETURN(createBundle(bundle, slot), false);
+
+	const auto isReused = bundle.IsValid && bundle.RecordedKey == key;
+	if (!isReused)
+	{
+		// Invalid until recorded completely, so that a failed recording is never reused
+		bundle.IsValid = false;
+
+		// The allocator of the bundle is only referenced by the bundle itself.
+		XUSG_N_RETURN(bundle.CommandAllocator->Reset(), false);
+		XUSG_N_RETURN(bundle.CommandList->Reset(bundle.CommandAllocator.get(), nullptr), false);
+		record(bundle.CommandList.get());
+		XUSG_N_RETURN(bundle.CommandList->Close(), false);
+		bundle.RecordedKey = key;
+		bundle.IsValid = true;
+	}
+
+	pCommandList->ExecuteBundle(bundle.CommandList.get());
+
+	const chrono::duration<double> time = chrono::steady_clock::now() - startTime;
+	if (isReused)
+	{
+		++m_stats.NumReused;
+		m_stats.ReuseTime += time.count();
+	}
+	else
+	{
+		++m_stats.NumRecorded;
+		m_stats.RecordTime += time.count();
+	}
+
+	return true;
+}
+
+void BundleCache::Replay(CommandList* pCommandList, uint32_t slot, const Key& key, const RecordFunc& record)
+{
+	if (Execute(pCommandList, slot, key, record)) return;
+
+	record(pCommandList);
+	++m_stats.NumFailed;
+}
+
+void BundleCache::Invalidate()
+{
+	for (auto& bundle : m_bundles) bundle.IsValid = false;
+}
+
+uint32_t BundleCache::GetFirstSlot(uint8_t frameIndex, uint32_t sequence, uint32_t numSequences, uint32_t numSteps)
+{
+	assert(sequence < numSequences);
+
+	return (frameIndex * numSequences + sequence) * numSteps;
+}
+
+BundleCache::Stats BundleCache::GetStats(bool reset)
+{
+	const auto stats = m_stats;
+	if (reset) m_stats = {};
+
+	return stats;
+}
+
+bool BundleCache::createBundle(Bundle& bundle, uint32_t slot)
+{
+	const auto name = m_name + to_wstring(slot);
+	bundle.CommandAllocator = CommandAllocator::MakeUnique();
+	XUSG_N_RETURN(bundle.CommandAllocator->Create(m_pDevice, CommandListType::BUNDLE,
+		(name + L"Allocator").c_str()), false);
+
+	// Bundles are created open, and recorded at the first execution.
+	bundle.CommandList = CommandList::MakeUnique();
+	XUSG_N_RETURN(bundle.CommandList->Create(m_pDevice, 0, CommandListType::BUNDLE,
+		bundle.CommandAllocator.get(), nullptr, name.c_str()), false);
+	XUSG_N_RETURN(bundle.CommandList->Close(), false);
+	bundle.IsValid = false;
+
+	return true;
+}
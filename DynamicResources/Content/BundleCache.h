@@ -0,0 +1,63 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <functional>
+#include "Core/XUSG.h"
+
+// Bundles of command sequences that repeat from frame to frame. A bundle is identified
+// by a slot, and remembers the key of the inputs it was recorded from; it is only
+// re-recorded when the key changes. The caller must not use a slot again before the
+// GPU is done with the frame that last executed it, e.g. with one set of slots per
+// frame context.
+class BundleCache
+{
+public:
+	struct Stats
+	{
+		uint64_t NumReused;
+		uint64_t NumRecorded;
+		double ReuseTime;	// CPU time spent on executing reused bundles
+		double RecordTime;	// CPU time spent on re-recording and executing bundles
+		uint64_t NumFailed;	// Sequences recorded directly by Replay(), as their bundles failed
+	};
+
+	using Key = std::vector<uint64_t>;
+	using RecordFunc = std::function<void(XUSG::CommandList*)>;
+
+	BundleCache();
+	virtual ~BundleCache();
+
+	bool Init(const XUSG::Device* pDevice, const wchar_t* name = nullptr);
+
+	// Bundles inherit the descriptor heaps of the command list, but neither its pipeline
+	// state nor its pipeline layout, so record must set them.
+	bool Execute(XUSG::CommandList* pCommandList, uint32_t slot, const Key& key, const RecordFunc& record);
+	// Executes the bundle, or records directly into the command list if the bundle fails.
+	void Replay(XUSG::CommandList* pCommandList, uint32_t slot, const Key& key, const RecordFunc& record);
+	void Invalidate();
+
+	// First of the numSteps slots of a sequence, for numSequences sequences per frame context
+	static uint32_t GetFirstSlot(uint8_t frameIndex, uint32_t sequence, uint32_t numSequences, uint32_t numSteps);
+
+	Stats GetStats(bool reset = true);
+
+protected:
+	struct Bundle
+	{
+		XUSG::CommandAllocator::uptr CommandAllocator;
+		XUSG::CommandList::uptr CommandList;
+		Key RecordedKey;
+		bool IsValid;
+	};
+
+	// Creates the allocator and the closed command list of a slot on its first use
+	virtual bool createBundle(Bundle& bundle, uint32_t slot);
+
+	const XUSG::Device*	m_pDevice;
+	std::wstring		m_name;
+	std::vector<Bundle>	m_bundles;
+	Stats				m_stats;
+};
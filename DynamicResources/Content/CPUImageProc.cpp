@@ -0,0 +1,189 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include "CPUImageProc.h"
+#include "stb_image.h"
+
+using namespace std;
+
+CPUImageProc::CPUImageProc() :
+	m_width(0),
+	m_height(0),
+	m_resultWidth(0),
+	m_resultHeight(0)
+{
+}
+
+CPUImageProc::~CPUImageProc()
+{
+}
+
+bool CPUImageProc::Init(const char* fileName)
+{
+	int width, height, channels;
+	if (!stbi_info(fileName, &width, &height, &channels)) return false;
+
+	// Same channel expansion as XUSG::LoadImageFromFile()
+	const auto reqChannels = channels != 3 ? channels : 4;
+	const auto pData = stbi_load(fileName, &width, &height, &channels, reqChannels);
+	if (!pData) return false;
+
+	const auto ret = Init(pData, width, height, static_cast<uint8_t>(reqChannels));
+	stbi_image_free(pData);
+
+	return ret;
+}
+
+bool CPUImageProc::Init(const uint8_t* pData, uint32_t width, uint32_t height, uint8_t comp)
+{
+	if (!pData || !width || !height || comp < 1 || comp > 4) return false;
+
+	m_width = width;
+	m_height = height;
+	m_resultWidth = width;
+	m_resultHeight = height;
+
+	// Expand to RGBA the way the texture sampler does for narrower formats
+	const auto numPixels = static_cast<size_t>(width) * height;
+	m_source.resize(4 * numPixels);
+	for (size_t i = 0; i < numPixels; ++i)
+	{
+		auto pDst = &m_source[4 * i];
+		const auto pSrc = &pData[comp * i];
+		pDst[0] = pSrc[0] / 255.0f;
+		pDst[1] = comp > 1 ? pSrc[1] / 255.0f : 0.0f;
+		pDst[2] = comp > 2 ? pSrc[2] / 255.0f : 0.0f;
+		pDst[3] = comp > 3 ? pSrc[3] / 255.0f : 1.0f;
+	}
+
+	m_intermediate.resize(m_source.size());
+	m_result.resize(m_source.size());
+
+	return true;
+}
+
+void CPUImageProc::Process(uint32_t radius)
+{
+	Process(0, 0, m_width, m_height, radius);
+}
+
+void CPUImageProc::Process(uint32_t left, uint32_t top, uint32_t width, uint32_t height, uint32_t radius)
+{
+	assert(m_width && m_height);
+	m_weights.resize(2 * radius + 1);
+	GenerateGaussianWeights(m_weights.data(), radius);
+
+	const auto r = static_cast<int>(radius);
+	const auto w = static_cast<int>(m_width);
+	const auto h = static_cast<int>(m_height);
+
+	// Clip the region to the image
+	const auto x0 = static_cast<int>((min)(left, m_width));
+	const auto y0 = static_cast<int>((min)(top, m_height));
+	const auto x1 = static_cast<int>((min)(width, m_width - x0)) + x0;
+	const auto y1 = static_cast<int>((min)(height, m_height - y0)) + y0;
+	m_resultWidth = x1 - x0;
+	m_resultHeight = y1 - y0;
+	m_result.resize(4 * static_cast<size_t>(m_resultWidth) * m_resultHeight);
+
+	// Horizontal filter, over the rows that the vertical filter of the region reads
+	for (auto y = (max)(y0 - r, 0); y < (min)(y1 + r, h); ++y)
+	{
+		const auto pRow = &m_source[4 * static_cast<size_t>(w) * y];
+		for (auto x = x0; x < x1; ++x)
+		{
+			float mu[4] = {};
+			for (auto i = -r; i <= r; ++i)
+			{
+				const auto xi = (min)((max)(x + i, 0), w - 1);
+				const auto wi = m_weights[i + r];
+				for (uint8_t k = 0; k < 4; ++k) mu[k] += pRow[4 * xi + k] * wi;
+			}
+
+			const auto pDst = &m_intermediate[4 * (static_cast<size_t>(w) * y + x)];
+			for (uint8_t k = 0; k < 4; ++k) pDst[k] = mu[k];
+		}
+	}
+
+	// Vertical filter
+	for (auto y = y0; y < y1; ++y)
+	{
+		for (auto x = x0; x < x1; ++x)
+		{
+			float mu[4] = {};
+			for (auto i = -r; i <= r; ++i)
+			{
+				const auto yi = (min)((max)(y + i, 0), h - 1);
+				const auto wi = m_weights[i + r];
+				const auto pSrc = &m_intermediate[4 * (static_cast<size_t>(w) * yi + x)];
+				for (uint8_t k = 0; k < 4; ++k) mu[k] += pSrc[k] * wi;
+			}
+
+			// UNORM conversion with round-to-nearest
+			const auto pDst = &m_result[4 * (static_cast<size_t>(m_resultWidth) * (y - y0) + x - x0)];
+			for (uint8_t k = 0; k < 4; ++k)
+				pDst[k] = static_cast<uint8_t>((min)((max)(mu[k], 0.0f), 1.0f) * 255.0f + 0.5f);
+		}
+	}
+}
+
+void CPUImageProc::GetImageSize(uint32_t& width, uint32_t& height) const
+{
+	width = m_width;
+	height = m_height;
+}
+
+void CPUImageProc::GetResultSize(uint32_t& width, uint32_t& height) const
+{
+	width = m_resultWidth;
+	height = m_resultHeight;
+}
+
+const uint8_t* CPUImageProc::GetResult() const
+{
+	return m_result.data();
+}
+
+float CPUImageProc::GaussianSigmaFromRadius(float r)
+{
+	// Must match GaussianSigmaFromRadius() in CSImageProc.hlsl
+	return (r + 1.0f) / 3.0f;
+}
+
+void CPUImageProc::GenerateGaussianWeights(float* pWeights, uint32_t radius)
+{
+	const auto sigma = GaussianSigmaFromRadius(static_cast<float>(radius));
+	const auto r = static_cast<int>(radius);
+
+	auto ws = 0.0f;
+	for (auto i = -r; i <= r; ++i)
+	{
+		const auto a = i / sigma;
+		const auto w = exp(-0.5f * a * a);
+		pWeights[i + r] = w;
+		ws += w;
+	}
+
+	// Normalize, so that the filter only needs multiply-adds
+	for (auto i = 0; i <= 2 * r; ++i) pWeights[i] /= ws;
+}
+
+void CPUImageProc::Repack(uint8_t* pDst, const uint8_t* pSrc, uint32_t w, uint32_t h,
+	uint32_t rowPitch, uint8_t comp)
+{
+	assert(comp >= 1 && comp <= 4);
+	const auto sw = rowPitch / 4; // Byte to pixel
+	for (auto i = 0u; i < h; ++i)
+		for (auto j = 0u; j < w; ++j)
+		{
+			const auto s = sw * i + j;
+			const auto d = w * i + j;
+			for (uint8_t k = 0; k < comp; ++k)
+				pDst[comp * d + k] = pSrc[4 * s + k];
+		}
+}
@@ -0,0 +1,48 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// CPU reference of CSImageProc.hlsl: a separable Gaussian blur with clamped
+// addressing, written into an RGBA8 result. It is device-free so that it can
+// serve as a baseline for timing and for validating the GPU path.
+class CPUImageProc
+{
+public:
+	CPUImageProc();
+	virtual ~CPUImageProc();
+
+	bool Init(const char* fileName);
+	bool Init(const uint8_t* pData, uint32_t width, uint32_t height, uint8_t comp);
+
+	void Process(uint32_t radius = BlurRadius);
+	// Filters only a region of interest, clipped to the image, into a result of its size;
+	// the texels around it are read as far as the blur reaches.
+	void Process(uint32_t left, uint32_t top, uint32_t width, uint32_t height, uint32_t radius = BlurRadius);
+	void GetImageSize(uint32_t& width, uint32_t& height) const;
+	void GetResultSize(uint32_t& width, uint32_t& height) const;
+
+	const uint8_t* GetResult() const;
+
+	static float GaussianSigmaFromRadius(float r);
+	static void GenerateGaussianWeights(float* pWeights, uint32_t radius);
+	static void Repack(uint8_t* pDst, const uint8_t* pSrc, uint32_t w, uint32_t h,
+		uint32_t rowPitch, uint8_t comp = 3);
+
+	static const uint32_t BlurRadius = 16;	// BLUR_RADIUS in the shaders
+
+protected:
+	std::vector<float>		m_source;
+	std::vector<float>		m_intermediate;
+	std::vector<float>		m_weights;
+	std::vector<uint8_t>	m_result;
+
+	uint32_t				m_width;
+	uint32_t				m_height;
+	uint32_t				m_resultWidth;
+	uint32_t				m_resultHeight;
+};
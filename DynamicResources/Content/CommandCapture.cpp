@@ -0,0 +1,168 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include "CommandCapture.h"
+
+using namespace std;
+using namespace XUSG;
+
+CommandCapture::CommandCapture()
+{
+}
+
+CommandCapture::~CommandCapture()
+{
+}
+
+bool CommandCapture::AddFrame(uint64_t frame, const RecordingCommandList& commandList,
+	const vector<Object>& objects, const vector<Range>& ranges)
+{
+	XUSG_N_RETURN(commandList.IsClosed(), false);
+
+	CapturedFrame capturedFrame;
+	capturedFrame.Frame = frame;
+	capturedFrame.Stream.assign(commandList.GetStream(), commandList.GetStream() + commandList.GetStreamSize());
+
+	unordered_map<const void*, const ObjectDesc*> objectDescs;
+	for (const auto& object : objects) objectDescs.emplace(object.pObject, &object.Desc);
+
+	const auto numObjects = commandList.GetNumObjects();
+	capturedFrame.Objects.resize(numObjects);
+	for (auto i = 0u; i < numObjects; ++i)
+	{
+		const auto it = objectDescs.find(commandList.GetObject(i));
+		capturedFrame.Objects[i] = it != objectDescs.cend() ? *it->second : GetObjectDesc("", OBJECT_UNKNOWN);
+	}
+
+	for (const auto& range : ranges)
+	{
+		auto desc = range.Desc;
+		desc.DataOffset = capturedFrame.Data.size();
+		if (desc.DataSize > 0)
+		{
+			XUSG_N_RETURN(range.pData, false);
+			capturedFrame.Data.resize(static_cast<size_t>(alignUp(desc.DataOffset + desc.DataSize)));
+			memcpy(&capturedFrame.Data[static_cast<size_t>(desc.DataOffset)], range.pData, static_cast<size_t>(desc.DataSize));
+		}
+		capturedFrame.Ranges.emplace_back(desc);
+	}
+
+	m_frames.emplace_back(move(capturedFrame));
+
+	return true;
+}
+
+bool CommandCapture::Write(const char* fileName) const
+{
+	// Lay out the file: header, frame headers, then the arrays of each frame
+	FileHeader fileHeader = {};
+	fileHeader.Magic = Magic;
+	fileHeader.Version = Version;
+	fileHeader.NumFrames = static_cast<uint32_t>(m_frames.size());
+	fileHeader.FramesOffset = alignUp(sizeof(FileHeader));
+
+	vector<FrameHeader> frameHeaders(m_frames.size());
+	auto offset = alignUp(fileHeader.FramesOffset + sizeof(FrameHeader) * frameHeaders.size());
+	for (size_t i = 0; i < m_frames.size(); ++i)
+	{
+		const auto& frame = m_frames[i];
+		auto& frameHeader = frameHeaders[i];
+		frameHeader.Frame = frame.Frame;
+		frameHeader.NumStreamWords = static_cast<uint32_t>(frame.Stream.size());
+		frameHeader.NumObjects = static_cast<uint32_t>(frame.Objects.size());
+		frameHeader.NumRanges = static_cast<uint32_t>(frame.Ranges.size());
+
+		frameHeader.StreamOffset = offset;
+		offset = alignUp(offset + sizeof(uint32_t) * frame.Stream.size());
+		frameHeader.ObjectsOffset = offset;
+		offset = alignUp(offset + sizeof(ObjectDesc) * frame.Objects.size());
+		frameHeader.RangesOffset = offset;
+		offset = alignUp(offset + sizeof(AddressRange) * frame.Ranges.size());
+		offset += frame.Data.size();
+	}
+	fileHeader.FileSize = offset;
+
+	ofstream file(fileName, ios::out | ios::binary);
+	XUSG_N_RETURN(file, false);
+
+	// Range data offsets are relative to the frame data until written.
+	const char padding[8] = {};
+	const auto pad = [&file, &padding]()
+	{
+		const auto size = static_cast<uint64_t>(file.tellp());
+		file.write(padding, alignUp(size) - size);
+	};
+
+	file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(FileHeader));
+	pad();
+	file.write(reinterpret_cast<const char*>(frameHeaders.data()), sizeof(FrameHeader) * frameHeaders.size());
+	pad();
+	for (size_t i = 0; i < m_frames.size(); ++i)
+	{
+		const auto& frame = m_frames[i];
+		const auto dataOffset = frameHeaders[i].RangesOffset + alignUp(sizeof(AddressRange) * frame.Ranges.size());
+
+		file.write(reinterpret_cast<const char*>(frame.Stream.data()), sizeof(uint32_t) * frame.Stream.size());
+		pad();
+		file.write(reinterpret_cast<const char*>(frame.Objects.data()), sizeof(ObjectDesc) * frame.Objects.size());
+		pad();
+		for (auto range : frame.Ranges)
+		{
+			range.DataOffset += dataOffset;
+			file.write(reinterpret_cast<const char*>(&range), sizeof(AddressRange));
+		}
+		pad();
+		file.write(reinterpret_cast<const char*>(frame.Data.data()), frame.Data.size());
+	}
+
+	XUSG_N_RETURN(file, false);
+	assert(static_cast<uint64_t>(file.tellp()) == fileHeader.FileSize);
+
+	return true;
+}
+
+void CommandCapture::Reset()
+{
+	m_frames.clear();
+}
+
+uint32_t CommandCapture::GetNumFrames() const
+{
+	return static_cast<uint32_t>(m_frames.size());
+}
+
+CommandCapture::ObjectDesc CommandCapture::GetObjectDesc(const char* name, ObjectType type,
+	uint32_t format, uint32_t width, uint32_t height, uint64_t size)
+{
+	ObjectDesc desc = {};
+	memcpy(desc.Name, name, (min)(strlen(name), static_cast<size_t>(MaxNameLength)));
+	desc.Type = type;
+	desc.Format = format;
+	desc.Width = width;
+	desc.Height = height;
+	desc.Size = size;
+
+	return desc;
+}
+
+CommandCapture::AddressRange CommandCapture::GetAddressRange(const char* name, uint64_t base,
+	uint64_t size, uint64_t dataSize)
+{
+	AddressRange range = {};
+	memcpy(range.Name, name, (min)(strlen(name), static_cast<size_t>(MaxNameLength)));
+	range.Base = base;
+	range.Size = size;
+	range.DataSize = dataSize;
+
+	return range;
+}
+
+uint64_t CommandCapture::alignUp(uint64_t offset)
+{
+	return (offset + 7) & ~7ull;
+}
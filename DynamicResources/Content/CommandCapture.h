@@ -0,0 +1,121 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "RecordingCommandList.h"
+
+// Writer of command-stream capture files. A capture holds, per frame, the stream of a
+// recording command list, a description of each object id of the stream, and the address
+// ranges that the stream refers to, such as the record table with its uploaded contents.
+// The file is a flat layout of the structures below, each 8-byte aligned at an offset from
+// the start of the file, so that it is read in place from a mapped view (see
+// CommandCaptureFile). The layout is that of the x64 host.
+class CommandCapture
+{
+public:
+	static const uint32_t Magic = 0x53434452;	// "RDCS"
+	static const uint32_t Version = 1;
+	static const uint32_t MaxNameLength = 47;
+
+	enum ObjectType : uint32_t
+	{
+		OBJECT_UNKNOWN,
+		OBJECT_TEXTURE,
+		OBJECT_BUFFER,
+		OBJECT_PIPELINE,
+		OBJECT_PIPELINE_LAYOUT,
+		OBJECT_DESCRIPTOR_HEAP,
+
+		NUM_OBJECT
+	};
+
+	// Objects are matched by name on replay; Format and sizes are those of textures and buffers.
+	struct ObjectDesc
+	{
+		char Name[MaxNameLength + 1];
+		ObjectType Type;
+		uint32_t Format;
+		uint32_t Width;
+		uint32_t Height;
+		uint64_t Size;
+	};
+
+	// A range of addresses, as found in root constants and root views, with the contents
+	// uploaded to it if DataSize is nonzero
+	struct AddressRange
+	{
+		char Name[MaxNameLength + 1];
+		uint64_t Base;
+		uint64_t Size;
+		uint64_t DataOffset;
+		uint64_t DataSize;
+	};
+
+	struct FileHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t NumFrames;
+		uint32_t Reserved;
+		uint64_t FramesOffset;	// Array of FrameHeader
+		uint64_t FileSize;
+	};
+
+	struct FrameHeader
+	{
+		uint64_t Frame;
+		uint64_t StreamOffset;	// Array of words
+		uint64_t ObjectsOffset;	// Array of ObjectDesc, indexed by object id
+		uint64_t RangesOffset;	// Array of AddressRange
+		uint32_t NumStreamWords;
+		uint32_t NumObjects;
+		uint32_t NumRanges;
+		uint32_t Reserved;
+	};
+
+	// A live object and its description, for capture and replay
+	struct Object
+	{
+		const void* pObject;
+		ObjectDesc Desc;
+	};
+
+	// A live address range and the contents to capture
+	struct Range
+	{
+		AddressRange Desc;
+		const void* pData;
+	};
+
+	CommandCapture();
+	virtual ~CommandCapture();
+
+	// Copies the stream of a closed command list; object ids without a description in
+	// objects are captured as OBJECT_UNKNOWN.
+	bool AddFrame(uint64_t frame, const RecordingCommandList& commandList,
+		const std::vector<Object>& objects, const std::vector<Range>& ranges);
+	bool Write(const char* fileName) const;
+	void Reset();
+
+	uint32_t GetNumFrames() const;
+
+	static ObjectDesc GetObjectDesc(const char* name, ObjectType type, uint32_t format = 0,
+		uint32_t width = 0, uint32_t height = 0, uint64_t size = 0);
+	static AddressRange GetAddressRange(const char* name, uint64_t base, uint64_t size, uint64_t dataSize = 0);
+
+protected:
+	struct CapturedFrame
+	{
+		uint64_t Frame;
+		std::vector<uint32_t> Stream;
+		std::vector<ObjectDesc> Objects;
+		std::vector<AddressRange> Ranges;
+		std::vector<uint8_t> Data;	// Contents of the ranges, each 8-byte aligned
+	};
+
+	static uint64_t alignUp(uint64_t offset);
+
+	std::vector<CapturedFrame> m_frames;
+};
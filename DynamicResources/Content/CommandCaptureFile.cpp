@@ -0,0 +1,142 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include "CommandCaptureFile.h"
+
+using namespace std;
+using namespace XUSG;
+
+CommandCaptureFile::CommandCaptureFile() :
+	m_file(INVALID_HANDLE_VALUE),
+	m_mapping(nullptr),
+	m_pData(nullptr),
+	m_size(0)
+{
+}
+
+CommandCaptureFile::~CommandCaptureFile()
+{
+	Close();
+}
+
+bool CommandCaptureFile::Open(const wchar_t* fileName)
+{
+	Close();
+
+	m_file = CreateFileW(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	XUSG_C_RETURN(m_file == INVALID_HANDLE_VALUE, false);
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(CommandCapture::FileHeader)))
+	{
+		Close();
+
+		return false;
+	}
+
+	m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const auto pView = m_mapping ? MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (!pView || !view(pView, static_cast<uint64_t>(fileSize.QuadPart)))
+	{
+		if (pView) UnmapViewOfFile(pView);
+		Close();
+
+		return false;
+	}
+
+	return true;
+}
+
+bool CommandCaptureFile::Open(const void* pData, uint64_t size)
+{
+	Close();
+
+	return view(pData, size);
+}
+
+void CommandCaptureFile::Close()
+{
+	if (m_pData && m_mapping) UnmapViewOfFile(m_pData);
+	if (m_mapping) CloseHandle(m_mapping);
+	if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+
+	m_file = INVALID_HANDLE_VALUE;
+	m_mapping = nullptr;
+	m_pData = nullptr;
+	m_size = 0;
+}
+
+uint32_t CommandCaptureFile::GetNumFrames() const
+{
+	return m_pData ? reinterpret_cast<const CommandCapture::FileHeader*>(m_pData)->NumFrames : 0;
+}
+
+CommandCaptureFile::Frame CommandCaptureFile::GetFrame(uint32_t i) const
+{
+	assert(i < GetNumFrames());
+	const auto pFileHeader = reinterpret_cast<const CommandCapture::FileHeader*>(m_pData);
+	const auto& frameHeader = reinterpret_cast<const CommandCapture::FrameHeader*>(m_pData + pFileHeader->FramesOffset)[i];
+
+	Frame frame;
+	frame.Frame = frameHeader.Frame;
+	frame.pStream = reinterpret_cast<const uint32_t*>(m_pData + frameHeader.StreamOffset);
+	frame.NumStreamWords = frameHeader.NumStreamWords;
+	frame.pObjects = reinterpret_cast<const CommandCapture::ObjectDesc*>(m_pData + frameHeader.ObjectsOffset);
+	frame.NumObjects = frameHeader.NumObjects;
+	frame.pRanges = reinterpret_cast<const CommandCapture::AddressRange*>(m_pData + frameHeader.RangesOffset);
+	frame.NumRanges = frameHeader.NumRanges;
+	frame.pFileData = m_pData;
+
+	return frame;
+}
+
+const uint8_t* CommandCaptureFile::GetRangeData(const Frame& frame, uint32_t range)
+{
+	assert(range < frame.NumRanges);
+	const auto& addressRange = frame.pRanges[range];
+
+	return addressRange.DataSize > 0 ? frame.pFileData + addressRange.DataOffset : nullptr;
+}
+
+bool CommandCaptureFile::view(const void* pData, uint64_t size)
+{
+	m_pData = static_cast<const uint8_t*>(pData);
+	m_size = size;
+	if (validate()) return true;
+
+	m_pData = nullptr;
+	m_size = 0;
+
+	return false;
+}
+
+bool CommandCaptureFile::validate() const
+{
+	// Every array must be in the file and aligned, so that frames are safe to view in place.
+	XUSG_N_RETURN(m_pData && isInFile(0, sizeof(CommandCapture::FileHeader)), false);
+	const auto pFileHeader = reinterpret_cast<const CommandCapture::FileHeader*>(m_pData);
+	XUSG_C_RETURN(pFileHeader->Magic != CommandCapture::Magic || pFileHeader->Version != CommandCapture::Version, false);
+	XUSG_C_RETURN(pFileHeader->FileSize != m_size, false);
+	XUSG_N_RETURN(isInFile(pFileHeader->FramesOffset, sizeof(CommandCapture::FrameHeader) * pFileHeader->NumFrames), false);
+
+	const auto pFrameHeaders = reinterpret_cast<const CommandCapture::FrameHeader*>(m_pData + pFileHeader->FramesOffset);
+	for (auto i = 0u; i < pFileHeader->NumFrames; ++i)
+	{
+		const auto& frameHeader = pFrameHeaders[i];
+		XUSG_N_RETURN(isInFile(frameHeader.StreamOffset, sizeof(uint32_t) * frameHeader.NumStreamWords), false);
+		XUSG_N_RETURN(isInFile(frameHeader.ObjectsOffset, sizeof(CommandCapture::ObjectDesc) * frameHeader.NumObjects), false);
+		XUSG_N_RETURN(isInFile(frameHeader.RangesOffset, sizeof(CommandCapture::AddressRange) * frameHeader.NumRanges), false);
+
+		const auto pRanges = reinterpret_cast<const CommandCapture::AddressRange*>(m_pData + frameHeader.RangesOffset);
+		for (auto j = 0u; j < frameHeader.NumRanges; ++j)
+			XUSG_C_RETURN(pRanges[j].DataSize > 0 && !isInFile(pRanges[j].DataOffset, pRanges[j].DataSize), false);
+	}
+
+	return true;
+}
+
+bool CommandCaptureFile::isInFile(uint64_t offset, uint64_t size) const
+{
+	return offset % 8 == 0 && offset <= m_size && size <= m_size - offset;
+}
@@ -0,0 +1,49 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CommandCapture.h"
+
+// Reader of command-stream capture files. The file is mapped read-only and validated
+// once; frames are then views into the mapping, without copies.
+class CommandCaptureFile
+{
+public:
+	struct Frame
+	{
+		uint64_t Frame;
+		const uint32_t* pStream;
+		size_t NumStreamWords;
+		const CommandCapture::ObjectDesc* pObjects;	// Indexed by object id
+		uint32_t NumObjects;
+		const CommandCapture::AddressRange* pRanges;
+		uint32_t NumRanges;
+		const uint8_t* pFileData;	// Base of the range data offsets
+	};
+
+	CommandCaptureFile();
+	virtual ~CommandCaptureFile();
+
+	bool Open(const wchar_t* fileName);
+	// Views data mapped or loaded by the caller, which must outlive the reader.
+	bool Open(const void* pData, uint64_t size);
+	void Close();
+
+	uint32_t GetNumFrames() const;
+	Frame GetFrame(uint32_t i) const;
+
+	// Contents uploaded to a range, or nullptr
+	static const uint8_t* GetRangeData(const Frame& frame, uint32_t range);
+
+protected:
+	bool view(const void* pData, uint64_t size);
+	bool validate() const;
+	bool isInFile(uint64_t offset, uint64_t size) const;
+
+	HANDLE			m_file;
+	HANDLE			m_mapping;
+	const uint8_t*	m_pData;
+	uint64_t		m_size;
+};
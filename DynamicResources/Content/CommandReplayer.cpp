@@ -0,0 +1,328 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <cstring>
+#include <unordered_set>
+#include "CommandReplayer.h"
+
+using namespace std;
+using namespace XUSG;
+
+namespace
+{
+	uint64_t read64(const uint32_t* pWords)
+	{
+		return pWords[0] | (static_cast<uint64_t>(pWords[1]) << 32);
+	}
+}
+
+CommandReplayer::CommandReplayer()
+{
+}
+
+CommandReplayer::~CommandReplayer()
+{
+}
+
+bool CommandReplayer::ResolveObjects(const CommandCaptureFile::Frame& frame,
+	const vector<CommandCapture::Object>& objects, vector<const void*>& resolved)
+{
+	const auto nameSize = CommandCapture::MaxNameLength + 1;
+
+	resolved.assign(frame.NumObjects, nullptr);
+	for (auto i = 0u; i < frame.NumObjects; ++i)
+	{
+		const auto& desc = frame.pObjects[i];
+		for (const auto& object : objects)
+		{
+			if (strncmp(object.Desc.Name, desc.Name, nameSize) == 0 && object.Desc.Type == desc.Type &&
+				object.Desc.Format == desc.Format && object.Desc.Width == desc.Width &&
+				object.Desc.Height == desc.Height && object.Desc.Size == desc.Size)
+			{
+				resolved[i] = object.pObject;
+				break;
+			}
+		}
+
+		XUSG_N_RETURN(resolved[i], false);
+	}
+
+	return true;
+}
+
+void CommandReplayer::RequestInitialStates(const CommandCaptureFile::Frame& frame,
+	const vector<const void*>& objects, ResourceStateTracker& stateTracker)
+{
+	const auto barrierWords = RecordingCommandList::BarrierWords;
+
+	unordered_set<uint32_t> seenResources;
+	for (size_t i = 0; i < frame.NumStreamWords;)
+	{
+		const auto opcode = static_cast<RecordingCommandList::Opcode>(frame.pStream[i] & 0xffff);
+		const auto size = frame.pStream[i] >> 16;
+		const auto pPayload = &frame.pStream[i + 1];
+		i += 1 + size;
+
+		if (opcode != RecordingCommandList::OP_BARRIER || size < 1) continue;
+		for (auto j = 0u; j < pPayload[0] && barrierWords * (j + 1) < size; ++j)
+		{
+			const auto pBarrier = &pPayload[1 + barrierWords * j];
+			const auto resource = pBarrier[0];
+			if (pBarrier[5] != RecordingCommandList::InvalidId || resource >= objects.size()) continue;
+			if (seenResources.insert(resource).second)
+				stateTracker.Transition(static_cast<Resource*>(const_cast<void*>(objects[resource])),
+					static_cast<ResourceState>(pBarrier[1]));
+		}
+	}
+}
+
+bool CommandReplayer::Replay(CommandList* pCommandList, const CommandCaptureFile::Frame& frame,
+	const vector<const void*>& objects, const vector<Relocation>& relocations)
+{
+	const auto invalidId = RecordingCommandList::InvalidId;
+	const auto barrierWords = RecordingCommandList::BarrierWords;
+
+	auto isValid = true;
+	const auto getObject = [&objects, &isValid, invalidId](uint32_t id)
+	{
+		if (id == invalidId) return static_cast<void*>(nullptr);
+		if (id >= objects.size() || !objects[id])
+		{
+			isValid = false;
+
+			return static_cast<void*>(nullptr);
+		}
+
+		// Live objects are owned by the caller, which hands them over as const.
+		return const_cast<void*>(objects[id]);
+	};
+
+	const auto getResource = [&getObject](uint32_t id) { return static_cast<Resource*>(getObject(id)); };
+
+	vector<ResourceBarrier> barriers;
+	vector<uint32_t> constants;
+	vector<DescriptorHeap> descriptorHeaps;
+	for (size_t i = 0; i < frame.NumStreamWords && isValid;)
+	{
+		const auto opcode = static_cast<RecordingCommandList::Opcode>(frame.pStream[i] & 0xffff);
+		const auto size = frame.pStream[i] >> 16;
+		const auto pPayload = &frame.pStream[i + 1];
+		XUSG_C_RETURN(size > frame.NumStreamWords - i - 1, false);
+		i += 1 + size;
+
+		switch (opcode)
+		{
+		case RecordingCommandList::OP_DISPATCH:
+			XUSG_C_RETURN(size < 3, false);
+			pCommandList->Dispatch(pPayload[0], pPayload[1], pPayload[2]);
+			break;
+		case RecordingCommandList::OP_COPY_BUFFER_REGION:
+			XUSG_C_RETURN(size < 8, false);
+			pCommandList->CopyBufferRegion(getResource(pPayload[0]), read64(&pPayload[1]),
+				getResource(pPayload[3]), read64(&pPayload[4]), read64(&pPayload[6]));
+			break;
+		case RecordingCommandList::OP_COPY_TEXTURE_REGION:
+			XUSG_C_RETURN(size < 7, false);
+			pCommandList->CopyTextureRegion(TextureCopyLocation(getResource(pPayload[0]), pPayload[1]),
+				pPayload[2], pPayload[3], pPayload[4], TextureCopyLocation(getResource(pPayload[5]), pPayload[6]));
+			break;
+		case RecordingCommandList::OP_COPY_RESOURCE:
+			XUSG_C_RETURN(size < 2, false);
+			pCommandList->CopyResource(getResource(pPayload[0]), getResource(pPayload[1]));
+			break;
+		case RecordingCommandList::OP_SET_PIPELINE_STATE:
+			XUSG_C_RETURN(size < 1, false);
+			pCommandList->SetPipelineState(getObject(pPayload[0]));
+			break;
+		case RecordingCommandList::OP_BARRIER:
+		{
+			XUSG_C_RETURN(size < 1 || size != 1 + static_cast<uint64_t>(barrierWords) * pPayload[0], false);
+			const auto pNativeCommandList = static_cast<ID3D12GraphicsCommandList*>(pCommandList->GetHandle());
+
+			// Request the transitions from the resources, as the state tracker does, so that
+			// XUSG follows the replayed states.
+			barriers.resize(pPayload[0]);
+			auto numBarriers = 0u;
+			for (auto j = 0u; j < pPayload[0]; ++j)
+			{
+				const auto pBarrier = &pPayload[1 + barrierWords * j];
+				if (pBarrier[5] != invalidId && pNativeCommandList)
+				{
+					D3D12_RESOURCE_BARRIER barrier = {};
+					barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+					const auto pBefore = getResource(pBarrier[0]);
+					barrier.Aliasing.pResourceBefore = pBefore ? static_cast<ID3D12Resource*>(pBefore->GetHandle()) : nullptr;
+					barrier.Aliasing.pResourceAfter = static_cast<ID3D12Resource*>(getResource(pBarrier[5])->GetHandle());
+					pNativeCommandList->ResourceBarrier(1, &barrier);
+				}
+				else if (pBarrier[5] != invalidId)
+				{
+					barriers[numBarriers++] = { getResource(pBarrier[0]), ResourceState::COMMON, ResourceState::COMMON,
+						XUSG_BARRIER_ALL_SUBRESOURCES, BarrierFlag::NONE, getResource(pBarrier[5]) };
+				}
+				else
+				{
+					const auto pResource = getResource(pBarrier[0]);
+					XUSG_N_RETURN(pResource, false);
+					numBarriers = pResource->SetBarrier(barriers.data(), static_cast<ResourceState>(pBarrier[2]), numBarriers,
+						pBarrier[3], static_cast<BarrierFlag>(pBarrier[4]), static_cast<ResourceState>(pBarrier[1]));
+				}
+			}
+
+			if (numBarriers > 0) pCommandList->Barrier(numBarriers, barriers.data());
+			break;
+		}
+		case RecordingCommandList::OP_SET_DESCRIPTOR_HEAPS:
+			XUSG_C_RETURN(size < 1 || size != 1 + static_cast<uint64_t>(pPayload[0]), false);
+			descriptorHeaps.resize(pPayload[0]);
+			for (auto j = 0u; j < pPayload[0]; ++j) descriptorHeaps[j] = getObject(pPayload[1 + j]);
+			pCommandList->SetDescriptorHeaps(pPayload[0], descriptorHeaps.data());
+			break;
+		case RecordingCommandList::OP_SET_COMPUTE_PIPELINE_LAYOUT:
+			XUSG_C_RETURN(size < 1, false);
+			pCommandList->SetComputePipelineLayout(getObject(pPayload[0]));
+			break;
+		case RecordingCommandList::OP_SET_GRAPHICS_PIPELINE_LAYOUT:
+			XUSG_C_RETURN(size < 1, false);
+			pCommandList->SetGraphicsPipelineLayout(getObject(pPayload[0]));
+			break;
+		case RecordingCommandList::OP_SET_COMPUTE_DESCRIPTOR_TABLE:
+		case RecordingCommandList::OP_SET_GRAPHICS_DESCRIPTOR_TABLE:
+		{
+			XUSG_C_RETURN(size < 4, false);
+			const auto isCompute = opcode == RecordingCommandList::OP_SET_COMPUTE_DESCRIPTOR_TABLE;
+			auto value = read64(&pPayload[2]);
+			if (pPayload[1] != invalidId)
+			{
+				const DescriptorHeap descriptorHeap = getObject(pPayload[1]);
+				const auto offset = static_cast<int32_t>(value);
+				if (isCompute) pCommandList->SetComputeDescriptorTable(pPayload[0], descriptorHeap, offset);
+				else pCommandList->SetGraphicsDescriptorTable(pPayload[0], descriptorHeap, offset);
+			}
+			else
+			{
+				XUSG_N_RETURN(relocate(value, relocations), false);
+				if (isCompute) pCommandList->SetComputeDescriptorTable(pPayload[0], value);
+				else pCommandList->SetGraphicsDescriptorTable(pPayload[0], value);
+			}
+			break;
+		}
+		case RecordingCommandList::OP_SET_COMPUTE_32BIT_CONSTANTS:
+		case RecordingCommandList::OP_SET_GRAPHICS_32BIT_CONSTANTS:
+		{
+			XUSG_C_RETURN(size < 3 || size != 3 + static_cast<uint64_t>(pPayload[2]), false);
+			const auto num32BitValues = pPayload[2];
+			constants.assign(&pPayload[3], &pPayload[3] + num32BitValues);
+
+			// Pairs of words aligned to 64 bits that fall in a captured range are addresses.
+			for (auto j = pPayload[1] % 2; j + 1 < num32BitValues; j += 2)
+			{
+				auto value = read64(&constants[j]);
+				if (isInRange(value, relocations) && relocate(value, relocations))
+				{
+					constants[j] = static_cast<uint32_t>(value);
+					constants[j + 1] = static_cast<uint32_t>(value >> 32);
+				}
+			}
+
+			if (opcode == RecordingCommandList::OP_SET_COMPUTE_32BIT_CONSTANTS)
+				pCommandList->SetCompute32BitConstants(pPayload[0], num32BitValues, constants.data(), pPayload[1]);
+			else pCommandList->SetGraphics32BitConstants(pPayload[0], num32BitValues, constants.data(), pPayload[1]);
+			break;
+		}
+		case RecordingCommandList::OP_SET_COMPUTE_ROOT_CBV:
+		case RecordingCommandList::OP_SET_COMPUTE_ROOT_SRV:
+		case RecordingCommandList::OP_SET_COMPUTE_ROOT_UAV:
+		{
+			XUSG_C_RETURN(size < 4, false);
+			auto value = read64(&pPayload[2]);
+			const auto pResource = getResource(pPayload[1]);
+			if (!pResource) XUSG_N_RETURN(relocate(value, relocations), false);
+
+			if (opcode == RecordingCommandList::OP_SET_COMPUTE_ROOT_CBV)
+			{
+				if (pResource) pCommandList->SetComputeRootConstantBufferView(pPayload[0], pResource, static_cast<int32_t>(value));
+				else pCommandList->SetComputeRootConstantBufferView(pPayload[0], value);
+			}
+			else if (opcode == RecordingCommandList::OP_SET_COMPUTE_ROOT_SRV)
+			{
+				if (pResource) pCommandList->SetComputeRootShaderResourceView(pPayload[0], pResource, static_cast<int32_t>(value));
+				else pCommandList->SetComputeRootShaderResourceView(pPayload[0], value);
+			}
+			else
+			{
+				if (pResource) pCommandList->SetComputeRootUnorderedAccessView(pPayload[0], pResource, static_cast<int32_t>(value));
+				else pCommandList->SetComputeRootUnorderedAccessView(pPayload[0], value);
+			}
+			break;
+		}
+		case RecordingCommandList::OP_SET_MARKER:
+		case RecordingCommandList::OP_BEGIN_EVENT:
+		case RecordingCommandList::OP_END_EVENT:
+			// Marker contents are not captured.
+			break;
+		default:
+			return false;
+		}
+	}
+
+	return isValid;
+}
+
+bool CommandReplayer::ReplayOnCPU(const CommandCaptureFile::Frame& frame, uint32_t radius)
+{
+	for (size_t i = 0; i < frame.NumStreamWords;)
+	{
+		const auto opcode = static_cast<RecordingCommandList::Opcode>(frame.pStream[i] & 0xffff);
+		const auto size = frame.pStream[i] >> 16;
+		const auto pPayload = &frame.pStream[i + 1];
+		XUSG_C_RETURN(size > frame.NumStreamWords - i - 1, false);
+		i += 1 + size;
+
+		if (opcode != RecordingCommandList::OP_DISPATCH) continue;
+		XUSG_C_RETURN(size < 3, false);
+
+		// One image per extent, kept across replays
+		const auto width = 8 * pPayload[0];
+		const auto height = 8 * pPayload[1];
+		CPUImageProc* pImageProc = nullptr;
+		for (const auto& target : m_cpuTargets)
+			if (target.Width == width && target.Height == height) pImageProc = target.ImageProc.get();
+
+		if (!pImageProc)
+		{
+			const vector<uint8_t> image(4ull * width * height);
+			m_cpuTargets.push_back({ width, height, make_unique<CPUImageProc>() });
+			pImageProc = m_cpuTargets.back().ImageProc.get();
+			XUSG_N_RETURN(pImageProc->Init(image.data(), width, height, 4), false);
+		}
+
+		for (auto z = 0u; z < pPayload[2]; ++z) pImageProc->Process(radius);
+	}
+
+	return true;
+}
+
+bool CommandReplayer::relocate(uint64_t& address, const vector<Relocation>& relocations)
+{
+	for (const auto& relocation : relocations)
+	{
+		if (address >= relocation.Base && address - relocation.Base < relocation.Size)
+		{
+			address = relocation.NewBase + (address - relocation.Base);
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool CommandReplayer::isInRange(uint64_t address, const vector<Relocation>& relocations)
+{
+	for (const auto& relocation : relocations)
+		if (address >= relocation.Base && address - relocation.Base < relocation.Size) return true;
+
+	return false;
+}
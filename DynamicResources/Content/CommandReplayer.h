@@ -0,0 +1,56 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <memory>
+#include "CommandCaptureFile.h"
+#include "CPUImageProc.h"
+#include "ResourceStateTracker.h"
+
+// Re-issues captured frames, against a command list of a real device, or against the CPU
+// reference for timing comparisons. Object ids are resolved by name to live objects, and
+// addresses in root views and 64-bit root constants are rebased from the captured ranges
+// to the live ones, whose contents the caller restores from the capture.
+class CommandReplayer
+{
+public:
+	struct Relocation
+	{
+		uint64_t Base;
+		uint64_t Size;
+		uint64_t NewBase;
+	};
+
+	CommandReplayer();
+	virtual ~CommandReplayer();
+
+	// Fails if an object of the frame has no live object of the same name, type and size.
+	static bool ResolveObjects(const CommandCaptureFile::Frame& frame,
+		const std::vector<CommandCapture::Object>& objects, std::vector<const void*>& resolved);
+	// Requests the state before the first barrier of each resource in the frame, so that the
+	// captured barriers apply.
+	static void RequestInitialStates(const CommandCaptureFile::Frame& frame,
+		const std::vector<const void*>& objects, ResourceStateTracker& stateTracker);
+
+	// Fails on commands that are not replayable, and on unresolved objects or addresses. The
+	// states tracked by XUSG follow the replayed barriers.
+	static bool Replay(XUSG::CommandList* pCommandList, const CommandCaptureFile::Frame& frame,
+		const std::vector<const void*>& objects, const std::vector<Relocation>& relocations);
+	// Each dispatch blurs its extent of 8x8 thread groups once on the CPU.
+	bool ReplayOnCPU(const CommandCaptureFile::Frame& frame, uint32_t radius = CPUImageProc::BlurRadius);
+
+protected:
+	struct CPUTarget
+	{
+		uint32_t Width;
+		uint32_t Height;
+		std::unique_ptr<CPUImageProc> ImageProc;
+	};
+
+	static bool relocate(uint64_t& address, const std::vector<Relocation>& relocations);
+	static bool isInRange(uint64_t address, const std::vector<Relocation>& relocations);
+
+	std::vector<CPUTarget> m_cpuTargets;
+};
@@ -0,0 +1,63 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include "CommandStream.h"
+
+const char* CommandStream::GetOpcodeName(Opcode opcode)
+{
+	static const char* const opcodeNames[] =
+	{
+		"ClearState",
+		"Draw",
+		"DrawIndexed",
+		"Dispatch",
+		"CopyBufferRegion",
+		"CopyTextureRegion",
+		"CopyResource",
+		"CopyTiles",
+		"ResolveSubresource",
+		"IASetPrimitiveTopology",
+		"RSSetViewports",
+		"RSSetScissorRects",
+		"OMSetBlendFactor",
+		"OMSetStencilRef",
+		"SetPipelineState",
+		"Barrier",
+		"ExecuteBundle",
+		"SetDescriptorHeaps",
+		"SetComputePipelineLayout",
+		"SetGraphicsPipelineLayout",
+		"SetComputeDescriptorTable",
+		"SetGraphicsDescriptorTable",
+		"SetCompute32BitConstants",
+		"SetGraphics32BitConstants",
+		"SetComputeRootConstantBufferView",
+		"SetGraphicsRootConstantBufferView",
+		"SetComputeRootShaderResourceView",
+		"SetGraphicsRootShaderResourceView",
+		"SetComputeRootUnorderedAccessView",
+		"SetGraphicsRootUnorderedAccessView",
+		"IASetIndexBuffer",
+		"IASetVertexBuffers",
+		"SOSetTargets",
+		"OMSetFramebuffer",
+		"OMSetRenderTargets",
+		"ClearDepthStencilView",
+		"ClearRenderTargetView",
+		"ClearUnorderedAccessViewUint",
+		"ClearUnorderedAccessViewFloat",
+		"DiscardResource",
+		"BeginQuery",
+		"EndQuery",
+		"ResolveQueryData",
+		"SetPredication",
+		"SetMarker",
+		"BeginEvent",
+		"EndEvent",
+		"ExecuteIndirect"
+	};
+	static_assert(sizeof(opcodeNames) / sizeof(opcodeNames[0]) == NUM_OPCODE, "Missing opcode names");
+
+	return opcode < NUM_OPCODE ? opcodeNames[opcode] : "Unknown";
+}
@@ -0,0 +1,76 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+
+// Format of the streams recorded by RecordingCommandList, free of XUSG, so that the streams
+// can be analyzed anywhere. The stream is a sequence of 32-bit words; each command is a
+// header word, the opcode in the low 16 bits and the number of payload words in the high
+// 16 bits, followed by its payload. Resources and other API objects are encoded as dense ids
+// in order of first use, nullptr as InvalidId; 64-bit values take two words, low first.
+class CommandStream
+{
+public:
+	enum Opcode : uint16_t
+	{
+		OP_CLEAR_STATE,
+		OP_DRAW,					// Vertices, instances, start vertex, start instance
+		OP_DRAW_INDEXED,			// Indices, instances, start index, base vertex, start instance
+		OP_DISPATCH,				// Thread-group counts X, Y, Z
+		OP_COPY_BUFFER_REGION,		// Dst, dst offset (2), src, src offset (2), size (2)
+		OP_COPY_TEXTURE_REGION,		// Dst, dst subresource, X, Y, Z, src, src subresource
+		OP_COPY_RESOURCE,			// Dst, src
+		OP_COPY_TILES,				// Tiled resource, buffer, buffer offset (2), flags
+		OP_RESOLVE_SUBRESOURCE,		// Dst, dst subresource, src, src subresource, format
+		OP_SET_PRIMITIVE_TOPOLOGY,	// Topology
+		OP_SET_VIEWPORTS,			// Count
+		OP_SET_SCISSOR_RECTS,		// Count
+		OP_SET_BLEND_FACTOR,		// RGBA bits
+		OP_SET_STENCIL_REF,			// Reference
+		OP_SET_PIPELINE_STATE,		// Pipeline
+		OP_BARRIER,					// Count, then BarrierWords per barrier
+		OP_EXECUTE_BUNDLE,			// Bundle
+		OP_SET_DESCRIPTOR_HEAPS,	// Count, then heaps
+		OP_SET_COMPUTE_PIPELINE_LAYOUT,		// Layout
+		OP_SET_GRAPHICS_PIPELINE_LAYOUT,	// Layout
+		OP_SET_COMPUTE_DESCRIPTOR_TABLE,	// Index, heap or InvalidId, table or offset (2)
+		OP_SET_GRAPHICS_DESCRIPTOR_TABLE,	// Index, heap or InvalidId, table or offset (2)
+		OP_SET_COMPUTE_32BIT_CONSTANTS,		// Index, dst offset, count, then values
+		OP_SET_GRAPHICS_32BIT_CONSTANTS,	// Index, dst offset, count, then values
+		OP_SET_COMPUTE_ROOT_CBV,	// Index, resource or InvalidId, offset or address (2)
+		OP_SET_GRAPHICS_ROOT_CBV,	// Index, resource or InvalidId, offset or address (2)
+		OP_SET_COMPUTE_ROOT_SRV,	// Index, resource or InvalidId, offset or address (2)
+		OP_SET_GRAPHICS_ROOT_SRV,	// Index, resource or InvalidId, offset or address (2)
+		OP_SET_COMPUTE_ROOT_UAV,	// Index, resource or InvalidId, offset or address (2)
+		OP_SET_GRAPHICS_ROOT_UAV,	// Index, resource or InvalidId, offset or address (2)
+		OP_SET_INDEX_BUFFER,
+		OP_SET_VERTEX_BUFFERS,		// Start slot, count
+		OP_SET_STREAM_OUT_TARGETS,	// Start slot, count
+		OP_SET_FRAMEBUFFER,
+		OP_SET_RENDER_TARGETS,		// Count
+		OP_CLEAR_DEPTH_STENCIL,		// Flags, depth bits, stencil
+		OP_CLEAR_RENDER_TARGET,		// RGBA bits
+		OP_CLEAR_UAV_UINT,			// Resource, values (4)
+		OP_CLEAR_UAV_FLOAT,			// Resource, value bits (4)
+		OP_DISCARD_RESOURCE,		// Resource, first subresource, count
+		OP_BEGIN_QUERY,				// Heap, type, index
+		OP_END_QUERY,				// Heap, type, index
+		OP_RESOLVE_QUERY_DATA,		// Heap, type, start, count, dst, dst offset (2)
+		OP_SET_PREDICATION,			// Buffer or InvalidId, offset (2), equal to zero
+		OP_SET_MARKER,				// Metadata, size in bytes
+		OP_BEGIN_EVENT,				// Metadata, size in bytes
+		OP_END_EVENT,
+		OP_EXECUTE_INDIRECT,		// Layout, max count, args, args offset (2), count, count offset (2)
+
+		NUM_OPCODE
+	};
+
+	// Resource, state before, state after, subresource, flags, resource after or InvalidId
+	static const uint32_t BarrierWords = 6;
+	static const uint32_t InvalidId = UINT32_MAX;
+
+	static const char* GetOpcodeName(Opcode opcode);
+};
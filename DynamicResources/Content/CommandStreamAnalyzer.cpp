@@ -0,0 +1,269 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include "CommandStreamAnalyzer.h"
+
+using namespace std;
+
+CommandStreamAnalyzer::CommandStreamAnalyzer()
+{
+}
+
+CommandStreamAnalyzer::~CommandStreamAnalyzer()
+{
+}
+
+bool CommandStreamAnalyzer::Analyze(const uint32_t* pStream, size_t numWords, Stats& stats)
+{
+	enum Kind : uint8_t
+	{
+		COMPUTE,
+		GRAPHICS,
+
+		NUM_KIND
+	};
+
+	const auto invalidId = CommandStream::InvalidId;
+	const auto barrierWords = CommandStream::BarrierWords;
+
+	stats = {};
+	stats.NumWords = static_cast<uint32_t>(numWords);
+
+	auto pipeline = invalidId;
+	uint32_t layouts[NUM_KIND] = { invalidId, invalidId };
+	vector<uint32_t> descriptorHeaps;
+	vector<RootParameter> rootParameters[NUM_KIND];
+	auto numRootParameterSets = 0u;
+	auto isAfterBarrier = false;
+
+	// Dispatches, draws, copies and bundles separate the barrier batches and root-parameter sets.
+	const auto work = [&]()
+	{
+		stats.MaxRootParameterSetsPerWork = (max)(stats.MaxRootParameterSetsPerWork, numRootParameterSets);
+		numRootParameterSets = 0;
+		isAfterBarrier = false;
+	};
+
+	const auto setRoot = [&](Kind kind, uint32_t index, const uint32_t* pValues, uint32_t numValues, uint32_t offset)
+	{
+		// A root signature holds at most 64 words.
+		if (index >= 64 || offset + static_cast<uint64_t>(numValues) > 64) return false;
+		++stats.NumRootParameterSets;
+		++numRootParameterSets;
+		if (setRootParameter(rootParameters[kind], index, pValues, numValues, offset))
+			++stats.NumRedundantRootParameters;
+
+		return true;
+	};
+
+	for (size_t i = 0; i < numWords;)
+	{
+		const auto opcode = static_cast<CommandStream::Opcode>(pStream[i] & 0xffff);
+		const auto size = pStream[i] >> 16;
+		const auto pPayload = &pStream[i + 1];
+		if (opcode >= CommandStream::NUM_OPCODE || size > numWords - i - 1) return false;
+		i += 1 + size;
+
+		++stats.NumCommands;
+		++stats.NumOpcodes[opcode];
+
+		switch (opcode)
+		{
+		case CommandStream::OP_CLEAR_STATE:
+			pipeline = invalidId;
+			for (auto& layout : layouts) layout = invalidId;
+			for (auto& parameters : rootParameters) parameters.clear();
+			break;
+		case CommandStream::OP_DISPATCH:
+			if (size < 3) return false;
+			++stats.NumDispatches;
+			stats.NumThreadGroups += static_cast<uint64_t>(pPayload[0]) * pPayload[1] * pPayload[2];
+			work();
+			break;
+		case CommandStream::OP_DRAW:
+		case CommandStream::OP_DRAW_INDEXED:
+			++stats.NumDraws;
+			work();
+			break;
+		case CommandStream::OP_EXECUTE_INDIRECT:
+			++stats.NumIndirectExecutions;
+			work();
+			break;
+		case CommandStream::OP_COPY_BUFFER_REGION:
+		case CommandStream::OP_COPY_TEXTURE_REGION:
+		case CommandStream::OP_COPY_RESOURCE:
+		case CommandStream::OP_COPY_TILES:
+		case CommandStream::OP_RESOLVE_SUBRESOURCE:
+			++stats.NumCopies;
+			work();
+			break;
+		case CommandStream::OP_EXECUTE_BUNDLE:
+			work();
+			break;
+		case CommandStream::OP_BARRIER:
+		{
+			if (size < 1 || size != 1 + static_cast<uint64_t>(barrierWords) * pPayload[0]) return false;
+			const auto numBarriers = pPayload[0];
+			++stats.NumBarrierBatches;
+			if (isAfterBarrier) ++stats.NumUnbatchedBarriers;
+			isAfterBarrier = true;
+
+			stats.NumBarriers += numBarriers;
+			for (auto j = 0u; j < numBarriers; ++j)
+			{
+				const auto pBarrier = &pPayload[1 + barrierWords * j];
+				if (pBarrier[5] != invalidId) ++stats.NumAliasingBarriers;
+				else if (pBarrier[4] != 0) ++stats.NumSplitBarriers;	// Begin- or end-only flags
+				else if (pBarrier[1] == pBarrier[2]) ++stats.NumUAVBarriers;
+				else ++stats.NumTransitions;
+			}
+			break;
+		}
+		case CommandStream::OP_SET_PIPELINE_STATE:
+			if (size < 1) return false;
+			if (pPayload[0] == pipeline) ++stats.NumRedundantPipelines;
+			else
+			{
+				++stats.NumPipelineChanges;
+				pipeline = pPayload[0];
+			}
+			break;
+		case CommandStream::OP_SET_COMPUTE_PIPELINE_LAYOUT:
+		case CommandStream::OP_SET_GRAPHICS_PIPELINE_LAYOUT:
+		{
+			if (size < 1) return false;
+			const auto kind = opcode == CommandStream::OP_SET_COMPUTE_PIPELINE_LAYOUT ? COMPUTE : GRAPHICS;
+
+			// Setting the bound layout again keeps the root parameters.
+			if (pPayload[0] == layouts[kind]) ++stats.NumRedundantLayouts;
+			else
+			{
+				++stats.NumLayoutChanges;
+				layouts[kind] = pPayload[0];
+				rootParameters[kind].clear();
+			}
+			break;
+		}
+		case CommandStream::OP_SET_DESCRIPTOR_HEAPS:
+			if (size < 1 || size != 1 + static_cast<uint64_t>(pPayload[0])) return false;
+			if (equal(descriptorHeaps.cbegin(), descriptorHeaps.cend(), &pPayload[1], &pPayload[size]))
+				++stats.NumRedundantDescriptorHeaps;
+			else
+			{
+				++stats.NumDescriptorHeapChanges;
+				descriptorHeaps.assign(&pPayload[1], &pPayload[size]);
+			}
+			break;
+		case CommandStream::OP_SET_COMPUTE_DESCRIPTOR_TABLE:
+		case CommandStream::OP_SET_COMPUTE_ROOT_CBV:
+		case CommandStream::OP_SET_COMPUTE_ROOT_SRV:
+		case CommandStream::OP_SET_COMPUTE_ROOT_UAV:
+			if (size < 4) return false;
+			if (!setRoot(COMPUTE, pPayload[0], &pPayload[1], 3, 0)) return false;
+			break;
+		case CommandStream::OP_SET_GRAPHICS_DESCRIPTOR_TABLE:
+		case CommandStream::OP_SET_GRAPHICS_ROOT_CBV:
+		case CommandStream::OP_SET_GRAPHICS_ROOT_SRV:
+		case CommandStream::OP_SET_GRAPHICS_ROOT_UAV:
+			if (size < 4) return false;
+			if (!setRoot(GRAPHICS, pPayload[0], &pPayload[1], 3, 0)) return false;
+			break;
+		case CommandStream::OP_SET_COMPUTE_32BIT_CONSTANTS:
+		case CommandStream::OP_SET_GRAPHICS_32BIT_CONSTANTS:
+			if (size < 3 || size != 3 + static_cast<uint64_t>(pPayload[2])) return false;
+			stats.NumRootConstantWords += pPayload[2];
+			if (!setRoot(opcode == CommandStream::OP_SET_COMPUTE_32BIT_CONSTANTS ? COMPUTE : GRAPHICS,
+				pPayload[0], &pPayload[3], pPayload[2], pPayload[1])) return false;
+			break;
+		default:
+			break;
+		}
+	}
+
+	work();
+
+	return true;
+}
+
+vector<CommandStreamAnalyzer::Counter> CommandStreamAnalyzer::GetCounters(const Stats& stats)
+{
+	vector<Counter> counters =
+	{
+		{ "Commands", stats.NumCommands, false },
+		{ "Words", stats.NumWords, false },
+		{ "Dispatches", stats.NumDispatches, false },
+		{ "ThreadGroups", stats.NumThreadGroups, false },
+		{ "Draws", stats.NumDraws, false },
+		{ "IndirectExecutions", stats.NumIndirectExecutions, false },
+		{ "Copies", stats.NumCopies, false },
+		{ "BarrierBatches", stats.NumBarrierBatches, false },
+		{ "Barriers", stats.NumBarriers, false },
+		{ "Transitions", stats.NumTransitions, false },
+		{ "UAVBarriers", stats.NumUAVBarriers, false },
+		{ "SplitBarriers", stats.NumSplitBarriers, false },
+		{ "AliasingBarriers", stats.NumAliasingBarriers, false },
+		{ "UnbatchedBarriers", stats.NumUnbatchedBarriers, false },
+		{ "PipelineChanges", stats.NumPipelineChanges, false },
+		{ "RedundantPipelines", stats.NumRedundantPipelines, false },
+		{ "LayoutChanges", stats.NumLayoutChanges, false },
+		{ "RedundantLayouts", stats.NumRedundantLayouts, false },
+		{ "DescriptorHeapChanges", stats.NumDescriptorHeapChanges, false },
+		{ "RedundantDescriptorHeaps", stats.NumRedundantDescriptorHeaps, false },
+		{ "RootParameterSets", stats.NumRootParameterSets, false },
+		{ "RedundantRootParameters", stats.NumRedundantRootParameters, false },
+		{ "RootConstantWords", stats.NumRootConstantWords, false },
+		{ "MaxRootParameterSetsPerWork", stats.MaxRootParameterSetsPerWork, false }
+	};
+
+	for (uint16_t i = 0; i < CommandStream::NUM_OPCODE; ++i)
+	{
+		const auto opcode = static_cast<CommandStream::Opcode>(i);
+		counters.push_back({ string("Op.") + CommandStream::GetOpcodeName(opcode), stats.NumOpcodes[i], true });
+	}
+
+	return counters;
+}
+
+void CommandStreamAnalyzer::Print(ostream& os, const Stats& stats)
+{
+	for (const auto& counter : GetCounters(stats))
+		if (!counter.IsOpcode || counter.Value > 0) os << counter.Name << ": " << counter.Value << endl;
+}
+
+bool CommandStreamAnalyzer::Compare(ostream& os, const Stats& stats, const Stats& baseline)
+{
+	const auto counters = GetCounters(stats);
+	const auto baselineCounters = GetCounters(baseline);
+
+	auto isPassed = true;
+	for (size_t i = 0; i < counters.size(); ++i)
+	{
+		if (counters[i].Value > baselineCounters[i].Value)
+		{
+			os << counters[i].Name << ": " << counters[i].Value << " > " << baselineCounters[i].Value << endl;
+			isPassed = false;
+		}
+	}
+
+	return isPassed;
+}
+
+bool CommandStreamAnalyzer::setRootParameter(vector<RootParameter>& rootParameters, uint32_t index,
+	const uint32_t* pValues, uint32_t numValues, uint32_t offset)
+{
+	if (index >= rootParameters.size()) rootParameters.resize(index + 1);
+	auto& rootParameter = rootParameters[index];
+	if (offset + numValues > rootParameter.size()) rootParameter.resize(offset + numValues, UINT64_MAX);
+
+	auto isRedundant = true;
+	for (auto i = 0u; i < numValues; ++i)
+	{
+		auto& value = rootParameter[offset + i];
+		if (value != pValues[i]) isRedundant = false;
+		value = pValues[i];
+	}
+
+	return isRedundant;
+}
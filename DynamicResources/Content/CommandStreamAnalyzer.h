@@ -0,0 +1,83 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "CommandStream.h"
+
+// Analysis passes over the stream of a recording command list: command and dispatch
+// counts, barrier counts by kind, state changes of pipelines, layouts and descriptor heaps,
+// and root-parameter churn. A set is redundant if it binds what is already bound; setting
+// a pipeline layout unbinds all root parameters of its kind. The counters are listed in a
+// fixed order, so that a CI job can compare them against those of a baseline. Only the
+// stream format is needed, not XUSG.
+class CommandStreamAnalyzer
+{
+public:
+	struct Stats
+	{
+		uint32_t NumCommands;
+		uint32_t NumWords;
+		uint32_t NumOpcodes[CommandStream::NUM_OPCODE];
+
+		// Work
+		uint32_t NumDispatches;
+		uint64_t NumThreadGroups;
+		uint32_t NumDraws;
+		uint32_t NumIndirectExecutions;
+		uint32_t NumCopies;
+
+		// Barriers
+		uint32_t NumBarrierBatches;
+		uint32_t NumBarriers;
+		uint32_t NumTransitions;
+		uint32_t NumUAVBarriers;
+		uint32_t NumSplitBarriers;		// Counting both halves
+		uint32_t NumAliasingBarriers;
+		uint32_t NumUnbatchedBarriers;	// Batches following another one without work in between
+
+		// State changes
+		uint32_t NumPipelineChanges;
+		uint32_t NumRedundantPipelines;
+		uint32_t NumLayoutChanges;
+		uint32_t NumRedundantLayouts;
+		uint32_t NumDescriptorHeapChanges;
+		uint32_t NumRedundantDescriptorHeaps;
+
+		// Root-parameter churn
+		uint32_t NumRootParameterSets;
+		uint32_t NumRedundantRootParameters;
+		uint32_t NumRootConstantWords;
+		uint32_t MaxRootParameterSetsPerWork;	// Between two dispatches or draws
+	};
+
+	struct Counter
+	{
+		std::string Name;
+		uint64_t Value;
+		bool IsOpcode;
+	};
+
+	CommandStreamAnalyzer();
+	virtual ~CommandStreamAnalyzer();
+
+	// Fails on a malformed stream.
+	static bool Analyze(const uint32_t* pStream, size_t numWords, Stats& stats);
+
+	static std::vector<Counter> GetCounters(const Stats& stats);
+	static void Print(std::ostream& os, const Stats& stats);
+	// Reports the counters that exceed those of the baseline; returns false if any does.
+	static bool Compare(std::ostream& os, const Stats& stats, const Stats& baseline);
+
+protected:
+	// Bound 32-bit values of a root parameter; UINT64_MAX where unbound
+	using RootParameter = std::vector<uint64_t>;
+
+	// Returns true if the set is redundant.
+	static bool setRootParameter(std::vector<RootParameter>& rootParameters, uint32_t index,
+		const uint32_t* pValues, uint32_t numValues, uint32_t offset = 0);
+};
@@ -0,0 +1,148 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include "DescriptorKeyMap.h"
+
+// Read-mostly cache for parallel recording. The shared entries live in immutable
+// per-shard snapshots, which any thread may read without locks. New entries go to
+// the inserting thread's own staging map and are visible to that thread at once;
+// at frame boundaries Merge() folds the staged entries into fresh snapshots of the
+// touched shards and publishes them, RCU style. A replaced snapshot is only freed
+// one Merge() later, so shared values found in one frame stay valid in the next.
+template<typename TKey, typename TValue, uint8_t NumShardBits = 4>
+class ConcurrentKeyCache
+{
+public:
+	static const uint32_t NumShards = 1u << NumShardBits;
+
+	ConcurrentKeyCache() :
+		m_shards(new Shard[NumShards])
+	{
+	}
+
+	virtual ~ConcurrentKeyCache()
+	{
+		for (auto i = 0u; i < NumShards; ++i) delete m_shards[i].Snapshot.load();
+	}
+
+	void Init(uint32_t numThreads)
+	{
+		Clear();
+		m_stagings.resize(numThreads);
+		for (auto& staging : m_stagings) staging = std::make_unique<Staging>();
+	}
+
+	// Thread-safe across distinct thread indices. The returned value is valid until the
+	// second Merge() for shared entries, and until the next Merge() for staged ones.
+	const TValue* Find(uint32_t threadIndex, const TKey& key, uint64_t hash) const
+	{
+		assert(threadIndex < m_stagings.size());
+		const auto pValue = FindShared(key, hash);
+
+		return pValue ? pValue : m_stagings[threadIndex]->Entries.Find(key, hash);
+	}
+
+	// Looks up the shared entries only; thread-safe, and may also overlap Merge(). The returned
+	// value is valid until the second Merge(), or the next one if the call overlaps a Merge().
+	const TValue* FindShared(const TKey& key, uint64_t hash) const
+	{
+		const auto pSnapshot = m_shards[getShardIndex(hash)].Snapshot.load(std::memory_order_acquire);
+
+		return pSnapshot ? pSnapshot->Find(key, hash) : nullptr;
+	}
+
+	// Thread-safe across distinct thread indices; shared by the next Merge().
+	void Insert(uint32_t threadIndex, const TKey& key, uint64_t hash, const TValue& value)
+	{
+		assert(threadIndex < m_stagings.size());
+		m_stagings[threadIndex]->Entries.Insert(key, hash, value);
+	}
+
+	// Must not overlap Find() or Insert(), but may overlap FindShared(); returns the number of newly
+	// shared entries. An entry staged by several threads keeps the value of the lowest thread index.
+	uint32_t Merge()
+	{
+		std::unique_ptr<KeyMap<TKey, TValue>> snapshots[NumShards];
+		auto numMerged = 0u;
+
+		for (auto i = static_cast<uint32_t>(m_stagings.size()); i-- > 0;)
+		{
+			auto& entries = m_stagings[i]->Entries;
+			entries.ForEach([&](const TKey& key, uint64_t hash, const TValue& value)
+			{
+				const auto s = getShardIndex(hash);
+				const auto pSnapshot = m_shards[s].Snapshot.load(std::memory_order_relaxed);
+				if (pSnapshot && pSnapshot->Find(key, hash)) return;
+
+				// Copy on first write to the shard
+				auto& snapshot = snapshots[s];
+				if (!snapshot) snapshot = pSnapshot ? std::make_unique<KeyMap<TKey, TValue>>(*pSnapshot) :
+					std::make_unique<KeyMap<TKey, TValue>>();
+
+				const auto size = snapshot->GetSize();
+				snapshot->Insert(key, hash, value);
+				numMerged += snapshot->GetSize() - size;
+			});
+			entries.Clear();
+		}
+
+		// Publish, and free the snapshots replaced by the previous merge
+		for (auto s = 0u; s < NumShards; ++s)
+		{
+			auto& shard = m_shards[s];
+			shard.Retired.reset();
+			if (snapshots[s]) shard.Retired.reset(shard.Snapshot.exchange(snapshots[s].release(), std::memory_order_acq_rel));
+		}
+
+		m_size += numMerged;
+
+		return numMerged;
+	}
+
+	// Must not overlap any other call.
+	void Clear()
+	{
+		for (auto s = 0u; s < NumShards; ++s)
+		{
+			auto& shard = m_shards[s];
+			delete shard.Snapshot.exchange(nullptr);
+			shard.Retired.reset();
+		}
+
+		for (auto& staging : m_stagings) staging->Entries.Clear();
+		m_size = 0;
+	}
+
+	// Number of shared entries
+	uint32_t GetSize() const { return m_size; }
+	uint32_t GetNumThreads() const { return static_cast<uint32_t>(m_stagings.size()); }
+
+protected:
+	// Cache-line aligned, so that readers of different shards do not false-share
+	struct alignas(64) Shard
+	{
+		std::atomic<const KeyMap<TKey, TValue>*> Snapshot = {};
+		std::unique_ptr<const KeyMap<TKey, TValue>> Retired;
+	};
+
+	struct alignas(64) Staging
+	{
+		KeyMap<TKey, TValue> Entries;
+	};
+
+	static uint32_t getShardIndex(uint64_t hash)
+	{
+		// High bits, since the maps probe from the low ones
+		return static_cast<uint32_t>(hash >> (64 - NumShardBits));
+	}
+
+	std::unique_ptr<Shard[]>				m_shards;
+	std::vector<std::unique_ptr<Staging>>	m_stagings;
+
+	uint32_t m_size = 0;
+};
@@ -0,0 +1,70 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include "CrossQueueSchedule.h"
+
+CrossQueueSchedule::CrossQueueSchedule() :
+	m_numProduced(0),
+	m_numConsumed(0),
+	m_numBuffers(0)
+{
+}
+
+CrossQueueSchedule::~CrossQueueSchedule()
+{
+}
+
+bool CrossQueueSchedule::Init(uint8_t numBuffers)
+{
+	if (numBuffers < 1) return false;
+
+	m_numBuffers = numBuffers;
+	m_numProduced = 0;
+	m_numConsumed = 0;
+
+	return true;
+}
+
+bool CrossQueueSchedule::Produce(Submission& submission)
+{
+	const auto k = m_numProduced;
+	if (m_numBuffers < 1 || k >= m_numConsumed + m_numBuffers) return false;
+
+	// The buffer was last read by consumption k - n, which signaled k - n + 1.
+	submission.BufferIndex = static_cast<uint8_t>(k % m_numBuffers);
+	submission.WaitValue = k >= m_numBuffers ? k + 1 - m_numBuffers : 0;
+	submission.SignalValue = k + 1;
+	++m_numProduced;
+
+	return true;
+}
+
+bool CrossQueueSchedule::Consume(Submission& submission)
+{
+	const auto k = m_numConsumed;
+	if (k >= m_numProduced) return false;
+
+	// Read what production k wrote, once it has signaled k + 1.
+	submission.BufferIndex = static_cast<uint8_t>(k % m_numBuffers);
+	submission.WaitValue = k + 1;
+	submission.SignalValue = k + 1;
+	++m_numConsumed;
+
+	return true;
+}
+
+uint8_t CrossQueueSchedule::GetNumBuffers() const
+{
+	return m_numBuffers;
+}
+
+uint64_t CrossQueueSchedule::GetNumProduced() const
+{
+	return m_numProduced;
+}
+
+uint64_t CrossQueueSchedule::GetNumConsumed() const
+{
+	return m_numConsumed;
+}
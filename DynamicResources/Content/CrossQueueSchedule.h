@@ -0,0 +1,41 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+
+// Cross-queue dependencies between a producer queue (e.g. the compute filter) and a
+// consumer queue (e.g. copy and present) that share a ring of intermediate buffers.
+// Each queue signals its own fence once per submission, so both timelines are plain
+// counters; the schedule only hands out fence values and can be driven by a mock queue.
+class CrossQueueSchedule
+{
+public:
+	struct Submission
+	{
+		uint8_t BufferIndex;
+		uint64_t WaitValue;		// Fence value of the other queue to wait for; 0 for none
+		uint64_t SignalValue;	// Fence value of this queue to signal
+	};
+
+	CrossQueueSchedule();
+	virtual ~CrossQueueSchedule();
+
+	bool Init(uint8_t numBuffers);
+
+	// Fails if all buffers are produced but not yet consumed, since the wait could never be satisfied.
+	bool Produce(Submission& submission);
+	// Fails if there is nothing produced to consume.
+	bool Consume(Submission& submission);
+
+	uint8_t GetNumBuffers() const;
+	uint64_t GetNumProduced() const;
+	uint64_t GetNumConsumed() const;
+
+protected:
+	uint64_t	m_numProduced;
+	uint64_t	m_numConsumed;
+	uint8_t		m_numBuffers;
+};
@@ -0,0 +1,193 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+// 64-bit wyhash-style hashing of 8-byte-word keys
+namespace KeyHash
+{
+	const uint64_t P0 = 0xa0761d6478bd642full;
+	const uint64_t P1 = 0xe7037ed1a0b428dbull;
+
+	inline uint64_t Mix(uint64_t a, uint64_t b)
+	{
+#if defined(_MSC_VER) && defined(_M_X64)
+		uint64_t hi;
+		const auto lo = _umul128(a, b, &hi);
+
+		return lo ^ hi;
+#elif defined(__SIZEOF_INT128__)
+		const auto r = static_cast<unsigned __int128>(a) * b;
+
+		return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+#else
+		const auto aLo = a & 0xffffffff, aHi = a >> 32, bLo = b & 0xffffffff, bHi = b >> 32;
+		const auto mid = aHi * bLo + (aLo * bLo >> 32);
+		const auto mid2 = aLo * bHi + (mid & 0xffffffff);
+
+		return a * b ^ (aHi * bHi + (mid >> 32) + (mid2 >> 32));
+#endif
+	}
+
+	inline uint64_t Hash(const uint64_t* pWords, size_t numWords, uint64_t seed = 0)
+	{
+		seed ^= Mix(seed ^ P0, P1);
+
+		size_t i = 0;
+		for (; i + 2 <= numWords; i += 2) seed = Mix(pWords[i] ^ P1, pWords[i + 1] ^ seed);
+		const auto a = i < numWords ? pWords[i] : 0;
+
+		return Mix(P1 ^ (numWords << 3), Mix(a ^ P1, seed));
+	}
+}
+
+// Fixed-size, inline key of a descriptor table: the raw descriptors (CPU handles
+// or sampler presets) and the heap type, without any heap allocation.
+struct DescriptorKey
+{
+	static const uint8_t MaxDescriptors = 8;
+
+	uint64_t Descriptors[MaxDescriptors];
+	uint8_t NumDescriptors;
+	uint8_t HeapType;
+
+	bool Set(uint8_t heapType, const uintptr_t* pDescriptors, uint32_t numDescriptors)
+	{
+		if (numDescriptors > MaxDescriptors) return false;
+
+		HeapType = heapType;
+		NumDescriptors = static_cast<uint8_t>(numDescriptors);
+		for (auto i = 0u; i < numDescriptors; ++i) Descriptors[i] = pDescriptors[i];
+
+		return true;
+	}
+
+	uint64_t Hash() const
+	{
+		return KeyHash::Hash(Descriptors, NumDescriptors, HeapType);
+	}
+
+	bool operator==(const DescriptorKey& key) const
+	{
+		return HeapType == key.HeapType && NumDescriptors == key.NumDescriptors &&
+			!memcmp(Descriptors, key.Descriptors, sizeof(uint64_t) * NumDescriptors);
+	}
+};
+
+// Insert-only open-addressing hash map with linear probing, meant as a cache in
+// front of content-keyed lookups. Hashes are stored with the entries, so probes
+// rarely touch the keys; the load factor is kept at or below 1/2.
+template<typename TKey, typename TValue>
+class KeyMap
+{
+public:
+	KeyMap(uint32_t capacity = 64) :
+		m_size(0)
+	{
+		Clear(capacity);
+	}
+
+	virtual ~KeyMap()
+	{
+	}
+
+	// The returned value is valid until the next Insert() or Clear(), which may move the entries.
+	const TValue* Find(const TKey& key, uint64_t hash) const
+	{
+		for (auto i = static_cast<size_t>(hash) & m_mask;; i = (i + 1) & m_mask)
+		{
+			const auto& entry = m_entries[i];
+			if (!entry.IsOccupied) return nullptr;
+			if (entry.Hash == hash && entry.Key == key) return &entry.Value;
+		}
+	}
+
+	const TValue* Find(const TKey& key) const { return Find(key, key.Hash()); }
+
+	// Overwrites the value if the key exists.
+	void Insert(const TKey& key, uint64_t hash, const TValue& value)
+	{
+		if (2 * (m_size + 1) > m_entries.size()) rehash(static_cast<uint32_t>(2 * m_entries.size()));
+		insert(key, hash, value);
+	}
+
+	void Insert(const TKey& key, const TValue& value) { Insert(key, key.Hash(), value); }
+
+	void Clear(uint32_t capacity = 64)
+	{
+		// Round up to a power of two
+		auto size = 2u;
+		while (size < capacity) size <<= 1;
+
+		m_entries.assign(size, Entry());
+		m_mask = size - 1;
+		m_size = 0;
+	}
+
+	// Calls func(key, hash, value) for every entry.
+	template<typename F>
+	void ForEach(const F& func) const
+	{
+		for (const auto& entry : m_entries)
+			if (entry.IsOccupied) func(entry.Key, entry.Hash, entry.Value);
+	}
+
+	uint32_t GetSize() const { return m_size; }
+	uint32_t GetCapacity() const { return static_cast<uint32_t>(m_entries.size()); }
+
+protected:
+	struct Entry
+	{
+		TKey Key;
+		TValue Value;
+		uint64_t Hash;
+		bool IsOccupied = false;
+	};
+
+	void insert(const TKey& key, uint64_t hash, const TValue& value)
+	{
+		for (auto i = static_cast<size_t>(hash) & m_mask;; i = (i + 1) & m_mask)
+		{
+			auto& entry = m_entries[i];
+			if (!entry.IsOccupied)
+			{
+				entry = { key, value, hash, true };
+				++m_size;
+
+				return;
+			}
+
+			if (entry.Hash == hash && entry.Key == key)
+			{
+				entry.Value = value;
+
+				return;
+			}
+		}
+	}
+
+	void rehash(uint32_t capacity)
+	{
+		std::vector<Entry> entries;
+		entries.swap(m_entries);
+		m_entries.assign(capacity, Entry());
+		m_mask = capacity - 1;
+		m_size = 0;
+
+		for (const auto& entry : entries)
+			if (entry.IsOccupied) insert(entry.Key, entry.Hash, entry.Value);
+	}
+
+	std::vector<Entry> m_entries;
+	size_t m_mask;
+	uint32_t m_size;
+};
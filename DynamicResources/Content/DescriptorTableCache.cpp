@@ -0,0 +1,131 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include "DescriptorTableCache.h"
+
+using namespace std;
+
+DescriptorTableCache::DescriptorTableCache() :
+	m_numHits(0),
+	m_numMisses(0)
+{
+}
+
+DescriptorTableCache::~DescriptorTableCache()
+{
+}
+
+void DescriptorTableCache::Init(const shared_ptr<Source>& source)
+{
+	m_source = source;
+	Clear();
+}
+
+DescriptorTableCache::Entry DescriptorTableCache::GetCbvSrvUavTable(const uintptr_t* pDescriptors, uint32_t numDescriptors)
+{
+	DescriptorKey key;
+
+	return key.Set(CbvSrvUavHeap, pDescriptors, numDescriptors) ? getTable(key) : Entry{};
+}
+
+void DescriptorTableCache::Clear()
+{
+	m_entries.Clear();
+	m_numHits = 0;
+	m_numMisses = 0;
+}
+
+uint64_t DescriptorTableCache::GetNumHits() const
+{
+	return m_numHits;
+}
+
+uint64_t DescriptorTableCache::GetNumMisses() const
+{
+	return m_numMisses;
+}
+
+DescriptorTableCache::Entry DescriptorTableCache::getTable(const DescriptorKey& key)
+{
+	const auto hash = key.Hash();
+	const auto pEntry = m_entries.Find(key, hash);
+	if (pEntry)
+	{
+		++m_numHits;
+
+		return *pEntry;
+	}
+
+	// Miss: fall through to the source
+	Entry entry = {};
+	if (!m_source->CreateTable(key, entry) || !entry.Table) return {};
+
+	++m_numMisses;
+	m_entries.Insert(key, hash, entry);
+
+	return entry;
+}
+
+//--------------------------------------------------------------------------------------
+// Concurrent front end
+//--------------------------------------------------------------------------------------
+
+ConcurrentDescriptorTableCache::ConcurrentDescriptorTableCache() :
+	m_numMisses(0)
+{
+}
+
+ConcurrentDescriptorTableCache::~ConcurrentDescriptorTableCache()
+{
+}
+
+void ConcurrentDescriptorTableCache::Init(const shared_ptr<Source>& source, uint32_t numThreads)
+{
+	m_source = source;
+	m_entries.Init(numThreads);
+	m_numMisses = 0;
+}
+
+ConcurrentDescriptorTableCache::Entry ConcurrentDescriptorTableCache::GetCbvSrvUavTable(uint32_t threadIndex,
+	const uintptr_t* pDescriptors, uint32_t numDescriptors)
+{
+	DescriptorKey key;
+
+	return key.Set(DescriptorTableCache::CbvSrvUavHeap, pDescriptors, numDescriptors) ? getTable(threadIndex, key) : Entry{};
+}
+
+uint32_t ConcurrentDescriptorTableCache::Merge()
+{
+	return m_entries.Merge();
+}
+
+void ConcurrentDescriptorTableCache::Clear()
+{
+	m_entries.Clear();
+	m_numMisses = 0;
+}
+
+uint64_t ConcurrentDescriptorTableCache::GetNumMisses() const
+{
+	return m_numMisses;
+}
+
+ConcurrentDescriptorTableCache::Entry ConcurrentDescriptorTableCache::getTable(uint32_t threadIndex, const DescriptorKey& key)
+{
+	const auto hash = key.Hash();
+	const auto pEntry = m_entries.Find(threadIndex, key, hash);
+	if (pEntry) return *pEntry;
+
+	// Miss: the lib behind the source is not thread-safe
+	Entry entry = {};
+	{
+		lock_guard<mutex> lock(m_sourceMutex);
+		if (!m_source->CreateTable(key, entry) || !entry.Table) return {};
+	}
+
+	++m_numMisses;
+	m_entries.Insert(threadIndex, key, hash, entry);
+
+	return entry;
+}
@@ -0,0 +1,121 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <mutex>
+#include "ConcurrentKeyCache.h"
+
+// Lookup layer in front of a descriptor-table lib. Tables are keyed by fixed-size
+// binary keys with a 64-bit hash, so repeated lookups neither allocate nor hash
+// strings; only misses fall through to the Source, which is DescriptorTableLibSource
+// over the string-keyed XUSG::DescriptorTableLib in the app, so that the cache itself
+// needs no device.
+class DescriptorTableCache
+{
+public:
+	// Heap types of the keys, as XUSG::CBV_SRV_UAV_HEAP and XUSG::SAMPLER_HEAP
+	static const uint8_t CbvSrvUavHeap = 0;
+	static const uint8_t SamplerHeap = 1;
+
+	struct Entry
+	{
+		uint64_t Table;	// XUSG::DescriptorTable; 0 on failure
+		uint32_t Index;
+	};
+
+	// Creates the tables on misses.
+	class Source
+	{
+	public:
+		virtual ~Source() {}
+
+		// The key holds the CPU descriptor handles, or the sampler presets for sampler heaps.
+		virtual bool CreateTable(const DescriptorKey& key, Entry& entry) = 0;
+	};
+
+	DescriptorTableCache();
+	virtual ~DescriptorTableCache();
+
+	void Init(const std::shared_ptr<Source>& source);
+
+	// Entries are returned by value, since a miss may grow the map. The table is 0 on
+	// failure, or for more than DescriptorKey::MaxDescriptors descriptors.
+	Entry GetCbvSrvUavTable(const uintptr_t* pDescriptors, uint32_t numDescriptors);
+	template<typename TPreset>
+	Entry GetSamplerTable(const TPreset* pPresets, uint32_t numSamplers)
+	{
+		DescriptorKey key;
+
+		return setSamplerKey(key, pPresets, numSamplers) ? getTable(key) : Entry{};
+	}
+
+	// Must be called when the lib's heaps are reset.
+	void Clear();
+
+	uint64_t GetNumHits() const;
+	uint64_t GetNumMisses() const;
+
+protected:
+	friend class ConcurrentDescriptorTableCache;
+
+	template<typename TPreset>
+	static bool setSamplerKey(DescriptorKey& key, const TPreset* pPresets, uint32_t numSamplers)
+	{
+		uintptr_t presets[DescriptorKey::MaxDescriptors];
+		if (numSamplers > DescriptorKey::MaxDescriptors) return false;
+		for (auto i = 0u; i < numSamplers; ++i) presets[i] = static_cast<uintptr_t>(pPresets[i]);
+
+		return key.Set(SamplerHeap, presets, numSamplers);
+	}
+
+	Entry getTable(const DescriptorKey& key);
+
+	std::shared_ptr<Source> m_source;
+
+	KeyMap<DescriptorKey, Entry> m_entries;
+
+	uint64_t m_numHits;
+	uint64_t m_numMisses;
+};
+
+// Thread-safe variant for parallel recording, where each recording thread passes its
+// own index. Hits are lock-free; misses serialize on the source and are shared with the
+// other threads by Merge(), which is called at frame boundaries while no thread records.
+class ConcurrentDescriptorTableCache
+{
+public:
+	using Entry = DescriptorTableCache::Entry;
+	using Source = DescriptorTableCache::Source;
+
+	ConcurrentDescriptorTableCache();
+	virtual ~ConcurrentDescriptorTableCache();
+
+	void Init(const std::shared_ptr<Source>& source, uint32_t numThreads);
+
+	// Thread-safe across distinct thread indices
+	Entry GetCbvSrvUavTable(uint32_t threadIndex, const uintptr_t* pDescriptors, uint32_t numDescriptors);
+	template<typename TPreset>
+	Entry GetSamplerTable(uint32_t threadIndex, const TPreset* pPresets, uint32_t numSamplers)
+	{
+		DescriptorKey key;
+
+		return DescriptorTableCache::setSamplerKey(key, pPresets, numSamplers) ? getTable(threadIndex, key) : Entry{};
+	}
+
+	uint32_t Merge();
+	void Clear();
+
+	uint64_t GetNumMisses() const;
+
+protected:
+	Entry getTable(uint32_t threadIndex, const DescriptorKey& key);
+
+	std::shared_ptr<Source> m_source;
+
+	ConcurrentKeyCache<DescriptorKey, Entry> m_entries;
+	std::mutex m_sourceMutex;
+
+	std::atomic<uint64_t> m_numMisses;
+};
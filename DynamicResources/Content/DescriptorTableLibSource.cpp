@@ -0,0 +1,48 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include "DescriptorTableLibSource.h"
+
+using namespace XUSG;
+
+static_assert(DescriptorTableCache::CbvSrvUavHeap == CBV_SRV_UAV_HEAP &&
+	DescriptorTableCache::SamplerHeap == SAMPLER_HEAP, "Heap types of the keys must match XUSG's");
+static_assert(sizeof(DescriptorTable) == sizeof(DescriptorTableCache::Entry::Table), "Tables must fit the entries");
+
+DescriptorTableLibSource::DescriptorTableLibSource(const DescriptorTableLib::sptr& descriptorTableLib) :
+	m_descriptorTableLib(descriptorTableLib)
+{
+}
+
+DescriptorTableLibSource::~DescriptorTableLibSource()
+{
+}
+
+bool DescriptorTableLibSource::CreateTable(const DescriptorKey& key, DescriptorTableCache::Entry& entry)
+{
+	const auto heapType = static_cast<DescriptorHeapType>(key.HeapType);
+	const auto descriptorTable = Util::DescriptorTable::MakeUnique();
+
+	DescriptorTable table;
+	if (heapType == SAMPLER_HEAP)
+	{
+		SamplerPreset presets[DescriptorKey::MaxDescriptors];
+		for (uint8_t i = 0; i < key.NumDescriptors; ++i) presets[i] = static_cast<SamplerPreset>(key.Descriptors[i]);
+		descriptorTable->SetSamplers(0, key.NumDescriptors, presets, m_descriptorTableLib.get());
+		table = descriptorTable->GetSamplerTable(m_descriptorTableLib.get());
+	}
+	else
+	{
+		Descriptor descriptors[DescriptorKey::MaxDescriptors];
+		for (uint8_t i = 0; i < key.NumDescriptors; ++i) descriptors[i] = static_cast<Descriptor>(key.Descriptors[i]);
+		descriptorTable->SetDescriptors(0, key.NumDescriptors, descriptors);
+		table = descriptorTable->GetCbvSrvUavTable(m_descriptorTableLib.get());
+	}
+	XUSG_N_RETURN(table, false);
+
+	entry.Table = table;
+	entry.Index = descriptorTable->GetDescriptorTableIndex(m_descriptorTableLib.get(), heapType, table);
+
+	return true;
+}
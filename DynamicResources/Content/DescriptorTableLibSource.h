@@ -0,0 +1,22 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Core/XUSG.h"
+#include "DescriptorTableCache.h"
+
+// Creates the tables of the descriptor-table caches in the content-keyed XUSG lib
+class DescriptorTableLibSource :
+	public DescriptorTableCache::Source
+{
+public:
+	DescriptorTableLibSource(const XUSG::DescriptorTableLib::sptr& descriptorTableLib);
+	virtual ~DescriptorTableLibSource();
+
+	bool CreateTable(const DescriptorKey& key, DescriptorTableCache::Entry& entry);
+
+protected:
+	XUSG::DescriptorTableLib::sptr m_descriptorTableLib;
+};
@@ -0,0 +1,178 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include "DirtyRegion.h"
+
+using namespace std;
+
+DirtyRegion::DirtyRegion() :
+	m_width(0),
+	m_height(0),
+	m_tileSize(8),
+	m_isFull(false)
+{
+}
+
+DirtyRegion::~DirtyRegion()
+{
+}
+
+void DirtyRegion::Init(uint32_t width, uint32_t height, uint32_t tileSize)
+{
+	m_width = width;
+	m_height = height;
+	m_tileSize = (max)(tileSize, 1u);
+	Clear();
+}
+
+void DirtyRegion::Add(const Rect& rect)
+{
+	if (m_isFull) return;
+
+	const Rect clipped = { rect.Left, rect.Top, (min)(rect.Right, m_width), (min)(rect.Bottom, m_height) };
+	if (IsEmpty(clipped)) return;
+
+	if (clipped.Left == 0 && clipped.Top == 0 && clipped.Right == m_width && clipped.Bottom == m_height)
+	{
+		AddAll();
+		return;
+	}
+
+	// Skip rectangles that are already covered.
+	for (const auto& r : m_rects)
+		if (r.Left <= clipped.Left && r.Top <= clipped.Top && r.Right >= clipped.Right && r.Bottom >= clipped.Bottom)
+			return;
+
+	m_rects.emplace_back(clipped);
+
+	// Keep the list short, as it grows with every change until the region is processed.
+	if (m_rects.size() > MaxRects)
+	{
+		auto bounds = m_rects[0];
+		for (const auto& r : m_rects) bounds = Union(bounds, r);
+		m_rects.assign(1, bounds);
+	}
+}
+
+void DirtyRegion::AddAll()
+{
+	m_rects.assign(1, { 0, 0, m_width, m_height });
+	m_isFull = m_width > 0 && m_height > 0;
+	if (!m_isFull) m_rects.clear();
+}
+
+void DirtyRegion::Clear()
+{
+	m_rects.clear();
+	m_isFull = false;
+}
+
+bool DirtyRegion::IsEmpty() const
+{
+	return m_rects.empty();
+}
+
+bool DirtyRegion::IsFull() const
+{
+	return m_isFull;
+}
+
+const vector<DirtyRegion::Rect>& DirtyRegion::GetRects() const
+{
+	return m_rects;
+}
+
+void DirtyRegion::GetTiles(vector<Rect>& tiles, uint32_t radius, uint32_t maxTiles) const
+{
+	tiles.clear();
+	if (m_rects.empty()) return;
+
+	const auto toTiles = [this](const Rect& rect) -> Rect
+	{
+		return { rect.Left / m_tileSize, rect.Top / m_tileSize,
+			(rect.Right + m_tileSize - 1) / m_tileSize, (rect.Bottom + m_tileSize - 1) / m_tileSize };
+	};
+
+	if (m_isFull)
+	{
+		tiles.emplace_back(toTiles(m_rects[0]));
+		return;
+	}
+
+	for (const auto& rect : m_rects) tiles.emplace_back(toTiles(Dilate(rect, radius, m_width, m_height)));
+
+	// Overlapping tiles are always merged, so that no tile is dispatched twice; others
+	// only when the merge wastes nothing, or while there are too many.
+	maxTiles = (max)(maxTiles, 1u);
+	while (tiles.size() > 1)
+	{
+		auto bestA = 0u, bestB = 0u;
+		auto bestWaste = INT64_MAX;
+		auto isOverlapped = false;
+		for (auto a = 0u; a + 1 < tiles.size(); ++a)
+		{
+			for (auto b = a + 1; b < tiles.size(); ++b)
+			{
+				const auto overlapped = IsOverlapped(tiles[a], tiles[b]);
+				if (isOverlapped && !overlapped) continue;
+
+				const auto waste = static_cast<int64_t>(GetArea(Union(tiles[a], tiles[b]))) -
+					static_cast<int64_t>(GetArea(tiles[a]) + GetArea(tiles[b]));
+				if (overlapped != isOverlapped || waste < bestWaste)
+				{
+					bestA = a;
+					bestB = b;
+					bestWaste = waste;
+					isOverlapped = overlapped;
+				}
+			}
+		}
+
+		if (!isOverlapped && bestWaste > 0 && tiles.size() <= maxTiles) break;
+
+		tiles[bestA] = Union(tiles[bestA], tiles[bestB]);
+		tiles.erase(tiles.begin() + bestB);
+	}
+}
+
+DirtyRegion::Rect DirtyRegion::GetTexels(const Rect& tiles) const
+{
+	return { (min)(tiles.Left * m_tileSize, m_width), (min)(tiles.Top * m_tileSize, m_height),
+		(min)(tiles.Right * m_tileSize, m_width), (min)(tiles.Bottom * m_tileSize, m_height) };
+}
+
+uint32_t DirtyRegion::GetNumTiles() const
+{
+	return ((m_width + m_tileSize - 1) / m_tileSize) * ((m_height + m_tileSize - 1) / m_tileSize);
+}
+
+DirtyRegion::Rect DirtyRegion::Dilate(const Rect& rect, uint32_t radius, uint32_t width, uint32_t height)
+{
+	return { rect.Left > radius ? rect.Left - radius : 0, rect.Top > radius ? rect.Top - radius : 0,
+		(min)(rect.Right + radius, width), (min)(rect.Bottom + radius, height) };
+}
+
+DirtyRegion::Rect DirtyRegion::Union(const Rect& a, const Rect& b)
+{
+	if (IsEmpty(a)) return b;
+	if (IsEmpty(b)) return a;
+
+	return { (min)(a.Left, b.Left), (min)(a.Top, b.Top), (max)(a.Right, b.Right), (max)(a.Bottom, b.Bottom) };
+}
+
+bool DirtyRegion::IsEmpty(const Rect& rect)
+{
+	return rect.Left >= rect.Right || rect.Top >= rect.Bottom;
+}
+
+bool DirtyRegion::IsOverlapped(const Rect& a, const Rect& b)
+{
+	return a.Left < b.Right && b.Left < a.Right && a.Top < b.Bottom && b.Top < a.Bottom;
+}
+
+uint64_t DirtyRegion::GetArea(const Rect& rect)
+{
+	return IsEmpty(rect) ? 0 : static_cast<uint64_t>(rect.Right - rect.Left) * (rect.Bottom - rect.Top);
+}
@@ -0,0 +1,64 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Changed part of an image, as a list of rectangles in texels, and its cover by tiles
+// of thread groups. The cover is dilated by the reach of a filter, so that it holds
+// every output texel the changes affect, and coalesced into a few tile-aligned
+// rectangles, each of which is one dispatch. It is device-free, so that the region
+// arithmetic can be checked on its own.
+class DirtyRegion
+{
+public:
+	// Half-open, in texels or in tiles
+	struct Rect
+	{
+		uint32_t Left;
+		uint32_t Top;
+		uint32_t Right;
+		uint32_t Bottom;
+	};
+
+	static const uint32_t MaxRects = 32;	// Beyond it, the rectangles collapse into their bounds
+
+	DirtyRegion();
+	virtual ~DirtyRegion();
+
+	// Starts clean.
+	void Init(uint32_t width, uint32_t height, uint32_t tileSize = 8);
+
+	// The rectangle is clipped to the image; empty ones are ignored.
+	void Add(const Rect& rect);
+	void AddAll();
+	void Clear();
+
+	bool IsEmpty() const;
+	bool IsFull() const;
+	const std::vector<Rect>& GetRects() const;
+
+	// Covers the region, dilated by radius texels, with at most maxTiles rectangles in
+	// tile units, which do not overlap. Tiles are merged greedily by least wasted area.
+	void GetTiles(std::vector<Rect>& tiles, uint32_t radius, uint32_t maxTiles) const;
+	// Texels of a rectangle of tiles, clipped to the image
+	Rect GetTexels(const Rect& tiles) const;
+	uint32_t GetNumTiles() const;
+
+	static Rect Dilate(const Rect& rect, uint32_t radius, uint32_t width, uint32_t height);
+	static Rect Union(const Rect& a, const Rect& b);
+	static bool IsEmpty(const Rect& rect);
+	static bool IsOverlapped(const Rect& a, const Rect& b);
+	static uint64_t GetArea(const Rect& rect);
+
+protected:
+	std::vector<Rect> m_rects;
+
+	uint32_t	m_width;
+	uint32_t	m_height;
+	uint32_t	m_tileSize;
+	bool		m_isFull;
+};
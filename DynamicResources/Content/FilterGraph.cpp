@@ -0,0 +1,308 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cassert>
+#include "FilterGraph.h"
+
+using namespace std;
+
+namespace
+{
+	uint64_t alignUp(uint64_t value, uint64_t alignment)
+	{
+		return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+	}
+}
+
+FilterGraph::FilterGraph()
+{
+}
+
+FilterGraph::~FilterGraph()
+{
+}
+
+FilterGraph::ResourceId FilterGraph::Import(const char* name, Access initialAccess, Access finalAccess)
+{
+	Resource resource = {};
+	resource.Name = name;
+	resource.InitialAccess = initialAccess;
+	resource.FinalAccess = finalAccess;
+	resource.IsImported = true;
+	m_resources.emplace_back(move(resource));
+
+	return static_cast<ResourceId>(m_resources.size() - 1);
+}
+
+FilterGraph::ResourceId FilterGraph::CreateTexture(const char* name, const TextureDesc& desc)
+{
+	Resource resource = {};
+	resource.Name = name;
+	resource.Desc = desc;
+	resource.InitialAccess = ACCESS_UNKNOWN;
+	resource.FinalAccess = ACCESS_UNKNOWN;
+	resource.IsImported = false;
+	m_resources.emplace_back(move(resource));
+
+	return static_cast<ResourceId>(m_resources.size() - 1);
+}
+
+FilterGraph::PassId FilterGraph::AddPass(const char* name, const vector<ResourceId>& reads,
+	const vector<ResourceId>& writes, Access readAccess, Access writeAccess)
+{
+	m_passes.push_back({ name, reads, writes, readAccess, writeAccess });
+
+	return static_cast<PassId>(m_passes.size() - 1);
+}
+
+void FilterGraph::Reset()
+{
+	m_resources.clear();
+	m_passes.clear();
+}
+
+bool FilterGraph::Compile(Plan& plan) const
+{
+	const auto numResources = static_cast<uint32_t>(m_resources.size());
+	plan = {};
+	plan.Lifetimes.assign(numResources, { InvalidId, InvalidId });
+	plan.HeapOffsets.assign(numResources, UINT64_MAX);
+
+	vector<bool> isPassNeeded;
+	if (!cull(isPassNeeded)) return false;
+
+	// Schedule the remaining passes in declaration order, and find the lifetimes.
+	vector<bool> isWritten(numResources, false);
+	vector<Access> lastAccesses(numResources, ACCESS_UNKNOWN);
+	for (PassId i = 0; i < m_passes.size(); ++i)
+	{
+		if (!isPassNeeded[i])
+		{
+			++plan.NumCulledPasses;
+			continue;
+		}
+
+		const auto& pass = m_passes[i];
+		const auto step = static_cast<uint32_t>(plan.Steps.size());
+		const auto touch = [&plan, step](ResourceId resource)
+		{
+			auto& lifetime = plan.Lifetimes[resource];
+			if (lifetime.First == InvalidId) lifetime.First = step;
+			lifetime.Last = step;
+		};
+
+		for (const auto& read : pass.Reads)
+		{
+			if (!m_resources[read].IsImported && !isWritten[read]) return false;
+			if (find(pass.Writes.cbegin(), pass.Writes.cend(), read) != pass.Writes.cend()) return false;
+			lastAccesses[read] = pass.ReadAccess;
+			touch(read);
+		}
+
+		for (const auto& write : pass.Writes)
+		{
+			isWritten[write] = true;
+			lastAccesses[write] = pass.WriteAccess;
+			touch(write);
+		}
+
+		plan.Steps.push_back({ i, {}, {} });
+	}
+
+	// Transient textures are reused by every execution, so each one starts in the state
+	// of its last access; imported ones start in their declared state.
+	vector<Access> accesses(numResources);
+	for (ResourceId i = 0; i < numResources; ++i)
+		accesses[i] = m_resources[i].IsImported ? m_resources[i].InitialAccess : lastAccesses[i];
+
+	for (auto& step : plan.Steps)
+	{
+		const auto& pass = m_passes[step.Pass];
+		const auto transition = [&step, &accesses](ResourceId resource, Access access)
+		{
+			for (const auto& barrier : step.Barriers) if (barrier.Resource == resource) return;
+
+			auto& before = accesses[resource];
+			if (before != access || access == ACCESS_UNORDERED_WRITE)
+				step.Barriers.push_back({ resource, before, access });
+			before = access;
+		};
+
+		for (const auto& read : pass.Reads) transition(read, pass.ReadAccess);
+		for (const auto& write : pass.Writes) transition(write, pass.WriteAccess);
+	}
+
+	for (ResourceId i = 0; i < numResources; ++i)
+	{
+		const auto& resource = m_resources[i];
+		if (resource.IsImported && resource.FinalAccess != ACCESS_UNKNOWN && accesses[i] != resource.FinalAccess)
+			plan.FinalBarriers.push_back({ i, accesses[i], resource.FinalAccess });
+	}
+
+	place(plan);
+	setAliasingBarriers(plan);
+
+	return true;
+}
+
+uint32_t FilterGraph::GetNumResources() const
+{
+	return static_cast<uint32_t>(m_resources.size());
+}
+
+uint32_t FilterGraph::GetNumPasses() const
+{
+	return static_cast<uint32_t>(m_passes.size());
+}
+
+bool FilterGraph::IsImported(ResourceId resource) const
+{
+	assert(resource < m_resources.size());
+
+	return m_resources[resource].IsImported;
+}
+
+const FilterGraph::TextureDesc& FilterGraph::GetTextureDesc(ResourceId resource) const
+{
+	assert(resource < m_resources.size());
+
+	return m_resources[resource].Desc;
+}
+
+const char* FilterGraph::GetResourceName(ResourceId resource) const
+{
+	assert(resource < m_resources.size());
+
+	return m_resources[resource].Name.c_str();
+}
+
+const char* FilterGraph::GetPassName(PassId pass) const
+{
+	assert(pass < m_passes.size());
+
+	return m_passes[pass].Name.c_str();
+}
+
+bool FilterGraph::cull(vector<bool>& isPassNeeded) const
+{
+	// Walk backwards from the imported textures: a pass is needed if it writes a texture
+	// that is imported or read by a needed pass.
+	vector<bool> isResourceNeeded(m_resources.size());
+	for (size_t i = 0; i < m_resources.size(); ++i) isResourceNeeded[i] = m_resources[i].IsImported;
+
+	isPassNeeded.assign(m_passes.size(), false);
+	for (auto i = m_passes.size(); i-- > 0;)
+	{
+		const auto& pass = m_passes[i];
+		for (const auto& write : pass.Writes)
+		{
+			if (write >= m_resources.size()) return false;
+			if (isResourceNeeded[write]) isPassNeeded[i] = true;
+		}
+
+		for (const auto& read : pass.Reads)
+		{
+			if (read >= m_resources.size()) return false;
+			if (isPassNeeded[i]) isResourceNeeded[read] = true;
+		}
+	}
+
+	return true;
+}
+
+void FilterGraph::place(Plan& plan) const
+{
+	vector<ResourceId> order;
+	vector<uint64_t> unaliasedOffsets;
+	for (ResourceId i = 0; i < m_resources.size(); ++i)
+	{
+		const auto& resource = m_resources[i];
+		if (resource.IsImported || plan.Lifetimes[i].First == InvalidId) continue;
+
+		order.push_back(i);
+		unaliasedOffsets.push_back(alignUp(plan.UnaliasedHeapSize, resource.Desc.Alignment));
+		plan.UnaliasedHeapSize = unaliasedOffsets.back() + resource.Desc.Size;
+	}
+
+	// Largest first, each at the lowest offset that is free during its lifetime
+	sort(order.begin(), order.end(), [this, &plan](ResourceId a, ResourceId b)
+	{
+		const auto sizeA = m_resources[a].Desc.Size;
+		const auto sizeB = m_resources[b].Desc.Size;
+		if (sizeA != sizeB) return sizeA > sizeB;
+		if (plan.Lifetimes[a].First != plan.Lifetimes[b].First) return plan.Lifetimes[a].First < plan.Lifetimes[b].First;
+
+		return a < b;
+	});
+
+	vector<pair<uint64_t, uint64_t>> busyRanges;
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		const auto resource = order[i];
+		const auto& desc = m_resources[resource].Desc;
+
+		busyRanges.clear();
+		for (size_t j = 0; j < i; ++j)
+		{
+			const auto placed = order[j];
+			if (isOverlapped(plan.Lifetimes[resource], plan.Lifetimes[placed]))
+				busyRanges.emplace_back(plan.HeapOffsets[placed], plan.HeapOffsets[placed] + m_resources[placed].Desc.Size);
+		}
+		sort(busyRanges.begin(), busyRanges.end());
+
+		uint64_t offset = 0;
+		for (const auto& range : busyRanges)
+		{
+			if (offset + desc.Size <= range.first) break;
+			offset = (max)(offset, alignUp(range.second, desc.Alignment));
+		}
+
+		plan.HeapOffsets[resource] = offset;
+		plan.HeapSize = (max)(plan.HeapSize, offset + desc.Size);
+	}
+
+	// With mixed alignments, the padding may outweigh the reuse; do not alias then.
+	if (plan.HeapSize > plan.UnaliasedHeapSize)
+	{
+		sort(order.begin(), order.end());
+		for (size_t i = 0; i < order.size(); ++i) plan.HeapOffsets[order[i]] = unaliasedOffsets[i];
+		plan.HeapSize = plan.UnaliasedHeapSize;
+	}
+}
+
+void FilterGraph::setAliasingBarriers(Plan& plan) const
+{
+	// Every execution reactivates a texture sharing memory with others, including those
+	// used last by the previous execution.
+	for (ResourceId i = 0; i < m_resources.size(); ++i)
+	{
+		if (plan.HeapOffsets[i] == UINT64_MAX) continue;
+
+		auto before = InvalidId;
+		auto numOverlapped = 0u;
+		for (ResourceId j = 0; j < m_resources.size(); ++j)
+		{
+			if (j == i || plan.HeapOffsets[j] == UINT64_MAX) continue;
+			if (isOverlapped(plan.HeapOffsets[i], m_resources[i].Desc.Size, plan.HeapOffsets[j], m_resources[j].Desc.Size))
+			{
+				before = j;
+				++numOverlapped;
+			}
+		}
+
+		if (numOverlapped > 1) before = InvalidId;
+		if (numOverlapped > 0) plan.Steps[plan.Lifetimes[i].First].AliasingBarriers.push_back({ before, i });
+	}
+}
+
+bool FilterGraph::isOverlapped(uint64_t offsetA, uint64_t sizeA, uint64_t offsetB, uint64_t sizeB)
+{
+	return offsetA < offsetB + sizeB && offsetB < offsetA + sizeA;
+}
+
+bool FilterGraph::isOverlapped(const Lifetime& a, const Lifetime& b)
+{
+	return a.First <= b.Last && b.First <= a.Last;
+}
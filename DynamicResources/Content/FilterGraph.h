@@ -0,0 +1,135 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Scheduling, lifetime and aliasing planner of a chain of filter passes. Passes declare
+// the textures they read and write; Compile() culls passes that do not contribute to an
+// imported texture, infers the state transitions before each pass, and places the
+// transient textures in one heap, so that textures with disjoint lifetimes share memory.
+// It is pure CPU logic; the executor creates the heap and records the barriers.
+class FilterGraph
+{
+public:
+	using ResourceId = uint32_t;
+	using PassId = uint32_t;
+
+	static const uint32_t InvalidId = UINT32_MAX;
+
+	enum Access : uint8_t
+	{
+		ACCESS_UNKNOWN,		// State of an imported texture that is not tracked by the graph
+		ACCESS_SHADER_READ,
+		ACCESS_UNORDERED_WRITE,
+		ACCESS_COPY_READ,
+		ACCESS_COPY_WRITE,
+
+		NUM_ACCESS
+	};
+
+	// Size and Alignment are the placement requirements queried from the device.
+	struct TextureDesc
+	{
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t Format;
+		uint64_t Size;
+		uint64_t Alignment;
+	};
+
+	// Before == After == ACCESS_UNORDERED_WRITE denotes a UAV barrier between two writes.
+	struct Barrier
+	{
+		ResourceId Resource;
+		Access Before;
+		Access After;
+	};
+
+	// Before is InvalidId when several textures may have last occupied the memory of After.
+	struct AliasingBarrier
+	{
+		ResourceId Before;
+		ResourceId After;
+	};
+
+	struct Step
+	{
+		PassId Pass;
+		std::vector<AliasingBarrier> AliasingBarriers;
+		std::vector<Barrier> Barriers;
+	};
+
+	// First and last steps accessing a resource; First is InvalidId if it is unused.
+	struct Lifetime
+	{
+		uint32_t First;
+		uint32_t Last;
+	};
+
+	struct Plan
+	{
+		std::vector<Step> Steps;
+		std::vector<Barrier> FinalBarriers;
+		std::vector<Lifetime> Lifetimes;	// Per resource
+		std::vector<uint64_t> HeapOffsets;	// Per resource; UINT64_MAX unless placed
+		uint64_t HeapSize;
+		uint64_t UnaliasedHeapSize;			// Heap size without aliasing, for comparison
+		uint32_t NumCulledPasses;
+	};
+
+	FilterGraph();
+	virtual ~FilterGraph();
+
+	// Textures created outside of the graph; a final access of ACCESS_UNKNOWN leaves them
+	// in the state of their last access.
+	ResourceId Import(const char* name, Access initialAccess, Access finalAccess = ACCESS_UNKNOWN);
+	ResourceId CreateTexture(const char* name, const TextureDesc& desc);
+	PassId AddPass(const char* name, const std::vector<ResourceId>& reads, const std::vector<ResourceId>& writes,
+		Access readAccess = ACCESS_SHADER_READ, Access writeAccess = ACCESS_UNORDERED_WRITE);
+	void Reset();
+
+	// Passes run in declaration order. Fails if a pass reads a transient texture that no
+	// earlier pass writes, or reads and writes the same texture.
+	bool Compile(Plan& plan) const;
+
+	uint32_t GetNumResources() const;
+	uint32_t GetNumPasses() const;
+	bool IsImported(ResourceId resource) const;
+	const TextureDesc& GetTextureDesc(ResourceId resource) const;
+	const char* GetResourceName(ResourceId resource) const;
+	const char* GetPassName(PassId pass) const;
+
+protected:
+	struct Resource
+	{
+		std::string Name;
+		TextureDesc Desc;
+		Access InitialAccess;
+		Access FinalAccess;
+		bool IsImported;
+	};
+
+	struct Pass
+	{
+		std::string Name;
+		std::vector<ResourceId> Reads;
+		std::vector<ResourceId> Writes;
+		Access ReadAccess;
+		Access WriteAccess;
+	};
+
+	bool cull(std::vector<bool>& isPassNeeded) const;
+	void place(Plan& plan) const;
+	void setAliasingBarriers(Plan& plan) const;
+
+	static bool isOverlapped(uint64_t offsetA, uint64_t sizeA, uint64_t offsetB, uint64_t sizeB);
+	static bool isOverlapped(const Lifetime& a, const Lifetime& b);
+
+	std::vector<Resource>	m_resources;
+	std::vector<Pass>		m_passes;
+};
@@ -0,0 +1,256 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include "FilterGraphExecutor.h"
+
+using namespace std;
+using namespace XUSG;
+
+namespace
+{
+	// Private-data slot, through which each placed texture holds a reference to its heap
+	const GUID g_heapGuid = { 0x5a1c9e3b, 0x7d42, 0x4f6e, { 0x9b, 0x13, 0x2c, 0x8e, 0x61, 0xa4, 0xd7, 0x05 } };
+
+	D3D12_RESOURCE_DESC getResourceDesc(uint32_t width, uint32_t height, Format format)
+	{
+		// XUSG formats mirror the DXGI enumeration.
+		D3D12_RESOURCE_DESC desc = {};
+		desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		desc.Width = width;
+		desc.Height = height;
+		desc.DepthOrArraySize = 1;
+		desc.MipLevels = 1;
+		desc.Format = static_cast<DXGI_FORMAT>(format);
+		desc.SampleDesc.Count = 1;
+		desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+		desc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+
+		return desc;
+	}
+}
+
+FilterGraphExecutor::FilterGraphExecutor() :
+	m_plan()
+{
+}
+
+FilterGraphExecutor::~FilterGraphExecutor()
+{
+}
+
+bool FilterGraphExecutor::GetTextureDesc(const Device* pDevice, uint32_t width, uint32_t height,
+	Format format, FilterGraph::TextureDesc& desc)
+{
+	const auto pNativeDevice = static_cast<ID3D12Device*>(pDevice->GetHandle());
+	const auto resourceDesc = getResourceDesc(width, height, format);
+	const auto info = pNativeDevice->GetResourceAllocationInfo(0, 1, &resourceDesc);
+	XUSG_C_RETURN(info.SizeInBytes == UINT64_MAX, false);
+
+	desc.Width = width;
+	desc.Height = height;
+	desc.Format = static_cast<uint32_t>(format);
+	desc.Size = info.SizeInBytes;
+	desc.Alignment = info.Alignment;
+
+	return true;
+}
+
+bool FilterGraphExecutor::Create(const Device* pDevice, const FilterGraph& graph, const FilterGraph::Plan& plan,
+	vector<Resource::uptr>& retiredResources, const wchar_t* name)
+{
+	for (auto& texture : m_textures) if (texture) retiredResources.emplace_back(move(texture));
+
+	const auto numResources = graph.GetNumResources();
+	m_plan = plan;
+	m_textures.clear();
+	m_textures.resize(numResources);
+	m_resources.assign(numResources, nullptr);
+	m_srvs.assign(numResources, 0);
+	m_uavs.assign(numResources, 0);
+
+	if (plan.HeapSize == 0) return true;
+
+	// One heap for all transient textures; XUSG has no placed resources, so create them natively.
+	const auto pNativeDevice = static_cast<ID3D12Device*>(pDevice->GetHandle());
+	D3D12_HEAP_DESC heapDesc = {};
+	heapDesc.SizeInBytes = plan.HeapSize;
+	heapDesc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+	heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+
+	com_ptr<ID3D12Heap> heap;
+	XUSG_C_RETURN(FAILED(pNativeDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(heap.put()))), false);
+
+	for (FilterGraph::ResourceId i = 0; i < numResources; ++i)
+	{
+		if (plan.HeapOffsets[i] == UINT64_MAX) continue;
+
+		const auto& desc = graph.GetTextureDesc(i);
+		const auto format = static_cast<Format>(desc.Format);
+		const auto resourceDesc = getResourceDesc(desc.Width, desc.Height, format);
+
+		com_ptr<ID3D12Resource> resource;
+		XUSG_C_RETURN(FAILED(pNativeDevice->CreatePlacedResource(heap.get(), plan.HeapOffsets[i], &resourceDesc,
+			D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(resource.put()))), false);
+		XUSG_C_RETURN(FAILED(resource->SetPrivateDataInterface(g_heapGuid, heap.get())), false);
+
+		const string resourceName = graph.GetResourceName(i);
+		auto& texture = m_textures[i];
+		texture = Texture::MakeUnique();
+		XUSG_N_RETURN(texture->Initialize(pDevice, format), false);
+		texture->Create(pNativeDevice, resource.get(), ((name ? wstring(name) + L"." : wstring()) +
+			wstring(resourceName.cbegin(), resourceName.cend())).c_str());
+
+		// Textures wrapped from native handles have no auto views.
+		const auto descriptorHeapStart = texture->AllocateCbvSrvUavHeap(2);
+		m_srvs[i] = texture->CreateSRV(descriptorHeapStart, 0, 1);
+		m_uavs[i] = texture->CreateUAV(descriptorHeapStart, 1, 1);
+		XUSG_N_RETURN(m_srvs[i] && m_uavs[i], false);
+
+		m_resources[i] = texture.get();
+	}
+
+	return true;
+}
+
+void FilterGraphExecutor::SetImported(FilterGraph::ResourceId resource, Resource* pResource)
+{
+	assert(resource < m_resources.size() && !m_textures[resource]);
+	m_resources[resource] = pResource;
+}
+
+void FilterGraphExecutor::SetBarriers(CommandList* pCommandList, uint32_t step, ResourceStateTracker& stateTracker) const
+{
+	assert(step < m_plan.Steps.size());
+	const auto& planStep = m_plan.Steps[step];
+
+	const auto numAliasingBarriers = static_cast<uint32_t>(planStep.AliasingBarriers.size());
+	const auto pNativeCommandList = static_cast<ID3D12GraphicsCommandList*>(pCommandList->GetHandle());
+	if (numAliasingBarriers > 0 && pNativeCommandList)
+	{
+		// XUSG barriers have no aliasing type, so record them natively.
+		vector<D3D12_RESOURCE_BARRIER> aliasingBarriers(numAliasingBarriers);
+		for (auto i = 0u; i < numAliasingBarriers; ++i)
+		{
+			const auto& aliasingBarrier = planStep.AliasingBarriers[i];
+			auto& barrier = aliasingBarriers[i];
+			barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+			barrier.Aliasing.pResourceBefore = aliasingBarrier.Before != FilterGraph::InvalidId ?
+				static_cast<ID3D12Resource*>(m_resources[aliasingBarrier.Before]->GetHandle()) : nullptr;
+			barrier.Aliasing.pResourceAfter = static_cast<ID3D12Resource*>(m_resources[aliasingBarrier.After]->GetHandle());
+		}
+
+		pNativeCommandList->ResourceBarrier(numAliasingBarriers, aliasingBarriers.data());
+	}
+	else if (numAliasingBarriers > 0)
+	{
+		// Command lists without a native one, such as recording ones, take them as
+		// barriers with a resource after.
+		vector<ResourceBarrier> aliasingBarriers(numAliasingBarriers);
+		for (auto i = 0u; i < numAliasingBarriers; ++i)
+		{
+			const auto& aliasingBarrier = planStep.AliasingBarriers[i];
+			auto& barrier = aliasingBarriers[i];
+			barrier.pResource = aliasingBarrier.Before != FilterGraph::InvalidId ? m_resources[aliasingBarrier.Before] : nullptr;
+			barrier.StateBefore = ResourceState::COMMON;
+			barrier.StateAfter = ResourceState::COMMON;
+			barrier.Subresource = XUSG_BARRIER_ALL_SUBRESOURCES;
+			barrier.Flags = BarrierFlag::NONE;
+			barrier.pResourceAfter = m_resources[aliasingBarrier.After];
+		}
+
+		pCommandList->Barrier(numAliasingBarriers, aliasingBarriers.data());
+	}
+
+	setBarriers(stateTracker, planStep.Barriers);
+}
+
+void FilterGraphExecutor::SetFinalBarriers(ResourceStateTracker& stateTracker) const
+{
+	setBarriers(stateTracker, m_plan.FinalBarriers);
+}
+
+void FilterGraphExecutor::Execute(CommandList* pCommandList, ResourceStateTracker& stateTracker,
+	const function<void(CommandList*, FilterGraph::PassId)>& recordPass) const
+{
+	for (auto i = 0u; i < GetNumSteps(); ++i)
+	{
+		SetBarriers(pCommandList, i, stateTracker);
+		stateTracker.Flush(pCommandList);
+		recordPass(pCommandList, GetPass(i));
+	}
+
+	SetFinalBarriers(stateTracker);
+	stateTracker.Flush(pCommandList);
+}
+
+uint32_t FilterGraphExecutor::GetNumSteps() const
+{
+	return static_cast<uint32_t>(m_plan.Steps.size());
+}
+
+FilterGraph::PassId FilterGraphExecutor::GetPass(uint32_t step) const
+{
+	assert(step < m_plan.Steps.size());
+
+	return m_plan.Steps[step].Pass;
+}
+
+Texture* FilterGraphExecutor::GetTexture(FilterGraph::ResourceId resource) const
+{
+	assert(resource < m_textures.size());
+
+	return m_textures[resource].get();
+}
+
+const Descriptor& FilterGraphExecutor::GetSRV(FilterGraph::ResourceId resource) const
+{
+	assert(resource < m_srvs.size());
+
+	return m_srvs[resource];
+}
+
+const Descriptor& FilterGraphExecutor::GetUAV(FilterGraph::ResourceId resource) const
+{
+	assert(resource < m_uavs.size());
+
+	return m_uavs[resource];
+}
+
+uint64_t FilterGraphExecutor::GetHeapSize() const
+{
+	return m_plan.HeapSize;
+}
+
+uint64_t FilterGraphExecutor::GetUnaliasedHeapSize() const
+{
+	return m_plan.UnaliasedHeapSize;
+}
+
+ResourceState FilterGraphExecutor::GetResourceState(FilterGraph::Access access)
+{
+	switch (access)
+	{
+	case FilterGraph::ACCESS_SHADER_READ:
+		return ResourceState::NON_PIXEL_SHADER_RESOURCE;
+	case FilterGraph::ACCESS_UNORDERED_WRITE:
+		return ResourceState::UNORDERED_ACCESS;
+	case FilterGraph::ACCESS_COPY_READ:
+		return ResourceState::COPY_SOURCE;
+	case FilterGraph::ACCESS_COPY_WRITE:
+		return ResourceState::COPY_DEST;
+	default:
+		return ResourceState::COMMON;
+	}
+}
+
+void FilterGraphExecutor::setBarriers(ResourceStateTracker& stateTracker, const vector<FilterGraph::Barrier>& barriers) const
+{
+	// Transition from the tracked states, which also covers imported textures in states
+	// unknown to the graph; a write after a write gets a UAV barrier.
+	for (const auto& barrier : barriers)
+	{
+		assert(m_resources[barrier.Resource]);
+		stateTracker.Transition(m_resources[barrier.Resource], GetResourceState(barrier.After));
+	}
+}
@@ -0,0 +1,58 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <functional>
+#include "Core/XUSG.h"
+#include "FilterGraph.h"
+#include "ResourceStateTracker.h"
+
+// Backs a compiled filter graph: the transient textures are placed in one heap at the
+// offsets of the plan, and the transitions of each step are requested from a state
+// tracker. Imported textures are bound per execution, and transitioned from their
+// tracked states.
+class FilterGraphExecutor
+{
+public:
+	FilterGraphExecutor();
+	virtual ~FilterGraphExecutor();
+
+	// Fills Size and Alignment of the description of a transient texture.
+	static bool GetTextureDesc(const XUSG::Device* pDevice, uint32_t width, uint32_t height,
+		XUSG::Format format, FilterGraph::TextureDesc& desc);
+
+	// The textures of a previous plan are handed over in retiredResources; each keeps
+	// its heap alive.
+	bool Create(const XUSG::Device* pDevice, const FilterGraph& graph, const FilterGraph::Plan& plan,
+		std::vector<XUSG::Resource::uptr>& retiredResources, const wchar_t* name = nullptr);
+	void SetImported(FilterGraph::ResourceId resource, XUSG::Resource* pResource);
+
+	// Records the aliasing barriers of the step, and requests its transitions, which are
+	// recorded at the next flush of the tracker.
+	void SetBarriers(XUSG::CommandList* pCommandList, uint32_t step, ResourceStateTracker& stateTracker) const;
+	void SetFinalBarriers(ResourceStateTracker& stateTracker) const;
+	// Runs all steps of a single graph.
+	void Execute(XUSG::CommandList* pCommandList, ResourceStateTracker& stateTracker,
+		const std::function<void(XUSG::CommandList*, FilterGraph::PassId)>& recordPass) const;
+
+	uint32_t GetNumSteps() const;
+	FilterGraph::PassId GetPass(uint32_t step) const;
+	XUSG::Texture* GetTexture(FilterGraph::ResourceId resource) const;
+	const XUSG::Descriptor& GetSRV(FilterGraph::ResourceId resource) const;
+	const XUSG::Descriptor& GetUAV(FilterGraph::ResourceId resource) const;
+	uint64_t GetHeapSize() const;
+	uint64_t GetUnaliasedHeapSize() const;
+
+	static XUSG::ResourceState GetResourceState(FilterGraph::Access access);
+
+protected:
+	void setBarriers(ResourceStateTracker& stateTracker, const std::vector<FilterGraph::Barrier>& barriers) const;
+
+	FilterGraph::Plan					m_plan;
+	std::vector<XUSG::Texture::uptr>	m_textures;
+	std::vector<XUSG::Resource*>		m_resources;
+	std::vector<XUSG::Descriptor>		m_srvs;
+	std::vector<XUSG::Descriptor>		m_uavs;
+};
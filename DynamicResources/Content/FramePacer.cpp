@@ -0,0 +1,143 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include "FramePacer.h"
+
+using namespace std;
+
+FramePacer::FramePacer() :
+	m_targetFrameTime(0.0),
+	m_wakeUpMargin(0.0005),
+	m_sleepGranularity(0.002),
+	m_deadline(0.0),
+	m_frameStart(0.0),
+	m_frameEnd(0.0),
+	m_cpuBusyEstimate(0.0),
+	m_signaledFenceValue(0),
+	m_maxFramesInFlight(3),
+	m_isFirstFrame(true),
+	m_numFrames(0),
+	m_numOverlapped(0),
+	m_numCompleted(0),
+	m_cpuBusy(0.0),
+	m_cpuWait(0.0),
+	m_gpuLatency(0.0)
+{
+}
+
+FramePacer::~FramePacer()
+{
+}
+
+void FramePacer::SetTargetFrameTime(double seconds)
+{
+	m_targetFrameTime = (max)(seconds, 0.0);
+}
+
+void FramePacer::SetMaxFramesInFlight(uint8_t maxFramesInFlight)
+{
+	m_maxFramesInFlight = (max)(maxFramesInFlight, uint8_t(1));
+}
+
+void FramePacer::SetWakeUpMargin(double seconds)
+{
+	m_wakeUpMargin = (max)(seconds, 0.0);
+}
+
+void FramePacer::SetSleepGranularity(double seconds)
+{
+	m_sleepGranularity = (max)(seconds, 0.0);
+}
+
+uint8_t FramePacer::GetMaxFramesInFlight() const
+{
+	return m_maxFramesInFlight;
+}
+
+uint64_t FramePacer::GetRequiredFenceValue() const
+{
+	// The next frame signals m_signaledFenceValue + 1, and at most
+	// m_maxFramesInFlight frames may be outstanding including it.
+	return m_signaledFenceValue + 1 > m_maxFramesInFlight ?
+		m_signaledFenceValue + 1 - m_maxFramesInFlight : 0;
+}
+
+double FramePacer::GetWaitTime(double now) const
+{
+	if (m_targetFrameTime <= 0.0 || m_isFirstFrame) return 0.0;
+
+	// Start as late as possible, so that the frame is submitted right at its deadline
+	const auto start = m_deadline + m_targetFrameTime - m_cpuBusyEstimate - m_wakeUpMargin;
+
+	return (max)(start - now, 0.0);
+}
+
+double FramePacer::GetSleepTime(double now) const
+{
+	return (max)(GetWaitTime(now) - m_sleepGranularity, 0.0);
+}
+
+void FramePacer::BeginFrame(double now, uint64_t completedFenceValue)
+{
+	updateCompletion(now, completedFenceValue);
+
+	if (!m_isFirstFrame) m_cpuWait += now - m_frameEnd;
+	if (completedFenceValue < m_signaledFenceValue) ++m_numOverlapped;
+
+	// Advance the deadline by one period; resync if the frame already started late
+	const auto deadline = m_deadline + m_targetFrameTime;
+	m_deadline = m_isFirstFrame || deadline < now + m_cpuBusyEstimate ? now + m_cpuBusyEstimate : deadline;
+
+	m_frameStart = now;
+	m_isFirstFrame = false;
+}
+
+void FramePacer::EndFrame(double now, uint64_t signaledFenceValue)
+{
+	const auto cpuBusy = now - m_frameStart;
+	m_cpuBusyEstimate = m_cpuBusyEstimate > 0.0 ? 0.9 * m_cpuBusyEstimate + 0.1 * cpuBusy : cpuBusy;
+	m_cpuBusy += cpuBusy;
+	++m_numFrames;
+
+	m_submissions.push_back({ signaledFenceValue, now });
+	m_signaledFenceValue = signaledFenceValue;
+	m_frameEnd = now;
+}
+
+FramePacer::Stats FramePacer::GetStats(bool reset)
+{
+	Stats stats = {};
+	stats.NumFrames = m_numFrames;
+	if (m_numFrames)
+	{
+		stats.CpuBusy = m_cpuBusy / m_numFrames;
+		stats.CpuWait = m_cpuWait / m_numFrames;
+		stats.Overlap = static_cast<double>(m_numOverlapped) / m_numFrames;
+	}
+	if (m_numCompleted) stats.GpuLatency = m_gpuLatency / m_numCompleted;
+
+	if (reset)
+	{
+		m_numFrames = 0;
+		m_numOverlapped = 0;
+		m_numCompleted = 0;
+		m_cpuBusy = 0.0;
+		m_cpuWait = 0.0;
+		m_gpuLatency = 0.0;
+	}
+
+	return stats;
+}
+
+void FramePacer::updateCompletion(double now, uint64_t completedFenceValue)
+{
+	// Completion is only observed when polled, so the latency is an upper bound.
+	while (!m_submissions.empty() && m_submissions.front().FenceValue <= completedFenceValue)
+	{
+		m_gpuLatency += now - m_submissions.front().Time;
+		++m_numCompleted;
+		m_submissions.pop_front();
+	}
+}
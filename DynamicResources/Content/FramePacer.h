@@ -0,0 +1,78 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+// Frame-pacing policy. It only consumes timestamps (in seconds) and fence values,
+// so the caller owns the actual clock, fence and waiting; this keeps the policy
+// pure and drivable by a fake clock and fence.
+class FramePacer
+{
+public:
+	struct Stats
+	{
+		uint32_t NumFrames;
+		double CpuBusy;		// Average recording and submission time per frame
+		double CpuWait;		// Average time between frames spent waiting or idle
+		double GpuLatency;	// Average submission-to-observed-completion time
+		double Overlap;		// Share of frames recorded while the GPU still had work in flight
+	};
+
+	FramePacer();
+	virtual ~FramePacer();
+
+	void SetTargetFrameTime(double seconds);	// 0 for unlimited
+	void SetMaxFramesInFlight(uint8_t maxFramesInFlight);
+	void SetWakeUpMargin(double seconds);
+	void SetSleepGranularity(double seconds);
+
+	uint8_t GetMaxFramesInFlight() const;
+
+	// Fence value that must be completed before the next frame may be recorded
+	uint64_t GetRequiredFenceValue() const;
+
+	// Time left until the next frame should start; 0 when it may start now
+	double GetWaitTime(double now) const;
+	// Portion of the wait time that is safe to spend in a coarse OS sleep
+	double GetSleepTime(double now) const;
+
+	void BeginFrame(double now, uint64_t completedFenceValue);
+	void EndFrame(double now, uint64_t signaledFenceValue);
+
+	Stats GetStats(bool reset = true);
+
+protected:
+	struct Submission
+	{
+		uint64_t FenceValue;
+		double Time;
+	};
+
+	void updateCompletion(double now, uint64_t completedFenceValue);
+
+	std::deque<Submission> m_submissions;
+
+	double		m_targetFrameTime;
+	double		m_wakeUpMargin;
+	double		m_sleepGranularity;
+	double		m_deadline;
+	double		m_frameStart;
+	double		m_frameEnd;
+	double		m_cpuBusyEstimate;
+
+	uint64_t	m_signaledFenceValue;
+	uint8_t		m_maxFramesInFlight;
+	bool		m_isFirstFrame;
+
+	// Accumulated statistics
+	uint32_t	m_numFrames;
+	uint32_t	m_numOverlapped;
+	uint32_t	m_numCompleted;
+	double		m_cpuBusy;
+	double		m_cpuWait;
+	double		m_gpuLatency;
+};
@@ -0,0 +1,69 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+// Ring of per-frame contexts (command allocators, transient resources and so on).
+// Each slot remembers the fence value signaled by the last frame that used it;
+// a slot may only be reused once the GPU has completed that value. The depth,
+// i.e. the number of frames in flight, is chosen at startup.
+template<typename T>
+class FrameRing
+{
+public:
+	static const uint8_t MaxDepth = 4;
+
+	FrameRing() :
+		m_index(0)
+	{
+	}
+
+	virtual ~FrameRing()
+	{
+	}
+
+	bool Init(uint8_t depth)
+	{
+		if (depth < 1 || depth > MaxDepth) return false;
+
+		m_slots.clear();
+		m_slots.resize(depth);
+		m_index = 0;
+
+		return true;
+	}
+
+	// Retire the current frame, which has signaled fenceValue, and move to the next slot.
+	void Advance(uint64_t fenceValue)
+	{
+		assert(!m_slots.empty());
+		m_slots[m_index].FenceValue = fenceValue;
+		m_index = (m_index + 1) % GetDepth();
+	}
+
+	T& GetCurrent() { return m_slots[m_index].Context; }
+	T& operator[](uint8_t i) { return m_slots[i].Context; }
+
+	// Fence value that must be completed before the current context may be reused
+	uint64_t GetFenceValue() const { return m_slots[m_index].FenceValue; }
+	// Fence value signaled by the last frame that used slot i
+	uint64_t GetFenceValue(uint8_t i) const { return m_slots[i].FenceValue; }
+
+	uint8_t GetIndex() const { return m_index; }
+	uint8_t GetDepth() const { return static_cast<uint8_t>(m_slots.size()); }
+
+protected:
+	struct Slot
+	{
+		T Context = {};
+		uint64_t FenceValue = 0;
+	};
+
+	std::vector<Slot> m_slots;
+	uint8_t m_index;
+};
@@ -0,0 +1,420 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#endif
+#include "HostBenchmark.h"
+#include "CPUImageProc.h"
+#include "DescriptorTableCache.h"
+#include "stb_image.h"
+#include "stb_image_write.h"
+
+using namespace std;
+
+namespace
+{
+	// Keep the optimizer from discarding benchmarked work
+	volatile uint64_t g_sink = 0;
+
+	// Tables of a mock descriptor-table lib, numbered in the order of creation
+	class MockTableSource :
+		public DescriptorTableCache::Source
+	{
+	public:
+		bool CreateTable(const DescriptorKey&, DescriptorTableCache::Entry& entry)
+		{
+			++m_numTables;
+			entry = { m_numTables, static_cast<uint32_t>(m_numTables) };
+
+			return true;
+		}
+
+	protected:
+		uint64_t m_numTables = 0;
+	};
+
+	// Reusable barrier of a fixed number of threads (std::barrier is C++20)
+	class Barrier
+	{
+	public:
+		Barrier(uint32_t numThreads) : m_numThreads(numThreads), m_numArrived(0), m_phase(0) {}
+
+		void Wait()
+		{
+			unique_lock<mutex> lock(m_mutex);
+			const auto phase = m_phase;
+			if (++m_numArrived < m_numThreads)
+				m_condition.wait(lock, [this, phase]() { return m_phase != phase; });
+			else
+			{
+				m_numArrived = 0;
+				++m_phase;
+				m_condition.notify_all();
+			}
+		}
+
+	protected:
+		mutex m_mutex;
+		condition_variable m_condition;
+		uint32_t m_numThreads;
+		uint32_t m_numArrived;
+		uint64_t m_phase;
+	};
+
+	void countBytes(void* context, void*, int size)
+	{
+		*static_cast<size_t*>(context) += size;
+	}
+
+	// Same decode as XUSG::LoadImageFromFile(), which expands RGB to RGBA
+	stbi_uc* loadImage(const char* fileName, int& width, int& height, int& reqChannels)
+	{
+		int channels;
+		if (!stbi_info(fileName, &width, &height, &channels)) return nullptr;
+		reqChannels = channels != 3 ? channels : 4;
+
+		return stbi_load(fileName, &width, &height, &channels, reqChannels);
+	}
+
+	// CPU time of the calling thread in seconds, which std::clock() is not on every platform
+	double getThreadCpuTime()
+	{
+#ifdef _WIN32
+		FILETIME creationTime, exitTime, kernelTime, userTime;
+		if (!GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime)) return 0.0;
+		const auto toSeconds = [](const FILETIME& t)
+		{
+			return ((static_cast<uint64_t>(t.dwHighDateTime) << 32) | t.dwLowDateTime) * 1e-7;
+		};
+
+		return toSeconds(kernelTime) + toSeconds(userTime);
+#else
+		timespec t;
+		if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t)) return 0.0;
+
+		return t.tv_sec + t.tv_nsec * 1e-9;
+#endif
+	}
+
+	bool getLocalTime(tm& dateTime, time_t t)
+	{
+#ifdef _WIN32
+		return !localtime_s(&dateTime, &t);
+#else
+		return localtime_r(&t, &dateTime) != nullptr;
+#endif
+	}
+}
+
+HostBenchmark::HostBenchmark() :
+	m_minTime(0.5)
+{
+}
+
+HostBenchmark::~HostBenchmark()
+{
+}
+
+bool HostBenchmark::Run(const char* imageFileName, const char* outFileName)
+{
+	m_results.clear();
+
+	// Image decode
+	int width, height, reqChannels;
+	{
+		const auto pData = loadImage(imageFileName, width, height, reqChannels);
+		if (!pData)
+		{
+			cerr << "HostBenchmark: failed to load " << imageFileName << endl;
+
+			return false;
+		}
+		stbi_image_free(pData);
+	}
+
+	measure("BM_LoadImageFromFile", [imageFileName]()
+	{
+		int w, h, c;
+		const auto pData = loadImage(imageFileName, w, h, c);
+		g_sink = g_sink + (pData ? pData[0] : 0);
+		stbi_image_free(pData);
+	});
+
+	// SaveImage repack and encode, from a 256-byte pitch-aligned readback layout
+	{
+		const auto w = static_cast<uint32_t>(width);
+		const auto h = static_cast<uint32_t>(height);
+		const auto rowPitch = (4 * w + 255) / 256 * 256;
+		vector<uint8_t> readBack(rowPitch * h, 0x7f);
+		vector<uint8_t> imageData(3 * w * h);
+
+		measure("BM_SaveImage_Repack", [&]()
+		{
+			CPUImageProc::Repack(imageData.data(), readBack.data(), w, h, rowPitch);
+			g_sink = g_sink + imageData[0];
+		});
+
+		measure("BM_SaveImage_Encode", [&]()
+		{
+			size_t size = 0;
+			stbi_write_png_to_func(countBytes, &size, w, h, 3, imageData.data(), 0);
+			g_sink = g_sink + size;
+		});
+	}
+
+	// Gaussian weight generation
+	for (const auto radius : { 4u, 8u, 16u, 32u })
+	{
+		vector<float> weights(2 * radius + 1);
+		measure("BM_GaussianWeights/" + to_string(radius), [&weights, radius]()
+		{
+			CPUImageProc::GenerateGaussianWeights(weights.data(), radius);
+			g_sink = g_sink + static_cast<uint64_t>(weights[radius] * 1000.0f);
+		});
+	}
+
+	// Descriptor-table key building and lookup, mocking the content-keyed cache
+	// of DescriptorTableLib with string keys made of raw descriptor bytes
+	for (const auto numTables : { 64u, 1024u, 8192u })
+	{
+		const uint32_t numDescriptors = 2;
+		vector<uintptr_t> descriptors(numDescriptors * numTables);
+		for (size_t i = 0; i < descriptors.size(); ++i) descriptors[i] = 0x10000 + 32 * i;
+
+		const auto makeKey = [&descriptors](uint32_t i)
+		{
+			string key(sizeof(uintptr_t) * numDescriptors, '\0');
+			memcpy(&key[0], &descriptors[numDescriptors * i], key.size());
+
+			return key;
+		};
+
+		unordered_map<string, uint32_t> tableLib;
+		for (auto i = 0u; i < numTables; ++i) tableLib.emplace(makeKey(i), i);
+
+		measure("BM_DescriptorTableKey/" + to_string(numTables), [&]()
+		{
+			for (auto i = 0u; i < numTables; ++i) g_sink = g_sink + makeKey(i).size();
+		});
+
+		measure("BM_DescriptorTableLookup/" + to_string(numTables), [&]()
+		{
+			for (auto i = 0u; i < numTables; ++i) g_sink = g_sink + tableLib.find(makeKey(i))->second;
+		});
+
+		// Same descriptors through the inline binary keys and hash map of DescriptorTableCache,
+		// which hits on every lookup once the tables are created
+		const auto makeHashedKey = [&descriptors](uint32_t i)
+		{
+			DescriptorKey key;
+			key.Set(DescriptorTableCache::CbvSrvUavHeap, &descriptors[numDescriptors * i], numDescriptors);
+
+			return key;
+		};
+
+		DescriptorTableCache tableCache;
+		tableCache.Init(make_shared<MockTableSource>());
+		for (auto i = 0u; i < numTables; ++i) tableCache.GetCbvSrvUavTable(&descriptors[numDescriptors * i], numDescriptors);
+
+		measure("BM_DescriptorTableHashedKey/" + to_string(numTables), [&]()
+		{
+			for (auto i = 0u; i < numTables; ++i) g_sink = g_sink + makeHashedKey(i).Hash();
+		});
+
+		measure("BM_DescriptorTableHashedLookup/" + to_string(numTables), [&]()
+		{
+			for (auto i = 0u; i < numTables; ++i)
+				g_sink = g_sink + tableCache.GetCbvSrvUavTable(&descriptors[numDescriptors * i], numDescriptors).Index;
+		});
+
+		if (tableCache.GetNumMisses() != numTables)
+		{
+			cerr << "HostBenchmark: " << tableCache.GetNumMisses() << " descriptor-table cache misses for "
+				<< numTables << " tables" << endl;
+
+			return false;
+		}
+	}
+
+	// Concurrent descriptor-cache lookups from several recording threads, backed by a mock
+	// heap whose tables are a pure function of the descriptors, so that every hit is checked.
+	// One iteration is a frame: the threads look up a working set that shifts by 1/16 per
+	// frame, so that there are misses to stage, and the staged entries are merged at the end.
+	{
+		const uint32_t numTables = 8192, numDescriptors = 2;
+		const auto mockTable = [](const uintptr_t* pDescriptors) { return 3 * pDescriptors[0] + pDescriptors[1]; };
+
+		atomic<uint32_t> numErrors(0);
+		for (const auto numThreads : { 1u, 2u, 4u, 8u })
+		{
+			ConcurrentKeyCache<DescriptorKey, uint64_t> cache;
+			cache.Init(numThreads);
+
+			// The threads are started once; each iteration releases them on a barrier and waits
+			// for them on another one, so that only the lookups and the merge are measured.
+			Barrier start(numThreads + 1), finish(numThreads + 1);
+			auto base = 0u;
+			auto isRunning = true;
+			vector<thread> threads;
+			for (auto t = 0u; t < numThreads; ++t) threads.emplace_back([&, t]()
+			{
+				for (;;)
+				{
+					start.Wait();
+					if (!isRunning) break;
+
+					for (auto i = t; i < numTables; i += numThreads)
+					{
+						// Scatter, so that the threads overlap on the keys
+						const uintptr_t id = base + (i * 2654435761u + 7 * t) % numTables;
+						const uintptr_t descriptors[numDescriptors] = { 0x10000 + 32 * id, 0x10000 + 32 * id + 32 };
+
+						DescriptorKey key;
+						key.Set(DescriptorTableCache::CbvSrvUavHeap, descriptors, numDescriptors);
+						const auto hash = key.Hash();
+						const auto pTable = cache.Find(t, key, hash);
+						if (!pTable) cache.Insert(t, key, hash, mockTable(descriptors));
+						else if (*pTable != mockTable(descriptors)) ++numErrors;
+					}
+
+					finish.Wait();
+				}
+			});
+
+			auto frame = 0u;
+			measure("BM_ConcurrentDescriptorLookup/" + to_string(numThreads), [&]()
+			{
+				base = (frame++ % 256) * (numTables / 16);
+				start.Wait();
+				finish.Wait();
+				g_sink = g_sink + cache.Merge();
+			});
+
+			isRunning = false;
+			start.Wait();
+			for (auto& thread : threads) thread.join();
+		}
+
+		if (numErrors > 0)
+		{
+			cerr << "HostBenchmark: " << numErrors << " inconsistent concurrent descriptor-cache hits" << endl;
+
+			return false;
+		}
+	}
+
+	// CPU blur reference at several radii and sizes
+	{
+		mt19937 rng(0);
+		for (const auto size : { 128u, 512u, 1024u })
+		{
+			vector<uint8_t> noise(4 * size * size);
+			for (auto& c : noise) c = static_cast<uint8_t>(rng());
+
+			CPUImageProc imageProc;
+			imageProc.Init(noise.data(), size, size, 4);
+			for (const auto radius : { 4u, 8u, 16u })
+			{
+				measure("BM_CPUBlur/" + to_string(size) + "/" + to_string(radius), [&imageProc, radius]()
+				{
+					imageProc.Process(radius);
+					g_sink = g_sink + imageProc.GetResult()[0];
+				});
+			}
+		}
+	}
+
+	return writeJson(outFileName);
+}
+
+void HostBenchmark::SetMinTime(double seconds)
+{
+	m_minTime = seconds;
+}
+
+void HostBenchmark::measure(const string& name, const function<void()>& func)
+{
+	using clock = chrono::steady_clock;
+
+	// Warm up once, then grow the iteration count until the batch is long enough
+	func();
+
+	uint64_t iterations = 1;
+	double realTime, cpuTime;
+	for (;;)
+	{
+		// The CPU time is the one of this thread, so threads spawned by func() are not included.
+		const auto cpuStart = getThreadCpuTime();
+		const auto start = clock::now();
+		for (uint64_t i = 0; i < iterations; ++i) func();
+		realTime = chrono::duration<double>(clock::now() - start).count();
+		cpuTime = getThreadCpuTime() - cpuStart;
+
+		if (realTime >= m_minTime || iterations >= (1ull << 30)) break;
+		const auto scale = realTime > 0.0 ? 1.4 * m_minTime / realTime : 10.0;
+		iterations = static_cast<uint64_t>(iterations * (min)((max)(scale, 2.0), 10.0));
+	}
+
+	m_results.push_back({ name, iterations, realTime * 1e9 / iterations, cpuTime * 1e9 / iterations });
+	cout << left << setw(36) << name << right << setw(14) << fixed << setprecision(0)
+		<< m_results.back().RealTime << " ns" << setw(12) << iterations << endl;
+}
+
+bool HostBenchmark::writeJson(const char* fileName) const
+{
+	ofstream file(fileName);
+	if (!file) return false;
+
+	char timeStr[32] = {};
+	tm dateTime;
+	if (getLocalTime(dateTime, time(nullptr))) strftime(timeStr, sizeof(timeStr), "%Y-%m-%dT%H:%M:%S", &dateTime);
+
+	file << "{" << endl;
+	file << "  \"context\": {" << endl;
+	file << "    \"date\": \"" << timeStr << "\"," << endl;
+	file << "    \"executable\": \"DynamicResources\"," << endl;
+	file << "    \"library_build_type\": \"" <<
+#if defined(_DEBUG)
+		"debug"
+#else
+		"release"
+#endif
+		<< "\"" << endl;
+	file << "  }," << endl;
+	file << "  \"benchmarks\": [" << endl;
+	for (size_t i = 0; i < m_results.size(); ++i)
+	{
+		const auto& result = m_results[i];
+		file << "    {" << endl;
+		file << "      \"name\": \"" << result.Name << "\"," << endl;
+		file << "      \"run_name\": \"" << result.Name << "\"," << endl;
+		file << "      \"run_type\": \"iteration\"," << endl;
+		file << "      \"iterations\": " << result.Iterations << "," << endl;
+		file << "      \"real_time\": " << fixed << setprecision(3) << result.RealTime << "," << endl;
+		file << "      \"cpu_time\": " << fixed << setprecision(3) << result.CpuTime << "," << endl;
+		file << "      \"time_unit\": \"ns\"" << endl;
+		file << "    }" << (i + 1 < m_results.size() ? "," : "") << endl;
+	}
+	file << "  ]" << endl;
+	file << "}" << endl;
+
+	return true;
+}
@@ -0,0 +1,40 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Microbenchmarks of the host-side hot paths. Neither a device nor XUSG is needed,
+// so they also build standalone (see CMakeLists.txt); the results are written in the
+// Google Benchmark JSON layout so that existing trend tools can consume them.
+class HostBenchmark
+{
+public:
+	HostBenchmark();
+	virtual ~HostBenchmark();
+
+	bool Run(const char* imageFileName, const char* outFileName);
+
+	void SetMinTime(double seconds);
+
+protected:
+	struct Result
+	{
+		std::string Name;
+		uint64_t Iterations;
+		double RealTime;	// ns per iteration
+		double CpuTime;		// ns per iteration
+	};
+
+	void measure(const std::string& name, const std::function<void()>& func);
+	bool writeJson(const char* fileName) const;
+
+	std::vector<Result> m_results;
+
+	double m_minTime;
+};
@@ -0,0 +1,246 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include "ImageValidator.h"
+#include "CPUImageProc.h"
+#include "stb_image.h"
+#include "stb_image_write.h"
+
+using namespace std;
+
+namespace
+{
+	// Odd sizes, so that the 8x8 groups at the right and bottom edges are partial
+	struct CorpusEntry
+	{
+		ImageValidator::Pattern Pattern;
+		uint32_t Width;
+		uint32_t Height;
+	};
+
+	const CorpusEntry g_corpus[] =
+	{
+		{ ImageValidator::PATTERN_GRADIENT, 37, 29 },
+		{ ImageValidator::PATTERN_GRADIENT, 257, 131 },
+		{ ImageValidator::PATTERN_EDGES, 65, 17 },
+		{ ImageValidator::PATTERN_EDGES, 9, 203 },
+		{ ImageValidator::PATTERN_NOISE, 45, 45 },
+		{ ImageValidator::PATTERN_NOISE, 199, 71 }
+	};
+
+	const char* const g_patternNames[] = { "gradient", "edges", "noise" };
+
+	double luma(const uint8_t* pPixel)
+	{
+		return 0.299 * pPixel[0] + 0.587 * pPixel[1] + 0.114 * pPixel[2];
+	}
+}
+
+ImageValidator::ImageValidator()
+{
+}
+
+ImageValidator::~ImageValidator()
+{
+}
+
+bool ImageValidator::Run(const char* imageFileName, const char* goldenDir, bool isRecording)
+{
+	auto passed = true;
+	CPUImageProc imageProc;
+	uint32_t width, height;
+
+	// Real image
+	if (imageProc.Init(imageFileName))
+	{
+		imageProc.Process();
+		imageProc.GetImageSize(width, height);
+
+		// Golden name from the file stem
+		string name = imageFileName;
+		name = name.substr(name.find_last_of("/\\") + 1);
+		name = name.substr(0, name.find_last_of('.'));
+		passed = validate(name, imageProc.GetResult(), width, height, goldenDir, isRecording) && passed;
+	}
+	else
+	{
+		cerr << "ImageValidator: cannot load " << imageFileName << endl;
+		passed = false;
+	}
+
+	// Synthetic corpus
+	vector<uint8_t> image;
+	for (const auto& entry : g_corpus)
+	{
+		GeneratePattern(image, entry.Pattern, entry.Width, entry.Height);
+		imageProc.Init(image.data(), entry.Width, entry.Height, 4);
+		imageProc.Process();
+
+		const auto name = string(g_patternNames[entry.Pattern]) + "_" +
+			to_string(entry.Width) + "x" + to_string(entry.Height);
+		passed = validate(name, imageProc.GetResult(), entry.Width, entry.Height, goldenDir, isRecording) && passed;
+	}
+
+	return passed;
+}
+
+void ImageValidator::SetThresholds(const Thresholds& thresholds)
+{
+	m_thresholds = thresholds;
+}
+
+const ImageValidator::Thresholds& ImageValidator::GetThresholds() const
+{
+	return m_thresholds;
+}
+
+bool ImageValidator::Check(const Metrics& metrics) const
+{
+	return metrics.MaxAbsError <= m_thresholds.MaxAbsError &&
+		metrics.PSNR >= m_thresholds.MinPSNR && metrics.SSIM >= m_thresholds.MinSSIM;
+}
+
+ImageValidator::Metrics ImageValidator::Compare(const uint8_t* pImage, const uint8_t* pReference,
+	uint32_t width, uint32_t height)
+{
+	Metrics metrics = {};
+
+	// Max-abs-error and PSNR over all channels
+	const auto numValues = 4ull * width * height;
+	auto sse = 0.0;
+	for (size_t i = 0; i < numValues; ++i)
+	{
+		const auto e = abs(static_cast<int>(pImage[i]) - static_cast<int>(pReference[i]));
+		metrics.MaxAbsError = (max)(metrics.MaxAbsError, static_cast<uint8_t>(e));
+		sse += static_cast<double>(e) * e;
+	}
+
+	const auto mse = sse / numValues;
+	metrics.PSNR = mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : INFINITY;
+
+	// Mean SSIM of luma over 8x8 windows with a stride of 4
+	const auto c1 = (0.01 * 255.0) * (0.01 * 255.0);
+	const auto c2 = (0.03 * 255.0) * (0.03 * 255.0);
+	const auto winW = (min)(width, 8u);
+	const auto winH = (min)(height, 8u);
+
+	auto ssimSum = 0.0;
+	auto numWindows = 0u;
+	for (auto y = 0u; y + winH <= height; y += 4)
+	{
+		for (auto x = 0u; x + winW <= width; x += 4)
+		{
+			double muA = 0.0, muB = 0.0, a2 = 0.0, b2 = 0.0, ab = 0.0;
+			for (auto j = y; j < y + winH; ++j)
+			{
+				for (auto i = x; i < x + winW; ++i)
+				{
+					const auto idx = 4 * (static_cast<size_t>(width) * j + i);
+					const auto a = luma(&pImage[idx]);
+					const auto b = luma(&pReference[idx]);
+					muA += a;
+					muB += b;
+					a2 += a * a;
+					b2 += b * b;
+					ab += a * b;
+				}
+			}
+
+			const double n = winW * winH;
+			muA /= n;
+			muB /= n;
+			const auto varA = a2 / n - muA * muA;
+			const auto varB = b2 / n - muB * muB;
+			const auto covAB = ab / n - muA * muB;
+
+			ssimSum += ((2.0 * muA * muB + c1) * (2.0 * covAB + c2)) /
+				((muA * muA + muB * muB + c1) * (varA + varB + c2));
+			++numWindows;
+		}
+	}
+
+	metrics.SSIM = numWindows ? ssimSum / numWindows : 1.0;
+
+	return metrics;
+}
+
+void ImageValidator::GeneratePattern(vector<uint8_t>& image, Pattern pattern, uint32_t width, uint32_t height)
+{
+	image.resize(4ull * width * height);
+	mt19937 rng(width * 7919u + height);
+
+	for (auto y = 0u; y < height; ++y)
+	{
+		for (auto x = 0u; x < width; ++x)
+		{
+			const auto pPixel = &image[4 * (static_cast<size_t>(width) * y + x)];
+			switch (pattern)
+			{
+			case PATTERN_GRADIENT:
+				pPixel[0] = static_cast<uint8_t>(255 * x / (max)(width - 1, 1u));
+				pPixel[1] = static_cast<uint8_t>(255 * y / (max)(height - 1, 1u));
+				pPixel[2] = static_cast<uint8_t>(255 * (x + y) / (max)(width + height - 2, 1u));
+				pPixel[3] = 255;
+				break;
+			case PATTERN_EDGES:
+			{
+				// Checkerboard with a period that is not a multiple of the group size
+				const auto on = ((x / 5) + (y / 5)) & 1;
+				pPixel[0] = on ? 255 : 0;
+				pPixel[1] = on ? 0 : 255;
+				pPixel[2] = x == width - 1 || y == height - 1 ? 255 : 0;
+				pPixel[3] = 255;
+				break;
+			}
+			default:
+				for (uint8_t k = 0; k < 4; ++k) pPixel[k] = static_cast<uint8_t>(rng());
+			}
+		}
+	}
+}
+
+bool ImageValidator::validate(const string& name, const uint8_t* pResult, uint32_t width,
+	uint32_t height, const string& goldenDir, bool isRecording)
+{
+	const auto fileName = goldenDir + "/" + name + ".png";
+
+	int w, h, comp;
+	const auto pGolden = stbi_load(fileName.c_str(), &w, &h, &comp, 4);
+	if (!pGolden)
+	{
+		// A wrong golden directory must not pass silently.
+		if (!isRecording)
+		{
+			cout << left << setw(24) << name << "FAILED  missing " << fileName << endl;
+
+			return false;
+		}
+
+		const auto recorded = stbi_write_png(fileName.c_str(), width, height, 4, pResult, 0) != 0;
+		cout << left << setw(24) << name << (recorded ? "recorded" : "FAILED to record") << endl;
+
+		return recorded;
+	}
+
+	auto passed = static_cast<uint32_t>(w) == width && static_cast<uint32_t>(h) == height;
+	if (passed)
+	{
+		const auto metrics = Compare(pResult, pGolden, width, height);
+		passed = Check(metrics);
+		cout << left << setw(24) << name << (passed ? "passed" : "FAILED") << fixed << setprecision(4)
+			<< "  max-abs: " << static_cast<uint32_t>(metrics.MaxAbsError)
+			<< "  PSNR: " << metrics.PSNR << "  SSIM: " << metrics.SSIM << endl;
+	}
+	else cout << left << setw(24) << name << "FAILED  size mismatch" << endl;
+
+	stbi_image_free(pGolden);
+
+	return passed;
+}
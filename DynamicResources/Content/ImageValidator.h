@@ -0,0 +1,61 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Golden-image regression checks for the image filters. Results are compared
+// with perceptual tolerances rather than bit-exactly, so that reordered math in
+// the shader or in the CPU path does not trip the check, but visible changes do.
+class ImageValidator
+{
+public:
+	struct Metrics
+	{
+		uint8_t MaxAbsError;
+		double PSNR;
+		double SSIM;
+	};
+
+	struct Thresholds
+	{
+		uint8_t MaxAbsError = 2;
+		double MinPSNR = 45.0;
+		double MinSSIM = 0.995;
+	};
+
+	enum Pattern : uint8_t
+	{
+		PATTERN_GRADIENT,
+		PATTERN_EDGES,
+		PATTERN_NOISE,
+
+		NUM_PATTERN
+	};
+
+	ImageValidator();
+	virtual ~ImageValidator();
+
+	// Runs the CPU filter over the corpus and checks against the goldens. A missing golden
+	// fails the check, unless recording, which writes it instead.
+	bool Run(const char* imageFileName, const char* goldenDir, bool isRecording = false);
+
+	void SetThresholds(const Thresholds& thresholds);
+	const Thresholds& GetThresholds() const;
+
+	bool Check(const Metrics& metrics) const;
+
+	// Both images are tightly packed RGBA8.
+	static Metrics Compare(const uint8_t* pImage, const uint8_t* pReference, uint32_t width, uint32_t height);
+	static void GeneratePattern(std::vector<uint8_t>& image, Pattern pattern, uint32_t width, uint32_t height);
+
+protected:
+	bool validate(const std::string& name, const uint8_t* pResult, uint32_t width,
+		uint32_t height, const std::string& goldenDir, bool isRecording);
+
+	Thresholds m_thresholds;
+};
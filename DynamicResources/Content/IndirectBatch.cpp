@@ -0,0 +1,116 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <cassert>
+#include "IndirectBatch.h"
+
+using namespace std;
+using namespace XUSG;
+
+IndirectBatch::IndirectBatch() :
+	m_numJobs(0),
+	m_numLists(0)
+{
+}
+
+IndirectBatch::~IndirectBatch()
+{
+}
+
+bool IndirectBatch::Init(const Device* pDevice, const PipelineLayout& pipelineLayout,
+	const vector<uint32_t>& jobs, uint32_t numJobs, uint32_t numBuiltLists,
+	UploadManager* pUploadManager)
+{
+	XUSG_C_RETURN(numJobs == 0 || jobs.empty() || jobs.size() % numJobs, false);
+	m_numJobs = numJobs;
+	m_numLists = static_cast<uint32_t>(jobs.size() / numJobs);
+
+	// The record address is set per command, since the command layout changes root constants.
+	IndirectArgument arguments[2] = {};
+	arguments[0].Type = IndirectArgumentType::CONSTANT;
+	arguments[0].Constant.Index = 0;
+	arguments[0].Constant.DestOffsetIn32BitValues = 0;
+	arguments[0].Constant.Num32BitValuesToSet = XUSG_UINT32_SIZE_OF(uint64_t);
+	arguments[1].Type = IndirectArgumentType::DISPATCH;
+	m_commandLayout = CommandLayout::MakeUnique();
+	XUSG_N_RETURN(m_commandLayout->Create(pDevice, ArgumentStride, static_cast<uint32_t>(size(arguments)),
+		arguments, pipelineLayout, 0, L"DispatchLayout"), false);
+
+	// The jobs are bound as a root SRV, the arguments and counts as root UAVs, so none needs views.
+	m_jobs = Buffer::MakeUnique();
+	XUSG_N_RETURN(m_jobs->Create(pDevice, sizeof(uint32_t) * jobs.size(), ResourceFlag::NONE,
+		MemoryType::DEFAULT, 0, nullptr, 0, nullptr, MemoryFlag::NONE, L"DispatchJobs"), false);
+	XUSG_N_RETURN(pUploadManager->Upload(m_jobs.get(), jobs.data(), sizeof(uint32_t) * jobs.size()), false);
+
+	m_arguments = Buffer::MakeUnique();
+	XUSG_N_RETURN(m_arguments->Create(pDevice, static_cast<size_t>(ArgumentStride) * numJobs * numBuiltLists,
+		ResourceFlag::ALLOW_UNORDERED_ACCESS, MemoryType::DEFAULT, 0, nullptr, 0, nullptr,
+		MemoryFlag::NONE, L"DispatchArguments"), false);
+
+	m_counts = Buffer::MakeUnique();
+	XUSG_N_RETURN(m_counts->Create(pDevice, sizeof(uint32_t) * numBuiltLists, ResourceFlag::ALLOW_UNORDERED_ACCESS,
+		MemoryType::DEFAULT, 0, nullptr, 0, nullptr, MemoryFlag::NONE, L"DispatchCounts"), false);
+
+	return true;
+}
+
+void IndirectBatch::Build(CommandList* pCommandList, uint64_t tableAddress, uint32_t recordSize,
+	uint32_t firstList, uint32_t numLists) const
+{
+	assert(firstList + numLists <= m_numLists);
+
+	// One group per list
+	const uint32_t cb[] =
+	{
+		static_cast<uint32_t>(tableAddress),
+		static_cast<uint32_t>(tableAddress >> 32),
+		recordSize,
+		m_numJobs,
+		firstList
+	};
+	pCommandList->SetCompute32BitConstants(0, static_cast<uint32_t>(size(cb)), cb);
+	pCommandList->SetComputeRootShaderResourceView(JobsRootIndex, m_jobs.get());
+	pCommandList->SetComputeRootUnorderedAccessView(ArgumentsRootIndex, m_arguments.get());
+	pCommandList->SetComputeRootUnorderedAccessView(CountsRootIndex, m_counts.get());
+	pCommandList->Dispatch(numLists, 1, 1);
+}
+
+void IndirectBatch::Execute(CommandList* pCommandList, uint32_t builtList) const
+{
+	pCommandList->SetCompute32BitConstant(0, 0, XUSG_UINT32_SIZE_OF(uint64_t));
+	pCommandList->ExecuteIndirect(m_commandLayout.get(), m_numJobs, m_arguments.get(),
+		static_cast<uint64_t>(ArgumentStride) * m_numJobs * builtList, m_counts.get(), sizeof(uint32_t) * builtList);
+}
+
+uint32_t IndirectBatch::GetList(uint32_t sequence, uint32_t step, uint32_t numSteps)
+{
+	assert(step < numSteps);
+
+	return numSteps * sequence + step;
+}
+
+Buffer* IndirectBatch::GetJobs() const
+{
+	return m_jobs.get();
+}
+
+Buffer* IndirectBatch::GetArguments() const
+{
+	return m_arguments.get();
+}
+
+Buffer* IndirectBatch::GetCounts() const
+{
+	return m_counts.get();
+}
+
+uint32_t IndirectBatch::GetNumJobs() const
+{
+	return m_numJobs;
+}
+
+uint32_t IndirectBatch::GetNumLists() const
+{
+	return m_numLists;
+}
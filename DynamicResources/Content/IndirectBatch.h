@@ -0,0 +1,65 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Core/XUSG.h"
+#include "UploadManager.h"
+#include "AddressWindows.h"
+
+// Indirect dispatches of a batch of jobs, each a record address set as a root constant
+// followed by a dispatch. The records of the jobs are uploaded once, in lists of equal
+// length; a GPU pass builds the arguments of the lists and their counts from the
+// records (see CSDispatchArgs.hlsl), so the CPU never needs the extents of the jobs.
+class IndirectBatch
+{
+public:
+	// Record address (2 words), then thread-group counts X, Y, Z
+	static const uint32_t ArgumentStride = sizeof(uint64_t) + 3 * sizeof(uint32_t);
+
+	// Root parameters of the pipeline layout of CSDispatchArgs.hlsl after the constants and
+	// the address windows, and their registers: t0, u4 and u5
+	static const uint32_t JobsRootIndex = 1 + AddressWindows::MaxWindows;
+	static const uint32_t ArgumentsRootIndex = 2 + AddressWindows::MaxWindows;
+	static const uint32_t CountsRootIndex = 3 + AddressWindows::MaxWindows;
+	static const uint32_t JobsRegister = 0;
+	static const uint32_t ArgumentsRegister = AddressWindows::MaxWindows;
+	static const uint32_t CountsRegister = AddressWindows::MaxWindows + 1;
+
+	IndirectBatch();
+	virtual ~IndirectBatch();
+
+	// jobs holds numLists lists of numJobs records each, and the arguments hold up to
+	// numBuiltLists lists at a time. The address constant is root parameter 0 of the
+	// pipeline layout. Uploads are only staged.
+	bool Init(const XUSG::Device* pDevice, const XUSG::PipelineLayout& pipelineLayout,
+		const std::vector<uint32_t>& jobs, uint32_t numJobs, uint32_t numBuiltLists,
+		UploadManager* pUploadManager);
+
+	// Records the build of the arguments of numLists lists from firstList on, which become
+	// the built lists 0 to numLists - 1. The pipeline of CSDispatchArgs.hlsl must be set.
+	void Build(XUSG::CommandList* pCommandList, uint64_t tableAddress, uint32_t recordSize,
+		uint32_t firstList, uint32_t numLists) const;
+	// Executes the jobs built for the list at index builtList of the last build. The group
+	// offset after the address constant is zeroed, as the arguments only set the address.
+	void Execute(XUSG::CommandList* pCommandList, uint32_t builtList) const;
+
+	// Index of the list of a step, for sequences of numSteps lists each
+	static uint32_t GetList(uint32_t sequence, uint32_t step, uint32_t numSteps);
+
+	XUSG::Buffer* GetJobs() const;
+	XUSG::Buffer* GetArguments() const;
+	XUSG::Buffer* GetCounts() const;
+	uint32_t GetNumJobs() const;
+	uint32_t GetNumLists() const;
+
+protected:
+	XUSG::CommandLayout::uptr m_commandLayout;
+	XUSG::Buffer::uptr	m_jobs;
+	XUSG::Buffer::uptr	m_arguments;
+	XUSG::Buffer::uptr	m_counts;
+
+	uint32_t			m_numJobs;
+	uint32_t			m_numLists;
+};
@@ -0,0 +1,173 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <cassert>
+#include "RecordTable.h"
+
+using namespace std;
+using namespace XUSG;
+
+RecordTable::RecordTable() :
+	m_versionOffsets(),
+	m_versionSize(0),
+	m_numUploadedBytes(0),
+	m_recordSize(0),
+	m_capacity(0),
+	m_highWaterMark(0)
+{
+}
+
+RecordTable::~RecordTable()
+{
+}
+
+bool RecordTable::Init(const Device* pDevice, uint32_t recordSize, uint32_t capacity,
+	const shared_ptr<AddressWindows>& addressWindows, const wchar_t* name)
+{
+	XUSG_C_RETURN(recordSize == 0 || capacity == 0, false);
+	m_recordSize = recordSize;
+	m_capacity = capacity;
+	m_highWaterMark = 0;
+	m_freeList.clear();
+	m_mirror.assign(static_cast<size_t>(recordSize) * capacity, 0);
+	m_versions.Reset();
+	m_numUploadedBytes = 0;
+
+	// All versions in one buffer, with room for skipping one 4 GB window boundary
+	m_versionSize = XUSG_DIV_UP(m_mirror.size(), 256) * 256;
+	const auto size = m_versionSize * (NumVersions + 1);
+	m_buffer = Buffer::MakeUnique();
+	XUSG_N_RETURN(m_buffer->Create(pDevice, size, ResourceFlag::ALLOW_UNORDERED_ACCESS,
+		MemoryType::DEFAULT, 0, nullptr, 1, nullptr, MemoryFlag::NONE, name), false);
+
+	// Place each version within one window, and map the windows for the shaders
+	m_addressWindows = addressWindows;
+	const auto address = m_buffer->GetVirtualAddress();
+	uint64_t offset = 0;
+	for (auto& versionOffset : m_versionOffsets)
+	{
+		XUSG_N_RETURN(AddressWindows::PlaceRange(address, offset, m_versionSize, 256, size), false);
+		XUSG_C_RETURN(m_addressWindows->Register(address + offset, m_versionSize) == AddressWindows::InvalidWindow, false);
+		versionOffset = offset;
+		offset += m_versionSize;
+	}
+
+	return true;
+}
+
+uint32_t RecordTable::Allocate()
+{
+	uint32_t record;
+	if (!m_freeList.empty())
+	{
+		record = m_freeList.back();
+		m_freeList.pop_back();
+	}
+	else if (m_highWaterMark < m_capacity) record = m_highWaterMark++;
+	else return UINT32_MAX;
+
+	// The GPU copy may differ from the mirror, so the first upload covers the whole record.
+	m_versions.MarkDirty(m_recordSize * record, m_recordSize * (record + 1));
+
+	return record;
+}
+
+void RecordTable::Free(uint32_t record)
+{
+	assert(record < m_highWaterMark);
+	m_freeList.push_back(record);
+}
+
+void RecordTable::Write(uint32_t record, const void* pData, uint32_t size, uint32_t offset)
+{
+	assert(record < m_capacity && offset + size <= m_recordSize);
+	const auto pSrc = static_cast<const uint8_t*>(pData);
+	const auto base = m_recordSize * record + offset;
+	auto pDst = &m_mirror[base];
+
+	// Trim the unchanged head and tail
+	auto begin = 0u, end = size;
+	while (begin < end && pDst[begin] == pSrc[begin]) ++begin;
+	while (end > begin && pDst[end - 1] == pSrc[end - 1]) --end;
+	if (begin == end) return;
+
+	memcpy(pDst + begin, pSrc + begin, end - begin);
+	m_versions.MarkDirty(base + begin, base + end);
+}
+
+const void* RecordTable::GetRecord(uint32_t record) const
+{
+	assert(record < m_capacity);
+
+	return &m_mirror[m_recordSize * record];
+}
+
+bool RecordTable::Update(UploadManager* pUploadManager, const Fence* pFence, uint64_t fenceValue)
+{
+	if (m_versions.IsPending())
+	{
+		// Wait for the frames still reading the version to be written
+		if (pFence) XUSG_N_RETURN(pUploadManager->WaitForQueue(pFence, m_versions.GetPendingFenceValue()), false);
+
+		const auto next = m_versions.GetPending();
+		for (const auto& range : m_versions.GetPendingRanges())
+		{
+			const auto size = range.End - range.Begin;
+			XUSG_N_RETURN(pUploadManager->Upload(m_buffer.get(), &m_mirror[range.Begin], size,
+				m_versionOffsets[next] + range.Begin), false);
+			m_numUploadedBytes += size;
+		}
+	}
+	m_versions.Publish(fenceValue);
+
+	return true;
+}
+
+uint64_t RecordTable::GetVirtualAddress(uint32_t record) const
+{
+	return m_buffer->GetVirtualAddress() + m_versionOffsets[m_versions.GetCurrent()] + m_recordSize * record;
+}
+
+uint64_t RecordTable::GetShaderAddress(uint32_t record) const
+{
+	// The shaders take any window index out of range for window 0; Init() registers the
+	// windows of all versions, so a miss here is a bug.
+	const auto address = m_addressWindows->Translate(GetVirtualAddress(record));
+	assert(address >> 32 < AddressWindows::MaxWindows);
+
+	return address;
+}
+
+const AddressWindows* RecordTable::GetAddressWindows() const
+{
+	return m_addressWindows.get();
+}
+
+Buffer* RecordTable::GetBuffer() const
+{
+	return m_buffer.get();
+}
+
+uint32_t RecordTable::GetRecordSize() const
+{
+	return m_recordSize;
+}
+
+uint32_t RecordTable::GetCapacity() const
+{
+	return m_capacity;
+}
+
+uint64_t RecordTable::GetVersion() const
+{
+	return m_versions.GetVersion();
+}
+
+uint64_t RecordTable::GetNumUploadedBytes(bool reset)
+{
+	const auto numUploadedBytes = m_numUploadedBytes;
+	if (reset) m_numUploadedBytes = 0;
+
+	return numUploadedBytes;
+}
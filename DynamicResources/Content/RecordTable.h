@@ -0,0 +1,70 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Core/XUSG.h"
+#include "UploadManager.h"
+#include "AddressWindows.h"
+#include "RecordVersions.h"
+
+// GPU table of fixed-size records (resource indices, filter parameters and so on),
+// read by the shaders through buffer addresses. Writes land in a CPU mirror and are
+// tracked as dirty byte ranges per version (see RecordVersions). The buffer holds two
+// versions; Update() copies only the ranges a version is missing into the one the GPU
+// is not reading, then publishes it, so a version is never written while frames in
+// flight read it.
+// Each version is placed within one 4 GB address window and registered with the
+// shared AddressWindows, so the shaders can reach it through a window address.
+class RecordTable
+{
+public:
+	static const uint8_t NumVersions = RecordVersions::NumVersions;
+
+	RecordTable();
+	virtual ~RecordTable();
+
+	bool Init(const XUSG::Device* pDevice, uint32_t recordSize, uint32_t capacity,
+		const std::shared_ptr<AddressWindows>& addressWindows, const wchar_t* name = nullptr);
+
+	// Returns UINT32_MAX when the table is full. Records are reusable at once after
+	// freeing, since writes never reach the version in use by the GPU.
+	uint32_t Allocate();
+	void Free(uint32_t record);
+
+	// Only bytes that differ from the mirror are marked dirty.
+	void Write(uint32_t record, const void* pData, uint32_t size, uint32_t offset = 0);
+	const void* GetRecord(uint32_t record) const;
+
+	// Called once per frame before recording. The frame will signal fenceValue on pFence;
+	// the copy queue waits on it for the frames still reading the version to be written.
+	bool Update(UploadManager* pUploadManager, const XUSG::Fence* pFence, uint64_t fenceValue);
+
+	// Address of the record in the published version
+	uint64_t GetVirtualAddress(uint32_t record) const;
+	// Window address of the record in the published version, for the shaders
+	uint64_t GetShaderAddress(uint32_t record) const;
+	const AddressWindows* GetAddressWindows() const;
+	XUSG::Buffer* GetBuffer() const;
+
+	uint32_t GetRecordSize() const;
+	uint32_t GetCapacity() const;
+	uint64_t GetVersion() const;
+	uint64_t GetNumUploadedBytes(bool reset = true);
+
+protected:
+	XUSG::Buffer::uptr		m_buffer;
+	std::shared_ptr<AddressWindows> m_addressWindows;
+
+	std::vector<uint8_t>	m_mirror;
+	std::vector<uint32_t>	m_freeList;
+	RecordVersions			m_versions;
+	uint64_t				m_versionOffsets[NumVersions];
+
+	uint64_t	m_versionSize;
+	uint64_t	m_numUploadedBytes;
+	uint32_t	m_recordSize;
+	uint32_t	m_capacity;
+	uint32_t	m_highWaterMark;
+};
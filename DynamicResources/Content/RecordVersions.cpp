@@ -0,0 +1,94 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include "RecordVersions.h"
+
+using namespace std;
+
+RecordVersions::RecordVersions() :
+	m_readFenceValues(),
+	m_version(0)
+{
+}
+
+RecordVersions::~RecordVersions()
+{
+}
+
+void RecordVersions::Reset()
+{
+	for (auto& ranges : m_dirtyRanges) ranges.clear();
+	for (auto& fenceValue : m_readFenceValues) fenceValue = 0;
+	m_version = 0;
+}
+
+void RecordVersions::MarkDirty(uint32_t begin, uint32_t end)
+{
+	for (auto& ranges : m_dirtyRanges)
+	{
+		// Extend the last range for sequential writes; the rest is coalesced on upload.
+		if (!ranges.empty() && begin >= ranges.back().Begin && begin <= ranges.back().End)
+			ranges.back().End = (max)(ranges.back().End, end);
+		else ranges.push_back({ begin, end });
+	}
+}
+
+bool RecordVersions::IsPending() const
+{
+	return !m_dirtyRanges[GetPending()].empty();
+}
+
+uint8_t RecordVersions::GetPending() const
+{
+	return static_cast<uint8_t>((m_version + 1) % NumVersions);
+}
+
+uint64_t RecordVersions::GetPendingFenceValue() const
+{
+	return m_readFenceValues[GetPending()];
+}
+
+const vector<RecordVersions::Range>& RecordVersions::GetPendingRanges()
+{
+	auto& ranges = m_dirtyRanges[GetPending()];
+	Coalesce(ranges, MaxGap);
+
+	return ranges;
+}
+
+void RecordVersions::Publish(uint64_t fenceValue)
+{
+	if (IsPending())
+	{
+		const auto next = GetPending();
+		m_dirtyRanges[next].clear();
+		++m_version;
+		m_readFenceValues[next] = fenceValue;
+	}
+	else m_readFenceValues[GetCurrent()] = fenceValue;
+}
+
+uint8_t RecordVersions::GetCurrent() const
+{
+	return static_cast<uint8_t>(m_version % NumVersions);
+}
+
+uint64_t RecordVersions::GetVersion() const
+{
+	return m_version;
+}
+
+void RecordVersions::Coalesce(vector<Range>& ranges, uint32_t maxGap)
+{
+	sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) { return a.Begin < b.Begin; });
+
+	size_t n = 0;
+	for (size_t i = 1; i < ranges.size(); ++i)
+	{
+		if (ranges[i].Begin <= ranges[n].End + maxGap) ranges[n].End = (max)(ranges[n].End, ranges[i].End);
+		else ranges[++n] = ranges[i];
+	}
+	if (!ranges.empty()) ranges.resize(n + 1);
+}
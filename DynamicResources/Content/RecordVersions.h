@@ -0,0 +1,58 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Version bookkeeping of RecordTable: the dirty byte ranges each version is missing, and
+// the fence value of the last frame reading each version. A frame writes the version the
+// GPU is not reading if it misses anything, after the frames still reading it, and
+// publishes it. No device object is involved, so it can be driven by fake fence values.
+class RecordVersions
+{
+public:
+	static const uint8_t NumVersions = 2;
+	// Gap up to which neighboring ranges are uploaded together, since a copy costs more
+	// than a few extra bytes
+	static const uint32_t MaxGap = 64;
+
+	struct Range
+	{
+		uint32_t Begin;
+		uint32_t End;
+	};
+
+	RecordVersions();
+	virtual ~RecordVersions();
+
+	void Reset();
+
+	// Marks the bytes dirty in every version.
+	void MarkDirty(uint32_t begin, uint32_t end);
+
+	// Whether the frame must write and publish the pending version
+	bool IsPending() const;
+	// Version the GPU is not reading, to be written
+	uint8_t GetPending() const;
+	// Fence value of the last frame reading the pending version, which the copy queue must wait for
+	uint64_t GetPendingFenceValue() const;
+	// Ranges the pending version is missing, sorted and coalesced
+	const std::vector<Range>& GetPendingRanges();
+	// Publishes the pending version if any; the frame that will signal fenceValue reads the
+	// published version.
+	void Publish(uint64_t fenceValue);
+
+	// Version read by the frames recorded since the last Publish()
+	uint8_t GetCurrent() const;
+	uint64_t GetVersion() const;
+
+	static void Coalesce(std::vector<Range>& ranges, uint32_t maxGap);
+
+protected:
+	std::vector<Range>	m_dirtyRanges[NumVersions];	// Missing from each version
+	uint64_t			m_readFenceValues[NumVersions];
+	uint64_t			m_version;
+};
@@ -0,0 +1,613 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <cstring>
+#include "RecordingCommandList.h"
+
+using namespace std;
+using namespace XUSG;
+
+namespace
+{
+	uint32_t asUint(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+
+		return bits;
+	}
+}
+
+RecordingCommandList::RecordingCommandList() :
+	m_pDevice(nullptr),
+	m_numCommands(0),
+	m_isClosed(false)
+{
+}
+
+RecordingCommandList::~RecordingCommandList()
+{
+}
+
+bool RecordingCommandList::Create(const Device* pDevice, uint32_t, CommandListType,
+	const CommandAllocator* pAllocator, const Pipeline& pipeline, const wchar_t*)
+{
+	m_pDevice = pDevice;
+
+	return Reset(pAllocator, pipeline);
+}
+
+bool RecordingCommandList::Close() const
+{
+	XUSG_C_RETURN(m_isClosed, false);
+	m_isClosed = true;
+
+	return true;
+}
+
+bool RecordingCommandList::Reset(const CommandAllocator*, const Pipeline& initialState) const
+{
+	m_stream.clear();
+	m_objects.clear();
+	m_objectIds.clear();
+	m_numCommands = 0;
+	m_isClosed = false;
+	if (initialState) SetPipelineState(initialState);
+
+	return true;
+}
+
+void RecordingCommandList::ClearState(const Pipeline& initialState) const
+{
+	beginCommand(OP_CLEAR_STATE, 0);
+	if (initialState) SetPipelineState(initialState);
+}
+
+void RecordingCommandList::Draw(uint32_t vertexCountPerInstance, uint32_t instanceCount,
+	uint32_t startVertexLocation, uint32_t startInstanceLocation) const
+{
+	beginCommand(OP_DRAW, 4);
+	write(vertexCountPerInstance);
+	write(instanceCount);
+	write(startVertexLocation);
+	write(startInstanceLocation);
+}
+
+void RecordingCommandList::DrawIndexed(uint32_t indexCountPerInstance, uint32_t instanceCount,
+	uint32_t startIndexLocation, int32_t baseVertexLocation, uint32_t startInstanceLocation) const
+{
+	beginCommand(OP_DRAW_INDEXED, 5);
+	write(indexCountPerInstance);
+	write(instanceCount);
+	write(startIndexLocation);
+	write(static_cast<uint32_t>(baseVertexLocation));
+	write(startInstanceLocation);
+}
+
+void RecordingCommandList::Dispatch(uint32_t threadGroupCountX, uint32_t threadGroupCountY,
+	uint32_t threadGroupCountZ) const
+{
+	beginCommand(OP_DISPATCH, 3);
+	write(threadGroupCountX);
+	write(threadGroupCountY);
+	write(threadGroupCountZ);
+}
+
+void RecordingCommandList::CopyBufferRegion(const Resource* pDstBuffer, uint64_t dstOffset,
+	const Resource* pSrcBuffer, uint64_t srcOffset, uint64_t numBytes) const
+{
+	beginCommand(OP_COPY_BUFFER_REGION, 8);
+	write(getId(pDstBuffer));
+	write64(dstOffset);
+	write(getId(pSrcBuffer));
+	write64(srcOffset);
+	write64(numBytes);
+}
+
+void RecordingCommandList::CopyTextureRegion(const TextureCopyLocation& dst,
+	uint32_t dstX, uint32_t dstY, uint32_t dstZ,
+	const TextureCopyLocation& src, const BoxRange*) const
+{
+	beginCommand(OP_COPY_TEXTURE_REGION, 7);
+	write(getId(dst.pResource));
+	write(dst.SubresourceIndex);
+	write(dstX);
+	write(dstY);
+	write(dstZ);
+	write(getId(src.pResource));
+	write(src.SubresourceIndex);
+}
+
+void RecordingCommandList::CopyResource(const Resource* pDstResource, const Resource* pSrcResource) const
+{
+	beginCommand(OP_COPY_RESOURCE, 2);
+	write(getId(pDstResource));
+	write(getId(pSrcResource));
+}
+
+void RecordingCommandList::CopyTiles(const Resource* pTiledResource, const TiledResourceCoord*,
+	const TileRegionSize*, const Resource* pBuffer, uint64_t bufferStartOffsetInBytes, TileCopyFlag flags) const
+{
+	beginCommand(OP_COPY_TILES, 5);
+	write(getId(pTiledResource));
+	write(getId(pBuffer));
+	write64(bufferStartOffsetInBytes);
+	write(static_cast<uint32_t>(flags));
+}
+
+void RecordingCommandList::ResolveSubresource(const Resource* pDstResource, uint32_t dstSubresource,
+	const Resource* pSrcResource, uint32_t srcSubresource, Format format) const
+{
+	beginCommand(OP_RESOLVE_SUBRESOURCE, 5);
+	write(getId(pDstResource));
+	write(dstSubresource);
+	write(getId(pSrcResource));
+	write(srcSubresource);
+	write(static_cast<uint32_t>(format));
+}
+
+void RecordingCommandList::IASetPrimitiveTopology(PrimitiveTopology primitiveTopology) const
+{
+	beginCommand(OP_SET_PRIMITIVE_TOPOLOGY, 1);
+	write(static_cast<uint32_t>(primitiveTopology));
+}
+
+void RecordingCommandList::RSSetViewports(uint32_t numViewports, const Viewport*) const
+{
+	beginCommand(OP_SET_VIEWPORTS, 1);
+	write(numViewports);
+}
+
+void RecordingCommandList::RSSetScissorRects(uint32_t numRects, const RectRange*) const
+{
+	beginCommand(OP_SET_SCISSOR_RECTS, 1);
+	write(numRects);
+}
+
+void RecordingCommandList::OMSetBlendFactor(const float blendFactor[4]) const
+{
+	beginCommand(OP_SET_BLEND_FACTOR, 4);
+	for (uint8_t i = 0; i < 4; ++i) write(asUint(blendFactor[i]));
+}
+
+void RecordingCommandList::OMSetStencilRef(uint32_t stencilRef) const
+{
+	beginCommand(OP_SET_STENCIL_REF, 1);
+	write(stencilRef);
+}
+
+void RecordingCommandList::SetPipelineState(const Pipeline& pipelineState) const
+{
+	beginCommand(OP_SET_PIPELINE_STATE, 1);
+	write(getId(pipelineState));
+}
+
+void RecordingCommandList::Barrier(uint32_t numBarriers, const ResourceBarrier* pBarriers)
+{
+	beginCommand(OP_BARRIER, 1 + BarrierWords * numBarriers);
+	write(numBarriers);
+	for (auto i = 0u; i < numBarriers; ++i)
+	{
+		const auto& barrier = pBarriers[i];
+		write(getId(barrier.pResource));
+		write(static_cast<uint32_t>(barrier.StateBefore));
+		write(static_cast<uint32_t>(barrier.StateAfter));
+		write(barrier.Subresource);
+		write(static_cast<uint32_t>(barrier.Flags));
+		write(getId(barrier.pResourceAfter));
+	}
+}
+
+void RecordingCommandList::ExecuteBundle(const CommandList* pCommandList) const
+{
+	beginCommand(OP_EXECUTE_BUNDLE, 1);
+	write(getId(pCommandList));
+}
+
+void RecordingCommandList::SetDescriptorHeaps(uint32_t numDescriptorHeaps, const DescriptorHeap* pDescriptorHeaps)
+{
+	beginCommand(OP_SET_DESCRIPTOR_HEAPS, 1 + numDescriptorHeaps);
+	write(numDescriptorHeaps);
+	for (auto i = 0u; i < numDescriptorHeaps; ++i) write(getId(pDescriptorHeaps[i]));
+}
+
+void RecordingCommandList::SetComputePipelineLayout(const PipelineLayout& pipelineLayout) const
+{
+	beginCommand(OP_SET_COMPUTE_PIPELINE_LAYOUT, 1);
+	write(getId(pipelineLayout));
+}
+
+void RecordingCommandList::SetGraphicsPipelineLayout(const PipelineLayout& pipelineLayout) const
+{
+	beginCommand(OP_SET_GRAPHICS_PIPELINE_LAYOUT, 1);
+	write(getId(pipelineLayout));
+}
+
+void RecordingCommandList::SetComputeDescriptorTable(uint32_t index, const DescriptorTable& descriptorTable) const
+{
+	beginCommand(OP_SET_COMPUTE_DESCRIPTOR_TABLE, 4);
+	write(index);
+	write(InvalidId);
+	write64(descriptorTable);
+}
+
+void RecordingCommandList::SetGraphicsDescriptorTable(uint32_t index, const DescriptorTable& descriptorTable) const
+{
+	beginCommand(OP_SET_GRAPHICS_DESCRIPTOR_TABLE, 4);
+	write(index);
+	write(InvalidId);
+	write64(descriptorTable);
+}
+
+void RecordingCommandList::SetComputeDescriptorTable(uint32_t index, const DescriptorHeap& descriptorHeap, int32_t offset) const
+{
+	beginCommand(OP_SET_COMPUTE_DESCRIPTOR_TABLE, 4);
+	write(index);
+	write(getId(descriptorHeap));
+	write64(static_cast<uint64_t>(offset));
+}
+
+void RecordingCommandList::SetGraphicsDescriptorTable(uint32_t index, const DescriptorHeap& descriptorHeap, int32_t offset) const
+{
+	beginCommand(OP_SET_GRAPHICS_DESCRIPTOR_TABLE, 4);
+	write(index);
+	write(getId(descriptorHeap));
+	write64(static_cast<uint64_t>(offset));
+}
+
+void RecordingCommandList::SetCompute32BitConstant(uint32_t index, uint32_t srcData, uint32_t destOffsetIn32BitValues) const
+{
+	SetCompute32BitConstants(index, 1, &srcData, destOffsetIn32BitValues);
+}
+
+void RecordingCommandList::SetGraphics32BitConstant(uint32_t index, uint32_t srcData, uint32_t destOffsetIn32BitValues) const
+{
+	SetGraphics32BitConstants(index, 1, &srcData, destOffsetIn32BitValues);
+}
+
+void RecordingCommandList::SetCompute32BitConstants(uint32_t index, uint32_t num32BitValuesToSet,
+	const void* pSrcData, uint32_t destOffsetIn32BitValues) const
+{
+	beginCommand(OP_SET_COMPUTE_32BIT_CONSTANTS, 3 + num32BitValuesToSet);
+	write(index);
+	write(destOffsetIn32BitValues);
+	write(num32BitValuesToSet);
+	m_stream.resize(m_stream.size() + num32BitValuesToSet);
+	memcpy(&m_stream[m_stream.size() - num32BitValuesToSet], pSrcData, sizeof(uint32_t) * num32BitValuesToSet);
+}
+
+void RecordingCommandList::SetGraphics32BitConstants(uint32_t index, uint32_t num32BitValuesToSet,
+	const void* pSrcData, uint32_t destOffsetIn32BitValues) const
+{
+	beginCommand(OP_SET_GRAPHICS_32BIT_CONSTANTS, 3 + num32BitValuesToSet);
+	write(index);
+	write(destOffsetIn32BitValues);
+	write(num32BitValuesToSet);
+	m_stream.resize(m_stream.size() + num32BitValuesToSet);
+	memcpy(&m_stream[m_stream.size() - num32BitValuesToSet], pSrcData, sizeof(uint32_t) * num32BitValuesToSet);
+}
+
+void RecordingCommandList::SetComputeRootConstantBufferView(uint32_t index, const Resource* pResource, int32_t offset) const
+{
+	beginCommand(OP_SET_COMPUTE_ROOT_CBV, 4);
+	write(index);
+	write(getId(pResource));
+	write64(static_cast<uint64_t>(offset));
+}
+
+void RecordingCommandList::SetGraphicsRootConstantBufferView(uint32_t index, const Resource* pResource, int32_t offset) const
+{
+	beginCommand(OP_SET_GRAPHICS_ROOT_CBV, 4);
+	write(index);
+	write(getId(pResource));
+	write64(static_cast<uint64_t>(offset));
+}
+
+void RecordingCommandList::SetComputeRootShaderResourceView(uint32_t index, const Resource* pResource, int32_t offset) const
+{
+	beginCommand(OP_SET_COMPUTE_ROOT_SRV, 4);
+	write(index);
+	write(getId(pResource));
+	write64(static_cast<uint64_t>(offset));
+}
+
+void RecordingCommandList::SetGraphicsRootShaderResourceView(uint32_t index, const Resource* pResource, int32_t offset) const
+{
+	beginCommand(OP_SET_GRAPHICS_ROOT_SRV, 4);
+	write(index);
+	write(getId(pResource));
+	write64(static_cast<uint64_t>(offset));
+}
+
+void RecordingCommandList::SetComputeRootUnorderedAccessView(uint32_t index, const Resource* pResource, int32_t offset) const
+{
+	beginCommand(OP_SET_COMPUTE_ROOT_UAV, 4);
+	write(index);
+	write(getId(pResource));
+	write64(static_cast<uint64_t>(offset));
+}
+
+void RecordingCommandList::SetGraphicsRootUnorderedAccessView(uint32_t index, const Resource* pResource, int32_t offset) const
+{
+	beginCommand(OP_SET_GRAPHICS_ROOT_UAV, 4);
+	write(index);
+	write(getId(pResource));
+	write64(static_cast<uint64_t>(offset));
+}
+
+void RecordingCommandList::SetComputeRootConstantBufferView(uint32_t index, uint64_t address) const
+{
+	beginCommand(OP_SET_COMPUTE_ROOT_CBV, 4);
+	write(index);
+	write(InvalidId);
+	write64(address);
+}
+
+void RecordingCommandList::SetGraphicsRootConstantBufferView(uint32_t index, uint64_t address) const
+{
+	beginCommand(OP_SET_GRAPHICS_ROOT_CBV, 4);
+	write(index);
+	write(InvalidId);
+	write64(address);
+}
+
+void RecordingCommandList::SetComputeRootShaderResourceView(uint32_t index, uint64_t address) const
+{
+	beginCommand(OP_SET_COMPUTE_ROOT_SRV, 4);
+	write(index);
+	write(InvalidId);
+	write64(address);
+}
+
+void RecordingCommandList::SetGraphicsRootShaderResourceView(uint32_t index, uint64_t address) const
+{
+	beginCommand(OP_SET_GRAPHICS_ROOT_SRV, 4);
+	write(index);
+	write(InvalidId);
+	write64(address);
+}
+
+void RecordingCommandList::SetComputeRootUnorderedAccessView(uint32_t index, uint64_t address) const
+{
+	beginCommand(OP_SET_COMPUTE_ROOT_UAV, 4);
+	write(index);
+	write(InvalidId);
+	write64(address);
+}
+
+void RecordingCommandList::SetGraphicsRootUnorderedAccessView(uint32_t index, uint64_t address) const
+{
+	beginCommand(OP_SET_GRAPHICS_ROOT_UAV, 4);
+	write(index);
+	write(InvalidId);
+	write64(address);
+}
+
+void RecordingCommandList::IASetIndexBuffer(const IndexBufferView&) const
+{
+	beginCommand(OP_SET_INDEX_BUFFER, 0);
+}
+
+void RecordingCommandList::IASetVertexBuffers(uint32_t startSlot, uint32_t numViews, const VertexBufferView*) const
+{
+	beginCommand(OP_SET_VERTEX_BUFFERS, 2);
+	write(startSlot);
+	write(numViews);
+}
+
+void RecordingCommandList::SOSetTargets(uint32_t startSlot, uint32_t numViews, const StreamOutBufferView*) const
+{
+	beginCommand(OP_SET_STREAM_OUT_TARGETS, 2);
+	write(startSlot);
+	write(numViews);
+}
+
+void RecordingCommandList::OMSetFramebuffer(const Framebuffer&) const
+{
+	beginCommand(OP_SET_FRAMEBUFFER, 0);
+}
+
+void RecordingCommandList::OMSetRenderTargets(uint32_t numRenderTargetDescriptors, const Descriptor*,
+	const Descriptor*, bool) const
+{
+	beginCommand(OP_SET_RENDER_TARGETS, 1);
+	write(numRenderTargetDescriptors);
+}
+
+void RecordingCommandList::ClearDepthStencilView(const Framebuffer&, ClearFlag clearFlags,
+	float depth, uint8_t stencil, uint32_t, const RectRange*)
+{
+	beginCommand(OP_CLEAR_DEPTH_STENCIL, 3);
+	write(static_cast<uint32_t>(clearFlags));
+	write(asUint(depth));
+	write(stencil);
+}
+
+void RecordingCommandList::ClearDepthStencilView(const Descriptor&, ClearFlag clearFlags,
+	float depth, uint8_t stencil, uint32_t, const RectRange*)
+{
+	beginCommand(OP_CLEAR_DEPTH_STENCIL, 3);
+	write(static_cast<uint32_t>(clearFlags));
+	write(asUint(depth));
+	write(stencil);
+}
+
+void RecordingCommandList::ClearRenderTargetView(const Descriptor&, const float colorRGBA[4],
+	uint32_t, const RectRange*)
+{
+	beginCommand(OP_CLEAR_RENDER_TARGET, 4);
+	for (uint8_t i = 0; i < 4; ++i) write(asUint(colorRGBA[i]));
+}
+
+void RecordingCommandList::ClearUnorderedAccessViewUint(const DescriptorTable&, const Descriptor&,
+	const Resource* pResource, const uint32_t values[4], uint32_t, const RectRange*)
+{
+	beginCommand(OP_CLEAR_UAV_UINT, 5);
+	write(getId(pResource));
+	for (uint8_t i = 0; i < 4; ++i) write(values[i]);
+}
+
+void RecordingCommandList::ClearUnorderedAccessViewFloat(const DescriptorTable&, const Descriptor&,
+	const Resource* pResource, const float values[4], uint32_t, const RectRange*)
+{
+	beginCommand(OP_CLEAR_UAV_FLOAT, 5);
+	write(getId(pResource));
+	for (uint8_t i = 0; i < 4; ++i) write(asUint(values[i]));
+}
+
+void RecordingCommandList::DiscardResource(const Resource* pResource, uint32_t, const RectRange*,
+	uint32_t firstSubresource, uint32_t numSubresources)
+{
+	beginCommand(OP_DISCARD_RESOURCE, 3);
+	write(getId(pResource));
+	write(firstSubresource);
+	write(numSubresources);
+}
+
+void RecordingCommandList::BeginQuery(const QueryHeap& queryHeap, QueryType type, uint32_t index) const
+{
+	beginCommand(OP_BEGIN_QUERY, 3);
+	write(getId(queryHeap));
+	write(static_cast<uint32_t>(type));
+	write(index);
+}
+
+void RecordingCommandList::EndQuery(const QueryHeap& queryHeap, QueryType type, uint32_t index) const
+{
+	beginCommand(OP_END_QUERY, 3);
+	write(getId(queryHeap));
+	write(static_cast<uint32_t>(type));
+	write(index);
+}
+
+void RecordingCommandList::ResolveQueryData(const QueryHeap& queryHeap, QueryType type, uint32_t startIndex,
+	uint32_t numQueries, const Resource* pDstBuffer, uint64_t alignedDstBufferOffset) const
+{
+	beginCommand(OP_RESOLVE_QUERY_DATA, 7);
+	write(getId(queryHeap));
+	write(static_cast<uint32_t>(type));
+	write(startIndex);
+	write(numQueries);
+	write(getId(pDstBuffer));
+	write64(alignedDstBufferOffset);
+}
+
+void RecordingCommandList::SetPredication(const Resource* pBuffer, uint64_t alignedBufferOffset, bool opEqualZero) const
+{
+	beginCommand(OP_SET_PREDICATION, 4);
+	write(getId(pBuffer));
+	write64(alignedBufferOffset);
+	write(opEqualZero ? 1 : 0);
+}
+
+void RecordingCommandList::SetMarker(uint32_t metaData, const void*, uint32_t size) const
+{
+	beginCommand(OP_SET_MARKER, 2);
+	write(metaData);
+	write(size);
+}
+
+void RecordingCommandList::BeginEvent(uint32_t metaData, const void*, uint32_t size) const
+{
+	beginCommand(OP_BEGIN_EVENT, 2);
+	write(metaData);
+	write(size);
+}
+
+void RecordingCommandList::EndEvent()
+{
+	beginCommand(OP_END_EVENT, 0);
+}
+
+void RecordingCommandList::ExecuteIndirect(const CommandLayout* pCommandlayout, uint32_t maxCommandCount,
+	const Resource* pArgumentBuffer, uint64_t argumentBufferOffset,
+	const Resource* pCountBuffer, uint64_t countBufferOffset)
+{
+	beginCommand(OP_EXECUTE_INDIRECT, 8);
+	write(getId(pCommandlayout));
+	write(maxCommandCount);
+	write(getId(pArgumentBuffer));
+	write64(argumentBufferOffset);
+	write(getId(pCountBuffer));
+	write64(countBufferOffset);
+}
+
+void RecordingCommandList::Create(void*, const wchar_t*)
+{
+	Reset(nullptr, nullptr);
+}
+
+void* RecordingCommandList::GetHandle() const
+{
+	return nullptr;
+}
+
+void* RecordingCommandList::GetDeviceHandle() const
+{
+	return m_pDevice ? m_pDevice->GetHandle() : nullptr;
+}
+
+const Device* RecordingCommandList::GetDevice() const
+{
+	return m_pDevice;
+}
+
+const uint32_t* RecordingCommandList::GetStream() const
+{
+	return m_stream.data();
+}
+
+size_t RecordingCommandList::GetStreamSize() const
+{
+	return m_stream.size();
+}
+
+uint32_t RecordingCommandList::GetNumCommands() const
+{
+	return m_numCommands;
+}
+
+bool RecordingCommandList::IsClosed() const
+{
+	return m_isClosed;
+}
+
+const void* RecordingCommandList::GetObject(uint32_t id) const
+{
+	return id < m_objects.size() ? m_objects[id] : nullptr;
+}
+
+uint32_t RecordingCommandList::GetNumObjects() const
+{
+	return static_cast<uint32_t>(m_objects.size());
+}
+
+void RecordingCommandList::beginCommand(Opcode opcode, uint32_t numWords) const
+{
+	assert(!m_isClosed);
+	assert(numWords <= UINT16_MAX);
+	write(static_cast<uint32_t>(opcode) | (numWords << 16));
+	++m_numCommands;
+}
+
+void RecordingCommandList::write(uint32_t value) const
+{
+	m_stream.push_back(value);
+}
+
+void RecordingCommandList::write64(uint64_t value) const
+{
+	m_stream.push_back(static_cast<uint32_t>(value));
+	m_stream.push_back(static_cast<uint32_t>(value >> 32));
+}
+
+uint32_t RecordingCommandList::getId(const void* pObject) const
+{
+	if (!pObject) return InvalidId;
+
+	const auto result = m_objectIds.emplace(pObject, static_cast<uint32_t>(m_objects.size()));
+	if (result.second) m_objects.push_back(pObject);
+
+	return result.first->second;
+}
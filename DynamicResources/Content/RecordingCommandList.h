@@ -0,0 +1,158 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <unordered_map>
+#include "Core/XUSG.h"
+#include "CommandStream.h"
+
+// Command list that records into a compact binary stream instead of the device, so that
+// the recording paths can run and be analyzed without a GPU. The stream format is that of
+// CommandStream. Objects passed in are never dereferenced.
+class RecordingCommandList :
+	public XUSG::CommandList,
+	public CommandStream
+{
+public:
+	RecordingCommandList();
+	virtual ~RecordingCommandList();
+
+	// Only stores the device; the command list is open once created.
+	bool Create(const XUSG::Device* pDevice, uint32_t nodeMask, XUSG::CommandListType type,
+		const XUSG::CommandAllocator* pAllocator, const XUSG::Pipeline& pipeline,
+		const wchar_t* name = nullptr);
+	bool Close() const;
+	// Clears the stream and the object ids.
+	bool Reset(const XUSG::CommandAllocator* pAllocator,
+		const XUSG::Pipeline& initialState) const;
+
+	void ClearState(const XUSG::Pipeline& initialState) const;
+	void Draw(
+		uint32_t vertexCountPerInstance,
+		uint32_t instanceCount,
+		uint32_t startVertexLocation,
+		uint32_t startInstanceLocation) const;
+	void DrawIndexed(
+		uint32_t indexCountPerInstance,
+		uint32_t instanceCount,
+		uint32_t startIndexLocation,
+		int32_t baseVertexLocation,
+		uint32_t startInstanceLocation) const;
+	void Dispatch(
+		uint32_t threadGroupCountX,
+		uint32_t threadGroupCountY,
+		uint32_t threadGroupCountZ) const;
+	void CopyBufferRegion(const XUSG::Resource* pDstBuffer, uint64_t dstOffset,
+		const XUSG::Resource* pSrcBuffer, uint64_t srcOffset, uint64_t numBytes) const;
+	void CopyTextureRegion(const XUSG::TextureCopyLocation& dst,
+		uint32_t dstX, uint32_t dstY, uint32_t dstZ,
+		const XUSG::TextureCopyLocation& src, const XUSG::BoxRange* pSrcBox = nullptr) const;
+	void CopyResource(const XUSG::Resource* pDstResource, const XUSG::Resource* pSrcResource) const;
+	void CopyTiles(const XUSG::Resource* pTiledResource, const XUSG::TiledResourceCoord* pTileRegionStartCoord,
+		const XUSG::TileRegionSize* pTileRegionSize, const XUSG::Resource* pBuffer, uint64_t bufferStartOffsetInBytes,
+		XUSG::TileCopyFlag flags) const;
+	void ResolveSubresource(const XUSG::Resource* pDstResource, uint32_t dstSubresource,
+		const XUSG::Resource* pSrcResource, uint32_t srcSubresource, XUSG::Format format) const;
+	void IASetPrimitiveTopology(XUSG::PrimitiveTopology primitiveTopology) const;
+	void RSSetViewports(uint32_t numViewports, const XUSG::Viewport* pViewports) const;
+	void RSSetScissorRects(uint32_t numRects, const XUSG::RectRange* pRects) const;
+	void OMSetBlendFactor(const float blendFactor[4]) const;
+	void OMSetStencilRef(uint32_t stencilRef) const;
+	void SetPipelineState(const XUSG::Pipeline& pipelineState) const;
+	void Barrier(uint32_t numBarriers, const XUSG::ResourceBarrier* pBarriers);
+	void ExecuteBundle(const XUSG::CommandList* pCommandList) const;
+	void SetDescriptorHeaps(uint32_t numDescriptorHeaps, const XUSG::DescriptorHeap* pDescriptorHeaps);
+	void SetComputePipelineLayout(const XUSG::PipelineLayout& pipelineLayout) const;
+	void SetGraphicsPipelineLayout(const XUSG::PipelineLayout& pipelineLayout) const;
+	void SetComputeDescriptorTable(uint32_t index, const XUSG::DescriptorTable& descriptorTable) const;
+	void SetGraphicsDescriptorTable(uint32_t index, const XUSG::DescriptorTable& descriptorTable) const;
+	void SetComputeDescriptorTable(uint32_t index, const XUSG::DescriptorHeap& descriptorHeap, int32_t offset) const;
+	void SetGraphicsDescriptorTable(uint32_t index, const XUSG::DescriptorHeap& descriptorHeap, int32_t offset) const;
+	void SetCompute32BitConstant(uint32_t index, uint32_t srcData, uint32_t destOffsetIn32BitValues = 0) const;
+	void SetGraphics32BitConstant(uint32_t index, uint32_t srcData, uint32_t destOffsetIn32BitValues = 0) const;
+	void SetCompute32BitConstants(uint32_t index, uint32_t num32BitValuesToSet,
+		const void* pSrcData, uint32_t destOffsetIn32BitValues = 0) const;
+	void SetGraphics32BitConstants(uint32_t index, uint32_t num32BitValuesToSet,
+		const void* pSrcData, uint32_t destOffsetIn32BitValues = 0) const;
+	void SetComputeRootConstantBufferView(uint32_t index, const XUSG::Resource* pResource, int32_t offset = 0) const;
+	void SetGraphicsRootConstantBufferView(uint32_t index, const XUSG::Resource* pResource, int32_t offset = 0) const;
+	void SetComputeRootShaderResourceView(uint32_t index, const XUSG::Resource* pResource, int32_t offset = 0) const;
+	void SetGraphicsRootShaderResourceView(uint32_t index, const XUSG::Resource* pResource, int32_t offset = 0) const;
+	void SetComputeRootUnorderedAccessView(uint32_t index, const XUSG::Resource* pResource, int32_t offset = 0) const;
+	void SetGraphicsRootUnorderedAccessView(uint32_t index, const XUSG::Resource* pResource, int32_t offset = 0) const;
+	void SetComputeRootConstantBufferView(uint32_t index, uint64_t address) const;
+	void SetGraphicsRootConstantBufferView(uint32_t index, uint64_t address) const;
+	void SetComputeRootShaderResourceView(uint32_t index, uint64_t address) const;
+	void SetGraphicsRootShaderResourceView(uint32_t index, uint64_t address) const;
+	void SetComputeRootUnorderedAccessView(uint32_t index, uint64_t address) const;
+	void SetGraphicsRootUnorderedAccessView(uint32_t index, uint64_t address) const;
+	void IASetIndexBuffer(const XUSG::IndexBufferView& view) const;
+	void IASetVertexBuffers(uint32_t startSlot, uint32_t numViews, const XUSG::VertexBufferView* pViews) const;
+	void SOSetTargets(uint32_t startSlot, uint32_t numViews, const XUSG::StreamOutBufferView* pViews) const;
+	void OMSetFramebuffer(const XUSG::Framebuffer& framebuffer) const;
+	void OMSetRenderTargets(
+		uint32_t numRenderTargetDescriptors,
+		const XUSG::Descriptor* pRenderTargetViews,
+		const XUSG::Descriptor* pDepthStencilView = nullptr,
+		bool rtsSingleHandleToDescriptorRange = false) const;
+	void ClearDepthStencilView(const XUSG::Framebuffer& framebuffer, XUSG::ClearFlag clearFlags,
+		float depth, uint8_t stencil = 0, uint32_t numRects = 0, const XUSG::RectRange* pRects = nullptr);
+	void ClearDepthStencilView(const XUSG::Descriptor& depthStencilView, XUSG::ClearFlag clearFlags,
+		float depth, uint8_t stencil = 0, uint32_t numRects = 0, const XUSG::RectRange* pRects = nullptr);
+	void ClearRenderTargetView(const XUSG::Descriptor& renderTargetView, const float colorRGBA[4],
+		uint32_t numRects = 0, const XUSG::RectRange* pRects = nullptr);
+	void ClearUnorderedAccessViewUint(const XUSG::DescriptorTable& descriptorTable,
+		const XUSG::Descriptor& descriptor, const XUSG::Resource* pResource, const uint32_t values[4],
+		uint32_t numRects = 0, const XUSG::RectRange* pRects = nullptr);
+	void ClearUnorderedAccessViewFloat(const XUSG::DescriptorTable& descriptorTable,
+		const XUSG::Descriptor& descriptor, const XUSG::Resource* pResource, const float values[4],
+		uint32_t numRects = 0, const XUSG::RectRange* pRects = nullptr);
+	void DiscardResource(const XUSG::Resource* pResource, uint32_t numRects, const XUSG::RectRange* pRects,
+		uint32_t firstSubresource, uint32_t numSubresources);
+	void BeginQuery(const XUSG::QueryHeap& queryHeap, XUSG::QueryType type, uint32_t index) const;
+	void EndQuery(const XUSG::QueryHeap& queryHeap, XUSG::QueryType type, uint32_t index) const;
+	void ResolveQueryData(const XUSG::QueryHeap& queryHeap, XUSG::QueryType type, uint32_t startIndex,
+		uint32_t numQueries, const XUSG::Resource* pDstBuffer, uint64_t alignedDstBufferOffset) const;
+	void SetPredication(const XUSG::Resource* pBuffer, uint64_t alignedBufferOffset, bool opEqualZero) const;
+	void SetMarker(uint32_t metaData, const void* pData, uint32_t size) const;
+	void BeginEvent(uint32_t metaData, const void* pData, uint32_t size) const;
+	void EndEvent();
+	void ExecuteIndirect(const XUSG::CommandLayout* pCommandlayout, uint32_t maxCommandCount,
+		const XUSG::Resource* pArgumentBuffer, uint64_t argumentBufferOffset = 0,
+		const XUSG::Resource* pCountBuffer = nullptr, uint64_t countBufferOffset = 0);
+
+	// There is no native command list; GetHandle() returns nullptr.
+	void Create(void* pHandle, const wchar_t* name = nullptr);
+
+	void* GetHandle() const;
+	void* GetDeviceHandle() const;
+
+	const XUSG::Device* GetDevice() const;
+
+	const uint32_t* GetStream() const;
+	size_t GetStreamSize() const;	// In words
+	uint32_t GetNumCommands() const;
+	bool IsClosed() const;
+
+	// The object behind an id of the stream, or nullptr
+	const void* GetObject(uint32_t id) const;
+	uint32_t GetNumObjects() const;
+
+
+protected:
+	void beginCommand(Opcode opcode, uint32_t numWords) const;
+	void write(uint32_t value) const;
+	void write64(uint64_t value) const;
+	uint32_t getId(const void* pObject) const;
+
+	const XUSG::Device* m_pDevice;
+
+	// The interface records through const methods.
+	mutable std::vector<uint32_t> m_stream;
+	mutable std::vector<const void*> m_objects;
+	mutable std::unordered_map<const void*, uint32_t> m_objectIds;
+	mutable uint32_t m_numCommands;
+	mutable bool m_isClosed;
+};
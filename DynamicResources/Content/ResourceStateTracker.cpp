@@ -0,0 +1,193 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include "ResourceStateTracker.h"
+
+using namespace std;
+using namespace XUSG;
+
+ResourceStateTracker::ResourceStateTracker() :
+	m_stats()
+{
+}
+
+ResourceStateTracker::~ResourceStateTracker()
+{
+}
+
+void ResourceStateTracker::Reset()
+{
+	assert(m_pendingBarriers.empty());
+#ifdef _DEBUG
+	for (const auto& trackedState : m_trackedStates) assert(!trackedState.IsSplit);
+#endif
+
+	m_trackedStates.clear();
+	m_log.clear();
+}
+
+void ResourceStateTracker::Discard()
+{
+	m_pendingBarriers.clear();
+
+	// XUSG has seen the flushed barriers only; the barriers of the reverse transitions
+	// are thrown away.
+	ResourceBarrier barrier;
+	for (const auto& trackedState : m_trackedStates)
+	{
+		const auto state = trackedState.pResource->GetResourceState();
+		if (state != trackedState.InitialState)
+			trackedState.pResource->SetBarrier(&barrier, trackedState.InitialState, 0,
+				XUSG_BARRIER_ALL_SUBRESOURCES, BarrierFlag::NONE, state);
+	}
+
+	m_trackedStates.clear();
+	m_log.clear();
+}
+
+void ResourceStateTracker::Transition(Resource* pResource, ResourceState state)
+{
+	++m_stats.NumRequests;
+	auto& trackedState = getTrackedState(pResource);
+
+	// A begun split transition ends with the next request for the resource.
+	if (trackedState.IsSplit)
+	{
+		endSplit(trackedState);
+		if (trackedState.State == state)
+		{
+			trackedState.IsUAVAccessed = state == ResourceState::UNORDERED_ACCESS;
+
+			return;
+		}
+	}
+
+	if (trackedState.State != state) addBarrier(trackedState, state, BarrierFlag::NONE, EVENT_TRANSITION);
+	else if (state == ResourceState::UNORDERED_ACCESS && trackedState.IsUAVAccessed)
+		addBarrier(trackedState, state, BarrierFlag::NONE, EVENT_UAV_BARRIER);
+	else
+	{
+		m_log.push_back({ pResource, state, state, EVENT_REDUNDANT });
+		++m_stats.NumRedundant;
+	}
+
+	// UAV writes are assumed to follow a request for the UAV state.
+	trackedState.IsUAVAccessed = state == ResourceState::UNORDERED_ACCESS;
+}
+
+void ResourceStateTracker::BeginTransition(Resource* pResource, ResourceState state)
+{
+	auto& trackedState = getTrackedState(pResource);
+	if (trackedState.IsSplit)
+	{
+		if (trackedState.SplitState == state)
+		{
+			++m_stats.NumRequests;
+			m_log.push_back({ pResource, state, state, EVENT_REDUNDANT });
+			++m_stats.NumRedundant;
+
+			return;
+		}
+
+		endSplit(trackedState);
+	}
+
+	// Nothing to split
+	if (trackedState.State == state)
+	{
+		Transition(pResource, state);
+
+		return;
+	}
+
+	++m_stats.NumRequests;
+	addBarrier(trackedState, state, BarrierFlag::BEGIN_ONLY, EVENT_SPLIT_BEGIN);
+	trackedState.SplitState = state;
+	trackedState.IsSplit = true;
+	trackedState.IsUAVAccessed = false;
+	++m_stats.NumSplit;
+}
+
+uint32_t ResourceStateTracker::Flush(CommandList* pCommandList)
+{
+	if (m_pendingBarriers.empty()) return 0;
+
+	// Explicit source states keep the states tracked by XUSG in sync.
+	m_barriers.resize(m_pendingBarriers.size());
+	auto numBarriers = 0u;
+	for (const auto& barrier : m_pendingBarriers)
+		numBarriers = barrier.pResource->SetBarrier(m_barriers.data(), barrier.After, numBarriers,
+			XUSG_BARRIER_ALL_SUBRESOURCES, barrier.Flags, barrier.Before);
+	m_pendingBarriers.clear();
+
+	if (numBarriers > 0)
+	{
+		pCommandList->Barrier(numBarriers, m_barriers.data());
+		m_stats.NumBarriers += numBarriers;
+		++m_stats.NumBatches;
+	}
+
+	return numBarriers;
+}
+
+ResourceState ResourceStateTracker::GetState(const Resource* pResource) const
+{
+	for (const auto& trackedState : m_trackedStates)
+		if (trackedState.pResource == pResource) return trackedState.State;
+
+	return pResource->GetResourceState();
+}
+
+const vector<ResourceStateTracker::LogEntry>& ResourceStateTracker::GetLog() const
+{
+	return m_log;
+}
+
+ResourceStateTracker::Stats ResourceStateTracker::GetStats(bool reset)
+{
+	const auto stats = m_stats;
+	if (reset) m_stats = {};
+
+	return stats;
+}
+
+const char* ResourceStateTracker::GetEventName(Event event)
+{
+	static const char* const eventNames[] =
+	{
+		"transition",
+		"uav-barrier",
+		"redundant",
+		"split-begin",
+		"split-end"
+	};
+
+	return event < NUM_EVENT ? eventNames[event] : "unknown";
+}
+
+ResourceStateTracker::TrackedState& ResourceStateTracker::getTrackedState(Resource* pResource)
+{
+	for (auto& trackedState : m_trackedStates)
+		if (trackedState.pResource == pResource) return trackedState;
+
+	const auto state = pResource->GetResourceState();
+	m_trackedStates.push_back({ pResource, state, state, ResourceState::COMMON, false, false });
+
+	return m_trackedStates.back();
+}
+
+void ResourceStateTracker::endSplit(TrackedState& trackedState)
+{
+	assert(trackedState.IsSplit);
+	addBarrier(trackedState, trackedState.SplitState, BarrierFlag::END_ONLY, EVENT_SPLIT_END);
+	trackedState.IsSplit = false;
+	trackedState.IsUAVAccessed = false;
+}
+
+void ResourceStateTracker::addBarrier(TrackedState& trackedState, ResourceState state, BarrierFlag flags, Event event)
+{
+	m_pendingBarriers.push_back({ trackedState.pResource, trackedState.State, state, flags });
+	m_log.push_back({ trackedState.pResource, trackedState.State, state, event });
+	if (flags != BarrierFlag::BEGIN_ONLY) trackedState.State = state;
+}
@@ -0,0 +1,95 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Core/XUSG.h"
+
+// Command-list-level tracking of whole-resource states. Transitions are requested
+// as needed and recorded in one batch at Flush(); a request for the current state is
+// dropped, and so is a UAV barrier before any UAV access in the command list, since
+// command-list boundaries already order those. Split transitions begin early and end
+// with the next request for the resource. Every request is logged.
+class ResourceStateTracker
+{
+public:
+	enum Event : uint8_t
+	{
+		EVENT_TRANSITION,
+		EVENT_UAV_BARRIER,
+		EVENT_REDUNDANT,
+		EVENT_SPLIT_BEGIN,
+		EVENT_SPLIT_END,
+
+		NUM_EVENT
+	};
+
+	struct LogEntry
+	{
+		const XUSG::Resource* pResource;
+		XUSG::ResourceState Before;
+		XUSG::ResourceState After;
+		Event Type;
+	};
+
+	struct Stats
+	{
+		uint32_t NumRequests;
+		uint32_t NumBarriers;	// Recorded barriers, counting both halves of split ones
+		uint32_t NumRedundant;
+		uint32_t NumSplit;
+		uint32_t NumBatches;
+	};
+
+	ResourceStateTracker();
+	virtual ~ResourceStateTracker();
+
+	// Starts a command list; the states of resources are picked up from XUSG on first use.
+	void Reset();
+	// Drops a command list that is not going to be executed, such as a recording one, and
+	// restores the states tracked by XUSG to those before it.
+	void Discard();
+
+	void Transition(XUSG::Resource* pResource, XUSG::ResourceState state);
+	void BeginTransition(XUSG::Resource* pResource, XUSG::ResourceState state);
+	// Records the pending barriers in one batch; returns their number.
+	uint32_t Flush(XUSG::CommandList* pCommandList);
+
+	XUSG::ResourceState GetState(const XUSG::Resource* pResource) const;
+	// Events since the last Reset()
+	const std::vector<LogEntry>& GetLog() const;
+	Stats GetStats(bool reset = true);
+
+	static const char* GetEventName(Event event);
+
+protected:
+	struct TrackedState
+	{
+		XUSG::Resource* pResource;
+		XUSG::ResourceState InitialState;
+		XUSG::ResourceState State;
+		XUSG::ResourceState SplitState;	// Target of a begun split transition
+		bool IsSplit;
+		bool IsUAVAccessed;				// A UAV access may be in flight in this command list
+	};
+
+	struct PendingBarrier
+	{
+		XUSG::Resource* pResource;
+		XUSG::ResourceState Before;
+		XUSG::ResourceState After;
+		XUSG::BarrierFlag Flags;
+	};
+
+	TrackedState& getTrackedState(XUSG::Resource* pResource);
+	void endSplit(TrackedState& trackedState);
+	void addBarrier(TrackedState& trackedState, XUSG::ResourceState state, XUSG::BarrierFlag flags, Event event);
+
+	std::vector<TrackedState>	m_trackedStates;
+	std::vector<PendingBarrier>	m_pendingBarriers;
+	std::vector<XUSG::ResourceBarrier> m_barriers;
+	std::vector<LogEntry>		m_log;
+
+	Stats						m_stats;
+};
@@ -2,36 +2,107 @@
 // Copyright (c) XU, Tianchen. All rights reserved.
 //--------------------------------------------------------------------------------------
 
+// Memory is reached through up to 4 root-bound 4 GB windows. With several windows,
+// addresses are window addresses: the window index in the high 32 bits and the
+// offset in the low 32 bits (see AddressWindows on the host). With a single window,
+// the high bits are ignored, so raw virtual addresses within it work as well.
+// A window index of ADDR_WINDOW_COUNT or above falls back to window 0; the host
+// asserts that it hands out none (RecordTable::GetShaderAddress).
+
+#ifndef ADDR_WINDOW_COUNT
+#define ADDR_WINDOW_COUNT	1
+#endif
+
+#if ADDR_WINDOW_COUNT < 1 || ADDR_WINDOW_COUNT > 4
+#error ADDR_WINDOW_COUNT must be 1 to 4 (AddressWindows::MaxWindows)
+#endif
+
 #ifndef ADDR_BUFFER_SLOT
 #define ADDR_BUFFER_SLOT	u0
 #endif
 
+#ifndef ADDR_BUFFER_SLOT1
+#define ADDR_BUFFER_SLOT1	u1
+#endif
+
+#ifndef ADDR_BUFFER_SLOT2
+#define ADDR_BUFFER_SLOT2	u2
+#endif
+
+#ifndef ADDR_BUFFER_SLOT3
+#define ADDR_BUFFER_SLOT3	u3
+#endif
+
 #ifndef ADDR_BUFFER_SPACE
 #define ADDR_BUFFER_SPACE	space2147420893
 #endif
 
 RWByteAddressBuffer g_memoryBuffer : register(ADDR_BUFFER_SLOT, ADDR_BUFFER_SPACE);
+#if ADDR_WINDOW_COUNT > 1
+RWByteAddressBuffer g_memoryBuffer1 : register(ADDR_BUFFER_SLOT1, ADDR_BUFFER_SPACE);
+#endif
+#if ADDR_WINDOW_COUNT > 2
+RWByteAddressBuffer g_memoryBuffer2 : register(ADDR_BUFFER_SLOT2, ADDR_BUFFER_SPACE);
+#endif
+#if ADDR_WINDOW_COUNT > 3
+RWByteAddressBuffer g_memoryBuffer3 : register(ADDR_BUFFER_SLOT3, ADDR_BUFFER_SPACE);
+#endif
 
 template<typename T>
-T LoadMemory(uint64_t addr)
+T LoadMemory2(uint2 addr)
 {
-	return g_memoryBuffer.Load<T>(uint(addr & 0xffffffff));
+#if ADDR_WINDOW_COUNT > 1
+	switch (addr.y)
+	{
+	case 1:
+		return g_memoryBuffer1.Load<T>(addr.x);
+#if ADDR_WINDOW_COUNT > 2
+	case 2:
+		return g_memoryBuffer2.Load<T>(addr.x);
+#endif
+#if ADDR_WINDOW_COUNT > 3
+	case 3:
+		return g_memoryBuffer3.Load<T>(addr.x);
+#endif
+	}
+#endif
+
+	return g_memoryBuffer.Load<T>(addr.x);
 }
 
 template<typename T>
-T LoadMemory2(uint2 addr)
+T LoadMemory(uint64_t addr)
 {
-	return g_memoryBuffer.Load<T>(addr.x);
+	return LoadMemory2<T>(uint2(uint(addr & 0xffffffff), uint(addr >> 32)));
 }
 
 template<typename T>
-T StoreMemory(uint64_t addr, T data)
+void StoreMemory2(uint2 addr, T data)
 {
-	return g_memoryBuffer.Store<T>(uint(addr & 0xffffffff), data);
+#if ADDR_WINDOW_COUNT > 1
+	switch (addr.y)
+	{
+	case 1:
+		g_memoryBuffer1.Store<T>(addr.x, data);
+		return;
+#if ADDR_WINDOW_COUNT > 2
+	case 2:
+		g_memoryBuffer2.Store<T>(addr.x, data);
+		return;
+#endif
+#if ADDR_WINDOW_COUNT > 3
+	case 3:
+		g_memoryBuffer3.Store<T>(addr.x, data);
+		return;
+#endif
+	}
+#endif
+
+	g_memoryBuffer.Store<T>(addr.x, data);
 }
 
 template<typename T>
-T StoreMemory2(uint2 addr, T data)
+void StoreMemory(uint64_t addr, T data)
 {
-	return g_memoryBuffer.Store<T>(addr.x, data);
+	StoreMemory2<T>(uint2(uint(addr & 0xffffffff), uint(addr >> 32)), data);
 }
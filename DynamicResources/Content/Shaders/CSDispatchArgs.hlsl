@@ -0,0 +1,68 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#define ADDR_BUFFER_SPACE space0
+#define ADDR_WINDOW_COUNT 4
+#include "BufferAddress.hlsli"
+
+#define GROUP_SIZE		64
+#define FILTER_GROUP_SIZE	8
+#define ARGUMENT_STRIDE	20	// Record address (2), thread-group counts (3)
+
+#define DIV_UP(x, n)	(((x) + (n) - 1) / (n))
+
+struct Constants
+{
+	uint64_t TableAddr;	// Window address of record 0
+	uint RecordSize;
+	uint NumJobs;		// Per list
+	uint FirstList;
+};
+
+struct ResourceIndices
+{
+	uint TexIn;
+	uint TexOut;
+	uint Sampler;
+};
+
+ConstantBuffer<Constants> g_cb;
+
+StructuredBuffer<uint> g_jobs		: register (t0);	// Records, list by list
+RWByteAddressBuffer g_arguments		: register (u4);
+RWByteAddressBuffer g_counts		: register (u5);
+
+groupshared uint g_count;
+
+// One group per list of jobs; the jobs of empty outputs are dropped, and the others are
+// compacted to the front of the arguments of the list.
+[numthreads(GROUP_SIZE, 1, 1)]
+void main(uint GTid : SV_GroupIndex, uint Gid : SV_GroupID)
+{
+	if (GTid == 0) g_count = 0;
+	GroupMemoryBarrierWithGroupSync();
+
+	const uint list = g_cb.FirstList + Gid;
+	for (uint i = GTid; i < g_cb.NumJobs; i += GROUP_SIZE)
+	{
+		const uint record = g_jobs[g_cb.NumJobs * list + i];
+		const uint64_t addr = g_cb.TableAddr + g_cb.RecordSize * record;
+		const ResourceIndices resIndices = LoadMemory<ResourceIndices>(addr);
+
+		const RWTexture2D<float4> texOut = ResourceDescriptorHeap[resIndices.TexOut];
+		uint2 texSize;
+		texOut.GetDimensions(texSize.x, texSize.y);
+		if (texSize.x == 0 || texSize.y == 0) continue;
+
+		uint slot;
+		InterlockedAdd(g_count, 1, slot);
+		const uint offset = ARGUMENT_STRIDE * (g_cb.NumJobs * Gid + slot);
+		g_arguments.Store2(offset, uint2(uint(addr & 0xffffffff), uint(addr >> 32)));
+		g_arguments.Store3(offset + 8, uint3(DIV_UP(texSize, FILTER_GROUP_SIZE), 1));
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
+	if (GTid == 0) g_counts.Store(4 * Gid, g_count);
+}
@@ -3,6 +3,7 @@
 //--------------------------------------------------------------------------------------
 
 #define ADDR_BUFFER_SPACE space0
+#define ADDR_WINDOW_COUNT 4
 #include "BufferAddress.hlsli"
 
 #define GROUP_SIZE		8
@@ -14,6 +15,15 @@
 struct VirtualAddress
 {
 	uint64_t Addr;
+#ifdef ATLAS
+	uint RecordSize;	// Of the tile records, which are consecutive from Addr
+	uint NumTiles;
+	uint NumGroups;
+#elif defined(REGION)
+	uint Origin;		// Of the region of interest in the image, in texels, x in the low 16 bits and y in the high ones
+#elif !defined(TEXTURE_ARRAY)
+	uint GroupOffset;	// Of the dispatched groups in the image, x in the low 16 bits and y in the high ones
+#endif
 };
 
 struct ResourceIndices
@@ -23,6 +33,21 @@ struct ResourceIndices
 	uint Sampler;
 };
 
+#ifdef ATLAS
+#define MAX_GROUPS_X		65535
+#define FIRST_GROUP_OFFSET	28
+
+// Image in an atlas, surrounded by an apron of BLUR_RADIUS texels. The groups of the
+// tiles follow each other in a linear dispatch, so the tiles are sorted by first group.
+struct TileRecord
+{
+	ResourceIndices ResIndices;
+	uint2 Origin;
+	uint2 Size;
+	uint FirstGroup;
+};
+#endif
+
 ConstantBuffer<VirtualAddress> g_cbAddress;
 
 groupshared float4 g_srcs[SHARED_MEM_SIZE][SHARED_MEM_SIZE];
@@ -43,23 +68,66 @@ float Gaussian(float r, float sigma)
 	return exp(-0.5 * a * a);
 }
 
+// With TEXTURE_ARRAY defined (see CSImageProcArray.hlsl), SV_GroupID.z selects the slice
+// of a Texture2DArray, and the results of all slices are packed into one byte-address
+// buffer as RGBA8, row by row and slice by slice.
+// With ATLAS defined (see CSImageProcAtlas.hlsl), each group looks its tile up, and
+// filters the tile in place of a whole image.
+// With REGION defined (see CSImageProcRegion.hlsl), the groups cover a region of interest,
+// whose texels are written from the origin of a result of its size.
 [numthreads(GROUP_SIZE, GROUP_SIZE, 1)]
-void main(uint2 DTid : SV_DispatchThreadID, uint2 Gid : SV_GroupID, uint2 GTid : SV_GroupThreadID)
+void main(uint3 Gid : SV_GroupID, uint2 GTid : SV_GroupThreadID)
 {
 	const uint64_t addr = g_cbAddress.Addr;
-	const ResourceIndices resIndices = LoadMemory<ResourceIndices>(addr);
+#ifdef ATLAS
+	const uint group = MAX_GROUPS_X * Gid.y + Gid.x;
+	if (group >= g_cbAddress.NumGroups) return;
 
-	const Texture2D texIn = ResourceDescriptorHeap[resIndices.TexIn];
-	const RWTexture2D<float4> texOut = ResourceDescriptorHeap[resIndices.TexOut];
+	// Binary search for the last tile starting at or before the group
+	uint first = 0, last = g_cbAddress.NumTiles - 1;
+	while (first < last)
+	{
+		const uint mid = (first + last + 1) / 2;
+		if (LoadMemory<uint>(addr + g_cbAddress.RecordSize * mid + FIRST_GROUP_OFFSET) <= group) first = mid;
+		else last = mid - 1;
+	}
+
+	const TileRecord tile = LoadMemory<TileRecord>(addr + g_cbAddress.RecordSize * first);
+	const ResourceIndices resIndices = tile.ResIndices;
+	const uint groupsX = DIV_UP(tile.Size.x, GROUP_SIZE);
+	const uint2 groupId = uint2((group - tile.FirstGroup) % groupsX, (group - tile.FirstGroup) / groupsX);
+#else
+	const ResourceIndices resIndices = LoadMemory<ResourceIndices>(addr);
+#ifdef TEXTURE_ARRAY
+	const uint2 groupId = Gid.xy;
+#elif defined(REGION)
+	const uint2 origin = uint2(g_cbAddress.Origin & 0xffff, g_cbAddress.Origin >> 16);
+	const uint2 groupId = Gid.xy + origin / GROUP_SIZE;
+#else
+	const uint2 groupId = Gid.xy + uint2(g_cbAddress.GroupOffset & 0xffff, g_cbAddress.GroupOffset >> 16);
+#endif
+#endif
+	const uint2 pixel = GROUP_SIZE * groupId + GTid;
 
 	const SamplerState smp = SamplerDescriptorHeap[resIndices.Sampler];
 
 	float2 texSize;
+#ifdef TEXTURE_ARRAY
+	const Texture2DArray texIn = ResourceDescriptorHeap[resIndices.TexIn];
+	const RWByteAddressBuffer bufOut = ResourceDescriptorHeap[resIndices.TexOut];
+
+	float arraySize;
+	texIn.GetDimensions(texSize.x, texSize.y, arraySize);
+#else
+	const Texture2D texIn = ResourceDescriptorHeap[resIndices.TexIn];
+	const RWTexture2D<float4> texOut = ResourceDescriptorHeap[resIndices.TexOut];
+
 	texIn.GetDimensions(texSize.x, texSize.y);
+#endif
 
 	// Load data into group-shared memory
 	const uint n = DIV_UP(SHARED_MEM_SIZE, GROUP_SIZE);
-	const int2 uvStart = GROUP_SIZE * (int2)Gid - BLUR_RADIUS;
+	const int2 uvStart = GROUP_SIZE * (int2)groupId - BLUR_RADIUS;
 	int i;
 	for (i = 0; i < n; ++i)
 	{
@@ -71,8 +139,18 @@ void main(uint2 DTid : SV_DispatchThreadID, uint2 Gid : SV_GroupID, uint2 GTid :
 				const int y = GROUP_SIZE * j + GTid.y;
 				if (y < SHARED_MEM_SIZE)
 				{
+#ifdef ATLAS
+					// Reads stay within the tile and its apron, which repeats the edges of the image.
+					const int2 texel = clamp(uvStart + int2(x, y), -BLUR_RADIUS, (int2)tile.Size + BLUR_RADIUS - 1);
+					g_srcs[y][x] = texIn[(int2)tile.Origin + texel];
+#else
 					const float2 uv = (uvStart + int2(x, y) + 0.5) / texSize;
+#endif
+#ifdef TEXTURE_ARRAY
+					g_srcs[y][x] = texIn.SampleLevel(smp, float3(uv, Gid.z), 0.0);
+#elif !defined(ATLAS)
 					g_srcs[y][x] = texIn.SampleLevel(smp, uv, 0.0);;
+#endif
 				}
 			}
 		}
@@ -121,5 +199,21 @@ void main(uint2 DTid : SV_DispatchThreadID, uint2 Gid : SV_GroupID, uint2 GTid :
 		ws += w;
 	}
 
-	texOut[DTid] = mu / ws;
+#ifdef TEXTURE_ARRAY
+	// Groups overhanging the image must not write into the next slice.
+	const uint2 size = (uint2)texSize;
+	if (all(pixel < size))
+	{
+		const uint4 rgba = (uint4)round(saturate(mu / ws) * 255.0);
+		bufOut.Store(4 * ((size.y * Gid.z + pixel.y) * size.x + pixel.x),
+			rgba.x | (rgba.y << 8) | (rgba.z << 16) | (rgba.w << 24));
+	}
+#elif defined(ATLAS)
+	if (all(pixel < tile.Size)) texOut[tile.Origin + pixel] = mu / ws;
+#elif defined(REGION)
+	// Writes past the end of the result are dropped.
+	if (all(pixel >= origin)) texOut[pixel - origin] = mu / ws;
+#else
+	texOut[pixel] = mu / ws;
+#endif
 }
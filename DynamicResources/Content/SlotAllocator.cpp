@@ -0,0 +1,146 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <functional>
+#include "SlotAllocator.h"
+
+using namespace std;
+
+SlotAllocator::SlotAllocator() :
+	m_numAllocated(0),
+	m_highWaterMark(0)
+{
+}
+
+SlotAllocator::~SlotAllocator()
+{
+}
+
+bool SlotAllocator::Init(uint32_t capacity)
+{
+	if (capacity < 1 || capacity == UINT32_MAX) return false;
+
+	m_generations.assign(capacity, 0);
+	m_isLive.assign(capacity, false);
+	m_freeList.clear();
+	m_freeList.reserve(capacity);
+	m_retiredSlots.clear();
+	m_numAllocated = 0;
+	m_highWaterMark = 0;
+
+	return true;
+}
+
+SlotAllocator::Handle SlotAllocator::Allocate()
+{
+	uint32_t index;
+	if (!m_freeList.empty())
+	{
+		index = m_freeList.back();
+		m_freeList.pop_back();
+	}
+	else if (m_highWaterMark < GetCapacity()) index = m_highWaterMark++;
+	else return InvalidHandle;
+
+	m_isLive[index] = true;
+	++m_numAllocated;
+
+	return (static_cast<Handle>(m_generations[index]) << 32) | index;
+}
+
+bool SlotAllocator::Free(Handle handle, uint64_t fenceValue)
+{
+	if (!IsValid(handle)) return false;
+
+	const auto index = static_cast<uint32_t>(handle);
+	++m_generations[index];
+	m_isLive[index] = false;
+	--m_numAllocated;
+
+	// Fence values are retired in order, so the queue stays sorted.
+	if (!m_retiredSlots.empty() && fenceValue < m_retiredSlots.back().FenceValue)
+		fenceValue = m_retiredSlots.back().FenceValue;
+	m_retiredSlots.push_back({ fenceValue, index });
+
+	return true;
+}
+
+void SlotAllocator::Recycle(uint64_t completedFenceValue)
+{
+	while (!m_retiredSlots.empty() && m_retiredSlots.front().FenceValue <= completedFenceValue)
+	{
+		m_freeList.push_back(m_retiredSlots.front().Index);
+		m_retiredSlots.pop_front();
+	}
+}
+
+uint32_t SlotAllocator::Compact(uint64_t fenceValue, vector<Relocation>& relocations)
+{
+	relocations.clear();
+
+	// Fill the lowest free slots first
+	sort(m_freeList.begin(), m_freeList.end(), greater<uint32_t>());
+
+	auto highest = m_highWaterMark;
+	while (!m_freeList.empty())
+	{
+		// Find the highest live slot above the lowest free one
+		const auto to = m_freeList.back();
+		while (highest > to && !m_isLive[highest - 1]) --highest;
+		if (highest <= to) break;
+		const auto from = highest - 1;
+
+		m_freeList.pop_back();
+		const auto handle = (static_cast<Handle>(m_generations[from]) << 32) | from;
+		m_isLive[to] = true;
+		relocations.push_back({ handle, (static_cast<Handle>(m_generations[to]) << 32) | to });
+
+		// The moved-from slot may still be read by the frames in flight.
+		Free(handle, fenceValue);
+		++m_numAllocated;
+	}
+
+	return static_cast<uint32_t>(relocations.size());
+}
+
+float SlotAllocator::GetFragmentation() const
+{
+	auto span = m_highWaterMark;
+	while (span > 0 && !m_isLive[span - 1]) --span;
+
+	// Otherwise, the slots vacated by a compaction would trigger another one every frame
+	// until they are recycled.
+	auto numRetired = 0u;
+	for (const auto& slot : m_retiredSlots) if (slot.Index < span) ++numRetired;
+
+	return span > 0 ? static_cast<float>(span - m_numAllocated - numRetired) / span : 0.0f;
+}
+
+bool SlotAllocator::IsValid(Handle handle) const
+{
+	const auto index = static_cast<uint32_t>(handle);
+
+	return index < m_highWaterMark && m_generations[index] == static_cast<uint32_t>(handle >> 32);
+}
+
+uint32_t SlotAllocator::GetIndex(Handle handle) const
+{
+	return IsValid(handle) ? static_cast<uint32_t>(handle) : UINT32_MAX;
+}
+
+uint32_t SlotAllocator::GetCapacity() const
+{
+	return static_cast<uint32_t>(m_generations.size());
+}
+
+uint32_t SlotAllocator::GetNumAllocated() const
+{
+	return m_numAllocated;
+}
+
+uint32_t SlotAllocator::GetNumRetired() const
+{
+	return static_cast<uint32_t>(m_retiredSlots.size());
+}
@@ -0,0 +1,68 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// O(1) slot allocator with generation-tagged handles and fence-deferred recycling.
+// A handle carries the slot index in its low 32 bits and the slot generation in its
+// high 32 bits; freeing bumps the generation, so stale handles are caught at once,
+// while the slot itself only returns to the free list after the GPU is done with it.
+class SlotAllocator
+{
+public:
+	using Handle = uint64_t;
+	static const Handle InvalidHandle = ~Handle(0);
+
+	struct Relocation
+	{
+		Handle From;
+		Handle To;
+	};
+
+	SlotAllocator();
+	virtual ~SlotAllocator();
+
+	bool Init(uint32_t capacity);
+
+	// Returns InvalidHandle when all slots are in use or awaiting recycling.
+	Handle Allocate();
+	// The slot may be reused once fenceValue has completed; fails for stale handles.
+	bool Free(Handle handle, uint64_t fenceValue);
+	void Recycle(uint64_t completedFenceValue);
+
+	// Moves the highest live slots into the lowest free ones, so that the live slots form a
+	// dense prefix as far as slots awaiting recycling allow. Moved-from handles become stale
+	// and their slots are retired with fenceValue, as if freed. Returns the number of moves.
+	uint32_t Compact(uint64_t fenceValue, std::vector<Relocation>& relocations);
+	// Share of the span up to the highest live slot that is free, i.e. that Compact() could fill;
+	// slots awaiting recycling are no holes yet. 0 for a dense prefix
+	float GetFragmentation() const;
+
+	bool IsValid(Handle handle) const;
+	// Returns UINT32_MAX for stale handles.
+	uint32_t GetIndex(Handle handle) const;
+
+	uint32_t GetCapacity() const;
+	uint32_t GetNumAllocated() const;
+	uint32_t GetNumRetired() const;
+
+protected:
+	struct RetiredSlot
+	{
+		uint64_t FenceValue;
+		uint32_t Index;
+	};
+
+	std::vector<uint32_t>		m_generations;
+	std::vector<uint32_t>		m_freeList;
+	std::deque<RetiredSlot>		m_retiredSlots;
+	std::vector<bool>			m_isLive;
+
+	uint32_t m_numAllocated;
+	uint32_t m_highWaterMark;	// Slots above it have never been allocated
+};
@@ -0,0 +1,113 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include "StagingRing.h"
+
+StagingRing::StagingRing() :
+	m_head(0),
+	m_tail(0),
+	m_retired(0),
+	m_capacity(0)
+{
+}
+
+StagingRing::~StagingRing()
+{
+}
+
+bool StagingRing::Init(uint64_t capacity)
+{
+	if (capacity < 1) return false;
+
+	m_batches.clear();
+	m_head = 0;
+	m_tail = 0;
+	m_retired = 0;
+	m_capacity = capacity;
+
+	return true;
+}
+
+bool StagingRing::Allocate(uint64_t size, uint64_t alignment, uint64_t& offset)
+{
+	uint64_t begin;
+	if (!isValid(size, alignment, m_capacity) || !fits(m_head, size, alignment, begin)) return false;
+
+	// Nothing is in use in an empty ring, so it restarts at the allocation.
+	if (m_head == m_tail) m_head = begin;
+	offset = begin % m_capacity;
+	m_tail = begin + size;
+
+	return true;
+}
+
+void StagingRing::Retire(uint64_t fenceValue)
+{
+	if (m_tail == m_retired) return;
+
+	m_batches.push_back({ fenceValue, m_tail });
+	m_retired = m_tail;
+}
+
+void StagingRing::Reclaim(uint64_t completedFenceValue)
+{
+	while (!m_batches.empty() && m_batches.front().FenceValue <= completedFenceValue)
+	{
+		m_head = m_batches.front().End;
+		m_batches.pop_front();
+	}
+}
+
+uint64_t StagingRing::GetOldestFenceValue() const
+{
+	return m_batches.empty() ? 0 : m_batches.front().FenceValue;
+}
+
+bool StagingRing::GetFenceValueForSpace(uint64_t size, uint64_t alignment, uint64_t& fenceValue) const
+{
+	if (!isValid(size, alignment, m_capacity)) return false;
+
+	// Reclaim the retired batches in order until the allocation fits.
+	uint64_t begin;
+	auto head = m_head;
+	fenceValue = 0;
+	for (const auto& batch : m_batches)
+	{
+		if (fits(head, size, alignment, begin)) return true;
+		head = batch.End;
+		fenceValue = batch.FenceValue;
+	}
+
+	return fits(head, size, alignment, begin);
+}
+
+uint64_t StagingRing::GetCapacity() const
+{
+	return m_capacity;
+}
+
+uint64_t StagingRing::GetUsedSize() const
+{
+	return m_tail - m_head;
+}
+
+bool StagingRing::HasPendingAllocations() const
+{
+	return m_tail != m_retired;
+}
+
+bool StagingRing::isValid(uint64_t size, uint64_t alignment, uint64_t capacity)
+{
+	return size <= capacity && alignment > 0 && !(alignment & (alignment - 1)) && capacity % alignment == 0;
+}
+
+bool StagingRing::fits(uint64_t head, uint64_t size, uint64_t alignment, uint64_t& begin) const
+{
+	begin = (m_tail + alignment - 1) & ~(alignment - 1);
+
+	// Do not straddle the end of the ring; skip to the start instead.
+	if (begin % m_capacity + size > m_capacity) begin = (begin / m_capacity + 1) * m_capacity;
+
+	return head == m_tail || begin + size - head <= m_capacity;
+}
@@ -0,0 +1,56 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+// Allocation and fence-based reclamation for a ring of staging memory. Offsets
+// are handed out in order; each submission retires the allocations made since the
+// previous one under its fence value, and they are reclaimed once that value has
+// completed. No device object is involved, so it can be driven by a fake fence.
+class StagingRing
+{
+public:
+	StagingRing();
+	virtual ~StagingRing();
+
+	bool Init(uint64_t capacity);
+
+	// Alignment must be a power of two dividing the capacity; fails when the ring is full.
+	bool Allocate(uint64_t size, uint64_t alignment, uint64_t& offset);
+	// Closes the allocations since the last retirement under fenceValue.
+	void Retire(uint64_t fenceValue);
+	void Reclaim(uint64_t completedFenceValue);
+
+	// Fence value to wait for to reclaim the oldest retired allocations; 0 if there are none
+	uint64_t GetOldestFenceValue() const;
+	// Fence value to wait for until Allocate() succeeds, 0 if it does already; fails if
+	// the space is held by allocations not yet retired, or the size exceeds the ring.
+	bool GetFenceValueForSpace(uint64_t size, uint64_t alignment, uint64_t& fenceValue) const;
+
+	uint64_t GetCapacity() const;
+	uint64_t GetUsedSize() const;
+	bool HasPendingAllocations() const;
+
+protected:
+	static bool isValid(uint64_t size, uint64_t alignment, uint64_t capacity);
+
+	bool fits(uint64_t head, uint64_t size, uint64_t alignment, uint64_t& begin) const;
+
+	struct Batch
+	{
+		uint64_t FenceValue;
+		uint64_t End;
+	};
+
+	std::deque<Batch> m_batches;
+
+	// Monotonic positions; the physical offset is the position modulo the capacity.
+	uint64_t m_head;
+	uint64_t m_tail;
+	uint64_t m_retired;
+	uint64_t m_capacity;
+};
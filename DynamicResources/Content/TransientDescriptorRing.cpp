@@ -0,0 +1,146 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cassert>
+#include "TransientDescriptorRing.h"
+
+using namespace std;
+
+TransientDescriptorRing::TransientDescriptorRing() :
+	m_cursor(0),
+	m_numAllocated(0),
+	m_numBlocks(0),
+	m_numOversized(0),
+	m_numOverflows(0),
+	m_frameId(0),
+	m_regionSize(0),
+	m_blockSize(0),
+	m_peakReserved(0),
+	m_regionIndex(0)
+{
+}
+
+TransientDescriptorRing::~TransientDescriptorRing()
+{
+}
+
+bool TransientDescriptorRing::Init(uint32_t capacity, uint8_t numFrames, uint32_t blockSize)
+{
+	if (numFrames < 1 || blockSize < 1 || capacity / numFrames < blockSize) return false;
+
+	m_regionSize = capacity / numFrames;
+	m_blockSize = blockSize;
+	m_regions.resize(numFrames);
+	for (uint8_t i = 0; i < numFrames; ++i) m_regions[i] = { 0, m_regionSize * i };
+
+	m_regionIndex = 0;
+	m_frameId = 0;
+	m_peakReserved = 0;
+	m_cursor = 0;
+	m_numAllocated = 0;
+	m_numBlocks = 0;
+	m_numOversized = 0;
+	m_numOverflows = 0;
+
+	return true;
+}
+
+bool TransientDescriptorRing::BeginFrame(uint64_t completedFenceValue)
+{
+	assert(!m_regions.empty());
+	if (m_regions[m_regionIndex].FenceValue > completedFenceValue) return false;
+
+	// A new frame id invalidates all thread blocks of the previous frames
+	++m_frameId;
+	m_cursor = 0;
+	m_numAllocated = 0;
+	m_numBlocks = 0;
+	m_numOversized = 0;
+
+	return true;
+}
+
+void TransientDescriptorRing::EndFrame(uint64_t fenceValue)
+{
+	assert(!m_regions.empty());
+	m_peakReserved = (max)(m_peakReserved, (min)(m_cursor.load(), m_regionSize));
+	m_regions[m_regionIndex].FenceValue = fenceValue;
+	m_regionIndex = (m_regionIndex + 1) % m_regions.size();
+}
+
+uint32_t TransientDescriptorRing::Allocate(ThreadBlock& block, uint32_t numDescriptors)
+{
+	assert(m_frameId > 0);
+	if (numDescriptors == 0) return InvalidOffset;
+
+	// Refill the block if it is from a previous frame or too small
+	if (block.FrameId != m_frameId || block.End - block.Offset < numDescriptors)
+	{
+		// Oversized requests bypass the block, so that its tail is not wasted
+		if (numDescriptors > m_blockSize)
+		{
+			const auto offset = reserve(numDescriptors);
+			if (offset != InvalidOffset)
+			{
+				m_numAllocated += numDescriptors;
+				++m_numOversized;
+			}
+
+			return offset;
+		}
+
+		const auto offset = reserve(m_blockSize);
+		if (offset == InvalidOffset) return InvalidOffset;
+		++m_numBlocks;
+
+		block.FrameId = m_frameId;
+		block.Offset = offset;
+		block.End = offset + m_blockSize;
+	}
+
+	const auto offset = block.Offset;
+	block.Offset += numDescriptors;
+	m_numAllocated += numDescriptors;
+
+	return offset;
+}
+
+uint32_t TransientDescriptorRing::GetCapacity() const
+{
+	return m_regionSize * static_cast<uint32_t>(m_regions.size());
+}
+
+uint32_t TransientDescriptorRing::GetRegionSize() const
+{
+	return m_regionSize;
+}
+
+TransientDescriptorRing::Stats TransientDescriptorRing::GetStats(bool resetOverflows)
+{
+	Stats stats;
+	stats.RegionSize = m_regionSize;
+	stats.NumAllocated = m_numAllocated;
+	stats.NumReserved = (min)(m_cursor.load(), m_regionSize);
+	stats.PeakReserved = (max)(m_peakReserved, stats.NumReserved);
+	stats.NumBlocks = m_numBlocks;
+	stats.NumOversized = m_numOversized;
+	stats.NumOverflows = resetOverflows ? m_numOverflows.exchange(0) : m_numOverflows.load();
+
+	return stats;
+}
+
+uint32_t TransientDescriptorRing::reserve(uint32_t count)
+{
+	// The cursor may run past the region end on overflow; it is reset in BeginFrame().
+	const auto offset = m_cursor.fetch_add(count);
+	if (offset > m_regionSize || count > m_regionSize - offset)
+	{
+		++m_numOverflows;
+
+		return InvalidOffset;
+	}
+
+	return m_regions[m_regionIndex].Offset + offset;
+}
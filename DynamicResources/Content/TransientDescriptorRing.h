@@ -0,0 +1,81 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Linear allocator of transient descriptor offsets. The range is split into one
+// region per frame in flight; a region is bump-allocated while its frame records
+// and reset as a whole once that frame's fence has completed. Recording threads
+// carve sub-blocks out of the region with a single atomic add, then allocate from
+// their own block without any synchronization.
+class TransientDescriptorRing
+{
+public:
+	static const uint32_t InvalidOffset = UINT32_MAX;
+
+	// Owned by one recording thread; it is refilled automatically in a new frame.
+	struct ThreadBlock
+	{
+		uint64_t FrameId = 0;
+		uint32_t Offset = 0;
+		uint32_t End = 0;
+	};
+
+	struct Stats
+	{
+		uint32_t RegionSize;
+		uint32_t NumAllocated;	// Descriptors handed out in the current frame
+		uint32_t NumReserved;	// Descriptors reserved by blocks, including unused tails
+		uint32_t PeakReserved;
+		uint32_t NumBlocks;		// Thread blocks carved out in the current frame
+		uint32_t NumOversized;	// Allocations larger than a block, reserved on their own
+		uint32_t NumOverflows;	// Failed allocations since the last reset of the stats
+	};
+
+	TransientDescriptorRing();
+	virtual ~TransientDescriptorRing();
+
+	bool Init(uint32_t capacity, uint8_t numFrames, uint32_t blockSize = 32);
+
+	// Fails while the GPU has not yet completed the frame that last used the next region.
+	bool BeginFrame(uint64_t completedFenceValue);
+	// The region of the current frame is reused once fenceValue has completed.
+	void EndFrame(uint64_t fenceValue);
+
+	// Thread-safe between BeginFrame() and EndFrame(); returns InvalidOffset on overflow.
+	// Offsets are relative to the start of the whole range, and contiguous per allocation.
+	uint32_t Allocate(ThreadBlock& block, uint32_t numDescriptors);
+
+	uint32_t GetCapacity() const;
+	uint32_t GetRegionSize() const;
+	Stats GetStats(bool resetOverflows = true);
+
+protected:
+	struct Region
+	{
+		uint64_t FenceValue;
+		uint32_t Offset;
+	};
+
+	// Reserves count descriptors of the current region; returns InvalidOffset on overflow.
+	uint32_t reserve(uint32_t count);
+
+	std::vector<Region>		m_regions;
+
+	std::atomic<uint32_t>	m_cursor;	// Relative to the current region
+	std::atomic<uint32_t>	m_numAllocated;
+	std::atomic<uint32_t>	m_numBlocks;
+	std::atomic<uint32_t>	m_numOversized;
+	std::atomic<uint32_t>	m_numOverflows;
+
+	uint64_t	m_frameId;
+	uint32_t	m_regionSize;
+	uint32_t	m_blockSize;
+	uint32_t	m_peakReserved;
+	uint8_t		m_regionIndex;
+};
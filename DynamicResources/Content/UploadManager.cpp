@@ -0,0 +1,273 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include "UploadManager.h"
+
+using namespace std;
+using namespace XUSG;
+
+UploadManager::UploadManager() :
+	m_pDevice(nullptr),
+	m_pStagingData(nullptr),
+	m_fenceValue(0),
+	m_fenceEvent(nullptr),
+	m_isRecording(false)
+{
+}
+
+UploadManager::~UploadManager()
+{
+	if (m_fenceEvent)
+	{
+		Flush();
+		CloseHandle(m_fenceEvent);
+	}
+	if (m_pStagingData) m_staging->Unmap();
+}
+
+bool UploadManager::Init(const Device* pDevice, uint64_t capacity)
+{
+	m_pDevice = pDevice;
+
+	m_copyQueue = CommandQueue::MakeUnique();
+	XUSG_N_RETURN(m_copyQueue->Create(pDevice, CommandListType::COPY, CommandQueueFlag::NONE,
+		0, 0, L"CopyQueue"), false);
+
+	XUSG_N_RETURN(m_commandAllocators.Init(NumBatches), false);
+	for (uint8_t n = 0; n < NumBatches; ++n)
+	{
+		auto& commandAllocator = m_commandAllocators[n];
+		commandAllocator = CommandAllocator::MakeUnique();
+		XUSG_N_RETURN(commandAllocator->Create(pDevice, CommandListType::COPY,
+			(L"CopyCommandAllocator" + to_wstring(n)).c_str()), false);
+	}
+
+	m_commandList = CommandList::MakeUnique();
+	XUSG_N_RETURN(m_commandList->Create(pDevice, 0, CommandListType::COPY,
+		m_commandAllocators.GetCurrent().get(), nullptr), false);
+	XUSG_N_RETURN(m_commandList->Close(), false);
+
+	// Staging ring, mapped for its whole lifetime
+	capacity = XUSG_DIV_UP(capacity, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT) * D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT;
+	m_staging = Buffer::MakeUnique();
+	XUSG_N_RETURN(m_staging->Create(pDevice, capacity, ResourceFlag::NONE, MemoryType::UPLOAD,
+		0, nullptr, 0, nullptr, MemoryFlag::NONE, L"StagingRing"), false);
+	m_pStagingData = static_cast<uint8_t*>(m_staging->Map(nullptr));
+	XUSG_N_RETURN(m_pStagingData, false);
+	XUSG_N_RETURN(m_stagingRing.Init(capacity), false);
+
+	m_fence = Fence::MakeUnique();
+	XUSG_N_RETURN(m_fence->Create(pDevice, m_fenceValue++, FenceFlag::NONE, L"CopyFence"), false);
+	m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	XUSG_N_RETURN(m_fenceEvent, false);
+
+	return true;
+}
+
+bool UploadManager::Upload(Texture* pDst, const void* pData, uint32_t rowPitch, uint32_t subresource)
+{
+	const auto pDevice = static_cast<ID3D12Device*>(m_pDevice->GetHandle());
+	const auto pResource = static_cast<ID3D12Resource*>(pDst->GetHandle());
+	const auto desc = pResource->GetDesc();
+
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint;
+	uint32_t numRows;
+	uint64_t rowSize, totalBytes;
+	pDevice->GetCopyableFootprints(&desc, subresource, 1, 0, &footprint, &numRows, &rowSize, &totalBytes);
+
+	uint64_t offset;
+	XUSG_N_RETURN(allocate(totalBytes, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, offset), false);
+	XUSG_N_RETURN(beginRecording(), false);
+
+	// Repitch the rows into the staging ring
+	const auto pSrc = static_cast<const uint8_t*>(pData);
+	for (auto y = 0u; y < numRows; ++y)
+		memcpy(&m_pStagingData[offset + footprint.Footprint.RowPitch * y],
+			&pSrc[static_cast<size_t>(rowPitch) * y], static_cast<size_t>(rowSize));
+	footprint.Offset = offset;
+
+	D3D12_TEXTURE_COPY_LOCATION dst = {};
+	dst.pResource = pResource;
+	dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+	dst.SubresourceIndex = subresource;
+
+	D3D12_TEXTURE_COPY_LOCATION src = {};
+	src.pResource = static_cast<ID3D12Resource*>(m_staging->GetHandle());
+	src.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+	src.PlacedFootprint = footprint;
+
+	// XUSG's copy locations have no placed footprint, so record the copy natively.
+	const auto pCommandList = static_cast<ID3D12GraphicsCommandList*>(m_commandList->GetHandle());
+	pCommandList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+
+	return true;
+}
+
+bool UploadManager::UploadRegion(Texture* pDst, const void* pData, uint32_t rowPitch, uint32_t x, uint32_t y,
+	uint32_t width, uint32_t height, uint32_t subresource)
+{
+	const auto pDevice = static_cast<ID3D12Device*>(m_pDevice->GetHandle());
+	const auto pResource = static_cast<ID3D12Resource*>(pDst->GetHandle());
+
+	// Footprint of a texture of the size of the region
+	auto desc = pResource->GetDesc();
+	desc.Width = width;
+	desc.Height = height;
+	desc.DepthOrArraySize = 1;
+	desc.MipLevels = 1;
+
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint;
+	uint32_t numRows;
+	uint64_t rowSize, totalBytes;
+	pDevice->GetCopyableFootprints(&desc, 0, 1, 0, &footprint, &numRows, &rowSize, &totalBytes);
+
+	uint64_t offset;
+	XUSG_N_RETURN(allocate(totalBytes, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, offset), false);
+	XUSG_N_RETURN(beginRecording(), false);
+
+	const auto pSrc = static_cast<const uint8_t*>(pData);
+	for (auto i = 0u; i < numRows; ++i)
+		memcpy(&m_pStagingData[offset + footprint.Footprint.RowPitch * i],
+			&pSrc[static_cast<size_t>(rowPitch) * i], static_cast<size_t>(rowSize));
+	footprint.Offset = offset;
+
+	D3D12_TEXTURE_COPY_LOCATION dst = {};
+	dst.pResource = pResource;
+	dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+	dst.SubresourceIndex = subresource;
+
+	D3D12_TEXTURE_COPY_LOCATION src = {};
+	src.pResource = static_cast<ID3D12Resource*>(m_staging->GetHandle());
+	src.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+	src.PlacedFootprint = footprint;
+
+	const auto pCommandList = static_cast<ID3D12GraphicsCommandList*>(m_commandList->GetHandle());
+	pCommandList->CopyTextureRegion(&dst, x, y, 0, &src, nullptr);
+
+	return true;
+}
+
+bool UploadManager::Upload(Buffer* pDst, const void* pData, size_t size, uint64_t dstOffset)
+{
+	uint64_t offset;
+	XUSG_N_RETURN(allocate(size, sizeof(uint32_t), offset), false);
+	XUSG_N_RETURN(beginRecording(), false);
+
+	memcpy(&m_pStagingData[offset], pData, size);
+	m_commandList->CopyBufferRegion(pDst, dstOffset, m_staging.get(), offset, size);
+
+	return true;
+}
+
+uint64_t UploadManager::Submit()
+{
+	if (!m_isRecording) return m_fenceValue - 1;
+
+	XUSG_N_RETURN(m_commandList->Close(), 0);
+	m_copyQueue->ExecuteCommandList(m_commandList.get());
+	m_isRecording = false;
+
+	const auto fenceValue = m_fenceValue++;
+	XUSG_N_RETURN(m_copyQueue->Signal(m_fence.get(), fenceValue), 0);
+	m_stagingRing.Retire(fenceValue);
+	m_commandAllocators.Advance(fenceValue);
+
+	return fenceValue;
+}
+
+bool UploadManager::Wait(CommandQueue* pQueue, uint64_t fenceValue) const
+{
+	return IsComplete(fenceValue) || pQueue->Wait(m_fence.get(), fenceValue);
+}
+
+bool UploadManager::WaitForQueue(const Fence* pFence, uint64_t fenceValue)
+{
+	return pFence->GetCompletedValue() >= fenceValue || m_copyQueue->Wait(pFence, fenceValue);
+}
+
+bool UploadManager::Flush()
+{
+	const auto fenceValue = Submit();
+	XUSG_N_RETURN(waitForFence(fenceValue), false);
+	m_stagingRing.Reclaim(fenceValue);
+
+	return true;
+}
+
+bool UploadManager::WaitForSpace(uint64_t size, uint64_t alignment)
+{
+	m_stagingRing.Reclaim(m_fence->GetCompletedValue());
+
+	// Space held by the batched copies is only reclaimed once they are submitted.
+	uint64_t fenceValue;
+	if (!m_stagingRing.GetFenceValueForSpace(size, alignment, fenceValue))
+	{
+		XUSG_N_RETURN(Submit(), false);
+		XUSG_N_RETURN(m_stagingRing.GetFenceValueForSpace(size, alignment, fenceValue), false);
+	}
+
+	if (fenceValue > 0)
+	{
+		XUSG_N_RETURN(waitForFence(fenceValue), false);
+		m_stagingRing.Reclaim(fenceValue);
+	}
+
+	return true;
+}
+
+bool UploadManager::IsComplete(uint64_t fenceValue) const
+{
+	return m_fence->GetCompletedValue() >= fenceValue;
+}
+
+bool UploadManager::HasPendingUploads() const
+{
+	return m_isRecording;
+}
+
+uint64_t UploadManager::GetUsedSize() const
+{
+	return m_stagingRing.GetUsedSize();
+}
+
+uint64_t UploadManager::GetCapacity() const
+{
+	return m_stagingRing.GetCapacity();
+}
+
+bool UploadManager::allocate(uint64_t size, uint64_t alignment, uint64_t& offset)
+{
+	if (m_stagingRing.Allocate(size, alignment, offset)) return true;
+
+	// Reclaim what the copy queue has finished, and retry once.
+	m_stagingRing.Reclaim(m_fence->GetCompletedValue());
+
+	return m_stagingRing.Allocate(size, alignment, offset);
+}
+
+bool UploadManager::beginRecording()
+{
+	if (m_isRecording) return true;
+
+	// The allocator is free once its previous batch has completed; with
+	// NumBatches in flight this rarely blocks.
+	XUSG_N_RETURN(waitForFence(m_commandAllocators.GetFenceValue()), false);
+
+	const auto pCommandAllocator = m_commandAllocators.GetCurrent().get();
+	XUSG_N_RETURN(pCommandAllocator->Reset(), false);
+	XUSG_N_RETURN(m_commandList->Reset(pCommandAllocator, nullptr), false);
+	m_isRecording = true;
+
+	return true;
+}
+
+bool UploadManager::waitForFence(uint64_t fenceValue)
+{
+	if (IsComplete(fenceValue)) return true;
+
+	XUSG_N_RETURN(m_fence->SetEventOnCompletion(fenceValue, m_fenceEvent), false);
+	WaitForSingleObject(m_fenceEvent, INFINITE);
+
+	return true;
+}
@@ -0,0 +1,74 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Core/XUSG.h"
+#include "FrameRing.h"
+#include "StagingRing.h"
+
+// Uploads through a persistently mapped staging ring on a dedicated COPY queue.
+// Copies are batched into one command list until Submit(), and staging memory is
+// reclaimed once the copy fence passes, so steady-state uploads never allocate
+// upload heaps. Destinations must be in the COMMON state; copy-queue accesses
+// promote and decay them implicitly.
+class UploadManager
+{
+public:
+	static const uint64_t DefaultCapacity = 64ull << 20;
+
+	UploadManager();
+	virtual ~UploadManager();
+
+	bool Init(const XUSG::Device* pDevice, uint64_t capacity = DefaultCapacity);
+
+	// Stage copies; these fail without side effects when the staging ring is full, in which
+	// case the caller may retry on a later frame, or block on WaitForSpace() and retry.
+	bool Upload(XUSG::Texture* pDst, const void* pData, uint32_t rowPitch, uint32_t subresource = 0);
+	// Copies width x height texels to (x, y) of the subresource; pData points to the first
+	// texel of the region.
+	bool UploadRegion(XUSG::Texture* pDst, const void* pData, uint32_t rowPitch, uint32_t x, uint32_t y,
+		uint32_t width, uint32_t height, uint32_t subresource = 0);
+	bool Upload(XUSG::Buffer* pDst, const void* pData, size_t size, uint64_t dstOffset = 0);
+
+	// Submits the batched copies and returns the fence value to wait for before using the destinations.
+	uint64_t Submit();
+	// Makes the queue wait on the GPU, without blocking the CPU.
+	bool Wait(XUSG::CommandQueue* pQueue, uint64_t fenceValue) const;
+	// Makes the copy queue wait on the GPU for another queue's fence before the next batch,
+	// e.g. before overwriting resources that frames in flight still read.
+	bool WaitForQueue(const XUSG::Fence* pFence, uint64_t fenceValue);
+	// Submits and blocks the CPU until all copies are done.
+	bool Flush();
+	// Blocks the CPU until size bytes can be staged, submitting the batched copies if they
+	// hold the space; fails if the size exceeds the staging ring.
+	bool WaitForSpace(uint64_t size, uint64_t alignment = D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+
+	bool IsComplete(uint64_t fenceValue) const;
+	bool HasPendingUploads() const;
+	uint64_t GetUsedSize() const;
+	uint64_t GetCapacity() const;
+
+protected:
+	static const uint8_t NumBatches = 3;
+
+	bool allocate(uint64_t size, uint64_t alignment, uint64_t& offset);
+	bool beginRecording();
+	bool waitForFence(uint64_t fenceValue);
+
+	const XUSG::Device* m_pDevice;
+
+	XUSG::CommandQueue::uptr	m_copyQueue;
+	XUSG::CommandList::uptr		m_commandList;
+	FrameRing<XUSG::CommandAllocator::uptr> m_commandAllocators;
+
+	XUSG::Buffer::uptr	m_staging;
+	uint8_t*			m_pStagingData;
+	StagingRing			m_stagingRing;
+
+	XUSG::Fence::uptr	m_fence;
+	uint64_t			m_fenceValue;
+	void*				m_fenceEvent;
+	bool				m_isRecording;
+};
@@ -10,20 +10,56 @@
 //*********************************************************
 
 #include "DynamicResources.h"
+#include "CPUImageProc.h"
 #include "stb_image_write.h"
+#define _ENABLE_STB_IMAGE_LOADER_ONLY_
+#include "Advanced/XUSGTextureLoader.h"
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
 
 using namespace std;
 using namespace XUSG;
 
 const auto g_backBufferFormat = Format::R8G8B8A8_UNORM;
+const auto g_maxFenceWaitTime = 16u; // ms, bounds waits so that the message loop stays responsive
+const auto g_numBindlessDescriptors = 256u;
+const auto g_numBindlessSamplers = 16u;
+const auto g_maxFragmentation = 0.25f; // Compacts the bindless heap beyond it
+const auto g_maxFilterInstances = 16u; // Each instance takes a sampler slot
+const auto g_maxFilterPasses = 4u; // Each intermediate takes 2 descriptor slots per instance
 
 DynamicResources::DynamicResources(uint32_t width, uint32_t height, wstring name) :
 	DXFramework(width, height, name),
-	m_frameIndex(0),
+	m_backBufferIndex(0),
+	m_numFrames(3),
+	m_numFilterInstances(1),
+	m_numFilterPasses(1),
+	m_frameTimer(nullptr),
+	m_fenceValue(0),
 	m_deviceType(DEVICE_DISCRETE),
 	m_showFPS(true),
+	m_asyncCompute(false),
+	m_analyzeCommands(false),
+	m_useBundles(true),
+	m_indirectDispatch(false),
+	m_repaintSource(false),
+	m_numArrayImages(0),
+	m_numAtlasImages(0),
+	m_regionOfInterest(),
+	m_filterRecordTime(0.0),
+	m_numCaptureFrames(0),
+	m_numReplayIterations(0),
 	m_fileName("Assets/Sashimi.png"),
-	m_screenShot(0)
+	m_repaintRect(),
+	m_sourceCopyWidth(0),
+	m_sourceCopyHeight(0),
+	m_numRepaints(0),
+	m_sourceCopyChannels(0),
+	m_screenShot(0),
+	m_validationPassed(true),
+	m_recordGoldens(false)
 {
 #if defined (_DEBUG)
 	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
@@ -44,13 +80,43 @@ DynamicResources::~DynamicResources()
 
 void DynamicResources::OnInit()
 {
-	vector<Resource::uptr> uploaders(0);
-	LoadPipeline(uploaders);
+	// Host-side microbenchmarks run before any device object exists.
+	if (!m_benchmarkFileName.empty())
+	{
+		HostBenchmark benchmark;
+		const auto succeeded = benchmark.Run(m_fileName.c_str(), m_benchmarkFileName.c_str());
+		if (!succeeded) cerr << "Failed to run the host benchmark" << endl;
+		PostQuitMessage(succeeded ? 0 : 1);
+
+		return;
+	}
+
+	// Check the CPU path against the goldens, then the GPU result against the CPU path
+	// once the first frames have been rendered.
+	if (!m_goldenDir.empty())
+	{
+		ImageValidator validator;
+		m_validationPassed = validator.Run(m_fileName.c_str(), m_goldenDir.c_str(), m_recordGoldens);
+		m_screenShot = 1;
+	}
+
+	LoadPipeline();
 	LoadAssets();
+
+	if (m_arrayBatchFilter) ProcessArrayBatch();
+	if (m_atlasFilter) ProcessAtlas();
+	if (!DirtyRegion::IsEmpty(m_regionOfInterest)) ProcessRegion();
+
+	// Replay the capture in place of rendering.
+	if (!m_replayFileName.empty())
+	{
+		ReplayCapture();
+		PostQuitMessage(0);
+	}
 }
 
 // Load the rendering pipeline dependencies.
-void DynamicResources::LoadPipeline(vector<Resource::uptr>& uploaders)
+void DynamicResources::LoadPipeline()
 {
 	auto dxgiFactoryFlags = 0u;
 
@@ -121,31 +187,167 @@ void DynamicResources::LoadPipeline(vector<Resource::uptr>& uploaders)
 	XUSG_N_RETURN(m_commandQueue->Create(m_device.get(), CommandListType::DIRECT, CommandQueueFlag::NONE,
 		0, 0, L"CommandQueue"), ThrowIfFailed(E_FAIL));
 
+	// Create the compute queue and its fences for the async-compute path.
+	if (m_asyncCompute)
+	{
+		m_computeQueue = CommandQueue::MakeUnique();
+		XUSG_N_RETURN(m_computeQueue->Create(m_device.get(), CommandListType::COMPUTE, CommandQueueFlag::NONE,
+			0, 0, L"ComputeQueue"), ThrowIfFailed(E_FAIL));
+
+		m_filterSemaphore.Fence = Fence::MakeUnique();
+		XUSG_N_RETURN(m_filterSemaphore.Fence->Create(m_device.get(), 0, FenceFlag::NONE, L"FilterFence"), ThrowIfFailed(E_FAIL));
+		m_presentSemaphore.Fence = Fence::MakeUnique();
+		XUSG_N_RETURN(m_presentSemaphore.Fence->Create(m_device.get(), 0, FenceFlag::NONE, L"PresentFence"), ThrowIfFailed(E_FAIL));
+		XUSG_N_RETURN(m_crossQueueSchedule.Init(BindlessFilter::ResultCount), ThrowIfFailed(E_FAIL));
+	}
+
 	// This sample does not support fullscreen transitions.
 	ThrowIfFailed(factory->MakeWindowAssociation(Win32Application::GetHwnd(), DXGI_MWA_NO_ALT_ENTER));
 
-	// Create a command allocator for each frame.
-	for (uint8_t n = 0u; n < FrameCount; ++n)
+	// Create the frame ring with a command allocator for each frame in flight.
+	XUSG_N_RETURN(m_frameRing.Init(m_numFrames), ThrowIfFailed(E_FAIL));
+	m_framePacer.SetMaxFramesInFlight(m_numFrames);
+	for (uint8_t n = 0u; n < m_numFrames; ++n)
 	{
-		m_commandAllocators[n] = CommandAllocator::MakeUnique();
-		XUSG_N_RETURN(m_commandAllocators[n]->Create(m_device.get(), CommandListType::DIRECT,
+		auto& commandAllocator = m_frameRing[n].CommandAllocator;
+		commandAllocator = CommandAllocator::MakeUnique();
+		XUSG_N_RETURN(commandAllocator->Create(m_device.get(), CommandListType::DIRECT,
 			(L"CommandAllocator" + to_wstring(n)).c_str()), ThrowIfFailed(E_FAIL));
+
+		if (m_asyncCompute)
+		{
+			auto& computeCommandAllocator = m_frameRing[n].ComputeCommandAllocator;
+			computeCommandAllocator = CommandAllocator::MakeUnique();
+			XUSG_N_RETURN(computeCommandAllocator->Create(m_device.get(), CommandListType::COMPUTE,
+				(L"ComputeCommandAllocator" + to_wstring(n)).c_str()), ThrowIfFailed(E_FAIL));
+		}
 	}
 
 	// Create the command list.
 	m_commandList = CommandList::MakeUnique();
 	const auto pCommandList = m_commandList.get();
 	XUSG_N_RETURN(pCommandList->Create(m_device.get(), 0, CommandListType::DIRECT,
-		m_commandAllocators[m_frameIndex].get(), nullptr), ThrowIfFailed(E_FAIL));
+		m_frameRing.GetCurrent().CommandAllocator.get(), nullptr), ThrowIfFailed(E_FAIL));
+
+	// The filter dispatches on the direct queue are replayed from bundles.
+	XUSG_N_RETURN(m_bundleCache.Init(m_device.get(), L"FilterBundle"), ThrowIfFailed(E_FAIL));
+
+	if (m_asyncCompute)
+	{
+		m_computeCommandList = CommandList::MakeUnique();
+		XUSG_N_RETURN(m_computeCommandList->Create(m_device.get(), 0, CommandListType::COMPUTE,
+			m_frameRing.GetCurrent().ComputeCommandAllocator.get(), nullptr), ThrowIfFailed(E_FAIL));
+		XUSG_N_RETURN(m_computeCommandList->Close(), ThrowIfFailed(E_FAIL));
+	}
 
 	// Create descriptor-table lib.
 	m_descriptorTableLib = DescriptorTableLib::MakeShared(m_device.get(), L"DescriptorTableLib");
 
-	m_bindlessFilter = make_unique<BindlessFilter>();
-	XUSG_N_RETURN(m_bindlessFilter->Init(pCommandList, m_descriptorTableLib, uploaders,
-		g_backBufferFormat, m_fileName.c_str()), ThrowIfFailed(E_FAIL));
+	// Allocate the heaps up front, since the bindless heap reserves fixed ranges in them.
+	XUSG_N_RETURN(m_descriptorTableLib->AllocateDescriptorHeap(CBV_SRV_UAV_HEAP,
+		g_numBindlessDescriptors + 64), ThrowIfFailed(E_FAIL));
+	XUSG_N_RETURN(m_descriptorTableLib->AllocateDescriptorHeap(SAMPLER_HEAP, g_numBindlessSamplers + 16), ThrowIfFailed(E_FAIL));
+	m_bindlessHeap = make_shared<BindlessHeap>();
+	XUSG_N_RETURN(m_bindlessHeap->Init(m_device.get(), m_descriptorTableLib, g_numBindlessDescriptors,
+		g_numBindlessSamplers), ThrowIfFailed(E_FAIL));
+
+	// Create the upload manager, which owns the copy queue and the staging ring.
+	m_uploadManager = make_unique<UploadManager>();
+	XUSG_N_RETURN(m_uploadManager->Init(m_device.get()), ThrowIfFailed(E_FAIL));
+
+	// All filter instances sub-allocate their records from one table, so that they share
+	// the address windows and are processed back to back with one pipeline bind.
+	m_addressWindows = make_shared<AddressWindows>();
+	m_recordTable = make_shared<RecordTable>();
+	XUSG_N_RETURN(m_recordTable->Init(m_device.get(), sizeof(BindlessFilter::ResourceIndices),
+		BindlessFilter::ResultCount * m_numFilterPasses * m_numFilterInstances + (m_numArrayImages > 0 ? 1 : 0) +
+		(DirtyRegion::IsEmpty(m_regionOfInterest) ? 0 : 1),
+		m_addressWindows, L"ResourceIndices"), ThrowIfFailed(E_FAIL));
+
+	m_bindlessFilters.resize(m_numFilterInstances);
+	for (auto& bindlessFilter : m_bindlessFilters)
+	{
+		bindlessFilter = make_unique<BindlessFilter>();
+		XUSG_N_RETURN(bindlessFilter->Init(m_device.get(), m_descriptorTableLib, m_bindlessHeap, m_recordTable,
+			m_uploadManager.get(), g_backBufferFormat, m_fileName.c_str(), m_numFilterPasses), ThrowIfFailed(E_FAIL));
+		bindlessFilter->SetIncremental(m_repaintSource);
+		m_filterBatch.emplace_back(bindlessFilter.get());
+	}
+
+	// The repainted square is inverted over a copy of the source.
+	if (m_repaintSource)
+	{
+		int width, height, channels;
+		const auto pData = LoadImageFromFile(m_fileName.c_str(), width, height, channels);
+		XUSG_N_RETURN(pData, ThrowIfFailed(E_FAIL));
+		m_sourceCopy.assign(pData, pData + static_cast<size_t>(width) * height * channels);
+		stbi_image_free(pData);
+		m_sourceCopyWidth = width;
+		m_sourceCopyHeight = height;
+		m_sourceCopyChannels = static_cast<uint8_t>(channels);
+	}
+
+	// The region of interest of the first instance is filtered once at startup.
+	if (!DirtyRegion::IsEmpty(m_regionOfInterest))
+	{
+		vector<Resource::uptr> retiredResources;
+		XUSG_N_RETURN(m_bindlessFilters[0]->CreateRegionResult(m_regionOfInterest.Right - m_regionOfInterest.Left,
+			m_regionOfInterest.Bottom - m_regionOfInterest.Top, retiredResources, 0), ThrowIfFailed(E_FAIL));
+	}
+
+	if (m_indirectDispatch)
+		XUSG_N_RETURN(BindlessFilter::CreateIndirectBatch(m_indirectBatch, m_filterBatch.data(),
+			static_cast<uint32_t>(m_filterBatch.size()), m_uploadManager.get()), ThrowIfFailed(E_FAIL));
+
+	// The array batch runs once at startup on copies of the source.
+	if (m_numArrayImages > 0)
+	{
+		m_arrayBatchFilter = make_unique<ArrayBatchFilter>();
+		XUSG_N_RETURN(m_arrayBatchFilter->Init(m_device.get(), m_bindlessHeap, m_recordTable, m_uploadManager.get(),
+			vector<string>(m_numArrayImages, m_fileName)), ThrowIfFailed(E_FAIL));
+	}
+
+	// So does the atlas, on crops of the source whose sizes and places follow a fixed LCG.
+	if (m_numAtlasImages > 0)
+	{
+		int width, height, channels;
+		const unique_ptr<uint8_t, decltype(&stbi_image_free)> source(stbi_load(m_fileName.c_str(),
+			&width, &height, &channels, 4), stbi_image_free);
+		XUSG_N_RETURN(source, ThrowIfFailed(E_FAIL));
+
+		auto seed = 1u;
+		const auto random = [&seed](uint32_t n)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			return (seed >> 8) % n;
+		};
+
+		const auto maxWidth = (min)(64u, static_cast<uint32_t>(width));
+		const auto maxHeight = (min)(64u, static_cast<uint32_t>(height));
+		vector<AtlasFilter::Image> images(m_numAtlasImages);
+		for (auto& image : images)
+		{
+			image.Width = (min)(8u, maxWidth) + random(maxWidth - (min)(8u, maxWidth) + 1);
+			image.Height = (min)(8u, maxHeight) + random(maxHeight - (min)(8u, maxHeight) + 1);
+			image.RowPitch = sizeof(uint32_t) * width;
+			const auto x = random(width - image.Width + 1);
+			const auto y = random(height - image.Height + 1);
+			image.pData = &source.get()[image.RowPitch * y + sizeof(uint32_t) * x];
+		}
+
+		m_atlasFilter = make_unique<AtlasFilter>();
+		XUSG_N_RETURN(m_atlasFilter->Init(m_device.get(), m_bindlessHeap, m_addressWindows, m_uploadManager.get(),
+			images.data(), m_numAtlasImages), ThrowIfFailed(E_FAIL));
+	}
+
+	XUSG_N_RETURN(m_recordTable->Update(m_uploadManager.get(), nullptr, 0), ThrowIfFailed(E_FAIL));
+
+	// The rendering queues wait for the initial uploads on the GPU.
+	const auto uploadFenceValue = m_uploadManager->Submit();
+	XUSG_N_RETURN(m_uploadManager->Wait(m_commandQueue.get(), uploadFenceValue), ThrowIfFailed(E_FAIL));
+	if (m_computeQueue) XUSG_N_RETURN(m_uploadManager->Wait(m_computeQueue.get(), uploadFenceValue), ThrowIfFailed(E_FAIL));
 	
-	m_bindlessFilter->GetImageSize(m_width, m_height);
+	m_bindlessFilters[0]->GetImageSize(m_width, m_height);
 
 	// Resize window
 	{
@@ -159,16 +361,17 @@ void DynamicResources::LoadPipeline(vector<Resource::uptr>& uploaders)
 			windowRect.right - windowRect.left, windowRect.bottom - windowRect.top, 0);
 	}
 
-	// Describe and create the swap chain.
+	// Describe and create the swap chain; flip-model swap chains need at least 2 buffers.
+	const auto numBackBuffers = (max)(m_numFrames, uint8_t(2));
 	m_swapChain = SwapChain::MakeUnique();
 	XUSG_N_RETURN(m_swapChain->Create(factory.get(), Win32Application::GetHwnd(), m_commandQueue->GetHandle(),
-		FrameCount, m_width, m_height, g_backBufferFormat, SwapChainFlag::ALLOW_TEARING), ThrowIfFailed(E_FAIL));
+		numBackBuffers, m_width, m_height, g_backBufferFormat, SwapChainFlag::ALLOW_TEARING), ThrowIfFailed(E_FAIL));
 
-	m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
+	m_backBufferIndex = m_swapChain->GetCurrentBackBufferIndex();
 
 	// Create frame resources.
-	// Create a RTV for each frame.
-	for (uint8_t n = 0; n < FrameCount; ++n)
+	// Create a RTV for each back buffer.
+	for (uint8_t n = 0; n < numBackBuffers; ++n)
 	{
 		m_renderTargets[n] = RenderTarget::MakeUnique();
 		XUSG_N_RETURN(m_renderTargets[n]->CreateFromSwapChain(m_device.get(), m_swapChain.get(), n), ThrowIfFailed(E_FAIL));
@@ -187,13 +390,21 @@ void DynamicResources::LoadAssets()
 		if (!m_fence)
 		{
 			m_fence = Fence::MakeUnique();
-			XUSG_N_RETURN(m_fence->Create(m_device.get(), m_fenceValues[m_frameIndex]++, FenceFlag::NONE, L"Fence"), ThrowIfFailed(E_FAIL));
+			XUSG_N_RETURN(m_fence->Create(m_device.get(), m_fenceValue++, FenceFlag::NONE, L"Fence"), ThrowIfFailed(E_FAIL));
 		}
 
 		// Create an event handle to use for frame synchronization.
 		m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
 		if (!m_fenceEvent) ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
 
+		// A high-resolution timer sleeps a frame right up to its start time, so that nothing
+		// is left to spin off on the message loop. Systems without one fall back to a timer
+		// of the scheduler tick, whose last tick is still spun.
+		m_frameTimer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+		if (m_frameTimer) m_framePacer.SetSleepGranularity(0.0);
+		else m_frameTimer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+		if (!m_frameTimer) ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+
 		// Wait for the command list to execute; we are reusing the same command 
 		// list in our main loop but for now, we just want to wait for setup to 
 		// complete before continuing.
@@ -218,11 +429,78 @@ void DynamicResources::OnUpdate()
 // Render the scene.
 void DynamicResources::OnRender()
 {
-	// Record all the commands we need to render the scene into the command list.
-	PopulateCommandList();
+	// Pace the frame; if it is not yet time, return and let the message loop run.
+	if (!WaitForNextFrame()) return;
+	m_framePacer.BeginFrame(GetTime(), m_fence->GetCompletedValue());
+
+	// The transient resources and views of this frame slot are no longer referenced
+	// by the GPU, neither are the descriptor slots freed by completed frames.
+	m_frameRing.GetCurrent().TransientResources.clear();
+	m_frameRing.GetCurrent().SourceRead = {};
+	m_bindlessHeap->Recycle(m_fence->GetCompletedValue());
+
+	// Hot-swap the source once it has been loaded.
+	if (m_bindlessFilters[0]->IsSourceReady()) UpdateSource();
+	if (m_repaintSource) RepaintSource();
+
+	// Compact the bindless heap at this frame boundary once it is fragmented.
+	if (m_bindlessHeap->GetFragmentation(CBV_SRV_UAV_HEAP) > g_maxFragmentation ||
+		m_bindlessHeap->GetFragmentation(SAMPLER_HEAP) > g_maxFragmentation)
+		CompactHeap();
+
+	// Publish the changed resource indices, and make the rendering queues wait for all uploads.
+	XUSG_N_RETURN(m_recordTable->Update(m_uploadManager.get(), m_fence.get(), m_fenceValue), ThrowIfFailed(E_FAIL));
+	if (m_uploadManager->HasPendingUploads())
+	{
+		const auto uploadFenceValue = m_uploadManager->Submit();
+		XUSG_N_RETURN(m_uploadManager->Wait(m_commandQueue.get(), uploadFenceValue), ThrowIfFailed(E_FAIL));
+		if (m_computeQueue) XUSG_N_RETURN(m_uploadManager->Wait(m_computeQueue.get(), uploadFenceValue), ThrowIfFailed(E_FAIL));
+	}
 
-	// Execute the command list.
-	m_commandQueue->ExecuteCommandList(m_commandList.get());
+	// Record the filters once more into a recording command list, which is analyzed
+	// instead of submitted.
+	if (m_analyzeCommands)
+	{
+		AnalyzeCommandList(0);
+		m_analyzeCommands = false;
+	}
+
+	if (m_numCaptureFrames > 0) CaptureCommandList(0);
+
+	if (m_asyncCompute)
+	{
+		// Filter on the compute queue once the copy that last read its result is done;
+		// it overlaps the copy and present of the previous frame on the direct queue.
+		CrossQueueSchedule::Submission production, consumption;
+		XUSG_N_RETURN(m_crossQueueSchedule.Produce(production), ThrowIfFailed(E_FAIL));
+		PopulateComputeCommandList(production.BufferIndex);
+
+		m_presentSemaphore.Value = production.WaitValue;
+		m_filterSemaphore.Value = production.SignalValue;
+		XUSG_N_RETURN(m_computeQueue->SubmitCommandList(m_computeCommandList.get(), &m_presentSemaphore,
+			production.WaitValue ? 1 : 0, &m_filterSemaphore, 1), ThrowIfFailed(E_FAIL));
+
+		// Copy the result once the filter is done.
+		XUSG_N_RETURN(m_crossQueueSchedule.Consume(consumption), ThrowIfFailed(E_FAIL));
+		PopulateCommandList(consumption.BufferIndex);
+
+		m_filterSemaphore.Value = consumption.WaitValue;
+		m_presentSemaphore.Value = consumption.SignalValue;
+		XUSG_N_RETURN(m_commandQueue->SubmitCommandList(m_commandList.get(), &m_filterSemaphore, 1,
+			&m_presentSemaphore, 1), ThrowIfFailed(E_FAIL));
+	}
+	else
+	{
+		// Record all the commands we need to render the scene into the command list.
+		PopulateCommandList(0);
+
+		// Execute the command list.
+		m_commandQueue->ExecuteCommandList(m_commandList.get());
+	}
+
+	// While this frame is in flight, repaints of the source texels its filters read wait for it.
+	auto& sourceRead = m_frameRing.GetCurrent().SourceRead;
+	for (const auto pFilter : m_filterBatch) sourceRead = DirtyRegion::Union(sourceRead, pFilter->GetSourceRead());
 
 	// Present the frame.
 	XUSG_N_RETURN(m_swapChain->Present(0, PresentFlag::ALLOW_TEARING), ThrowIfFailed(E_FAIL));
@@ -232,11 +510,15 @@ void DynamicResources::OnRender()
 
 void DynamicResources::OnDestroy()
 {
+	// Nothing was created when OnInit() only ran the host benchmark.
+	if (!m_commandQueue) return;
+
 	// Ensure that the GPU is no longer referencing resources that are about to be
 	// cleaned up by the destructor.
 	WaitForGpu();
 
 	CloseHandle(m_fenceEvent);
+	CloseHandle(m_frameTimer);
 }
 
 // User hot-key interactions.
@@ -250,6 +532,9 @@ void DynamicResources::OnKeyUp(uint8_t key)
 	case VK_F1:
 		m_showFPS = !m_showFPS;
 		break;
+	case VK_F5:
+		m_bindlessFilters[0]->SetSource(m_fileName.c_str());
+		break;
 	case VK_F11:
 		m_screenShot = 1;
 		break;
@@ -299,15 +584,186 @@ void DynamicResources::ParseCommandLineArgs(wchar_t* argv[], int argc)
 					m_fileName[j] = static_cast<char>(argv[i][j]);
 			}
 		}
+		else if (isArgMatched(i, L"fps"))
+		{
+			if (hasNextArgValue(i))
+			{
+				const auto fps = stof(argv[++i]);
+				m_framePacer.SetTargetFrameTime(fps > 0.0f ? 1.0 / fps : 0.0);
+			}
+		}
+		else if (isArgMatched(i, L"frames"))
+		{
+			if (hasNextArgValue(i))
+			{
+				const auto numFrames = stoi(argv[++i]);
+				m_numFrames = static_cast<uint8_t>((min)((max)(numFrames, 1), static_cast<int>(MaxFramesInFlight)));
+			}
+		}
+		else if (isArgMatched(i, L"instances"))
+		{
+			if (hasNextArgValue(i))
+			{
+				const auto numInstances = stoi(argv[++i]);
+				m_numFilterInstances = static_cast<uint8_t>((min)((max)(numInstances, 1), static_cast<int>(g_maxFilterInstances)));
+			}
+		}
+		else if (isArgMatched(i, L"passes"))
+		{
+			if (hasNextArgValue(i))
+			{
+				const auto numPasses = stoi(argv[++i]);
+				m_numFilterPasses = static_cast<uint8_t>((min)((max)(numPasses, 1), static_cast<int>(g_maxFilterPasses)));
+			}
+		}
+		else if (isArgMatched(i, L"async") || isArgMatched(i, L"asynccompute"))
+			m_asyncCompute = true;
+		else if (isArgMatched(i, L"analyze")) m_analyzeCommands = true;
+		else if (isArgMatched(i, L"nobundles")) m_useBundles = false;
+		else if (isArgMatched(i, L"indirect")) m_indirectDispatch = true;
+		else if (isArgMatched(i, L"dirtyrects")) m_repaintSource = true;
+		else if (isArgMatched(i, L"arraybatch"))
+		{
+			m_numArrayImages = 16;
+			if (hasNextArgValue(i)) m_numArrayImages = static_cast<uint32_t>((min)((max)(stoi(argv[++i]), 1), 2048));
+		}
+		else if (isArgMatched(i, L"atlas"))
+		{
+			m_numAtlasImages = 256;
+			if (hasNextArgValue(i)) m_numAtlasImages = static_cast<uint32_t>((min)((max)(stoi(argv[++i]), 1), 1024));
+		}
+		else if (isArgMatched(i, L"roi"))
+		{
+			uint32_t roi[] = { 0, 0, 256, 256 };	// Left, top, width, height
+			for (auto& value : roi) if (hasNextArgValue(i)) value = static_cast<uint32_t>((max)(stoi(argv[++i]), 0));
+			roi[2] = (min)(roi[2], 16384u);
+			roi[3] = (min)(roi[3], 16384u);
+			m_regionOfInterest = { roi[0], roi[1], roi[0] + roi[2], roi[1] + roi[3] };
+		}
+		else if (isArgMatched(i, L"capture"))
+		{
+			m_captureFileName = "DynamicResources.capture";
+			m_numCaptureFrames = 1;
+			if (hasNextArgValue(i))
+			{
+				m_captureFileName.resize(wcslen(argv[++i]));
+				for (size_t j = 0; j < m_captureFileName.size(); ++j)
+					m_captureFileName[j] = static_cast<char>(argv[i][j]);
+			}
+			if (hasNextArgValue(i)) m_numCaptureFrames = static_cast<uint32_t>((max)(stoi(argv[++i]), 1));
+		}
+		else if (isArgMatched(i, L"replay"))
+		{
+			m_replayFileName = L"DynamicResources.capture";
+			m_numReplayIterations = 1;
+			if (hasNextArgValue(i)) m_replayFileName = argv[++i];
+			if (hasNextArgValue(i)) m_numReplayIterations = static_cast<uint32_t>((max)(stoi(argv[++i]), 1));
+		}
+		else if (isArgMatched(i, L"validate"))
+		{
+			m_goldenDir = "Assets/Goldens";
+			if (hasNextArgValue(i))
+			{
+				m_goldenDir.resize(wcslen(argv[++i]));
+				for (size_t j = 0; j < m_goldenDir.size(); ++j)
+					m_goldenDir[j] = static_cast<char>(argv[i][j]);
+			}
+		}
+		else if (isArgMatched(i, L"record")) m_recordGoldens = true;
+		else if (isArgMatched(i, L"benchmark"))
+		{
+			m_benchmarkFileName = "DynamicResources_benchmark.json";
+			if (hasNextArgValue(i))
+			{
+				m_benchmarkFileName.resize(wcslen(argv[++i]));
+				for (size_t j = 0; j < m_benchmarkFileName.size(); ++j)
+					m_benchmarkFileName[j] = static_cast<char>(argv[i][j]);
+			}
+		}
 	}
 }
 
-void DynamicResources::PopulateCommandList()
+void DynamicResources::UpdateSource()
+{
+	// The copy queue must not overwrite the source before the frames
+	// in flight, which still read it, are done.
+	XUSG_N_RETURN(m_uploadManager->WaitForQueue(m_fence.get(), m_fenceValue - 1), ThrowIfFailed(E_FAIL));
+
+	// Replaced resources are released once this frame slot comes around again.
+	auto& retiredResources = m_frameRing.GetCurrent().TransientResources;
+	// A source that is still ready could not be staged, and is retried on the next frame.
+	if (!m_bindlessFilters[0]->UpdateSource(m_uploadManager.get(), retiredResources, m_fenceValue - 1)
+		&& !m_bindlessFilters[0]->IsSourceReady())
+		cerr << "Failed to update the source image" << endl;
+}
+
+void DynamicResources::RepaintSource()
+{
+	// A hot-swapped source of another size is left alone.
+	uint32_t width, height;
+	m_bindlessFilters[0]->GetImageSize(width, height);
+	if (width != m_sourceCopyWidth || height != m_sourceCopyHeight) return;
+
+	// The square moves every frame; the texels it leaves are restored from the copy.
+	const auto size = (min)(64u, (min)(width, height));
+	const DirtyRegion::Rect rect =
+	{
+		(4 * m_numRepaints) % (width - size + 1),
+		(3 * m_numRepaints) % (height - size + 1)
+	};
+	const DirtyRegion::Rect square = { rect.Left, rect.Top, rect.Left + size, rect.Top + size };
+	const auto region = DirtyRegion::Union(m_repaintRect, square);
+	m_repaintRect = square;
+	++m_numRepaints;
+
+	const auto comp = m_sourceCopyChannels;
+	const auto regionWidth = region.Right - region.Left;
+	vector<uint8_t> texels(static_cast<size_t>(comp) * regionWidth * (region.Bottom - region.Top));
+	for (auto y = region.Top; y < region.Bottom; ++y)
+	{
+		for (auto x = region.Left; x < region.Right; ++x)
+		{
+			const auto pSrc = &m_sourceCopy[comp * (static_cast<size_t>(width) * y + x)];
+			const auto pDst = &texels[comp * (static_cast<size_t>(regionWidth) * (y - region.Top) + x - region.Left)];
+			const auto isInSquare = x >= square.Left && x < square.Right && y >= square.Top && y < square.Bottom;
+			for (uint8_t c = 0; c < comp; ++c)
+				pDst[c] = isInSquare && (c < 3 || comp < 4) ? 255 - pSrc[c] : pSrc[c];
+		}
+	}
+
+	// The copy queue must not overwrite texels that the frames in flight still read. It waits
+	// for the last of those frames that read the repainted region only; the others keep
+	// overlapping with the upload, and only the tiles reached by the region are re-filtered.
+	uint64_t readFenceValue = 0;
+	for (uint8_t i = 0; i < m_frameRing.GetDepth(); ++i)
+		if (DirtyRegion::IsOverlapped(m_frameRing[i].SourceRead, region))
+			readFenceValue = (max)(readFenceValue, m_frameRing.GetFenceValue(i));
+	if (readFenceValue > 0)
+		XUSG_N_RETURN(m_uploadManager->WaitForQueue(m_fence.get(), readFenceValue), ThrowIfFailed(E_FAIL));
+	for (const auto& bindlessFilter : m_bindlessFilters)
+		XUSG_N_RETURN(bindlessFilter->UpdateSourceRegion(m_uploadManager.get(), texels.data(),
+			comp * regionWidth, region), ThrowIfFailed(E_FAIL));
+}
+
+void DynamicResources::CompactHeap()
+{
+	// The vacated slots are still read by the frames in flight; the new indices
+	// are published in a new version of the record table.
+	vector<BindlessHeap::Relocation> relocations;
+	for (const auto type : { CBV_SRV_UAV_HEAP, SAMPLER_HEAP })
+	{
+		if (m_bindlessHeap->Compact(type, m_fenceValue - 1, relocations) == 0) continue;
+		for (const auto& bindlessFilter : m_bindlessFilters)
+			XUSG_N_RETURN(bindlessFilter->RelocateSlots(type, relocations), ThrowIfFailed(E_FAIL));
+	}
+}
+
+void DynamicResources::PopulateCommandList(uint8_t resultIndex)
 {
 	// Command list allocators can only be reset when the associated 
 	// command lists have finished execution on the GPU; apps should use 
 	// fences to determine GPU execution progress.
-	const auto pCommandAllocator = m_commandAllocators[m_frameIndex].get();
+	const auto pCommandAllocator = m_frameRing.GetCurrent().CommandAllocator.get();
 	XUSG_N_RETURN(pCommandAllocator->Reset(), ThrowIfFailed(E_FAIL));
 
 	// However, when ExecuteCommandList() is called on a particular command 
@@ -317,88 +773,446 @@ void DynamicResources::PopulateCommandList()
 	XUSG_N_RETURN(pCommandList->Reset(pCommandAllocator, nullptr), ThrowIfFailed(E_FAIL));
 
 	// Record commands.
-	// Set the descriptor heaps.
+	const auto pResult = m_bindlessFilters[0]->GetResult(resultIndex);
+	const auto pRenderTarget = m_renderTargets[m_backBufferIndex].get();
+	m_stateTracker.Reset();
+
+	// The filter is recorded on the compute list in the async-compute path. Otherwise, the
+	// render target begins its transition for the copy before the filter dispatches; the
+	// result is written up to the last of them, so it has nothing to split around.
+	if (!m_asyncCompute)
+	{
+		// The bundles of a frame context are not in flight anymore.
+		const auto bundleSlot = BundleCache::GetFirstSlot(m_frameRing.GetIndex(), resultIndex,
+			BindlessFilter::ResultCount, m_numFilterPasses);
+		const auto startTime = chrono::steady_clock::now();
+		m_stateTracker.BeginTransition(pRenderTarget, ResourceState::COPY_DEST);
+		SetDescriptorHeaps(pCommandList);
+		BindlessFilter::ProcessBatch(pCommandList, m_stateTracker, m_filterBatch.data(),
+			static_cast<uint32_t>(m_filterBatch.size()), resultIndex,
+			m_useBundles ? &m_bundleCache : nullptr, bundleSlot, m_indirectDispatch ? &m_indirectBatch : nullptr);
+		m_filterRecordTime += chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+	}
+
+	m_stateTracker.Transition(pRenderTarget, ResourceState::COPY_DEST);
+	m_stateTracker.Transition(pResult, ResourceState::COPY_SOURCE);
+	m_stateTracker.Flush(pCommandList);
+
+	// The source may be hot-swapped to another size, so only copy the overlap.
+	uint32_t width, height;
+	m_bindlessFilters[0]->GetImageSize(width, height);
+	const BoxRange box(0, 0, (min)(width, m_width), (min)(height, m_height));
+	pCommandList->CopyTextureRegion(TextureCopyLocation(pRenderTarget, 0), 0, 0, 0, TextureCopyLocation(pResult, 0), &box);
+
+	m_stateTracker.Transition(pRenderTarget, ResourceState::PRESENT);
+	m_stateTracker.Flush(pCommandList);
+
+	// Screen-shot helper
+	if (m_screenShot == 1)
+	{
+		if (!m_readBuffer) m_readBuffer = Buffer::MakeUnique();
+		pRenderTarget->ReadBack(pCommandList, m_readBuffer.get(), &m_rowPitch);
+		m_screenShot = 2;
+	}
+
+
+	XUSG_N_RETURN(pCommandList->Close(), ThrowIfFailed(E_FAIL));
+}
+
+void DynamicResources::PopulateComputeCommandList(uint8_t resultIndex)
+{
+	const auto pCommandAllocator = m_frameRing.GetCurrent().ComputeCommandAllocator.get();
+	XUSG_N_RETURN(pCommandAllocator->Reset(), ThrowIfFailed(E_FAIL));
+
+	const auto pCommandList = m_computeCommandList.get();
+	XUSG_N_RETURN(pCommandList->Reset(pCommandAllocator, nullptr), ThrowIfFailed(E_FAIL));
+
+	m_stateTracker.Reset();
+	SetDescriptorHeaps(pCommandList);
+	BindlessFilter::ProcessBatch(pCommandList, m_stateTracker, m_filterBatch.data(),
+		static_cast<uint32_t>(m_filterBatch.size()), resultIndex, nullptr, 0,
+		m_indirectDispatch ? &m_indirectBatch : nullptr);
+
+	// Hand the presented result over to the direct queue in the copy-source state.
+	m_stateTracker.Transition(m_bindlessFilters[0]->GetResult(resultIndex), ResourceState::COPY_SOURCE);
+	m_stateTracker.Flush(pCommandList);
+
+	XUSG_N_RETURN(pCommandList->Close(), ThrowIfFailed(E_FAIL));
+}
+
+void DynamicResources::SetDescriptorHeaps(CommandList* pCommandList)
+{
 	const DescriptorHeap descriptorHeaps[] =
 	{
 		m_descriptorTableLib->GetDescriptorHeap(CBV_SRV_UAV_HEAP),
 		m_descriptorTableLib->GetDescriptorHeap(SAMPLER_HEAP)
 	};
 	pCommandList->SetDescriptorHeaps(static_cast<uint32_t>(size(descriptorHeaps)), descriptorHeaps);
+}
 
-	m_bindlessFilter->Process(pCommandList);
+void DynamicResources::ProcessArrayBatch()
+{
+	const auto pCommandAllocator = m_frameRing.GetCurrent().CommandAllocator.get();
+	XUSG_N_RETURN(pCommandAllocator->Reset(), ThrowIfFailed(E_FAIL));
 
-	const auto pResult = m_bindlessFilter->GetResult();
-	const auto pRenderTarget = m_renderTargets[m_frameIndex].get();
+	const auto pCommandList = m_commandList.get();
+	XUSG_N_RETURN(pCommandList->Reset(pCommandAllocator, nullptr), ThrowIfFailed(E_FAIL));
 
-	ResourceBarrier barriers[2];
-	auto numBarriers = pRenderTarget->SetBarrier(barriers, ResourceState::COPY_DEST);
-	numBarriers = pResult->SetBarrier(barriers, ResourceState::COPY_SOURCE, numBarriers);
-	pCommandList->Barrier(numBarriers, barriers);
+	auto readBuffer = Buffer::MakeUnique();
+	XUSG_N_RETURN(readBuffer->Create(m_device.get(), static_cast<size_t>(m_arrayBatchFilter->GetResultSize()),
+		ResourceFlag::NONE, MemoryType::READBACK, 0, nullptr, 0, nullptr, MemoryFlag::NONE, L"ArrayReadBuffer"),
+		ThrowIfFailed(E_FAIL));
+
+	// All slices in one dispatch, and read back in one copy
+	const auto startTime = chrono::steady_clock::now();
+	m_stateTracker.Reset();
+	SetDescriptorHeaps(pCommandList);
+	m_arrayBatchFilter->Process(pCommandList, m_stateTracker);
+	m_arrayBatchFilter->ReadBack(pCommandList, m_stateTracker, readBuffer.get());
+	XUSG_N_RETURN(pCommandList->Close(), ThrowIfFailed(E_FAIL));
 
-	pCommandList->CopyResource(pRenderTarget, pResult);
+	m_commandQueue->ExecuteCommandList(pCommandList);
+	WaitForGpu();
+	const chrono::duration<double, milli> time = chrono::steady_clock::now() - startTime;
+
+	// The slices are stacked vertically in the saved image.
+	uint32_t width, height;
+	const auto numImages = m_arrayBatchFilter->GetNumImages();
+	m_arrayBatchFilter->GetImageSize(width, height);
+	cout << "Filtered " << numImages << " images of " << width << "x" << height << " in one dispatch: "
+		<< time.count() << " ms (" << time.count() / numImages << " ms per image)" << endl;
+	SaveImage("DynamicResources_array.png", readBuffer.get(), width, height * numImages, 4 * width, 4);
+}
 
-	numBarriers = pRenderTarget->SetBarrier(barriers, ResourceState::PRESENT);
-	pCommandList->Barrier(numBarriers, barriers);
+void DynamicResources::ProcessAtlas()
+{
+	const auto pCommandAllocator = m_frameRing.GetCurrent().CommandAllocator.get();
+	XUSG_N_RETURN(pCommandAllocator->Reset(), ThrowIfFailed(E_FAIL));
 
-	// Screen-shot helper
-	if (m_screenShot == 1)
+	const auto pCommandList = m_commandList.get();
+	XUSG_N_RETURN(pCommandList->Reset(pCommandAllocator, nullptr), ThrowIfFailed(E_FAIL));
+
+	// All tiles in one dispatch, and the atlas read back in one copy
+	const auto readBuffer = Buffer::MakeUnique();
+	uint32_t rowPitch;
+	const auto startTime = chrono::steady_clock::now();
+	m_stateTracker.Reset();
+	SetDescriptorHeaps(pCommandList);
+	m_atlasFilter->Process(pCommandList, m_stateTracker);
+	XUSG_N_RETURN(m_atlasFilter->ReadBack(pCommandList, m_stateTracker, readBuffer.get(), rowPitch), ThrowIfFailed(E_FAIL));
+	XUSG_N_RETURN(pCommandList->Close(), ThrowIfFailed(E_FAIL));
+
+	m_commandQueue->ExecuteCommandList(pCommandList);
+	WaitForGpu();
+	const chrono::duration<double, milli> time = chrono::steady_clock::now() - startTime;
+
+	uint32_t width, height;
+	const auto numImages = m_atlasFilter->GetNumImages();
+	m_atlasFilter->GetAtlasSize(width, height);
+	cout << "Filtered " << numImages << " images on a " << width << "x" << height << " atlas ("
+		<< 100.0 * m_atlasFilter->GetOccupancy() << "% occupied) in one dispatch of "
+		<< m_atlasFilter->GetNumGroups() << " groups: " << time.count() << " ms ("
+		<< time.count() / numImages << " ms per image)" << endl;
+
+	// The first image is unpacked, and saved next to the whole atlas.
+	const auto& tile = m_atlasFilter->GetTile(0);
+	vector<uint8_t> imageData(sizeof(uint32_t) * tile.Width * tile.Height);
+	m_atlasFilter->Unpack(imageData.data(), static_cast<const uint8_t*>(readBuffer->Map(nullptr)), rowPitch, 0);
+	readBuffer->Unmap();
+	stbi_write_png("DynamicResources_atlas0.png", tile.Width, tile.Height, 4, imageData.data(), 0);
+	SaveImage("DynamicResources_atlas.png", readBuffer.get(), width, height, rowPitch, 4);
+}
+
+void DynamicResources::ProcessRegion()
+{
+	const auto pCommandAllocator = m_frameRing.GetCurrent().CommandAllocator.get();
+	XUSG_N_RETURN(pCommandAllocator->Reset(), ThrowIfFailed(E_FAIL));
+
+	const auto pCommandList = m_commandList.get();
+	XUSG_N_RETURN(pCommandList->Reset(pCommandAllocator, nullptr), ThrowIfFailed(E_FAIL));
+
+	// Only the groups of the region, and only the region read back
+	const auto pFilter = m_bindlessFilters[0].get();
+	const auto readBuffer = Buffer::MakeUnique();
+	uint32_t rowPitch;
+	const auto startTime = chrono::steady_clock::now();
+	m_stateTracker.Reset();
+	SetDescriptorHeaps(pCommandList);
+	pFilter->Process(pCommandList, m_stateTracker, m_regionOfInterest);
+	XUSG_N_RETURN(pFilter->ReadBackRegion(pCommandList, m_stateTracker, readBuffer.get(), rowPitch), ThrowIfFailed(E_FAIL));
+	XUSG_N_RETURN(pCommandList->Close(), ThrowIfFailed(E_FAIL));
+
+	m_commandQueue->ExecuteCommandList(pCommandList);
+	WaitForGpu();
+	const chrono::duration<double, milli> time = chrono::steady_clock::now() - startTime;
+
+	// The region as clipped to the image by the filter
+	uint32_t imageWidth, imageHeight;
+	pFilter->GetImageSize(imageWidth, imageHeight);
+	const auto& roi = m_regionOfInterest;
+	const auto width = roi.Left < imageWidth ? (min)(roi.Right, imageWidth) - roi.Left : 0;
+	const auto height = roi.Top < imageHeight ? (min)(roi.Bottom, imageHeight) - roi.Top : 0;
+	cout << "Filtered a region of " << width << "x" << height << " at (" << roi.Left << ", " << roi.Top
+		<< ") of " << imageWidth << "x" << imageHeight << ": " << time.count() << " ms" << endl;
+	if (width == 0 || height == 0) return;
+
+	SaveImage("DynamicResources_roi.png", readBuffer.get(), width, height, rowPitch, 4);
+
+	// The CPU path filters the same region, in one pass only.
+	CPUImageProc imageProc;
+	if (m_numFilterPasses == 1 && imageProc.Init(m_fileName.c_str()))
 	{
-		if (!m_readBuffer) m_readBuffer = Buffer::MakeUnique();
-		pRenderTarget->ReadBack(pCommandList, m_readBuffer.get(), &m_rowPitch);
-		m_screenShot = 2;
+		imageProc.Process(roi.Left, roi.Top, width, height);
+
+		vector<uint8_t> imageData(4 * width * height);
+		CPUImageProc::Repack(imageData.data(), static_cast<const uint8_t*>(readBuffer->Map(nullptr)),
+			width, height, rowPitch, 4);
+		readBuffer->Unmap();
+
+		ImageValidator validator;
+		const auto metrics = ImageValidator::Compare(imageData.data(), imageProc.GetResult(), width, height);
+		cout << left << setw(24) << "GPU vs. CPU region" << (validator.Check(metrics) ? "passed" : "FAILED")
+			<< fixed << setprecision(4) << "  max-abs: " << static_cast<uint32_t>(metrics.MaxAbsError)
+			<< "  PSNR: " << metrics.PSNR << "  SSIM: " << metrics.SSIM << endl;
 	}
+}
 
+void DynamicResources::RecordFilters(RecordingCommandList& commandList, uint8_t resultIndex)
+{
+	// The state tracker restores the states tracked by XUSG, since nothing is executed.
+	XUSG_N_RETURN(commandList.Create(m_device.get(), 0, CommandListType::DIRECT, nullptr, nullptr), ThrowIfFailed(E_FAIL));
+
+	// The dirty regions, which the recording consumes, are restored as well.
+	vector<DirtyRegion> dirtyRegions;
+	for (const auto pFilter : m_filterBatch) dirtyRegions.emplace_back(pFilter->GetDirtyRegion(resultIndex));
+
+	ResourceStateTracker stateTracker;
+	SetDescriptorHeaps(&commandList);
+	BindlessFilter::ProcessBatch(&commandList, stateTracker, m_filterBatch.data(),
+		static_cast<uint32_t>(m_filterBatch.size()), resultIndex);
+	stateTracker.Discard();
+	for (size_t i = 0; i < m_filterBatch.size(); ++i) m_filterBatch[i]->SetDirtyRegion(resultIndex, dirtyRegions[i]);
+	XUSG_N_RETURN(commandList.Close(), ThrowIfFailed(E_FAIL));
+}
 
-	XUSG_N_RETURN(pCommandList->Close(), ThrowIfFailed(E_FAIL));
+void DynamicResources::AnalyzeCommandList(uint8_t resultIndex)
+{
+	RecordingCommandList commandList;
+	RecordFilters(commandList, resultIndex);
+
+	CommandStreamAnalyzer::Stats stats;
+	XUSG_N_RETURN(CommandStreamAnalyzer::Analyze(commandList.GetStream(), commandList.GetStreamSize(), stats),
+		ThrowIfFailed(E_FAIL));
+	cout << "Filter command stream of " << m_filterBatch.size() << " instance(s), "
+		<< static_cast<uint32_t>(m_numFilterPasses) << " pass(es):" << endl;
+	CommandStreamAnalyzer::Print(cout, stats);
+}
+
+void DynamicResources::CaptureCommandList(uint8_t resultIndex)
+{
+	RecordingCommandList commandList;
+	RecordFilters(commandList, resultIndex);
+
+	vector<CommandCapture::Object> objects;
+	vector<CommandCapture::Range> ranges;
+	GetCaptureObjects(objects);
+	GetCaptureRanges(ranges);
+	XUSG_N_RETURN(m_commandCapture.AddFrame(m_fenceValue, commandList, objects, ranges), ThrowIfFailed(E_FAIL));
+
+	if (--m_numCaptureFrames == 0)
+	{
+		if (m_commandCapture.Write(m_captureFileName.c_str()))
+			cout << "Captured " << m_commandCapture.GetNumFrames() << " frame(s) to " << m_captureFileName << endl;
+		else cerr << "Failed to write the capture " << m_captureFileName << endl;
+		m_commandCapture.Reset();
+	}
+}
+
+void DynamicResources::ReplayCapture()
+{
+	CommandCaptureFile captureFile;
+	if (!captureFile.Open(m_replayFileName.c_str()) || captureFile.GetNumFrames() == 0)
+	{
+		cerr << "Failed to open the capture" << endl;
+		return;
+	}
+
+	vector<CommandCapture::Object> objects;
+	GetCaptureObjects(objects);
+
+	const auto recordSize = m_recordTable->GetRecordSize();
+	const auto pCommandList = m_commandList.get();
+	vector<const void*> resolvedObjects;
+	vector<CommandCapture::Range> ranges;
+	vector<CommandReplayer::Relocation> relocations;
+	chrono::duration<double, milli> recordTime(0.0), executionTime(0.0);
+	for (auto i = 0u; i < m_numReplayIterations; ++i)
+	{
+		const auto frame = captureFile.GetFrame(i % captureFile.GetNumFrames());
+		if (!CommandReplayer::ResolveObjects(frame, objects, resolvedObjects))
+		{
+			cerr << "The capture does not match the filter setup" << endl;
+			return;
+		}
+
+		// Restore the captured records, then rebase the captured ranges to the live ones.
+		for (auto j = 0u; j < frame.NumRanges; ++j)
+		{
+			const auto& range = frame.pRanges[j];
+			const auto pData = CommandCaptureFile::GetRangeData(frame, j);
+			if (pData && range.DataSize == static_cast<uint64_t>(recordSize) * m_recordTable->GetCapacity())
+				for (auto k = 0u; k < m_recordTable->GetCapacity(); ++k)
+					m_recordTable->Write(k, pData + static_cast<size_t>(recordSize) * k, recordSize);
+		}
+		XUSG_N_RETURN(m_recordTable->Update(m_uploadManager.get(), m_fence.get(), m_fenceValue), ThrowIfFailed(E_FAIL));
+		if (m_uploadManager->HasPendingUploads())
+			XUSG_N_RETURN(m_uploadManager->Wait(m_commandQueue.get(), m_uploadManager->Submit()), ThrowIfFailed(E_FAIL));
+
+		ranges.clear();
+		relocations.clear();
+		GetCaptureRanges(ranges);
+		for (auto j = 0u; j < frame.NumRanges; ++j)
+		{
+			const auto& captured = frame.pRanges[j];
+			for (const auto& range : ranges)
+				if (strncmp(range.Desc.Name, captured.Name, sizeof(captured.Name)) == 0 && range.Desc.Size == captured.Size)
+					relocations.push_back({ captured.Base, captured.Size, range.Desc.Base });
+		}
+
+		const auto startTime = chrono::steady_clock::now();
+		const auto pCommandAllocator = m_frameRing.GetCurrent().CommandAllocator.get();
+		XUSG_N_RETURN(pCommandAllocator->Reset(), ThrowIfFailed(E_FAIL));
+		XUSG_N_RETURN(pCommandList->Reset(pCommandAllocator, nullptr), ThrowIfFailed(E_FAIL));
+
+		m_stateTracker.Reset();
+		CommandReplayer::RequestInitialStates(frame, resolvedObjects, m_stateTracker);
+		m_stateTracker.Flush(pCommandList);
+		if (!CommandReplayer::Replay(pCommandList, frame, resolvedObjects, relocations))
+		{
+			cerr << "Failed to replay frame " << frame.Frame << " of the capture" << endl;
+			XUSG_N_RETURN(pCommandList->Close(), ThrowIfFailed(E_FAIL));
+			return;
+		}
+		XUSG_N_RETURN(pCommandList->Close(), ThrowIfFailed(E_FAIL));
+		const auto recordedTime = chrono::steady_clock::now();
+
+		m_commandQueue->ExecuteCommandList(pCommandList);
+		WaitForGpu();
+		recordTime += recordedTime - startTime;
+		executionTime += chrono::steady_clock::now() - recordedTime;
+	}
+
+	// The CPU reference of the first frame, after one run to allocate its images
+	CommandReplayer replayer;
+	const auto frame = captureFile.GetFrame(0);
+	XUSG_N_RETURN(replayer.ReplayOnCPU(frame), ThrowIfFailed(E_FAIL));
+	const auto startTime = chrono::steady_clock::now();
+	replayer.ReplayOnCPU(frame);
+	const chrono::duration<double, milli> cpuTime = chrono::steady_clock::now() - startTime;
+
+	cout << "Replayed " << m_numReplayIterations << " iteration(s) of " << captureFile.GetNumFrames() << " frame(s):" << endl;
+	cout << "    recording: " << recordTime.count() / m_numReplayIterations << " ms" << endl;
+	cout << "    execution: " << executionTime.count() / m_numReplayIterations << " ms" << endl;
+	cout << "    CPU reference of frame " << frame.Frame << ": " << cpuTime.count() << " ms" << endl;
+}
+
+void DynamicResources::GetCaptureObjects(vector<CommandCapture::Object>& objects) const
+{
+	for (size_t i = 0; i < m_bindlessFilters.size(); ++i)
+		m_bindlessFilters[i]->GetCaptureObjects(objects, ("Filter" + to_string(i) + "/").c_str());
+
+	objects.push_back({ m_descriptorTableLib->GetDescriptorHeap(CBV_SRV_UAV_HEAP),
+		CommandCapture::GetObjectDesc("CbvSrvUavHeap", CommandCapture::OBJECT_DESCRIPTOR_HEAP) });
+	objects.push_back({ m_descriptorTableLib->GetDescriptorHeap(SAMPLER_HEAP),
+		CommandCapture::GetObjectDesc("SamplerHeap", CommandCapture::OBJECT_DESCRIPTOR_HEAP) });
+}
+
+void DynamicResources::GetCaptureRanges(vector<CommandCapture::Range>& ranges) const
+{
+	// The records of the published version with their contents, then the address windows
+	// bound to the root; the records come first, as their window addresses are matched first.
+	const auto recordTableSize = static_cast<uint64_t>(m_recordTable->GetRecordSize()) * m_recordTable->GetCapacity();
+	ranges.push_back({ CommandCapture::GetAddressRange("RecordTable", m_recordTable->GetShaderAddress(0),
+		recordTableSize, recordTableSize), m_recordTable->GetRecord(0) });
+
+	for (uint8_t i = 0; i < m_addressWindows->GetNumWindows(); ++i)
+		ranges.push_back({ CommandCapture::GetAddressRange(("Window" + to_string(i)).c_str(),
+			m_addressWindows->GetWindowBase(i), AddressWindows::WindowSize), nullptr });
 }
 
 // Wait for pending GPU work to complete.
 void DynamicResources::WaitForGpu()
 {
 	// Schedule a Signal command in the queue.
-	XUSG_N_RETURN(m_commandQueue->Signal(m_fence.get(), m_fenceValues[m_frameIndex]), ThrowIfFailed(E_FAIL));
+	XUSG_N_RETURN(m_commandQueue->Signal(m_fence.get(), m_fenceValue), ThrowIfFailed(E_FAIL));
 
 	// Wait until the fence has been processed.
-	XUSG_N_RETURN(m_fence->SetEventOnCompletion(m_fenceValues[m_frameIndex], m_fenceEvent), ThrowIfFailed(E_FAIL));
+	XUSG_N_RETURN(m_fence->SetEventOnCompletion(m_fenceValue, m_fenceEvent), ThrowIfFailed(E_FAIL));
 	WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE);
 
-	// Increment the fence value for the current frame.
-	m_fenceValues[m_frameIndex]++;
+	// Increment the fence value.
+	m_fenceValue++;
+}
+
+// Wait until the next frame may be recorded: the frame slot must be free on the GPU,
+// and the paced start time must be reached. Waits are bounded and wake on input;
+// returns false if the frame should be retried on a later pass of the message loop.
+bool DynamicResources::WaitForNextFrame()
+{
+	const auto requiredFenceValue = (max)(m_framePacer.GetRequiredFenceValue(), m_frameRing.GetFenceValue());
+	if (m_fence->GetCompletedValue() < requiredFenceValue)
+	{
+		if (!m_fence->SetEventOnCompletion(requiredFenceValue, m_fenceEvent)) ThrowIfFailed(E_FAIL);
+		MsgWaitForMultipleObjectsEx(1, &m_fenceEvent, g_maxFenceWaitTime, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+		if (m_fence->GetCompletedValue() < requiredFenceValue) return false;
+	}
+
+	// Sleep on the frame timer until the start time; input wakes the loop up early.
+	const auto sleepTime = m_framePacer.GetSleepTime(GetTime());
+	if (sleepTime > 0.0)
+	{
+		LARGE_INTEGER dueTime;
+		dueTime.QuadPart = -static_cast<LONGLONG>(sleepTime * 1e7);	// Relative, in 100 ns
+		if (SetWaitableTimer(m_frameTimer, &dueTime, 0, nullptr, nullptr, FALSE))
+			MsgWaitForMultipleObjectsEx(1, &m_frameTimer, INFINITE, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+	}
+
+	return m_framePacer.GetWaitTime(GetTime()) <= 0.0;
 }
 
 // Prepare to render the next frame.
 void DynamicResources::MoveToNextFrame()
 {
 	// Schedule a Signal command in the queue.
-	const auto currentFenceValue = m_fenceValues[m_frameIndex];
+	const auto currentFenceValue = m_fenceValue++;
 	XUSG_N_RETURN(m_commandQueue->Signal(m_fence.get(), currentFenceValue), ThrowIfFailed(E_FAIL));
+	m_framePacer.EndFrame(GetTime(), currentFenceValue);
 
-	// Update the frame index.
-	m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
+	// Retire the frame context; the next one cannot be recorded before the GPU
+	// is done with it, which WaitForNextFrame() waits on.
+	m_frameRing.Advance(currentFenceValue);
 
-	// If the next frame is not ready to be rendered yet, wait until it is ready.
-	if (m_fence->GetCompletedValue() < m_fenceValues[m_frameIndex])
-	{
-		XUSG_N_RETURN(m_fence->SetEventOnCompletion(m_fenceValues[m_frameIndex], m_fenceEvent), ThrowIfFailed(E_FAIL));
-		WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE);
-	}
-
-	// Set the fence value for the next frame.
-	m_fenceValues[m_frameIndex] = currentFenceValue + 1;
+	// Update the back-buffer index.
+	m_backBufferIndex = m_swapChain->GetCurrentBackBufferIndex();
 
 	// Screen-shot helper
-	if (m_screenShot)
+	if (m_screenShot == 2)
+	{
+		m_screenShotFenceValue = currentFenceValue;
+		m_screenShot = 3;
+	}
+	else if (m_screenShot == 3 && m_fence->GetCompletedValue() >= m_screenShotFenceValue)
 	{
-		if (m_screenShot > FrameCount)
+		if (!m_goldenDir.empty()) ValidateResult(m_readBuffer.get(), m_width, m_height, m_rowPitch);
+		else
 		{
 			char timeStr[15];
 			tm dateTime;
 			const auto now = time(nullptr);
 			if (!localtime_s(&dateTime, &now) && strftime(timeStr, sizeof(timeStr), "%Y%m%d%H%M%S", &dateTime))
 				SaveImage((string("DynamicResources_") + timeStr + ".png").c_str(), m_readBuffer.get(), m_width, m_height, m_rowPitch);
-			m_screenShot = 0;
 		}
-		else ++m_screenShot;
+		m_screenShot = 0;
 	}
 }
 
@@ -409,44 +1223,101 @@ void DynamicResources::SaveImage(char const* fileName, Buffer* pImageBuffer, uin
 
 	//stbi_write_png_compression_level = 1024;
 	vector<uint8_t> imageData(comp * w * h);
-	const auto sw = rowPitch / 4; // Byte to pixel
-	for (auto i = 0u; i < h; ++i)
-		for (auto j = 0u; j < w; ++j)
-		{
-			const auto s = sw * i + j;
-			const auto d = w * i + j;
-			for (uint8_t k = 0; k < comp; ++k)
-				imageData[comp * d + k] = pData[4 * s + k];
-		}
+	CPUImageProc::Repack(imageData.data(), pData, w, h, rowPitch, comp);
 
 	stbi_write_png(fileName, w, h, comp, imageData.data(), 0);
 
 	pImageBuffer->Unmap();
 }
 
+void DynamicResources::ValidateResult(Buffer* pImageBuffer, uint32_t w, uint32_t h, uint32_t rowPitch)
+{
+	const auto pData = static_cast<const uint8_t*>(pImageBuffer->Map(nullptr));
+	vector<uint8_t> imageData(4 * w * h);
+	CPUImageProc::Repack(imageData.data(), pData, w, h, rowPitch, 4);
+	pImageBuffer->Unmap();
+
+	CPUImageProc imageProc;
+	if (imageProc.Init(m_fileName.c_str()))
+	{
+		imageProc.Process();
+
+		ImageValidator validator;
+		const auto metrics = ImageValidator::Compare(imageData.data(), imageProc.GetResult(), w, h);
+		const auto passed = validator.Check(metrics);
+		m_validationPassed = m_validationPassed && passed;
+
+		cout << left << setw(24) << "GPU vs. CPU" << (passed ? "passed" : "FAILED") << fixed << setprecision(4)
+			<< "  max-abs: " << static_cast<uint32_t>(metrics.MaxAbsError)
+			<< "  PSNR: " << metrics.PSNR << "  SSIM: " << metrics.SSIM << endl;
+	}
+	else m_validationPassed = false;
+
+	PostQuitMessage(m_validationPassed ? 0 : 1);
+}
+
 double DynamicResources::CalculateFrameStats(float* pTimeStep)
 {
-	static auto frameCnt = 0u;
 	static auto previousTime = 0.0;
 	const auto totalTime = m_timer.GetTotalSeconds();
-	++frameCnt;
 
 	const auto timeStep = totalTime - previousTime;
 
 	// Compute averages over one second period.
 	if (timeStep >= 1.0)
 	{
-		const auto fps = static_cast<float>(frameCnt / timeStep);	// Normalize to an exact second.
+		// Count rendered frames only, since paced updates may skip rendering.
+		const auto stats = m_framePacer.GetStats();
+		const auto fps = static_cast<float>(stats.NumFrames / timeStep);	// Normalize to an exact second.
 
-		frameCnt = 0;
 		previousTime = totalTime;
 
 		wstringstream windowText;
 		windowText << L"    fps: ";
-		if (m_showFPS) windowText << setprecision(2) << fixed << fps;
+		if (m_showFPS)
+		{
+			windowText << setprecision(2) << fixed << fps;
+			windowText << L"    CPU: " << stats.CpuBusy * 1000.0 << L" ms";
+			windowText << L"    wait: " << stats.CpuWait * 1000.0 << L" ms";
+			windowText << L"    GPU latency: " << stats.GpuLatency * 1000.0 << L" ms";
+			windowText << L"    overlap: " << setprecision(0) << stats.Overlap * 100.0 << L"%";
+			windowText << L"    frames in flight: " << static_cast<uint32_t>(m_frameRing.GetDepth());
+			if (m_numFilterInstances > 1) windowText << L"    instances: " << static_cast<uint32_t>(m_numFilterInstances);
+			if (m_numFilterPasses > 1)
+			{
+				const auto& graphExecutor = m_bindlessFilters[0]->GetGraphExecutor();
+				windowText << L"    passes: " << static_cast<uint32_t>(m_numFilterPasses);
+				windowText << L"    intermediates: " << setprecision(1) << graphExecutor.GetHeapSize() / 1048576.0
+					<< L" / " << graphExecutor.GetUnaliasedHeapSize() / 1048576.0 << L" MB aliased" << setprecision(0);
+			}
+
+			if (m_repaintSource)
+			{
+				uint64_t numDispatched, numFull;
+				m_bindlessFilters[0]->GetDispatchedGroups(numDispatched, numFull);
+				if (numFull > 0) windowText << L"    re-filtered: " << 100.0 * numDispatched / numFull << L"% of groups";
+			}
+
+			const auto barrierStats = m_stateTracker.GetStats();
+			if (stats.NumFrames > 0)
+				windowText << L"    barriers: " << setprecision(1) << static_cast<double>(barrierStats.NumBarriers) / stats.NumFrames
+					<< L" (" << static_cast<double>(barrierStats.NumRedundant) / stats.NumFrames << L" dropped)" << setprecision(0);
+
+			if (stats.NumFrames > 0 && !m_asyncCompute)
+			{
+				const auto bundleStats = m_bundleCache.GetStats();
+				const auto numBundles = bundleStats.NumReused + bundleStats.NumRecorded;
+				windowText << L"    filter recording: " << setprecision(1) << m_filterRecordTime * 1000000.0 / stats.NumFrames << L" us";
+				if (numBundles > 0) windowText << L" (" << setprecision(0) << 100.0 * bundleStats.NumReused / numBundles
+					<< L"% bundles reused)";
+			}
+			m_filterRecordTime = 0.0;
+
+			windowText << L"    heap fragmentation: " << m_bindlessHeap->GetFragmentation(CBV_SRV_UAV_HEAP) * 100.0f << L"%";
+		}
 		else windowText << L"[F1]";
 
-		windowText << L"    [F11] screen shot";
+		windowText << L"    [F5] reload    [F11] screen shot";
 
 		SetCustomWindowText(windowText.str().c_str());
 	}
@@ -455,3 +1326,8 @@ double DynamicResources::CalculateFrameStats(float* pTimeStep)
 
 	return totalTime;
 }
+
+double DynamicResources::GetTime() const
+{
+	return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -12,7 +12,16 @@
 #pragma once
 
 #include "StepTimer.h"
+#include "FramePacer.h"
+#include "FrameRing.h"
+#include "CrossQueueSchedule.h"
 #include "BindlessFilter.h"
+#include "ArrayBatchFilter.h"
+#include "AtlasFilter.h"
+#include "CommandStreamAnalyzer.h"
+#include "CommandReplayer.h"
+#include "HostBenchmark.h"
+#include "ImageValidator.h"
 
 using namespace DirectX;
 
@@ -45,48 +54,127 @@ private:
 		DEVICE_WARP
 	};
 
-	static const uint8_t FrameCount = 3;
+	// Per-frame resources, reused once the GPU has finished the frame that last used them
+	struct FrameContext
+	{
+		XUSG::CommandAllocator::uptr CommandAllocator;
+		XUSG::CommandAllocator::uptr ComputeCommandAllocator;
+		std::vector<XUSG::Resource::uptr> TransientResources;
+		DirtyRegion::Rect SourceRead;	// Source texels that the filters of the frame read
+	};
+
+	static const uint8_t MaxFramesInFlight = FrameRing<FrameContext>::MaxDepth;
 
 	XUSG::DescriptorTableLib::sptr	m_descriptorTableLib;
 
 	XUSG::SwapChain::uptr			m_swapChain;
-	XUSG::CommandAllocator::uptr	m_commandAllocators[FrameCount];
 	XUSG::CommandQueue::uptr		m_commandQueue;
+	FrameRing<FrameContext>			m_frameRing;
 
 	XUSG::Device::uptr			m_device;
-	XUSG::RenderTarget::uptr	m_renderTargets[FrameCount];
+	XUSG::RenderTarget::uptr	m_renderTargets[MaxFramesInFlight];
 	XUSG::CommandList::uptr		m_commandList;
+	ResourceStateTracker		m_stateTracker;	// Reset per command list
+	BundleCache					m_bundleCache;	// One set of filter bundles per frame context
+
+	// Async-compute objects
+	XUSG::CommandQueue::uptr	m_computeQueue;
+	XUSG::CommandList::uptr		m_computeCommandList;
+	XUSG::Semaphore				m_filterSemaphore;	// Signaled by the compute queue
+	XUSG::Semaphore				m_presentSemaphore;	// Signaled by the direct queue
+	CrossQueueSchedule			m_crossQueueSchedule;
 
 	// App resources.
-	std::unique_ptr<BindlessFilter> m_bindlessFilter;
+	std::vector<std::unique_ptr<BindlessFilter>> m_bindlessFilters;	// The first one is presented
+	std::vector<BindlessFilter*> m_filterBatch;
+	IndirectBatch m_indirectBatch;	// Used with m_indirectDispatch
+	std::unique_ptr<ArrayBatchFilter> m_arrayBatchFilter;
+	std::unique_ptr<AtlasFilter> m_atlasFilter;
+	std::unique_ptr<UploadManager> m_uploadManager;
+	std::shared_ptr<BindlessHeap> m_bindlessHeap;
+	std::shared_ptr<RecordTable> m_recordTable;
+	std::shared_ptr<AddressWindows> m_addressWindows;
 
 	// Synchronization objects.
-	uint32_t	m_frameIndex;
+	uint32_t	m_backBufferIndex;
+	uint8_t		m_numFrames;
+	uint8_t		m_numFilterInstances;
+	uint8_t		m_numFilterPasses;
 	HANDLE		m_fenceEvent;
+	HANDLE		m_frameTimer;	// Wakes the next frame up at its start time
 	XUSG::Fence::uptr m_fence;
-	uint64_t	m_fenceValues[FrameCount];
+	uint64_t	m_fenceValue;
+	FramePacer	m_framePacer;
 
 	// Application state
 	DeviceType	m_deviceType;
 	StepTimer	m_timer;
 	bool		m_showFPS;
 	bool		m_isPaused;
+	bool		m_asyncCompute;
+	bool		m_analyzeCommands;
+	bool		m_useBundles;
+	bool		m_indirectDispatch;
+	bool		m_repaintSource;	// Repaints a moving square of the source, re-filtered incrementally
+	uint32_t	m_numArrayImages;	// Copies of the source filtered as one texture array at startup
+	uint32_t	m_numAtlasImages;	// Crops of the source of different sizes filtered as one atlas at startup
+	DirtyRegion::Rect m_regionOfInterest;	// Filtered alone at startup into a result of its size, unless empty
+	double		m_filterRecordTime;	// CPU time spent on recording the filters since the last stats
+	uint32_t	m_numCaptureFrames;
+	uint32_t	m_numReplayIterations;
 
 	// User external settings
 	std::string m_fileName;
+	std::string m_benchmarkFileName;
+	std::string m_goldenDir;
+	std::string m_captureFileName;
+	std::wstring m_replayFileName;
+
+	// Source repainting state: a copy of the source, and the last square repainted
+	std::vector<uint8_t> m_sourceCopy;
+	DirtyRegion::Rect	m_repaintRect;
+	uint32_t			m_sourceCopyWidth;
+	uint32_t			m_sourceCopyHeight;
+	uint32_t			m_numRepaints;
+	uint8_t				m_sourceCopyChannels;
+
+	// Command-stream capture state
+	CommandCapture		m_commandCapture;
 
 	// Screen-shot helpers and state
 	XUSG::Buffer::uptr	m_readBuffer;
 	uint32_t			m_rowPitch;
+	uint64_t			m_screenShotFenceValue;
 	uint8_t				m_screenShot;
 
-	void LoadPipeline(std::vector<XUSG::Resource::uptr>& uploaders);
+	// Golden-image validation state
+	bool				m_validationPassed;
+	bool				m_recordGoldens;	// Writes missing goldens in place of failing
+
+	void LoadPipeline();
 	void LoadAssets();
 
-	void PopulateCommandList();
+	void UpdateSource();
+	void RepaintSource();
+	void CompactHeap();
+	void PopulateCommandList(uint8_t resultIndex);
+	void PopulateComputeCommandList(uint8_t resultIndex);
+	void SetDescriptorHeaps(XUSG::CommandList* pCommandList);
+	void ProcessArrayBatch();
+	void ProcessAtlas();
+	void ProcessRegion();
+	void RecordFilters(RecordingCommandList& commandList, uint8_t resultIndex);
+	void AnalyzeCommandList(uint8_t resultIndex);
+	void CaptureCommandList(uint8_t resultIndex);
+	void ReplayCapture();
+	void GetCaptureObjects(std::vector<CommandCapture::Object>& objects) const;
+	void GetCaptureRanges(std::vector<CommandCapture::Range>& ranges) const;
 	void WaitForGpu();
+	bool WaitForNextFrame();
 	void MoveToNextFrame();
 	void SaveImage(char const* fileName, XUSG::Buffer* pImageBuffer,
 		uint32_t w, uint32_t h, uint32_t rowPitch, uint8_t comp = 3);
+	void ValidateResult(XUSG::Buffer* pImageBuffer, uint32_t w, uint32_t h, uint32_t rowPitch);
 	double CalculateFrameStats(float* fTimeStep = nullptr);
+	double GetTime() const;
 };
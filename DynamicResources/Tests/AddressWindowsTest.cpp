@@ -0,0 +1,99 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include "AddressWindows.h"
+#include "TestHarness.h"
+
+namespace
+{
+	const uint64_t GB = 1ull << 30;
+
+	// Window addresses carry the window index in the high 32 bits and the offset in the low ones.
+	void testTranslate()
+	{
+		AddressWindows windows;
+		const auto base0 = 0x7ull * AddressWindows::WindowSize;
+		const auto base1 = 0x123ull * AddressWindows::WindowSize;
+
+		CHECK(windows.Translate(base0) == UINT64_MAX);
+		CHECK(windows.Register(base0 + 0x1000, 256) == 0);
+		CHECK(windows.Register(base1 + 3 * GB, 256) == 1);
+		CHECK(windows.Register(base0 + 2 * GB, 256) == 0);
+		CHECK(windows.GetNumWindows() == 2);
+		CHECK(windows.GetWindowBase(0) == base0 && windows.GetWindowBase(1) == base1);
+
+		CHECK(windows.Translate(base0 + 0x1234) == 0x1234);
+		CHECK(windows.Translate(base1 + 0xfffffff0) == ((1ull << 32) | 0xfffffff0));
+		CHECK(windows.Translate(base1 + AddressWindows::WindowSize) == UINT64_MAX);
+		CHECK(windows.FindWindow(base1 + 5) == 1);
+		CHECK(windows.FindWindow(base1 - 5) == AddressWindows::InvalidWindow);
+
+		windows.Reset();
+		CHECK(windows.GetNumWindows() == 0);
+		CHECK(windows.Translate(base0 + 0x1234) == UINT64_MAX);
+	}
+
+	// All windows taken: a new window is rejected, but the registered ones are still reused.
+	void testMaxWindows()
+	{
+		AddressWindows windows;
+		for (uint8_t i = 0; i < AddressWindows::MaxWindows; ++i)
+			CHECK(windows.Register((i + 1ull) * AddressWindows::WindowSize, 16) == i);
+
+		const auto base = (AddressWindows::MaxWindows + 1ull) * AddressWindows::WindowSize;
+		CHECK(windows.Register(base, 16) == AddressWindows::InvalidWindow);
+		CHECK(windows.Translate(base) == UINT64_MAX);
+		CHECK(windows.GetNumWindows() == AddressWindows::MaxWindows);
+		CHECK(windows.Register(AddressWindows::MaxWindows * AddressWindows::WindowSize + GB, 16) ==
+			AddressWindows::MaxWindows - 1);
+
+		// Every window address stays within the windows the shaders bind.
+		for (uint8_t i = 0; i < AddressWindows::MaxWindows; ++i)
+			CHECK(windows.Translate((i + 1ull) * AddressWindows::WindowSize + 64) >> 32 < AddressWindows::MaxWindows);
+	}
+
+	// Ranges must not straddle a 4 GB boundary.
+	void testBoundary()
+	{
+		const auto boundary = 2 * AddressWindows::WindowSize;
+		CHECK(AddressWindows::IsInOneWindow(boundary - 256, 256));
+		CHECK(!AddressWindows::IsInOneWindow(boundary - 256, 257));
+		CHECK(AddressWindows::IsInOneWindow(boundary, 0));
+		CHECK(AddressWindows::IsInOneWindow(boundary, AddressWindows::WindowSize));
+		CHECK(!AddressWindows::IsInOneWindow(UINT64_MAX - 15, 32));
+
+		AddressWindows windows;
+		CHECK(windows.Register(boundary - 128, 256) == AddressWindows::InvalidWindow);
+		CHECK(windows.GetNumWindows() == 0);
+
+		// Records placed across the boundary skip to the next window, aligned to the address.
+		const auto base = boundary - 1000;
+		uint64_t offset = 0;
+		CHECK(AddressWindows::PlaceRange(base, offset, 512, 256, 8192));
+		CHECK(base + offset == boundary - 768);
+		offset = 512;
+		CHECK(AddressWindows::PlaceRange(base, offset, 512, 256, 8192));
+		CHECK(base + offset == boundary);
+		CHECK(AddressWindows::IsInOneWindow(base + offset, 512));
+
+		// Unaligned base: the address is aligned, not the offset.
+		offset = 0;
+		CHECK(AddressWindows::PlaceRange(boundary - 1000 + 8, offset, 256, 256, 8192));
+		CHECK((boundary - 1000 + 8 + offset) % 256 == 0);
+
+		// The skip must still end by the limit.
+		offset = 512;
+		CHECK(!AddressWindows::PlaceRange(base, offset, 512, 256, 1024));
+		CHECK(!AddressWindows::PlaceRange(base, offset, AddressWindows::WindowSize + 1, 256, UINT64_MAX));
+	}
+}
+
+int main()
+{
+	testTranslate();
+	testMaxWindows();
+	testBoundary();
+
+	return GetTestResult();
+}
@@ -0,0 +1,128 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <random>
+#include "AtlasPacker.h"
+#include "TestHarness.h"
+
+using namespace std;
+
+namespace
+{
+	// The rectangles keep their sizes, and with their aprons they lie within the atlas and do
+	// not overlap, so that neighbors are at least two aprons apart.
+	void checkPacking(const AtlasPacker& packer, const vector<uint32_t>& widths, const vector<uint32_t>& heights,
+		uint32_t apron, uint32_t maxHeight, const vector<AtlasPacker::Rect>& rects)
+	{
+		const auto width = packer.GetWidth();
+		const auto height = packer.GetHeight();
+		CHECK(height <= maxHeight);
+		CHECK(rects.size() == widths.size());
+
+		vector<uint8_t> isUsed(static_cast<size_t>(width) * height);
+		auto numOverlaps = 0u;
+		for (size_t i = 0; i < rects.size(); ++i)
+		{
+			const auto& rect = rects[i];
+			CHECK(rect.Width == widths[i] && rect.Height == heights[i]);
+			CHECK(rect.X >= apron && rect.Y >= apron);
+			CHECK(rect.X + rect.Width + apron <= width && rect.Y + rect.Height + apron <= height);
+			if (rect.X < apron || rect.Y < apron || rect.X + rect.Width + apron > width ||
+				rect.Y + rect.Height + apron > height) continue;
+
+			for (auto y = rect.Y - apron; y < rect.Y + rect.Height + apron; ++y)
+				for (auto x = rect.X - apron; x < rect.X + rect.Width + apron; ++x)
+					if (isUsed[static_cast<size_t>(width) * y + x]++) ++numOverlaps;
+		}
+		CHECK(numOverlaps == 0);
+	}
+
+	void testPlacement()
+	{
+		const vector<uint32_t> widths = { 2, 5, 4 };
+		const vector<uint32_t> heights = { 2, 4, 4 };
+		const uint32_t apron = 1;
+
+		// The tallest go first, the wider one at the left, and the small one on top of them.
+		AtlasPacker packer;
+		vector<AtlasPacker::Rect> rects;
+		CHECK(packer.Pack(widths.data(), heights.data(), 3, 13, apron, 10, rects));
+		checkPacking(packer, widths, heights, apron, 10, rects);
+		CHECK(rects[1].X == 1 && rects[1].Y == 1);
+		CHECK(rects[2].X == 8 && rects[2].Y == 1);
+		CHECK(rects[0].X == 1 && rects[0].Y == 7);
+		CHECK(packer.GetWidth() == 13 && packer.GetHeight() == 10);
+		CHECK(packer.GetOccupancy() == 94.0 / 130.0);
+
+		// No apron
+		CHECK(packer.Pack(widths.data(), heights.data(), 3, 9, 0, 6, rects));
+		checkPacking(packer, widths, heights, 0, 6, rects);
+		CHECK(rects[2].X == 5 && rects[2].Y == 0);
+		CHECK(rects[0].X == 0 && rects[0].Y == 4);
+		CHECK(packer.GetOccupancy() == 40.0 / 54.0);
+	}
+
+	void testFull()
+	{
+		const vector<uint32_t> widths = { 2, 5, 4 };
+		const vector<uint32_t> heights = { 2, 4, 4 };
+		AtlasPacker packer;
+		vector<AtlasPacker::Rect> rects;
+
+		// One row short of the apron of the last rectangle
+		CHECK(!packer.Pack(widths.data(), heights.data(), 3, 13, 1, 9, rects));
+
+		// Narrower than a padded rectangle
+		CHECK(!packer.Pack(widths.data(), heights.data(), 3, 6, 1, 1024, rects));
+		CHECK(packer.Pack(widths.data(), heights.data(), 3, 7, 1, 1024, rects));
+		checkPacking(packer, widths, heights, 1, 1024, rects);
+
+		// Nothing to pack, and nothing fits in no width.
+		CHECK(packer.Pack(nullptr, nullptr, 0, 0, 1, 0, rects));
+		CHECK(packer.GetHeight() == 0 && packer.GetOccupancy() == 0.0);
+		CHECK(!packer.Pack(widths.data(), heights.data(), 3, 0, 0, 1024, rects));
+
+		// Many rectangles in an atlas that can hold a few of them only
+		const vector<uint32_t> sizes(64, 16);
+		CHECK(!packer.Pack(sizes.data(), sizes.data(), 64, 64, 2, 64, rects));
+	}
+
+	void testRandom()
+	{
+		mt19937 random(1);
+		for (auto n = 0; n < 40; ++n)
+		{
+			const auto numRects = 1 + random() % 1000;
+			const auto apron = random() % 8;
+			vector<uint32_t> widths(numRects), heights(numRects);
+			for (auto i = 0u; i < numRects; ++i)
+			{
+				widths[i] = 1 + random() % 128;
+				heights[i] = 1 + random() % 128;
+			}
+
+			const auto width = AtlasPacker::GetSquareWidth(widths.data(), heights.data(), numRects, apron, 16384);
+			AtlasPacker packer;
+			vector<AtlasPacker::Rect> rects;
+			CHECK(packer.Pack(widths.data(), heights.data(), numRects, width, apron, 65536, rects));
+			checkPacking(packer, widths, heights, apron, 65536, rects);
+			CHECK(packer.GetOccupancy() > 0.5);
+
+			// Packing into the height just reached succeeds again, and one row less fails.
+			const auto height = packer.GetHeight();
+			CHECK(packer.Pack(widths.data(), heights.data(), numRects, width, apron, height, rects));
+			checkPacking(packer, widths, heights, apron, height, rects);
+			CHECK(!packer.Pack(widths.data(), heights.data(), numRects, width, apron, height - 1, rects));
+		}
+	}
+}
+
+int main()
+{
+	testPlacement();
+	testFull();
+	testRandom();
+
+	return GetTestResult();
+}
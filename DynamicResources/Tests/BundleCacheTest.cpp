@@ -0,0 +1,290 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include "BundleCache.h"
+#include "RecordingCommandList.h"
+#include "TestHarness.h"
+
+using namespace std;
+using namespace XUSG;
+
+namespace
+{
+	class MockCommandAllocator :
+		public CommandAllocator
+	{
+	public:
+		MockCommandAllocator(const bool& isFailing) : m_isFailing(isFailing) {}
+		virtual ~MockCommandAllocator() {}
+
+		bool Create(const Device*, CommandListType, const wchar_t*) { return true; }
+		bool Reset() { return !m_isFailing; }
+
+		void Create(void*, const wchar_t*) {}
+
+		void* GetHandle() const { return nullptr; }
+		void* GetDeviceHandle() const { return nullptr; }
+		const Device* GetDevice() const { return nullptr; }
+
+	protected:
+		const bool& m_isFailing;
+	};
+
+	// Bundle that fails to close on request, leaving what was recorded so far in the stream
+	class MockBundle :
+		public RecordingCommandList
+	{
+	public:
+		MockBundle(const bool& isFailing) : m_isFailing(isFailing) {}
+		virtual ~MockBundle() {}
+
+		bool Close() const { return !m_isFailing && RecordingCommandList::Close(); }
+
+	protected:
+		const bool& m_isFailing;
+	};
+
+	// Bundles record into streams, so that what they would execute can be checked.
+	class TestBundleCache :
+		public BundleCache
+	{
+	public:
+		const MockBundle* GetBundle(uint32_t slot) const
+		{
+			return slot < m_bundles.size() ? static_cast<const MockBundle*>(m_bundles[slot].CommandList.get()) : nullptr;
+		}
+
+		bool IsResetFailing = false;
+		bool IsCloseFailing = false;
+
+	protected:
+		bool createBundle(Bundle& bundle, uint32_t)
+		{
+			bundle.CommandAllocator = make_unique<MockCommandAllocator>(IsResetFailing);
+			bundle.CommandList = make_unique<MockBundle>(IsCloseFailing);
+			bundle.CommandList->Close();
+			bundle.IsValid = false;
+
+			return true;
+		}
+	};
+
+	struct Command
+	{
+		uint32_t Opcode;
+		vector<uint32_t> Payload;
+	};
+
+	vector<Command> getCommands(const RecordingCommandList& commandList)
+	{
+		vector<Command> commands;
+		const auto pStream = commandList.GetStream();
+		const auto numWords = commandList.GetStreamSize();
+		for (size_t i = 0; i < numWords; i += 1 + (pStream[i] >> 16))
+			commands.push_back({ pStream[i] & 0xffff, vector<uint32_t>(&pStream[i + 1], &pStream[i + 1 + (pStream[i] >> 16)]) });
+
+		return commands;
+	}
+
+	// Whether the command list executes the bundle of the slot as its command-th command
+	bool isExecuted(const RecordingCommandList& commandList, uint32_t command, const TestBundleCache& bundleCache, uint32_t slot)
+	{
+		const auto commands = getCommands(commandList);
+
+		return command < commands.size() && commands[command].Opcode == CommandStream::OP_EXECUTE_BUNDLE &&
+			commandList.GetObject(commands[command].Payload[0]) == bundleCache.GetBundle(slot);
+	}
+
+	// Whether the command-th command dispatches x thread groups
+	bool isDispatch(const RecordingCommandList& commandList, uint32_t command, uint32_t x)
+	{
+		const auto commands = getCommands(commandList);
+
+		return command < commands.size() && commands[command].Opcode == CommandStream::OP_DISPATCH &&
+			commands[command].Payload[0] == x;
+	}
+
+	// Key of a step as ProcessBatch() builds it: layout, pipeline, window base, then the record
+	// address, the image size, the number of tiles and the tiles of each instance
+	BundleCache::Key getKey(uint64_t recordAddress, vector<uint64_t> tiles)
+	{
+		BundleCache::Key key = { 0x10, 0x20, 0x100000, recordAddress, (256ull << 32) | 256, tiles.size() };
+		key.insert(key.end(), tiles.cbegin(), tiles.cend());
+
+		return key;
+	}
+
+	void testReuse()
+	{
+		TestBundleCache bundleCache;
+		bundleCache.Init(nullptr);
+
+		auto numRecorded = 0u;
+		const auto record = [&numRecorded](CommandList* pCommandList)
+		{
+			pCommandList->Dispatch(4, 1, 1);
+			++numRecorded;
+		};
+
+		RecordingCommandList commandList;
+		const auto key = getKey(0x100000, { 0 });
+		CHECK(bundleCache.Execute(&commandList, 0, key, record));
+		CHECK(bundleCache.Execute(&commandList, 0, key, record));
+		CHECK(bundleCache.Execute(&commandList, 0, key, record));
+		CHECK(numRecorded == 1);
+
+		// Only the bundle is executed on the command list, and the bundle is closed.
+		CHECK(commandList.GetNumCommands() == 3);
+		for (auto i = 0u; i < 3; ++i) CHECK(isExecuted(commandList, i, bundleCache, 0));
+		const auto pBundle = bundleCache.GetBundle(0);
+		CHECK(pBundle->IsClosed() && pBundle->GetNumCommands() == 1 && isDispatch(*pBundle, 0, 4));
+
+		const auto stats = bundleCache.GetStats();
+		CHECK(stats.NumRecorded == 1 && stats.NumReused == 2 && stats.NumFailed == 0);
+		CHECK(bundleCache.GetStats().NumReused == 0);
+
+		// Invalidated bundles are re-recorded with the same key.
+		bundleCache.Invalidate();
+		CHECK(bundleCache.Execute(&commandList, 0, key, record));
+		CHECK(numRecorded == 2 && bundleCache.GetBundle(0)->GetNumCommands() == 1);
+	}
+
+	// The record table writes the records of a frame to its other version, so the record
+	// addresses alternate while the records change; the tiles change with the dirty regions.
+	void testRerecord()
+	{
+		TestBundleCache bundleCache;
+		bundleCache.Init(nullptr);
+
+		uint32_t groups = 0;
+		auto numRecorded = 0u;
+		const auto record = [&groups, &numRecorded](CommandList* pCommandList)
+		{
+			pCommandList->Dispatch(groups, 1, 1);
+			++numRecorded;
+		};
+
+		RecordingCommandList commandList;
+		const uint64_t versionSize = 0x10000;
+		const vector<uint64_t> tiles = { 0, 8ull << 32 | 8ull << 48 };
+		const vector<BundleCache::Key> keys =
+		{
+			getKey(0x100000, tiles),
+			getKey(0x100000 + versionSize, tiles),	// Records updated
+			getKey(0x100000 + versionSize, tiles),	// Unchanged
+			getKey(0x100000, tiles),				// Records updated again
+			getKey(0x100000, { tiles[1] }),			// Tiles changed
+			getKey(0x100000, { 8ull << 32 | 16ull << 48 })	// Tile resized
+		};
+		const bool isRecorded[] = { true, true, false, true, true, true };
+
+		for (auto i = 0u; i < keys.size(); ++i)
+		{
+			groups = i + 1;
+			CHECK(bundleCache.Execute(&commandList, 0, keys[i], record));
+			CHECK(isExecuted(commandList, i, bundleCache, 0));
+
+			// A reused bundle still holds the dispatch it was recorded with.
+			const auto pBundle = bundleCache.GetBundle(0);
+			CHECK(pBundle->GetNumCommands() == 1 && isDispatch(*pBundle, 0, isRecorded[i] ? groups : groups - 1));
+		}
+		CHECK(numRecorded == 5);
+
+		const auto stats = bundleCache.GetStats();
+		CHECK(stats.NumRecorded == 5 && stats.NumReused == 1);
+	}
+
+	// Failed bundles are recorded directly into the command list, and are not reused afterwards.
+	void testFallback()
+	{
+		TestBundleCache bundleCache;
+		bundleCache.Init(nullptr);
+
+		uint32_t groups = 0;
+		const auto record = [&groups](CommandList* pCommandList) { pCommandList->Dispatch(groups, 1, 1); };
+
+		RecordingCommandList commandList;
+		const auto key = getKey(0x100000, { 0 });
+		const auto otherKey = getKey(0x110000, { 0 });
+		groups = 1;
+		bundleCache.Replay(&commandList, 0, key, record);
+		CHECK(isExecuted(commandList, 0, bundleCache, 0));
+
+		// The allocator fails before the bundle is recorded.
+		bundleCache.IsResetFailing = true;
+		groups = 2;
+		CHECK(!bundleCache.Execute(&commandList, 0, otherKey, record));
+		CHECK(commandList.GetNumCommands() == 1);
+		bundleCache.Replay(&commandList, 0, otherKey, record);
+		CHECK(commandList.GetNumCommands() == 2 && isDispatch(commandList, 1, 2));
+		bundleCache.IsResetFailing = false;
+
+		// The bundle fails to close after recording otherKey, so it cannot be reused for key anymore.
+		bundleCache.IsCloseFailing = true;
+		bundleCache.Replay(&commandList, 0, otherKey, record);
+		CHECK(commandList.GetNumCommands() == 3 && isDispatch(commandList, 2, 2));
+		bundleCache.IsCloseFailing = false;
+
+		groups = 1;
+		bundleCache.Replay(&commandList, 0, key, record);
+		CHECK(commandList.GetNumCommands() == 4 && isExecuted(commandList, 3, bundleCache, 0));
+		CHECK(isDispatch(*bundleCache.GetBundle(0), 0, 1) && bundleCache.GetBundle(0)->GetNumCommands() == 1);
+
+		const auto stats = bundleCache.GetStats();
+		CHECK(stats.NumFailed == 2 && stats.NumRecorded == 2 && stats.NumReused == 0);
+	}
+
+	// The slots of the steps of each result and frame context, as PopulateCommandList() uses them
+	void testSlots()
+	{
+		const uint8_t numFrames = 3;
+		const uint32_t numResults = 2, numSteps = 3;
+
+		// Every step of every result and frame has its own slot, and the slots are dense.
+		vector<uint32_t> numUses(numFrames * numResults * numSteps);
+		for (uint8_t frame = 0; frame < numFrames; ++frame)
+			for (auto result = 0u; result < numResults; ++result)
+				for (auto step = 0u; step < numSteps; ++step)
+				{
+					const auto slot = BundleCache::GetFirstSlot(frame, result, numResults, numSteps) + step;
+					CHECK(slot == (frame * numResults + result) * numSteps + step);
+					if (slot < numUses.size()) ++numUses[slot];
+				}
+		for (const auto& n : numUses) CHECK(n == 1);
+
+		// Frames in flight keep their bundles, so a repeated sequence is reused in every frame.
+		TestBundleCache bundleCache;
+		bundleCache.Init(nullptr);
+		RecordingCommandList commandList;
+		for (auto i = 0u; i < 4 * numFrames; ++i)
+		{
+			const uint8_t frame = i % numFrames;
+			for (auto result = 0u; result < numResults; ++result)
+			{
+				const auto firstSlot = BundleCache::GetFirstSlot(frame, result, numResults, numSteps);
+				for (auto step = 0u; step < numSteps; ++step)
+				{
+					const auto groups = (frame * numResults + result) * numSteps + step + 1;
+					const auto record = [groups](CommandList* pCommandList) { pCommandList->Dispatch(groups, 1, 1); };
+					bundleCache.Replay(&commandList, firstSlot + step, getKey(0x100000 * (frame + 1), { step }), record);
+					CHECK(isDispatch(*bundleCache.GetBundle(firstSlot + step), 0, groups));
+				}
+			}
+		}
+
+		const auto stats = bundleCache.GetStats();
+		CHECK(stats.NumRecorded == numUses.size());
+		CHECK(stats.NumReused == 3 * numUses.size());
+	}
+}
+
+int main()
+{
+	testReuse();
+	testRerecord();
+	testFallback();
+	testSlots();
+
+	return GetTestResult();
+}
@@ -0,0 +1,280 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include "CommandReplayer.h"
+#include "TestHarness.h"
+
+using namespace std;
+using namespace XUSG;
+
+namespace
+{
+	const char* const g_fileName = "CommandCaptureTest.rdcs";
+	const wchar_t* const g_fileNameW = L"CommandCaptureTest.rdcs";
+
+	const uint64_t g_tableBase = 0x200000000;
+	const uint64_t g_newTableBase = 0x700000000;
+
+	struct Command
+	{
+		uint32_t Opcode;
+		vector<uint32_t> Payload;
+	};
+
+	vector<Command> getCommands(const uint32_t* pStream, size_t numWords)
+	{
+		vector<Command> commands;
+		for (size_t i = 0; i < numWords; i += 1 + (pStream[i] >> 16))
+			commands.push_back({ pStream[i] & 0xffff, vector<uint32_t>(&pStream[i + 1], &pStream[i + 1 + (pStream[i] >> 16)]) });
+
+		return commands;
+	}
+
+	uint64_t getWord64(const vector<uint32_t>& payload, uint32_t i)
+	{
+		return payload[i] | (static_cast<uint64_t>(payload[i + 1]) << 32);
+	}
+
+	// The file, loaded 8-byte aligned as a mapping would be
+	vector<uint64_t> load(uint64_t& size)
+	{
+		ifstream file(g_fileName, ios::in | ios::binary | ios::ate);
+		size = file ? static_cast<uint64_t>(file.tellg()) : 0;
+
+		vector<uint64_t> data((size + 7) / 8);
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(data.data()), size);
+
+		return data;
+	}
+
+	// Two frames of a filter dispatch, the second one from the other version of the table
+	bool writeCapture(int& pipelineLayout, int& pipeline, const uint8_t (&records)[20])
+	{
+		const vector<CommandCapture::Object> objects =
+		{
+			{ &pipelineLayout, CommandCapture::GetObjectDesc("ImageProcLayout", CommandCapture::OBJECT_PIPELINE_LAYOUT) },
+			{ &pipeline, CommandCapture::GetObjectDesc("ImageProc", CommandCapture::OBJECT_PIPELINE) }
+		};
+
+		// The contents are not a multiple of 8 bytes, so that the next array is padded.
+		const vector<CommandCapture::Range> ranges =
+		{
+			{ CommandCapture::GetAddressRange("RecordTable", g_tableBase, 0x10000, sizeof(records)), records },
+			{ CommandCapture::GetAddressRange("Window", g_tableBase, 1ull << 32), nullptr }
+		};
+
+		CommandCapture capture;
+		for (auto frame = 0u; frame < 2; ++frame)
+		{
+			const auto address = g_tableBase + 0x8000 * frame + 0x40;
+			const uint32_t cb[] = { static_cast<uint32_t>(address), static_cast<uint32_t>(address >> 32), 0x00020001 };
+
+			RecordingCommandList commandList;
+			commandList.SetComputePipelineLayout(&pipelineLayout);
+			commandList.SetPipelineState(&pipeline);
+			commandList.SetComputeRootUnorderedAccessView(1, g_tableBase);
+			commandList.SetCompute32BitConstants(0, static_cast<uint32_t>(size(cb)), cb);
+			commandList.Dispatch(4, 2, 1);
+
+			// Only closed command lists are captured.
+			if (capture.AddFrame(frame, commandList, objects, ranges)) return false;
+			if (!commandList.Close() || !capture.AddFrame(10 + frame, commandList, objects, ranges)) return false;
+		}
+
+		return capture.GetNumFrames() == 2 && capture.Write(g_fileName);
+	}
+
+	void checkFrames(const CommandCaptureFile& captureFile, const uint8_t (&records)[20])
+	{
+		CHECK(captureFile.GetNumFrames() == 2);
+		if (captureFile.GetNumFrames() != 2) return;
+
+		for (auto i = 0u; i < 2; ++i)
+		{
+			const auto frame = captureFile.GetFrame(i);
+			CHECK(frame.Frame == 10 + i);
+			CHECK(reinterpret_cast<uintptr_t>(frame.pStream) % 8 == 0);
+
+			const auto commands = getCommands(frame.pStream, frame.NumStreamWords);
+			CHECK(commands.size() == 5);
+			if (commands.size() != 5) continue;
+			CHECK(commands[0].Opcode == CommandStream::OP_SET_COMPUTE_PIPELINE_LAYOUT);
+			CHECK(commands[3].Opcode == CommandStream::OP_SET_COMPUTE_32BIT_CONSTANTS);
+			CHECK(getWord64(commands[3].Payload, 3) == g_tableBase + 0x8000 * i + 0x40);
+			CHECK(commands[4].Payload == vector<uint32_t>({ 4, 2, 1 }));
+
+			CHECK(frame.NumObjects == 2);
+			CHECK(strcmp(frame.pObjects[commands[0].Payload[0]].Name, "ImageProcLayout") == 0);
+			CHECK(frame.pObjects[commands[1].Payload[0]].Type == CommandCapture::OBJECT_PIPELINE);
+
+			CHECK(frame.NumRanges == 2);
+			const auto pData = CommandCaptureFile::GetRangeData(frame, 0);
+			CHECK(pData && frame.pRanges[0].DataSize == sizeof(records) && memcmp(pData, records, sizeof(records)) == 0);
+			CHECK(!CommandCaptureFile::GetRangeData(frame, 1));
+		}
+	}
+
+	// What the writer lays out is what the reader views, from the file and from memory.
+	void testRoundTrip()
+	{
+		int pipelineLayout = 0, pipeline = 0;
+		uint8_t records[20];
+		for (uint8_t i = 0; i < sizeof(records); ++i) records[i] = i + 1;
+		CHECK(writeCapture(pipelineLayout, pipeline, records));
+
+		CommandCaptureFile captureFile;
+		CHECK(captureFile.Open(g_fileNameW));
+		checkFrames(captureFile, records);
+		captureFile.Close();
+		CHECK(captureFile.GetNumFrames() == 0);
+
+		uint64_t size;
+		const auto data = load(size);
+		CHECK(captureFile.Open(data.data(), size));
+		checkFrames(captureFile, records);
+
+		// Replayed against other live objects, and a table at another address
+		int liveLayout = 0, livePipeline = 0;
+		const vector<CommandCapture::Object> liveObjects =
+		{
+			{ &livePipeline, CommandCapture::GetObjectDesc("ImageProc", CommandCapture::OBJECT_PIPELINE) },
+			{ &liveLayout, CommandCapture::GetObjectDesc("ImageProcLayout", CommandCapture::OBJECT_PIPELINE_LAYOUT) }
+		};
+		const vector<CommandReplayer::Relocation> relocations = { { g_tableBase, 0x10000, g_newTableBase } };
+
+		const auto frame = captureFile.GetFrame(1);
+		vector<const void*> resolved;
+		CHECK(CommandReplayer::ResolveObjects(frame, liveObjects, resolved));
+
+		RecordingCommandList commandList;
+		CHECK(CommandReplayer::Replay(&commandList, frame, resolved, relocations));
+		const auto commands = getCommands(commandList.GetStream(), commandList.GetStreamSize());
+		CHECK(commands.size() == 5);
+		if (commands.size() == 5)
+		{
+			CHECK(commandList.GetObject(commands[0].Payload[0]) == &liveLayout);
+			CHECK(commandList.GetObject(commands[1].Payload[0]) == &livePipeline);
+			CHECK(getWord64(commands[2].Payload, 2) == g_newTableBase);
+			CHECK(getWord64(commands[3].Payload, 3) == g_newTableBase + 0x8000 + 0x40);
+			CHECK(commands[3].Payload[5] == 0x00020001);
+			CHECK(commands[4].Payload == vector<uint32_t>({ 4, 2, 1 }));
+		}
+
+		// Objects must match by name and type.
+		CHECK(!CommandReplayer::ResolveObjects(frame, { liveObjects[0] }, resolved));
+	}
+
+	// Corrupted files are rejected, and leave the reader closed.
+	void testRejection()
+	{
+		uint64_t size;
+		const auto data = load(size);
+		CHECK(size > 0 && size % 8 == 0);
+		if (size == 0) return;
+
+		CommandCaptureFile captureFile;
+		const auto isRejected = [&captureFile, &data, size](uint64_t offset, uint64_t value, uint64_t fileSize = 0)
+		{
+			auto corrupted = data;
+			auto pBytes = reinterpret_cast<uint8_t*>(corrupted.data());
+			memcpy(&pBytes[offset], &value, sizeof(value));
+
+			// A valid file first, which a rejected one must close
+			captureFile.Open(data.data(), size);
+			const auto isOpen = captureFile.Open(corrupted.data(), fileSize ? fileSize : size);
+
+			return !isOpen && captureFile.GetNumFrames() == 0;
+		};
+
+		const auto pHeader = reinterpret_cast<const CommandCapture::FileHeader*>(data.data());
+		const auto framesOffset = pHeader->FramesOffset;
+		const auto pFrameHeader = reinterpret_cast<const CommandCapture::FrameHeader*>(
+			reinterpret_cast<const uint8_t*>(data.data()) + framesOffset);
+		const auto rangesOffset = pFrameHeader->RangesOffset;
+		const auto versionMagic = CommandCapture::Magic | (static_cast<uint64_t>(CommandCapture::Version) << 32);
+
+		// Unchanged, the file is accepted.
+		CHECK(!isRejected(offsetof(CommandCapture::FileHeader, Magic), versionMagic));
+
+		// Bad magic and version
+		CHECK(isRejected(offsetof(CommandCapture::FileHeader, Magic), versionMagic ^ 1));
+		CHECK(isRejected(offsetof(CommandCapture::FileHeader, Magic), versionMagic + (1ull << 32)));
+
+		// FileSize mismatches: the size in the header, and a truncated file
+		CHECK(isRejected(offsetof(CommandCapture::FileHeader, FileSize), size + 8));
+		CHECK(isRejected(offsetof(CommandCapture::FileHeader, FileSize), size, size - 8));
+		CHECK(!captureFile.Open(data.data(), sizeof(CommandCapture::FileHeader) - 8));
+
+		// Misaligned offsets, although in the file
+		CHECK(isRejected(offsetof(CommandCapture::FileHeader, FramesOffset), framesOffset + 4));
+		const auto frameOffset = framesOffset + sizeof(CommandCapture::FrameHeader);
+		CHECK(isRejected(frameOffset + offsetof(CommandCapture::FrameHeader, StreamOffset), pFrameHeader[1].StreamOffset + 4));
+		CHECK(isRejected(rangesOffset + offsetof(CommandCapture::AddressRange, DataOffset),
+			reinterpret_cast<const CommandCapture::AddressRange*>(reinterpret_cast<const uint8_t*>(data.data()) + rangesOffset)->DataOffset + 4));
+
+		// Out-of-file ranges, also where the end would wrap around
+		CHECK(isRejected(offsetof(CommandCapture::FileHeader, FramesOffset), size));
+		CHECK(isRejected(offsetof(CommandCapture::FileHeader, NumFrames), 1000));
+		CHECK(isRejected(frameOffset + offsetof(CommandCapture::FrameHeader, ObjectsOffset), size - 8));
+		CHECK(isRejected(frameOffset + offsetof(CommandCapture::FrameHeader, NumStreamWords), UINT32_MAX));
+		CHECK(isRejected(rangesOffset + offsetof(CommandCapture::AddressRange, DataSize), size));
+		CHECK(isRejected(rangesOffset + offsetof(CommandCapture::AddressRange, DataOffset), ~7ull));
+	}
+
+	// Streams that end inside a command are rejected before the command is replayed.
+	void testTruncatedPayload()
+	{
+		RecordingCommandList recorded;
+		recorded.Dispatch(4, 2, 1);
+		recorded.Dispatch(8, 8, 1);
+
+		CommandCaptureFile::Frame frame = {};
+		frame.pStream = recorded.GetStream();
+		const vector<const void*> objects;
+		const vector<CommandReplayer::Relocation> relocations;
+
+		frame.NumStreamWords = recorded.GetStreamSize();
+		RecordingCommandList commandList;
+		CHECK(CommandReplayer::Replay(&commandList, frame, objects, relocations));
+		CHECK(commandList.GetNumCommands() == 2);
+
+		// The last word of the second dispatch is missing.
+		frame.NumStreamWords = recorded.GetStreamSize() - 1;
+		commandList.Reset(nullptr, nullptr);
+		CHECK(!CommandReplayer::Replay(&commandList, frame, objects, relocations));
+		CHECK(commandList.GetNumCommands() == 1);
+		CommandReplayer replayer;
+		CHECK(!replayer.ReplayOnCPU(frame));
+
+		// A payload shorter than its command, and a barrier count beyond the payload
+		const uint32_t shortDispatch[] = { CommandStream::OP_DISPATCH | (2 << 16), 4, 2 };
+		frame.pStream = shortDispatch;
+		frame.NumStreamWords = size(shortDispatch);
+		commandList.Reset(nullptr, nullptr);
+		CHECK(!CommandReplayer::Replay(&commandList, frame, objects, relocations));
+		CHECK(!replayer.ReplayOnCPU(frame));
+		CHECK(commandList.GetNumCommands() == 0);
+
+		const uint32_t barriers[] = { CommandStream::OP_BARRIER | (2 << 16), 1, 0 };
+		frame.pStream = barriers;
+		frame.NumStreamWords = size(barriers);
+		CHECK(!CommandReplayer::Replay(&commandList, frame, objects, relocations));
+		CHECK(commandList.GetNumCommands() == 0);
+	}
+}
+
+int main()
+{
+	testRoundTrip();
+	testRejection();
+	testTruncatedPayload();
+	remove(g_fileName);
+
+	return GetTestResult();
+}
@@ -0,0 +1,200 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <sstream>
+#include "CommandStreamAnalyzer.h"
+#include "TestHarness.h"
+
+using namespace std;
+
+namespace
+{
+	const uint32_t InvalidId = CommandStream::InvalidId;
+
+	// Stream in the format RecordingCommandList records
+	class StreamWriter
+	{
+	public:
+		void Command(CommandStream::Opcode opcode, const vector<uint32_t>& payload)
+		{
+			m_stream.push_back(static_cast<uint32_t>(opcode) | (static_cast<uint32_t>(payload.size()) << 16));
+			m_stream.insert(m_stream.end(), payload.begin(), payload.end());
+		}
+
+		// Resource, before, after, flags, resource after
+		void Barriers(const vector<vector<uint32_t>>& barriers)
+		{
+			vector<uint32_t> payload = { static_cast<uint32_t>(barriers.size()) };
+			for (const auto& barrier : barriers)
+				payload.insert(payload.end(), { barrier[0], barrier[1], barrier[2], UINT32_MAX, barrier[3], barrier[4] });
+			Command(CommandStream::OP_BARRIER, payload);
+		}
+
+		bool Analyze(CommandStreamAnalyzer::Stats& stats) const
+		{
+			return CommandStreamAnalyzer::Analyze(m_stream.data(), m_stream.size(), stats);
+		}
+
+		vector<uint32_t>& GetStream() { return m_stream; }
+
+	protected:
+		vector<uint32_t> m_stream;
+	};
+
+	void testWorkAndBarriers()
+	{
+		StreamWriter writer;
+		writer.Barriers({ { 0, 1, 8, 0, InvalidId }, { 1, 8, 8, 0, InvalidId }, { 2, 0, 1, 1, InvalidId } });
+		writer.Barriers({ { 2, 0, 1, 2, InvalidId } });
+		writer.Command(CommandStream::OP_DISPATCH, { 4, 2, 3 });
+		writer.Command(CommandStream::OP_DISPATCH, { 1, 1, 1 });
+		writer.Barriers({ { InvalidId, 0, 0, 0, 3 } });
+		writer.Command(CommandStream::OP_COPY_RESOURCE, { 0, 1 });
+		writer.Command(CommandStream::OP_DRAW, { 3, 1, 0, 0 });
+		writer.Command(CommandStream::OP_EXECUTE_INDIRECT, { 0, 1, 1, 0, 0, InvalidId, 0, 0 });
+		writer.Command(CommandStream::OP_END_EVENT, {});
+
+		CommandStreamAnalyzer::Stats stats;
+		CHECK(writer.Analyze(stats));
+		CHECK(stats.NumCommands == 9);
+		CHECK(stats.NumWords == writer.GetStream().size());
+		CHECK(stats.NumOpcodes[CommandStream::OP_BARRIER] == 3);
+		CHECK(stats.NumOpcodes[CommandStream::OP_DISPATCH] == 2);
+		CHECK(stats.NumOpcodes[CommandStream::OP_END_EVENT] == 1);
+
+		CHECK(stats.NumDispatches == 2);
+		CHECK(stats.NumThreadGroups == 25);
+		CHECK(stats.NumDraws == 1);
+		CHECK(stats.NumIndirectExecutions == 1);
+		CHECK(stats.NumCopies == 1);
+
+		// The second batch follows the first one without work in between.
+		CHECK(stats.NumBarrierBatches == 3);
+		CHECK(stats.NumBarriers == 5);
+		CHECK(stats.NumTransitions == 1);
+		CHECK(stats.NumUAVBarriers == 1);
+		CHECK(stats.NumSplitBarriers == 2);
+		CHECK(stats.NumAliasingBarriers == 1);
+		CHECK(stats.NumUnbatchedBarriers == 1);
+	}
+
+	void testStateChanges()
+	{
+		StreamWriter writer;
+		writer.Command(CommandStream::OP_SET_DESCRIPTOR_HEAPS, { 2, 5, 6 });
+		writer.Command(CommandStream::OP_SET_DESCRIPTOR_HEAPS, { 2, 5, 6 });
+		writer.Command(CommandStream::OP_SET_DESCRIPTOR_HEAPS, { 1, 5 });
+		writer.Command(CommandStream::OP_SET_PIPELINE_STATE, { 7 });
+		writer.Command(CommandStream::OP_SET_PIPELINE_STATE, { 7 });
+		writer.Command(CommandStream::OP_SET_COMPUTE_PIPELINE_LAYOUT, { 8 });
+		writer.Command(CommandStream::OP_SET_COMPUTE_PIPELINE_LAYOUT, { 8 });
+		writer.Command(CommandStream::OP_SET_GRAPHICS_PIPELINE_LAYOUT, { 8 });
+
+		// Root parameters: a constant set again in part, and a table set again after a dispatch
+		writer.Command(CommandStream::OP_SET_COMPUTE_32BIT_CONSTANTS, { 0, 0, 3, 10, 11, 12 });
+		writer.Command(CommandStream::OP_SET_COMPUTE_32BIT_CONSTANTS, { 0, 1, 2, 11, 12 });
+		writer.Command(CommandStream::OP_SET_COMPUTE_DESCRIPTOR_TABLE, { 1, 5, 64, 0 });
+		writer.Command(CommandStream::OP_DISPATCH, { 1, 1, 1 });
+		writer.Command(CommandStream::OP_SET_COMPUTE_DESCRIPTOR_TABLE, { 1, 5, 64, 0 });
+		writer.Command(CommandStream::OP_SET_COMPUTE_32BIT_CONSTANTS, { 0, 2, 1, 13 });
+
+		// A new layout unbinds the root parameters of its kind only.
+		writer.Command(CommandStream::OP_SET_GRAPHICS_ROOT_CBV, { 0, 1, 0, 0 });
+		writer.Command(CommandStream::OP_SET_COMPUTE_PIPELINE_LAYOUT, { 9 });
+		writer.Command(CommandStream::OP_SET_COMPUTE_DESCRIPTOR_TABLE, { 1, 5, 64, 0 });
+		writer.Command(CommandStream::OP_SET_GRAPHICS_ROOT_CBV, { 0, 1, 0, 0 });
+
+		// Clearing the state unbinds everything but the descriptor heaps.
+		writer.Command(CommandStream::OP_CLEAR_STATE, {});
+		writer.Command(CommandStream::OP_SET_PIPELINE_STATE, { 7 });
+		writer.Command(CommandStream::OP_SET_DESCRIPTOR_HEAPS, { 1, 5 });
+
+		CommandStreamAnalyzer::Stats stats;
+		CHECK(writer.Analyze(stats));
+		CHECK(stats.NumDescriptorHeapChanges == 2);
+		CHECK(stats.NumRedundantDescriptorHeaps == 2);
+		CHECK(stats.NumPipelineChanges == 2);
+		CHECK(stats.NumRedundantPipelines == 1);
+		CHECK(stats.NumLayoutChanges == 3);
+		CHECK(stats.NumRedundantLayouts == 1);
+
+		CHECK(stats.NumRootParameterSets == 8);
+		CHECK(stats.NumRedundantRootParameters == 3);
+		CHECK(stats.NumRootConstantWords == 6);
+		CHECK(stats.MaxRootParameterSetsPerWork == 5);
+	}
+
+	void testMalformed()
+	{
+		CommandStreamAnalyzer::Stats stats;
+		{
+			// Truncated payload
+			StreamWriter writer;
+			writer.Command(CommandStream::OP_DISPATCH, { 1, 1, 1 });
+			writer.GetStream().pop_back();
+			CHECK(!writer.Analyze(stats));
+		}
+
+		{
+			StreamWriter writer;
+			writer.Command(static_cast<CommandStream::Opcode>(CommandStream::NUM_OPCODE), {});
+			CHECK(!writer.Analyze(stats));
+		}
+
+		{
+			// Barrier count against the payload size
+			StreamWriter writer;
+			writer.Command(CommandStream::OP_BARRIER, { 2, 0, 1, 8, UINT32_MAX, 0, InvalidId });
+			CHECK(!writer.Analyze(stats));
+		}
+
+		{
+			// Beyond the 64 words of a root signature
+			StreamWriter writer;
+			writer.Command(CommandStream::OP_SET_COMPUTE_32BIT_CONSTANTS, { 0, 63, 2, 1, 2 });
+			CHECK(!writer.Analyze(stats));
+		}
+
+		{
+			StreamWriter writer;
+			CHECK(writer.Analyze(stats));
+			CHECK(stats.NumCommands == 0 && stats.MaxRootParameterSetsPerWork == 0);
+		}
+	}
+
+	void testCompare()
+	{
+		StreamWriter writer;
+		writer.Command(CommandStream::OP_DISPATCH, { 1, 1, 1 });
+		CommandStreamAnalyzer::Stats baseline;
+		CHECK(writer.Analyze(baseline));
+
+		writer.Command(CommandStream::OP_DISPATCH, { 2, 1, 1 });
+		CommandStreamAnalyzer::Stats stats;
+		CHECK(writer.Analyze(stats));
+
+		ostringstream report;
+		CHECK(CommandStreamAnalyzer::Compare(report, baseline, stats));
+		CHECK(report.str().empty());
+		CHECK(!CommandStreamAnalyzer::Compare(report, stats, baseline));
+		CHECK(report.str().find("Dispatches: 2 > 1") != string::npos);
+		CHECK(report.str().find("Op.Dispatch: 2 > 1") != string::npos);
+
+		// Only the opcodes in use are printed.
+		ostringstream printed;
+		CommandStreamAnalyzer::Print(printed, stats);
+		CHECK(printed.str().find("ThreadGroups: 3") != string::npos);
+		CHECK(printed.str().find("Op.Barrier") == string::npos);
+	}
+}
+
+int main()
+{
+	testWorkAndBarriers();
+	testStateChanges();
+	testMalformed();
+	testCompare();
+
+	return GetTestResult();
+}
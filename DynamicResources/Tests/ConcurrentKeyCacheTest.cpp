@@ -0,0 +1,186 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <thread>
+#include "ConcurrentKeyCache.h"
+#include "TestHarness.h"
+
+using namespace std;
+
+namespace
+{
+	const uint32_t NumThreads = 4;
+	const uint32_t NumKeys = 4096;
+	const uint32_t NumFrames = 48;
+	const uint32_t NumDescriptors = 2;
+	const uint32_t Alive = 0xa11fe;
+
+	// Table of a mock descriptor heap, which is a pure function of the descriptors. It is
+	// cleared on destruction, so that a value read from a freed snapshot is caught even
+	// without a sanitizer.
+	struct MockTable
+	{
+		uint64_t Table = 0;
+		atomic<uint32_t> Guard;
+
+		MockTable() : Guard(0) {}
+		MockTable(uint64_t table) : Table(table), Guard(Alive) {}
+		MockTable(const MockTable& table) : Table(table.Table), Guard(table.Guard.load(memory_order_relaxed)) {}
+		~MockTable() { Guard.store(0, memory_order_relaxed); }
+
+		MockTable& operator=(const MockTable& table)
+		{
+			Table = table.Table;
+			Guard.store(table.Guard.load(memory_order_relaxed), memory_order_relaxed);
+
+			return *this;
+		}
+	};
+
+	struct HashedKey
+	{
+		DescriptorKey Key;
+		uint64_t Hash;
+	};
+
+	HashedKey getKey(uint32_t id)
+	{
+		const uintptr_t descriptors[NumDescriptors] = { 0x10000 + 32 * id, 0x10000 + 32 * id + 32 };
+
+		HashedKey key;
+		key.Key.Set(0, descriptors, NumDescriptors);
+		key.Hash = key.Key.Hash();
+
+		return key;
+	}
+
+	uint64_t getTable(uint32_t id)
+	{
+		return 3 * (0x10000 + 32 * id) + 0x10000 + 32 * id + 32;
+	}
+
+	bool isValid(const MockTable* pTable, uint32_t id)
+	{
+		return pTable->Guard.load(memory_order_relaxed) == Alive && pTable->Table == getTable(id);
+	}
+
+	struct Held
+	{
+		const MockTable* pTable;
+		uint32_t Id;
+	};
+
+	using Cache = ConcurrentKeyCache<DescriptorKey, MockTable>;
+
+	// Each frame, all threads look up a working set that shifts by 1/8 per frame, in different
+	// orders, and insert the misses. Then Merge() runs while the threads keep reading the
+	// shared entries. Shared values are held for a frame and checked again before they expire.
+	void testMerge()
+	{
+		Cache cache;
+		cache.Init(NumThreads);
+
+		vector<uint8_t> isShared(NumKeys * NumFrames / 8 + NumKeys);
+		vector<Held> held[NumThreads], prevHeld[NumThreads];
+		uint32_t numErrors[NumThreads] = {};
+
+		for (uint32_t frame = 0; frame < NumFrames; ++frame)
+		{
+			const auto base = frame * (NumKeys / 8);
+
+			// Recording: Find() and Insert(), and check the values held from the previous frame.
+			vector<thread> threads;
+			for (uint32_t t = 0; t < NumThreads; ++t) threads.emplace_back([&, t]()
+			{
+				for (const auto& h : prevHeld[t]) if (!isValid(h.pTable, h.Id)) ++numErrors[t];
+				prevHeld[t].clear();
+
+				for (auto i = 0u; i < NumKeys; ++i)
+				{
+					const auto id = base + (i * 2654435761u + NumKeys / NumThreads * t) % NumKeys;
+					const auto key = getKey(id);
+					if (const auto pTable = cache.FindShared(key.Key, key.Hash))
+					{
+						if (!isValid(pTable, id)) ++numErrors[t];
+						held[t].push_back({ pTable, id });
+					}
+					else if (const auto pStaged = cache.Find(t, key.Key, key.Hash))
+					{
+						if (!isValid(pStaged, id)) ++numErrors[t];
+					}
+					else cache.Insert(t, key.Key, key.Hash, MockTable(getTable(id)));
+				}
+			});
+			for (auto& thread : threads) thread.join();
+			threads.clear();
+
+			// Merge, while the threads read the shared entries and the values they hold.
+			for (uint32_t t = 0; t < NumThreads; ++t) threads.emplace_back([&, t]()
+			{
+				for (auto pass = 0; pass < 2; ++pass)
+				{
+					for (const auto& h : held[t]) if (!isValid(h.pTable, h.Id)) ++numErrors[t];
+					for (auto i = t; i < NumKeys; i += NumThreads)
+					{
+						const auto id = base + i;
+						const auto key = getKey(id);
+						const auto pTable = cache.FindShared(key.Key, key.Hash);
+						if (pTable) prevHeld[t].push_back({ pTable, id });
+						if (pTable ? !isValid(pTable, id) : isShared[id] != 0) ++numErrors[t];
+					}
+				}
+			});
+			cache.Merge();
+			for (auto& thread : threads) thread.join();
+
+			// Everything staged is shared after the merge.
+			for (uint32_t t = 0; t < NumThreads; ++t)
+			{
+				CHECK(numErrors[t] == 0);
+				prevHeld[t].insert(prevHeld[t].end(), held[t].begin(), held[t].end());
+				held[t].clear();
+			}
+
+			for (auto i = 0u; i < NumKeys; ++i)
+			{
+				const auto id = base + i;
+				const auto key = getKey(id);
+				const auto pTable = cache.FindShared(key.Key, key.Hash);
+				CHECK(pTable && isValid(pTable, id));
+				isShared[id] = 1;
+			}
+		}
+
+		CHECK(cache.GetSize() == NumKeys + (NumFrames - 1) * (NumKeys / 8));
+	}
+
+	// An entry staged by several threads keeps the value of the lowest thread index.
+	void testDuplicates()
+	{
+		Cache cache;
+		cache.Init(NumThreads);
+
+		const auto key = getKey(0);
+		for (uint32_t t = NumThreads; t-- > 0;) cache.Insert(t, key.Key, key.Hash, MockTable(t));
+		CHECK(cache.FindShared(key.Key, key.Hash) == nullptr);
+		CHECK(cache.Find(2, key.Key, key.Hash)->Table == 2);
+
+		CHECK(cache.Merge() == 1);
+		CHECK(cache.Find(2, key.Key, key.Hash)->Table == 0);
+		CHECK(cache.Merge() == 0);
+		CHECK(cache.GetSize() == 1);
+
+		cache.Clear();
+		CHECK(cache.FindShared(key.Key, key.Hash) == nullptr);
+		CHECK(cache.GetSize() == 0);
+	}
+}
+
+int main()
+{
+	testMerge();
+	testDuplicates();
+
+	return GetTestResult();
+}
@@ -0,0 +1,231 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <deque>
+#include <functional>
+#include <random>
+#include <vector>
+#include "CrossQueueSchedule.h"
+#include "FrameRing.h"
+#include "TestHarness.h"
+
+using namespace std;
+
+namespace
+{
+	struct MockFence
+	{
+		uint64_t Value = 0;
+	};
+
+	// In-order queue of GPU-side operations; a wait blocks everything behind it.
+	class MockQueue
+	{
+	public:
+		void Wait(MockFence* pFence, uint64_t value) { m_ops.push_back({ pFence, value, false, nullptr }); }
+		void Signal(MockFence* pFence, uint64_t value) { m_ops.push_back({ pFence, value, true, nullptr }); }
+		void Execute(function<void()> work) { m_ops.push_back({ nullptr, 0, false, move(work) }); }
+
+		bool IsEmpty() const { return m_ops.empty(); }
+
+		bool IsRunnable() const
+		{
+			if (m_ops.empty()) return false;
+			const auto& op = m_ops.front();
+
+			return op.IsSignal || !op.pFence || op.pFence->Value >= op.Value;
+		}
+
+		void Step()
+		{
+			const auto op = move(m_ops.front());
+			m_ops.pop_front();
+			if (op.IsSignal)
+			{
+				CHECK(op.Value >= op.pFence->Value);
+				op.pFence->Value = op.Value;
+			}
+			else if (op.Work) op.Work();
+		}
+
+	protected:
+		struct Op
+		{
+			MockFence* pFence;
+			uint64_t Value;
+			bool IsSignal;
+			function<void()> Work;
+		};
+
+		deque<Op> m_ops;
+	};
+
+	// The three queues of the app, stepped in a random order among those not blocked
+	class MockGpu
+	{
+	public:
+		enum QueueType : uint8_t
+		{
+			COPY,
+			COMPUTE,
+			DIRECT,
+
+			NUM_QUEUE
+		};
+
+		MockGpu(uint32_t seed) : m_random(seed) {}
+
+		MockQueue& operator[](uint8_t i) { return m_queues[i]; }
+
+		// A host wait on the fence; false if no queue can make progress towards it.
+		bool Wait(const MockFence& fence, uint64_t value)
+		{
+			while (fence.Value < value) if (!step()) return false;
+
+			return true;
+		}
+
+		// Runs all queues dry; false if any is left blocked.
+		bool Flush()
+		{
+			while (step()) {}
+			for (const auto& queue : m_queues) if (!queue.IsEmpty()) return false;
+
+			return true;
+		}
+
+	protected:
+		bool step()
+		{
+			uint8_t runnable[NUM_QUEUE];
+			uint8_t numRunnable = 0;
+			for (uint8_t i = 0; i < NUM_QUEUE; ++i)
+				if (m_queues[i].IsRunnable()) runnable[numRunnable++] = i;
+			if (numRunnable == 0) return false;
+
+			m_queues[runnable[m_random() % numRunnable]].Step();
+
+			return true;
+		}
+
+		MockQueue m_queues[NUM_QUEUE];
+		mt19937 m_random;
+	};
+
+	const uint32_t NumFrames = 32;
+
+	// Submits frames the way DynamicResources::OnRender() does with -async: uploads on the
+	// COPY queue, the filter on the COMPUTE queue and the copy and present on the DIRECT
+	// queue, which also signals the frame fence. Returns false on a deadlock, be it of the
+	// queues or of a host wait.
+	bool simulateFrames(uint8_t numBuffers, uint8_t numFramesInFlight, uint32_t seed,
+		bool waitOnOwnConsumer = false)
+	{
+		CrossQueueSchedule schedule;
+		FrameRing<uint8_t> frameRing;
+		CHECK(schedule.Init(numBuffers));
+		CHECK(frameRing.Init(numFramesInFlight));
+
+		MockGpu gpu(seed);
+		MockFence uploadFence, filterFence, presentFence, frameFence;
+		uint64_t fenceValue = 1;
+		uint64_t numRead = 0;
+		vector<uint32_t> contents(numBuffers, UINT32_MAX);
+
+		for (uint32_t frame = 0; frame < NumFrames; ++frame)
+		{
+			// WaitForNextFrame()
+			if (!gpu.Wait(frameFence, frameRing.GetFenceValue())) return false;
+
+			// Uploads, which both rendering queues wait for; a source update every few frames
+			// also makes the COPY queue wait for the previous frame.
+			if (frame % 4 == 1) gpu[MockGpu::COPY].Wait(&frameFence, fenceValue - 1);
+			gpu[MockGpu::COPY].Execute([] {});
+			gpu[MockGpu::COPY].Signal(&uploadFence, frame + 1);
+			gpu[MockGpu::COMPUTE].Wait(&uploadFence, frame + 1);
+			gpu[MockGpu::DIRECT].Wait(&uploadFence, frame + 1);
+
+			CrossQueueSchedule::Submission production, consumption;
+			CHECK(schedule.Produce(production));
+			CHECK(production.BufferIndex == frame % numBuffers);
+			if (waitOnOwnConsumer) production.WaitValue = production.SignalValue;
+			if (production.WaitValue) gpu[MockGpu::COMPUTE].Wait(&presentFence, production.WaitValue);
+			gpu[MockGpu::COMPUTE].Execute([&, frame, numBuffers, production]()
+			{
+				// The copy that last read the buffer must be done.
+				CHECK(numRead + numBuffers > frame);
+				contents[production.BufferIndex] = frame;
+			});
+			gpu[MockGpu::COMPUTE].Signal(&filterFence, production.SignalValue);
+
+			CHECK(schedule.Consume(consumption));
+			CHECK(consumption.BufferIndex == production.BufferIndex);
+			gpu[MockGpu::DIRECT].Wait(&filterFence, consumption.WaitValue);
+			gpu[MockGpu::DIRECT].Execute([&, frame, consumption]()
+			{
+				CHECK(contents[consumption.BufferIndex] == frame);
+				++numRead;
+			});
+			gpu[MockGpu::DIRECT].Signal(&presentFence, consumption.SignalValue);
+
+			// MoveToNextFrame()
+			gpu[MockGpu::DIRECT].Signal(&frameFence, fenceValue);
+			frameRing.Advance(fenceValue++);
+		}
+
+		if (!gpu.Flush()) return false;
+		CHECK(numRead == NumFrames);
+		CHECK(frameFence.Value == NumFrames);
+
+		return true;
+	}
+
+	void testFenceValues()
+	{
+		CrossQueueSchedule schedule;
+		CrossQueueSchedule::Submission submission;
+		CHECK(!schedule.Init(0));
+		CHECK(!schedule.Produce(submission));
+		CHECK(schedule.Init(2));
+		CHECK(!schedule.Consume(submission));
+
+		// The producer runs ahead by at most the number of buffers.
+		CHECK(schedule.Produce(submission));
+		CHECK(submission.BufferIndex == 0 && submission.WaitValue == 0 && submission.SignalValue == 1);
+		CHECK(schedule.Produce(submission));
+		CHECK(submission.BufferIndex == 1 && submission.WaitValue == 0 && submission.SignalValue == 2);
+		CHECK(!schedule.Produce(submission));
+
+		CHECK(schedule.Consume(submission));
+		CHECK(submission.BufferIndex == 0 && submission.WaitValue == 1 && submission.SignalValue == 1);
+
+		// Buffer 0 is reused once its consumption has signaled.
+		CHECK(schedule.Produce(submission));
+		CHECK(submission.BufferIndex == 0 && submission.WaitValue == 1 && submission.SignalValue == 3);
+		CHECK(schedule.GetNumProduced() == 3 && schedule.GetNumConsumed() == 1);
+	}
+
+	void testNoDeadlock()
+	{
+		for (uint8_t numBuffers = 1; numBuffers <= 3; ++numBuffers)
+			for (uint8_t numFramesInFlight = 1; numFramesInFlight <= FrameRing<uint8_t>::MaxDepth; ++numFramesInFlight)
+				for (uint32_t seed = 0; seed < 64; ++seed)
+					CHECK(simulateFrames(numBuffers, numFramesInFlight, seed));
+	}
+
+	// The simulation must catch a schedule that waits on a signal queued behind the wait.
+	void testDeadlockDetected()
+	{
+		for (uint32_t seed = 0; seed < 8; ++seed) CHECK(!simulateFrames(2, 2, seed, true));
+	}
+}
+
+int main()
+{
+	testFenceValues();
+	testNoDeadlock();
+	testDeadlockDetected();
+
+	return GetTestResult();
+}
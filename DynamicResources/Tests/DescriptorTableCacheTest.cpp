@@ -0,0 +1,263 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <thread>
+#include <vector>
+#include "DescriptorTableCache.h"
+#include "TestHarness.h"
+
+using namespace std;
+
+namespace
+{
+	// Key with a given hash, so that keys can collide
+	struct CollidingKey
+	{
+		uint32_t Id;
+		uint64_t HashValue;
+
+		uint64_t Hash() const { return HashValue; }
+		bool operator==(const CollidingKey& key) const { return Id == key.Id; }
+	};
+
+	// Tables of a mock descriptor-table lib, which are a pure function of the key
+	class MockSource :
+		public DescriptorTableCache::Source
+	{
+	public:
+		static uint64_t GetTable(const DescriptorKey& key)
+		{
+			auto table = (static_cast<uint64_t>(key.HeapType) + 1) << 48 | key.NumDescriptors;
+			for (uint8_t i = 0; i < key.NumDescriptors; ++i) table += key.Descriptors[i] << (4 * i);
+
+			return table;
+		}
+
+		// Not thread-safe, like the lib; calls that overlap are counted.
+		bool CreateTable(const DescriptorKey& key, DescriptorTableCache::Entry& entry)
+		{
+			if (IsCreating.exchange(true)) ++NumOverlaps;
+			++NumCreated;
+			const auto isFailing = IsFailing;
+			entry = { GetTable(key), NumCreated };
+			IsCreating = false;
+
+			return !isFailing;
+		}
+
+		uint32_t NumCreated = 0;
+		bool IsFailing = false;
+
+		atomic<bool> IsCreating = {};
+		atomic<uint32_t> NumOverlaps = {};
+	};
+
+	DescriptorKey getKey(uint8_t heapType, vector<uintptr_t> descriptors)
+	{
+		DescriptorKey key;
+		key.Set(heapType, descriptors.data(), static_cast<uint32_t>(descriptors.size()));
+
+		return key;
+	}
+
+	void testKeyMapCollisions()
+	{
+		KeyMap<CollidingKey, uint32_t> map(16);
+
+		// Same hash, and the same first slot with another hash
+		for (auto i = 0u; i < 4; ++i) map.Insert({ i, 7 }, 10 + i);
+		map.Insert({ 4, 7 + 16 }, 14);
+		CHECK(map.GetSize() == 5 && map.GetCapacity() == 16);
+		for (auto i = 0u; i < 4; ++i) CHECK(map.Find({ i, 7 }) && *map.Find({ i, 7 }) == 10 + i);
+		CHECK(map.Find({ 4, 7 + 16 }) && *map.Find({ 4, 7 + 16 }) == 14);
+		CHECK(!map.Find({ 5, 7 }));
+		CHECK(!map.Find({ 4, 7 }));
+
+		// Probing wraps around the end of the table.
+		for (auto i = 10u; i < 13; ++i) map.Insert({ i, 15 }, i);
+		for (auto i = 10u; i < 13; ++i) CHECK(map.Find({ i, 15 }) && *map.Find({ i, 15 }) == i);
+		CHECK(!map.Find({ 13, 15 }));
+
+		auto numEntries = 0u;
+		map.ForEach([&numEntries](const CollidingKey&, uint64_t, uint32_t) { ++numEntries; });
+		CHECK(numEntries == map.GetSize() && numEntries == 8);
+	}
+
+	void testKeyMapGrowth()
+	{
+		// The capacity doubles to keep the load factor at or below 1/2.
+		KeyMap<DescriptorKey, uint32_t> map(4);
+		CHECK(map.GetCapacity() == 4);
+		for (auto i = 0u; i < 1000; ++i)
+		{
+			map.Insert(getKey(0, { 0x10000 + 32 * i, i }), i);
+			CHECK(2 * map.GetSize() <= map.GetCapacity());
+		}
+		CHECK(map.GetSize() == 1000 && map.GetCapacity() == 2048);
+
+		auto numFound = 0u;
+		for (auto i = 0u; i < 1000; ++i)
+		{
+			const auto pValue = map.Find(getKey(0, { 0x10000 + 32 * i, i }));
+			if (pValue && *pValue == i) ++numFound;
+		}
+		CHECK(numFound == 1000);
+		CHECK(!map.Find(getKey(1, { 0x10000, 0 })));
+
+		map.Clear(3);
+		CHECK(map.GetSize() == 0 && map.GetCapacity() == 4);
+		CHECK(!map.Find(getKey(0, { 0x10000, 0 })));
+	}
+
+	void testKeyMapOverwrite()
+	{
+		KeyMap<CollidingKey, uint32_t> map(16);
+		for (auto i = 0u; i < 3; ++i) map.Insert({ i, 3 }, i);
+
+		// Also in the middle of a probe sequence
+		map.Insert({ 1, 3 }, 100);
+		map.Insert({ 2, 3 }, 200);
+		CHECK(map.GetSize() == 3);
+		CHECK(*map.Find({ 0, 3 }) == 0 && *map.Find({ 1, 3 }) == 100 && *map.Find({ 2, 3 }) == 200);
+	}
+
+	void testCache()
+	{
+		const auto source = make_shared<MockSource>();
+		DescriptorTableCache cache;
+		cache.Init(source);
+
+		const uintptr_t descriptors[] = { 0x100, 0x200 };
+		auto entry = cache.GetCbvSrvUavTable(descriptors, 2);
+		CHECK(entry.Table == MockSource::GetTable(getKey(DescriptorTableCache::CbvSrvUavHeap, { 0x100, 0x200 })));
+		CHECK(source->NumCreated == 1);
+
+		// Hits return the entry created by the miss.
+		entry = cache.GetCbvSrvUavTable(descriptors, 2);
+		CHECK(entry.Index == 1 && source->NumCreated == 1);
+		CHECK(cache.GetNumHits() == 1 && cache.GetNumMisses() == 1);
+
+		// A prefix, and samplers of the same values, are other tables.
+		CHECK(cache.GetCbvSrvUavTable(descriptors, 1).Index == 2);
+		const uint8_t presets[] = { 0x10, 0x20 };
+		const uintptr_t samplerDescriptors[] = { 0x10, 0x20 };
+		entry = cache.GetSamplerTable(presets, 2);
+		CHECK(entry.Table == MockSource::GetTable(getKey(DescriptorTableCache::SamplerHeap, { 0x10, 0x20 })));
+		CHECK(entry.Index == 3);
+		CHECK(cache.GetCbvSrvUavTable(samplerDescriptors, 2).Index == 4);
+		CHECK(cache.GetSamplerTable(presets, 2).Index == 3);
+		CHECK(cache.GetNumMisses() == 4);
+
+		// Too many descriptors fail without reaching the lib.
+		const vector<uintptr_t> tooMany(DescriptorKey::MaxDescriptors + 1, 0x100);
+		CHECK(cache.GetCbvSrvUavTable(tooMany.data(), static_cast<uint32_t>(tooMany.size())).Table == 0);
+		CHECK(cache.GetSamplerTable(tooMany.data(), static_cast<uint32_t>(tooMany.size())).Table == 0);
+		CHECK(source->NumCreated == 4);
+
+		// Failures are not cached.
+		const uintptr_t other[] = { 0x300 };
+		source->IsFailing = true;
+		CHECK(cache.GetCbvSrvUavTable(other, 1).Table == 0);
+		source->IsFailing = false;
+		CHECK(cache.GetCbvSrvUavTable(other, 1).Table != 0);
+		CHECK(source->NumCreated == 6 && cache.GetNumMisses() == 5);
+
+		// The entries returned survive the growth of the map, as they are copies.
+		vector<DescriptorTableCache::Entry> entries;
+		for (uintptr_t descriptor = 0x1000; descriptor < 0x1000 + 500; ++descriptor)
+			entries.push_back(cache.GetCbvSrvUavTable(&descriptor, 1));
+		auto numSame = 0u;
+		for (uintptr_t descriptor = 0x1000; descriptor < 0x1000 + 500; ++descriptor)
+		{
+			const auto hit = cache.GetCbvSrvUavTable(&descriptor, 1);
+			const auto& missed = entries[descriptor - 0x1000];
+			if (hit.Table == missed.Table && hit.Index == missed.Index) ++numSame;
+		}
+		CHECK(numSame == 500 && cache.GetNumMisses() == 505);
+
+		cache.Clear();
+		CHECK(cache.GetNumHits() == 0 && cache.GetNumMisses() == 0);
+		CHECK(cache.GetCbvSrvUavTable(descriptors, 2).Index == source->NumCreated);
+		CHECK(cache.GetNumMisses() == 1);
+	}
+
+	// Each frame, the threads look up a working set that shifts by 1/4 per frame, in different
+	// orders and partly as samplers, and check every table against the key. Then the staged
+	// misses are merged, and a frame on the same working set misses nothing.
+	void testConcurrent()
+	{
+		const uint32_t numThreads = 4, numKeys = 2048;
+		const auto source = make_shared<MockSource>();
+		ConcurrentDescriptorTableCache cache;
+		cache.Init(source, numThreads);
+
+		atomic<uint32_t> numErrors(0);
+		const auto runFrame = [&](uint32_t base)
+		{
+			// Started together, so that their misses overlap
+			atomic<uint32_t> numStarted(0);
+			vector<thread> threads;
+			for (auto t = 0u; t < numThreads; ++t) threads.emplace_back([&, t]()
+			{
+				for (++numStarted; numStarted < numThreads;) this_thread::yield();
+				for (auto i = 0u; i < numKeys; ++i)
+				{
+					const auto id = base + (i * 7 + 131 * t) % numKeys;
+					const uintptr_t descriptors[] = { 0x100 + id, id & 0xff };
+					const auto isSampler = id % 4 == 0;
+					const auto entry = isSampler ? cache.GetSamplerTable(t, descriptors, 2) :
+						cache.GetCbvSrvUavTable(t, descriptors, 2);
+
+					const auto heapType = isSampler ? DescriptorTableCache::SamplerHeap : DescriptorTableCache::CbvSrvUavHeap;
+					if (entry.Table != MockSource::GetTable(getKey(heapType, { 0x100 + id, id & 0xff }))) ++numErrors;
+				}
+			});
+
+			for (auto& thread : threads) thread.join();
+		};
+
+		// Nothing is shared yet, so every thread misses every key once.
+		runFrame(0);
+		CHECK(cache.GetNumMisses() == numThreads * numKeys);
+		CHECK(cache.Merge() == numKeys);
+
+		runFrame(0);
+		CHECK(cache.GetNumMisses() == numThreads * numKeys);
+		CHECK(cache.Merge() == 0);
+
+		for (auto frame = 1u; frame <= 8; ++frame)
+		{
+			runFrame(frame * numKeys / 4);
+			cache.Merge();
+		}
+		CHECK(numErrors == 0);
+		CHECK(source->NumOverlaps == 0);
+		CHECK(source->NumCreated == cache.GetNumMisses());
+		CHECK(cache.GetNumMisses() == numThreads * numKeys * 3);
+
+		// Failures are neither returned as tables nor staged.
+		source->IsFailing = true;
+		const uintptr_t descriptors[] = { 0x10000 };
+		CHECK(cache.GetCbvSrvUavTable(0, descriptors, 1).Table == 0);
+		source->IsFailing = false;
+		CHECK(cache.GetCbvSrvUavTable(0, descriptors, 1).Table != 0);
+		CHECK(cache.Merge() == 1);
+
+		cache.Clear();
+		CHECK(cache.GetNumMisses() == 0);
+		CHECK(cache.GetCbvSrvUavTable(1, descriptors, 1).Table != 0);
+		CHECK(cache.GetNumMisses() == 1);
+	}
+}
+
+int main()
+{
+	testKeyMapCollisions();
+	testKeyMapGrowth();
+	testKeyMapOverwrite();
+	testCache();
+	testConcurrent();
+
+	return GetTestResult();
+}
@@ -0,0 +1,131 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <random>
+#include "DirtyRegion.h"
+#include "TestHarness.h"
+
+using namespace std;
+
+namespace
+{
+	bool isEqual(const DirtyRegion::Rect& a, const DirtyRegion::Rect& b)
+	{
+		return a.Left == b.Left && a.Top == b.Top && a.Right == b.Right && a.Bottom == b.Bottom;
+	}
+
+	void testRects()
+	{
+		// Dilation is clipped to the image.
+		CHECK(isEqual(DirtyRegion::Dilate({ 2, 10, 6, 12 }, 4, 100, 14), { 0, 6, 10, 14 }));
+		CHECK(isEqual(DirtyRegion::Union({ 0, 0, 0, 0 }, { 1, 2, 3, 4 }), { 1, 2, 3, 4 }));
+		CHECK(isEqual(DirtyRegion::Union({ 5, 0, 6, 1 }, { 1, 2, 3, 4 }), { 1, 0, 6, 4 }));
+
+		// Half-open: touching rectangles do not overlap, and neither does the cleared one.
+		CHECK(DirtyRegion::IsOverlapped({ 0, 0, 4, 4 }, { 3, 3, 8, 8 }));
+		CHECK(!DirtyRegion::IsOverlapped({ 0, 0, 4, 4 }, { 4, 0, 8, 4 }));
+		CHECK(!DirtyRegion::IsOverlapped({}, { 0, 0, 4, 4 }));
+		CHECK(DirtyRegion::GetArea({ 3, 1, 1, 5 }) == 0);
+	}
+
+	void testAdd()
+	{
+		DirtyRegion region;
+		region.Init(64, 32);
+		CHECK(region.IsEmpty() && !region.IsFull());
+
+		// Clipped, and skipped when empty or covered
+		region.Add({ 60, 30, 80, 40 });
+		region.Add({ 10, 10, 10, 20 });
+		region.Add({ 61, 30, 62, 31 });
+		CHECK(region.GetRects().size() == 1);
+		CHECK(isEqual(region.GetRects()[0], { 60, 30, 64, 32 }));
+
+		// The tiles of 8 x 8 texels cover the region dilated by the radius.
+		vector<DirtyRegion::Rect> tiles;
+		region.GetTiles(tiles, 3, 4);
+		CHECK(tiles.size() == 1);
+		CHECK(isEqual(tiles[0], { 7, 3, 8, 4 }));
+		CHECK(isEqual(region.GetTexels(tiles[0]), { 56, 24, 64, 32 }));
+
+		// Beyond MaxRects, the rectangles collapse into their bounds.
+		for (uint32_t i = 0; i <= DirtyRegion::MaxRects; ++i) region.Add({ i, 0, i + 1, 1 });
+		CHECK(region.GetRects().size() == 1);
+		CHECK(isEqual(region.GetRects()[0], { 0, 0, 64, 32 }));
+		CHECK(!region.IsFull());
+
+		// Adding the whole image makes it full, which is not dilated further.
+		region.Clear();
+		region.Add({ 0, 0, 100, 100 });
+		CHECK(region.IsFull());
+		region.GetTiles(tiles, 16, 4);
+		CHECK(tiles.size() == 1 && isEqual(tiles[0], { 0, 0, 8, 4 }));
+		CHECK(region.GetNumTiles() == 32);
+
+		region.Clear();
+		region.GetTiles(tiles, 16, 4);
+		CHECK(region.IsEmpty() && tiles.empty());
+	}
+
+	// Random regions: the tiles cover the dilated region, do not overlap, stay within the
+	// image and within the cap.
+	void testRandomTiles()
+	{
+		mt19937 random(3);
+		for (auto n = 0; n < 2000; ++n)
+		{
+			const uint32_t width = 1 + random() % 300;
+			const uint32_t height = 1 + random() % 200;
+			const uint32_t radius = random() % 40;
+			const uint32_t maxTiles = 1 + random() % 8;
+
+			DirtyRegion region;
+			region.Init(width, height);
+			const uint32_t numRects = random() % 50;
+			for (auto i = 0u; i < numRects; ++i)
+			{
+				const uint32_t x = random() % (width + 20);
+				const uint32_t y = random() % (height + 20);
+				region.Add({ x, y, x + static_cast<uint32_t>(random() % 100), y + static_cast<uint32_t>(random() % 100) });
+			}
+			if (random() % 50 == 0) region.AddAll();
+
+			vector<uint8_t> isDirty(width * height);
+			for (const auto& rect : region.GetRects())
+			{
+				const auto dilated = region.IsFull() ? rect : DirtyRegion::Dilate(rect, radius, width, height);
+				for (auto y = dilated.Top; y < dilated.Bottom; ++y)
+					for (auto x = dilated.Left; x < dilated.Right; ++x) isDirty[width * y + x] = 1;
+			}
+
+			vector<DirtyRegion::Rect> tiles;
+			region.GetTiles(tiles, radius, maxTiles);
+			CHECK(tiles.size() <= maxTiles);
+
+			vector<uint8_t> isCovered(width * height);
+			for (size_t i = 0; i < tiles.size(); ++i)
+			{
+				for (auto j = i + 1; j < tiles.size(); ++j) CHECK(!DirtyRegion::IsOverlapped(tiles[i], tiles[j]));
+				CHECK(tiles[i].Right * 8 < width + 8 && tiles[i].Bottom * 8 < height + 8);
+
+				const auto texels = region.GetTexels(tiles[i]);
+				for (auto y = texels.Top; y < texels.Bottom; ++y)
+					for (auto x = texels.Left; x < texels.Right; ++x) isCovered[width * y + x] = 1;
+			}
+
+			auto numUncovered = 0u;
+			for (size_t i = 0; i < isDirty.size(); ++i) if (isDirty[i] && !isCovered[i]) ++numUncovered;
+			CHECK(numUncovered == 0);
+		}
+	}
+}
+
+int main()
+{
+	testRects();
+	testAdd();
+	testRandomTiles();
+
+	return GetTestResult();
+}
@@ -0,0 +1,226 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <random>
+#include "FilterGraph.h"
+#include "TestHarness.h"
+
+using namespace std;
+
+namespace
+{
+	const uint64_t MB = 1ull << 20;
+	const FilterGraph::TextureDesc Desc = { 512, 512, 28, MB, 64 * 1024 };
+
+	bool hasBarrier(const FilterGraph::Step& step, FilterGraph::ResourceId resource,
+		FilterGraph::Access before, FilterGraph::Access after)
+	{
+		for (const auto& barrier : step.Barriers)
+			if (barrier.Resource == resource && barrier.Before == before && barrier.After == after) return true;
+
+		return false;
+	}
+
+	// Transients whose lifetimes overlap must not share memory, and all must be aligned within the heap.
+	void checkPlacement(const FilterGraph& graph, const FilterGraph::Plan& plan)
+	{
+		for (FilterGraph::ResourceId i = 0; i < graph.GetNumResources(); ++i)
+		{
+			const auto offset = plan.HeapOffsets[i];
+			if (offset == UINT64_MAX) continue;
+
+			const auto& desc = graph.GetTextureDesc(i);
+			CHECK(!graph.IsImported(i));
+			CHECK(offset % desc.Alignment == 0);
+			CHECK(offset + desc.Size <= plan.HeapSize);
+
+			for (FilterGraph::ResourceId j = 0; j < i; ++j)
+			{
+				if (plan.HeapOffsets[j] == UINT64_MAX) continue;
+				const auto& a = plan.Lifetimes[i];
+				const auto& b = plan.Lifetimes[j];
+				if (a.First <= b.Last && b.First <= a.Last)
+					CHECK(offset + desc.Size <= plan.HeapOffsets[j] || plan.HeapOffsets[j] + graph.GetTextureDesc(j).Size <= offset);
+			}
+		}
+
+		CHECK(plan.HeapSize <= plan.UnaliasedHeapSize);
+	}
+
+	// The chain of BindlessFilter: the source through 3 intermediates into the result
+	void testChain()
+	{
+		FilterGraph graph;
+		const auto source = graph.Import("Source", FilterGraph::ACCESS_SHADER_READ, FilterGraph::ACCESS_SHADER_READ);
+		const auto result = graph.Import("Result", FilterGraph::ACCESS_UNKNOWN);
+		FilterGraph::ResourceId intermediates[3];
+		for (auto& intermediate : intermediates) intermediate = graph.CreateTexture("Intermediate", Desc);
+
+		graph.AddPass("Pass0", { source }, { intermediates[0] });
+		graph.AddPass("Pass1", { intermediates[0] }, { intermediates[1] });
+		graph.AddPass("Pass2", { intermediates[1] }, { intermediates[2] });
+		graph.AddPass("Pass3", { intermediates[2] }, { result });
+
+		FilterGraph::Plan plan;
+		CHECK(graph.Compile(plan));
+		CHECK(plan.Steps.size() == 4);
+		CHECK(plan.NumCulledPasses == 0);
+		checkPlacement(graph, plan);
+
+		// Lifetimes span from the writing to the reading step.
+		CHECK(plan.Lifetimes[source].First == 0 && plan.Lifetimes[source].Last == 0);
+		for (uint32_t i = 0; i < 3; ++i)
+			CHECK(plan.Lifetimes[intermediates[i]].First == i && plan.Lifetimes[intermediates[i]].Last == i + 1);
+
+		// The third intermediate reuses the memory of the first, which is dead by then.
+		CHECK(plan.HeapOffsets[intermediates[0]] == plan.HeapOffsets[intermediates[2]]);
+		CHECK(plan.HeapOffsets[intermediates[1]] != plan.HeapOffsets[intermediates[0]]);
+		CHECK(plan.HeapOffsets[source] == UINT64_MAX && plan.HeapOffsets[result] == UINT64_MAX);
+		CHECK(plan.HeapSize == 2 * MB);
+		CHECK(plan.UnaliasedHeapSize == 3 * MB);
+
+		// Aliasing barriers where a texture takes over memory; the first intermediate takes it
+		// back from the last one of the previous execution.
+		CHECK(plan.Steps[0].AliasingBarriers.size() == 1);
+		CHECK(plan.Steps[0].AliasingBarriers[0].Before == intermediates[2]);
+		CHECK(plan.Steps[0].AliasingBarriers[0].After == intermediates[0]);
+		CHECK(plan.Steps[1].AliasingBarriers.empty());
+		CHECK(plan.Steps[2].AliasingBarriers.size() == 1);
+		CHECK(plan.Steps[2].AliasingBarriers[0].Before == intermediates[0]);
+		CHECK(plan.Steps[2].AliasingBarriers[0].After == intermediates[2]);
+		CHECK(plan.Steps[3].AliasingBarriers.empty());
+
+		// Transitions right before the accessing pass; transients start in the state of their
+		// last access, and the source needs none.
+		CHECK(plan.Steps[0].Barriers.size() == 1);
+		CHECK(hasBarrier(plan.Steps[0], intermediates[0], FilterGraph::ACCESS_SHADER_READ, FilterGraph::ACCESS_UNORDERED_WRITE));
+		for (uint32_t i = 1; i < 3; ++i)
+		{
+			CHECK(plan.Steps[i].Barriers.size() == 2);
+			CHECK(hasBarrier(plan.Steps[i], intermediates[i - 1], FilterGraph::ACCESS_UNORDERED_WRITE, FilterGraph::ACCESS_SHADER_READ));
+			CHECK(hasBarrier(plan.Steps[i], intermediates[i], FilterGraph::ACCESS_SHADER_READ, FilterGraph::ACCESS_UNORDERED_WRITE));
+		}
+		CHECK(plan.Steps[3].Barriers.size() == 2);
+		CHECK(hasBarrier(plan.Steps[3], result, FilterGraph::ACCESS_UNKNOWN, FilterGraph::ACCESS_UNORDERED_WRITE));
+		CHECK(plan.FinalBarriers.empty());
+
+		// Compiling into a used plan starts over.
+		CHECK(graph.Compile(plan));
+		CHECK(plan.Steps.size() == 4 && plan.Steps[0].Barriers.size() == 1 && plan.Steps[0].AliasingBarriers.size() == 1);
+	}
+
+	void testCullAndFinalBarriers()
+	{
+		FilterGraph graph;
+		const auto source = graph.Import("Source", FilterGraph::ACCESS_SHADER_READ);
+		const auto result = graph.Import("Result", FilterGraph::ACCESS_COPY_READ, FilterGraph::ACCESS_COPY_READ);
+		const auto unused = graph.CreateTexture("Unused", Desc);
+
+		graph.AddPass("Dead", { source }, { unused });
+		graph.AddPass("Write", { source }, { result });
+		graph.AddPass("WriteAgain", { source }, { result });
+
+		FilterGraph::Plan plan;
+		CHECK(graph.Compile(plan));
+		CHECK(plan.NumCulledPasses == 1);
+		CHECK(plan.Steps.size() == 2 && plan.Steps[0].Pass == 1 && plan.Steps[1].Pass == 2);
+		CHECK(plan.Lifetimes[unused].First == FilterGraph::InvalidId);
+		CHECK(plan.HeapOffsets[unused] == UINT64_MAX);
+		CHECK(plan.HeapSize == 0);
+
+		// Two writes in a row are separated by a UAV barrier, and the result returns to its final state.
+		CHECK(hasBarrier(plan.Steps[0], result, FilterGraph::ACCESS_COPY_READ, FilterGraph::ACCESS_UNORDERED_WRITE));
+		CHECK(hasBarrier(plan.Steps[1], result, FilterGraph::ACCESS_UNORDERED_WRITE, FilterGraph::ACCESS_UNORDERED_WRITE));
+		CHECK(plan.FinalBarriers.size() == 1);
+		CHECK(plan.FinalBarriers[0].Resource == result);
+		CHECK(plan.FinalBarriers[0].Before == FilterGraph::ACCESS_UNORDERED_WRITE);
+		CHECK(plan.FinalBarriers[0].After == FilterGraph::ACCESS_COPY_READ);
+	}
+
+	void testInvalid()
+	{
+		FilterGraph::Plan plan;
+		{
+			FilterGraph graph;
+			const auto result = graph.Import("Result", FilterGraph::ACCESS_UNKNOWN);
+			const auto intermediate = graph.CreateTexture("Intermediate", Desc);
+			graph.AddPass("ReadUnwritten", { intermediate }, { result });
+			CHECK(!graph.Compile(plan));
+		}
+
+		{
+			FilterGraph graph;
+			const auto result = graph.Import("Result", FilterGraph::ACCESS_UNKNOWN);
+			graph.AddPass("InPlace", { result }, { result });
+			CHECK(!graph.Compile(plan));
+		}
+
+		{
+			FilterGraph graph;
+			const auto result = graph.Import("Result", FilterGraph::ACCESS_UNKNOWN);
+			graph.AddPass("OutOfRange", { result + 1 }, { result });
+			CHECK(!graph.Compile(plan));
+		}
+	}
+
+	// Random graphs of passes reading earlier textures, with transients of random sizes
+	void testRandomPlacement()
+	{
+		mt19937 random(7);
+		for (auto n = 0; n < 200; ++n)
+		{
+			FilterGraph graph;
+			const auto source = graph.Import("Source", FilterGraph::ACCESS_SHADER_READ);
+			vector<FilterGraph::ResourceId> written = { source };
+
+			const auto numPasses = 2 + random() % 10;
+			for (auto i = 0u; i < numPasses; ++i)
+			{
+				const auto isLast = i + 1 == numPasses;
+				FilterGraph::TextureDesc desc = Desc;
+				desc.Size = (1 + random() % 16) * 4096;
+				desc.Alignment = 4096ull << (random() % 3);
+				const auto output = isLast ? graph.Import("Result", FilterGraph::ACCESS_UNKNOWN) :
+					graph.CreateTexture("Transient", desc);
+
+				vector<FilterGraph::ResourceId> reads = { written[random() % written.size()] };
+				if (random() % 2) reads.push_back(written[random() % written.size()]);
+				if (reads.size() > 1 && reads[0] == reads[1]) reads.pop_back();
+				graph.AddPass("Pass", reads, { output });
+				written.push_back(output);
+			}
+
+			FilterGraph::Plan plan;
+			CHECK(graph.Compile(plan));
+			checkPlacement(graph, plan);
+
+			// Each placed texture that shares memory is activated by an aliasing barrier at its first step.
+			for (FilterGraph::ResourceId i = 0; i < graph.GetNumResources(); ++i)
+			{
+				if (plan.HeapOffsets[i] == UINT64_MAX) continue;
+				auto numActivations = 0u;
+				for (const auto& step : plan.Steps)
+					for (const auto& barrier : step.AliasingBarriers) if (barrier.After == i) ++numActivations;
+				CHECK(numActivations <= 1);
+				if (numActivations > 0)
+				{
+					auto isActivatedFirst = false;
+					for (const auto& barrier : plan.Steps[plan.Lifetimes[i].First].AliasingBarriers)
+						isActivatedFirst = isActivatedFirst || barrier.After == i;
+					CHECK(isActivatedFirst);
+				}
+			}
+		}
+	}
+}
+
+int main()
+{
+	testChain();
+	testCullAndFinalBarriers();
+	testInvalid();
+	testRandomPlacement();
+
+	return GetTestResult();
+}
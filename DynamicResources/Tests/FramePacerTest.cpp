@@ -0,0 +1,134 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <cmath>
+#include "FramePacer.h"
+#include "TestHarness.h"
+
+namespace
+{
+	// The pacer is driven by a fake clock in seconds, and fence values completed by hand.
+	bool isNear(double a, double b)
+	{
+		return fabs(a - b) < 1e-9;
+	}
+
+	void testFramesInFlight()
+	{
+		for (uint8_t maxFramesInFlight = 1; maxFramesInFlight <= 3; ++maxFramesInFlight)
+		{
+			FramePacer pacer;
+			pacer.SetMaxFramesInFlight(maxFramesInFlight);
+			CHECK(pacer.GetMaxFramesInFlight() == maxFramesInFlight);
+			CHECK(pacer.GetRequiredFenceValue() == 0);
+
+			// Frame n signals n, and may start once frame n - maxFramesInFlight has completed.
+			for (uint64_t n = 1; n <= 5; ++n)
+			{
+				pacer.BeginFrame(0.01 * n, 0);
+				pacer.EndFrame(0.01 * n + 0.005, n);
+				CHECK(pacer.GetRequiredFenceValue() == (n + 1 > maxFramesInFlight ? n + 1 - maxFramesInFlight : 0));
+			}
+		}
+
+		FramePacer pacer;
+		pacer.SetMaxFramesInFlight(0);
+		CHECK(pacer.GetMaxFramesInFlight() == 1);
+	}
+
+	void testDeadline()
+	{
+		FramePacer pacer;
+		pacer.SetTargetFrameTime(0.01);
+		pacer.SetWakeUpMargin(0.0);
+
+		// Nothing to wait for before the first frame
+		CHECK(pacer.GetWaitTime(0.0) == 0.0);
+		pacer.BeginFrame(0.0, 0);
+		pacer.EndFrame(0.004, 1);
+
+		// The next frame starts as late as its recording time allows to meet the deadline.
+		CHECK(isNear(pacer.GetWaitTime(0.004), 0.002));
+		CHECK(pacer.GetWaitTime(0.007) == 0.0);
+		pacer.BeginFrame(0.006, 1);
+		pacer.EndFrame(0.010, 2);
+		CHECK(isNear(pacer.GetWaitTime(0.010), 0.006));
+
+		// A frame that starts late moves the deadline, rather than rushing the frames after it.
+		pacer.BeginFrame(0.030, 2);
+		pacer.EndFrame(0.034, 3);
+		CHECK(isNear(pacer.GetWaitTime(0.034), 0.006));
+
+		// Unlimited
+		pacer.SetTargetFrameTime(0.0);
+		CHECK(pacer.GetWaitTime(0.034) == 0.0);
+	}
+
+	void testSleep()
+	{
+		FramePacer pacer;
+		pacer.SetTargetFrameTime(0.01);
+		pacer.SetWakeUpMargin(0.001);
+		pacer.SetSleepGranularity(0.002);
+		pacer.BeginFrame(0.0, 0);
+		pacer.EndFrame(0.004, 1);
+
+		// Woken up a margin early, and only the wait beyond the sleep granularity is slept.
+		CHECK(isNear(pacer.GetWaitTime(0.004), 0.001));
+		CHECK(pacer.GetSleepTime(0.004) == 0.0);
+		CHECK(isNear(pacer.GetWaitTime(0.0), 0.005));
+		CHECK(isNear(pacer.GetSleepTime(0.0), 0.003));
+
+		// Without a granularity, e.g. with a high-resolution timer, the whole wait is slept.
+		pacer.SetSleepGranularity(0.0);
+		CHECK(isNear(pacer.GetSleepTime(0.0), 0.005));
+		pacer.SetSleepGranularity(-1.0);
+		CHECK(isNear(pacer.GetSleepTime(0.0), 0.005));
+	}
+
+	void testStats()
+	{
+		FramePacer pacer;
+		CHECK(pacer.GetStats().NumFrames == 0);
+
+		pacer.BeginFrame(0.0, 0);
+		pacer.EndFrame(0.004, 1);
+		// Recorded while frame 1 is in flight
+		pacer.BeginFrame(0.010, 0);
+		pacer.EndFrame(0.016, 2);
+		// Both completed when polled
+		pacer.BeginFrame(0.020, 2);
+		pacer.EndFrame(0.022, 3);
+
+		auto stats = pacer.GetStats(false);
+		CHECK(stats.NumFrames == 3);
+		CHECK(isNear(stats.CpuBusy, 0.004));
+		CHECK(isNear(stats.CpuWait, 0.010 / 3.0));
+		CHECK(isNear(stats.Overlap, 1.0 / 3.0));
+		CHECK(isNear(stats.GpuLatency, 0.010));
+
+		stats = pacer.GetStats();
+		CHECK(stats.NumFrames == 3 && isNear(stats.GpuLatency, 0.010));
+		stats = pacer.GetStats();
+		CHECK(stats.NumFrames == 0 && stats.CpuBusy == 0.0 && stats.CpuWait == 0.0);
+		CHECK(stats.Overlap == 0.0 && stats.GpuLatency == 0.0);
+
+		// Submissions still in flight at the reset count after it.
+		pacer.BeginFrame(0.030, 3);
+		pacer.EndFrame(0.031, 4);
+		stats = pacer.GetStats();
+		CHECK(stats.NumFrames == 1 && stats.Overlap == 0.0);
+		CHECK(isNear(stats.GpuLatency, 0.008));
+	}
+}
+
+int main()
+{
+	testFramesInFlight();
+	testDeadline();
+	testSleep();
+	testStats();
+
+	return GetTestResult();
+}
@@ -0,0 +1,256 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <cstring>
+#include "IndirectBatch.h"
+#include "RecordingCommandList.h"
+#include "TestHarness.h"
+
+using namespace std;
+using namespace XUSG;
+
+namespace
+{
+	// Buffer that is only told apart by its address
+	class MockBuffer :
+		public Buffer
+	{
+	public:
+		MockBuffer() : m_descriptor(0) {}
+		virtual ~MockBuffer() {}
+
+		bool Initialize(const Device*) { return true; }
+		bool Initialize(const Device*, Format) { return true; }
+		bool ReadFromSubresource(void*, uint32_t, uint32_t, uint32_t, const BoxRange*) { return false; }
+		bool WriteToSubresource(uint32_t, const void*, uint32_t, uint32_t, const BoxRange*) { return false; }
+
+		Descriptor AllocateCbvSrvUavHeap(uint32_t) { return 0; }
+
+		uint32_t SetBarrier(ResourceBarrier*, ResourceState, uint32_t numBarriers, uint32_t, BarrierFlag,
+			ResourceState, uint32_t) { return numBarriers; }
+		ResourceState Transition(ResourceState, uint32_t, BarrierFlag, ResourceState, uint32_t) { return ResourceState::COMMON; }
+		ResourceState GetResourceState(uint32_t, uint32_t) const { return ResourceState::COMMON; }
+
+		uint64_t GetWidth() const { return 0; }
+		uint64_t GetVirtualAddress(int) const { return 0; }
+
+		void Unmap(const Range*) {}
+
+		void Create(void*, void*, const wchar_t*, uint32_t) {}
+		void SetName(const wchar_t*) {}
+
+		void* GetHandle() const { return nullptr; }
+
+		const Descriptor& GetSRV(uint32_t) const { return m_descriptor; }
+		Format GetFormat() const { return Format::UNKNOWN; }
+
+		bool Create(const Device*, size_t, ResourceFlag, MemoryType, uint32_t, const uintptr_t*, uint32_t,
+			const uintptr_t*, MemoryFlag, const wchar_t*, const uintptr_t*, uint32_t) { return true; }
+		bool CreateResource(size_t, ResourceFlag, MemoryType, MemoryFlag, ResourceState, uint8_t,
+			const Format*, uint32_t) { return true; }
+		bool Upload(CommandList*, Resource*, const void*, size_t, size_t, ResourceState, uint32_t) { return false; }
+		bool Upload(CommandList*, uint32_t, Resource*, const void*, size_t, ResourceState, uint32_t) { return false; }
+		bool ReadBack(CommandList*, Buffer*, size_t, size_t, size_t, ResourceState, uint32_t) { return false; }
+
+		Descriptor CreateSRV(const Descriptor&, uint32_t, uint32_t, uint32_t, Format, size_t, uint16_t) { return 0; }
+		Descriptor CreateUAV(const Descriptor&, uint32_t, uint32_t, uint32_t, Format, size_t, size_t) { return 0; }
+
+		const Descriptor& GetUAV(uint32_t) const { return m_descriptor; }
+
+		void* Map(uint32_t, uintptr_t, uintptr_t) { return nullptr; }
+		void* Map(const Range*, uint32_t) { return nullptr; }
+
+		void SetCounter(const Resource::sptr&) {}
+		Resource::sptr GetCounter() const { return nullptr; }
+
+	protected:
+		Descriptor m_descriptor;
+	};
+
+	// Batch over mock buffers, as Init() would create it for the lists of jobs
+	class TestIndirectBatch :
+		public IndirectBatch
+	{
+	public:
+		TestIndirectBatch(uint32_t numJobs, uint32_t numLists)
+		{
+			m_jobs = make_unique<MockBuffer>();
+			m_arguments = make_unique<MockBuffer>();
+			m_counts = make_unique<MockBuffer>();
+			m_numJobs = numJobs;
+			m_numLists = numLists;
+		}
+	};
+
+	struct Command
+	{
+		uint32_t Opcode;
+		vector<uint32_t> Payload;
+	};
+
+	vector<Command> getCommands(const RecordingCommandList& commandList)
+	{
+		vector<Command> commands;
+		const auto pStream = commandList.GetStream();
+		const auto numWords = commandList.GetStreamSize();
+		for (size_t i = 0; i < numWords; i += 1 + (pStream[i] >> 16))
+			commands.push_back({ pStream[i] & 0xffff, vector<uint32_t>(&pStream[i + 1], &pStream[i + 1 + (pStream[i] >> 16)]) });
+
+		return commands;
+	}
+
+	uint64_t getWord64(const vector<uint32_t>& payload, uint32_t i)
+	{
+		return payload[i] | (static_cast<uint64_t>(payload[i + 1]) << 32);
+	}
+
+	// Runs CSDispatchArgs.hlsl on the build recorded last, with every output non-empty. The
+	// arguments hold the record addresses, and the counts the number of jobs of each group.
+	void dispatchArgs(const RecordingCommandList& commandList, const vector<uint32_t>& jobs,
+		vector<uint8_t>& arguments, vector<uint32_t>& counts)
+	{
+		const uint32_t argumentStride = 20;	// ARGUMENT_STRIDE
+
+		uint32_t cb[5] = {};
+		for (const auto& command : getCommands(commandList))
+		{
+			if (command.Opcode == CommandStream::OP_SET_COMPUTE_32BIT_CONSTANTS && command.Payload[0] == 0)
+				for (auto i = 0u; i < command.Payload[2]; ++i) cb[command.Payload[1] + i] = command.Payload[3 + i];
+			if (command.Opcode != CommandStream::OP_DISPATCH) continue;
+
+			const auto tableAddress = cb[0] | (static_cast<uint64_t>(cb[1]) << 32);
+			const auto recordSize = cb[2], numJobs = cb[3], firstList = cb[4];
+			for (auto gid = 0u; gid < command.Payload[0]; ++gid)
+			{
+				const auto list = firstList + gid;
+				for (auto i = 0u; i < numJobs; ++i)
+				{
+					const uint64_t address = tableAddress + recordSize * jobs.at(numJobs * list + i);
+					const auto offset = argumentStride * (numJobs * gid + i);
+					CHECK(offset + argumentStride <= arguments.size());
+					if (offset + argumentStride <= arguments.size()) memcpy(&arguments[offset], &address, sizeof(address));
+				}
+				CHECK(gid < counts.size());
+				if (gid < counts.size()) counts[gid] = numJobs;
+			}
+		}
+	}
+
+	// The root parameters the batch binds are the ones the shader declares.
+	void testRootParameters()
+	{
+		CHECK(IndirectBatch::JobsRootIndex == 5 && IndirectBatch::JobsRegister == 0);				// t0
+		CHECK(IndirectBatch::ArgumentsRootIndex == 6 && IndirectBatch::ArgumentsRegister == 4);	// u4
+		CHECK(IndirectBatch::CountsRootIndex == 7 && IndirectBatch::CountsRegister == 5);			// u5
+		CHECK(IndirectBatch::ArgumentStride == 20);	// ARGUMENT_STRIDE
+
+		TestIndirectBatch batch(3, 4);
+		RecordingCommandList commandList;
+		batch.Build(&commandList, 0x100000040, 32, 2, 2);
+
+		const auto commands = getCommands(commandList);
+		CHECK(commands.size() == 5);
+		if (commands.size() != 5) return;
+
+		CHECK(commands[0].Opcode == CommandStream::OP_SET_COMPUTE_32BIT_CONSTANTS);
+		CHECK(commands[0].Payload == vector<uint32_t>({ 0, 0, 5, 0x40, 1, 32, 3, 2 }));
+
+		CHECK(commands[1].Opcode == CommandStream::OP_SET_COMPUTE_ROOT_SRV && commands[1].Payload[0] == 5);
+		CHECK(commandList.GetObject(commands[1].Payload[1]) == static_cast<Resource*>(batch.GetJobs()));
+		CHECK(commands[2].Opcode == CommandStream::OP_SET_COMPUTE_ROOT_UAV && commands[2].Payload[0] == 6);
+		CHECK(commandList.GetObject(commands[2].Payload[1]) == static_cast<Resource*>(batch.GetArguments()));
+		CHECK(commands[3].Opcode == CommandStream::OP_SET_COMPUTE_ROOT_UAV && commands[3].Payload[0] == 7);
+		CHECK(commandList.GetObject(commands[3].Payload[1]) == static_cast<Resource*>(batch.GetCounts()));
+		for (auto i = 1u; i < 4; ++i) CHECK(getWord64(commands[i].Payload, 2) == 0);
+
+		// One group per list
+		CHECK(commands[4].Opcode == CommandStream::OP_DISPATCH);
+		CHECK(commands[4].Payload == vector<uint32_t>({ 2, 1, 1 }));
+	}
+
+	// The arguments only set the record address, so the group offset after it must be zero.
+	void testGroupOffset()
+	{
+		TestIndirectBatch batch(3, 4);
+		RecordingCommandList commandList;
+		commandList.SetCompute32BitConstant(0, 0x00080008, 2);
+		batch.Execute(&commandList, 1);
+
+		const auto commands = getCommands(commandList);
+		CHECK(commands.size() == 3);
+		if (commands.size() != 3) return;
+
+		CHECK(commands[1].Opcode == CommandStream::OP_SET_COMPUTE_32BIT_CONSTANTS);
+		CHECK(commands[1].Payload == vector<uint32_t>({ 0, 2, 1, 0 }));
+		CHECK(commands[2].Opcode == CommandStream::OP_EXECUTE_INDIRECT);
+	}
+
+	// ProcessBatch() builds the lists of the steps of a result from GetList(result, 0, numSteps)
+	// on, and executes each step with Execute(step); CreateIndirectBatch() lays the jobs out with
+	// GetList() too. Each step must execute the arguments of its own jobs, and its own count.
+	void testLists()
+	{
+		const uint32_t numResults = 2, numSteps = 3, numJobs = 4;
+		const uint64_t tableAddress = 0x200000000;
+		const uint32_t recordSize = 64;
+
+		vector<uint32_t> jobs(numResults * numSteps * numJobs);
+		const auto getRecord = [](uint32_t result, uint32_t step, uint32_t job) { return 100 * result + 10 * step + job; };
+		for (auto result = 0u; result < numResults; ++result)
+			for (auto step = 0u; step < numSteps; ++step)
+				for (auto job = 0u; job < numJobs; ++job)
+					jobs.at(IndirectBatch::GetList(result, step, numSteps) * numJobs + job) = getRecord(result, step, job);
+
+		TestIndirectBatch batch(numJobs, numResults * numSteps);
+		for (auto result = 0u; result < numResults; ++result)
+		{
+			// The buffers of Init() with numSteps built lists
+			vector<uint8_t> arguments(IndirectBatch::ArgumentStride * numJobs * numSteps);
+			vector<uint32_t> counts(numSteps);
+
+			RecordingCommandList commandList;
+			batch.Build(&commandList, tableAddress, recordSize, IndirectBatch::GetList(result, 0, numSteps), numSteps);
+			dispatchArgs(commandList, jobs, arguments, counts);
+
+			for (auto step = 0u; step < numSteps; ++step)
+			{
+				RecordingCommandList stepList;
+				batch.Execute(&stepList, step);
+				const auto commands = getCommands(stepList);
+				CHECK(commands.size() == 2 && commands.back().Opcode == CommandStream::OP_EXECUTE_INDIRECT);
+				if (commands.size() != 2) continue;
+
+				// Layout, max count, args, args offset (2), count, count offset (2)
+				const auto& payload = commands.back().Payload;
+				CHECK(payload[1] == numJobs);
+				CHECK(stepList.GetObject(payload[2]) == static_cast<Resource*>(batch.GetArguments()));
+				CHECK(stepList.GetObject(payload[5]) == static_cast<Resource*>(batch.GetCounts()));
+
+				const auto argumentOffset = getWord64(payload, 3);
+				const auto countOffset = getWord64(payload, 6);
+				CHECK(countOffset % sizeof(uint32_t) == 0 && countOffset / sizeof(uint32_t) < counts.size());
+				if (countOffset / sizeof(uint32_t) < counts.size())
+					CHECK(counts[countOffset / sizeof(uint32_t)] == numJobs);
+
+				CHECK(argumentOffset + IndirectBatch::ArgumentStride * numJobs <= arguments.size());
+				if (argumentOffset + IndirectBatch::ArgumentStride * numJobs > arguments.size()) continue;
+				for (auto job = 0u; job < numJobs; ++job)
+				{
+					uint64_t address;
+					memcpy(&address, &arguments[argumentOffset + IndirectBatch::ArgumentStride * job], sizeof(address));
+					CHECK(address == tableAddress + recordSize * getRecord(result, step, job));
+				}
+			}
+		}
+	}
+}
+
+int main()
+{
+	testRootParameters();
+	testGroupOffset();
+	testLists();
+
+	return GetTestResult();
+}
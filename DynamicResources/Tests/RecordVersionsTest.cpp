@@ -0,0 +1,133 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include "RecordVersions.h"
+#include "TestHarness.h"
+
+using namespace std;
+
+namespace
+{
+	using Range = RecordVersions::Range;
+
+	bool isEqual(const vector<Range>& ranges, const vector<Range>& expected)
+	{
+		if (ranges.size() != expected.size()) return false;
+		for (size_t i = 0; i < ranges.size(); ++i)
+			if (ranges[i].Begin != expected[i].Begin || ranges[i].End != expected[i].End) return false;
+
+		return true;
+	}
+
+	// Each version misses what was written since it was last published.
+	void testDirtyRanges()
+	{
+		RecordVersions versions;
+		CHECK(!versions.IsPending() && versions.GetVersion() == 0 && versions.GetCurrent() == 0);
+
+		// Sequential writes extend the last range, also when they overlap it.
+		versions.MarkDirty(0, 8);
+		versions.MarkDirty(8, 16);
+		versions.MarkDirty(4, 12);
+		CHECK(versions.IsPending() && versions.GetPending() == 1);
+		CHECK(isEqual(versions.GetPendingRanges(), { { 0, 16 } }));
+		versions.Publish(1);
+		CHECK(versions.GetVersion() == 1 && versions.GetCurrent() == 1);
+
+		// Version 0 still misses the first writes, as well as the next ones.
+		versions.MarkDirty(1000, 1010);
+		CHECK(versions.IsPending() && versions.GetPending() == 0);
+		CHECK(isEqual(versions.GetPendingRanges(), { { 0, 16 }, { 1000, 1010 } }));
+		versions.Publish(2);
+		CHECK(versions.GetCurrent() == 0);
+
+		CHECK(versions.IsPending() && versions.GetPending() == 1);
+		CHECK(isEqual(versions.GetPendingRanges(), { { 1000, 1010 } }));
+		versions.Publish(3);
+
+		// Both versions are up to date.
+		CHECK(!versions.IsPending() && versions.GetPendingRanges().empty());
+		versions.Publish(4);
+		CHECK(versions.GetVersion() == 3 && versions.GetCurrent() == 1);
+
+		versions.Reset();
+		CHECK(!versions.IsPending() && versions.GetVersion() == 0 && versions.GetPendingFenceValue() == 0);
+	}
+
+	void testCoalescing()
+	{
+		// Sorted, and merged across gaps of up to MaxGap bytes
+		vector<Range> ranges = { { 300, 310 }, { 0, 16 }, { 80, 96 }, { 161, 170 }, { 8, 12 }, { 170, 180 } };
+		RecordVersions::Coalesce(ranges, RecordVersions::MaxGap);
+		CHECK(RecordVersions::MaxGap == 64);
+		CHECK(isEqual(ranges, { { 0, 96 }, { 161, 180 }, { 300, 310 } }));
+
+		ranges = {};
+		RecordVersions::Coalesce(ranges, RecordVersions::MaxGap);
+		CHECK(ranges.empty());
+
+		ranges = { { 0, 1000 }, { 10, 20 }, { 1064, 1070 } };
+		RecordVersions::Coalesce(ranges, RecordVersions::MaxGap);
+		CHECK(isEqual(ranges, { { 0, 1070 } }));
+
+		// Writes out of order are coalesced for the upload.
+		RecordVersions versions;
+		versions.MarkDirty(200, 208);
+		versions.MarkDirty(0, 8);
+		versions.MarkDirty(72, 80);
+		versions.MarkDirty(145, 150);
+		CHECK(isEqual(versions.GetPendingRanges(), { { 0, 80 }, { 145, 208 } }));
+	}
+
+	// The copy queue waits for the last frame that read the version it writes, which is not
+	// necessarily the frame before.
+	void testHazardWait()
+	{
+		RecordVersions versions;
+
+		// Frame 1 writes version 1, which no frame has read.
+		versions.MarkDirty(0, 4);
+		CHECK(versions.IsPending() && versions.GetPending() == 1 && versions.GetPendingFenceValue() == 0);
+		versions.Publish(1);
+
+		// Frame 2 writes version 0, which frame 1 did not read.
+		versions.MarkDirty(64, 68);
+		CHECK(versions.IsPending() && versions.GetPending() == 0 && versions.GetPendingFenceValue() == 0);
+		versions.Publish(2);
+
+		// Frame 3 writes version 1 again, after frame 1.
+		versions.MarkDirty(128, 132);
+		CHECK(versions.GetPending() == 1 && versions.GetPendingFenceValue() == 1);
+		versions.Publish(3);
+
+		// Frame 4 writes nothing, but version 0 misses the writes of frame 3.
+		CHECK(versions.IsPending() && versions.GetPending() == 0 && versions.GetPendingFenceValue() == 2);
+		versions.Publish(4);
+
+		// Frames 5 and 6 keep reading version 0.
+		for (auto frame = 5u; frame <= 6; ++frame)
+		{
+			CHECK(!versions.IsPending());
+			versions.Publish(frame);
+		}
+		CHECK(versions.GetCurrent() == 0);
+
+		// Frame 7 writes version 1, which frame 3 read last; then version 0 after frame 6.
+		versions.MarkDirty(0, 4);
+		CHECK(versions.GetPending() == 1 && versions.GetPendingFenceValue() == 3);
+		versions.Publish(7);
+		CHECK(versions.GetPending() == 0 && versions.GetPendingFenceValue() == 6);
+		versions.Publish(8);
+		CHECK(versions.GetPendingFenceValue() == 7);
+	}
+}
+
+int main()
+{
+	testDirtyRanges();
+	testCoalescing();
+	testHazardWait();
+
+	return GetTestResult();
+}
@@ -0,0 +1,217 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include "ResourceStateTracker.h"
+#include "RecordingCommandList.h"
+#include "TestHarness.h"
+
+using namespace std;
+using namespace XUSG;
+
+namespace
+{
+	// Resource that only keeps the whole-resource state, as XUSG does for the barriers it sets
+	class MockResource :
+		public Resource
+	{
+	public:
+		MockResource(ResourceState state) : m_state(state) {}
+		virtual ~MockResource() {}
+
+		bool Initialize(const Device*) { return true; }
+		bool ReadFromSubresource(void*, uint32_t, uint32_t, uint32_t, const BoxRange*) { return false; }
+		bool WriteToSubresource(uint32_t, const void*, uint32_t, uint32_t, const BoxRange*) { return false; }
+
+		Descriptor AllocateCbvSrvUavHeap(uint32_t) { return 0; }
+
+		uint32_t SetBarrier(ResourceBarrier* pBarriers, ResourceState dstState, uint32_t numBarriers,
+			uint32_t subresource, BarrierFlag flags, ResourceState srcState, uint32_t)
+		{
+			pBarriers[numBarriers] = { this, srcState == ResourceState::AUTO ? m_state : srcState,
+				dstState, subresource, flags, nullptr };
+			if (flags != BarrierFlag::BEGIN_ONLY) m_state = dstState;
+
+			return numBarriers + 1;
+		}
+
+		ResourceState Transition(ResourceState dstState, uint32_t, BarrierFlag, ResourceState, uint32_t)
+		{
+			const auto state = m_state;
+			m_state = dstState;
+
+			return state;
+		}
+
+		ResourceState GetResourceState(uint32_t = 0, uint32_t = 0) const { return m_state; }
+
+		uint64_t GetWidth() const { return 0; }
+		uint64_t GetVirtualAddress(int) const { return 0; }
+
+		void Unmap(const Range*) {}
+
+		void Create(void*, void*, const wchar_t*, uint32_t) {}
+		void SetName(const wchar_t*) {}
+
+		void* GetHandle() const { return nullptr; }
+
+	protected:
+		ResourceState m_state;
+	};
+
+	struct RecordedBarrier
+	{
+		const Resource* pResource;
+		ResourceState Before;
+		ResourceState After;
+		BarrierFlag Flags;
+		uint32_t Command;	// Index of the command in the stream
+	};
+
+	// Decodes the barriers of the stream.
+	vector<RecordedBarrier> getBarriers(const RecordingCommandList& commandList)
+	{
+		vector<RecordedBarrier> barriers;
+		const auto pStream = commandList.GetStream();
+		const auto numWords = commandList.GetStreamSize();
+		uint32_t command = 0;
+		for (size_t i = 0; i < numWords; i += 1 + (pStream[i] >> 16), ++command)
+		{
+			if ((pStream[i] & 0xffff) != RecordingCommandList::OP_BARRIER) continue;
+
+			const auto pPayload = &pStream[i + 1];
+			for (auto j = 0u; j < pPayload[0]; ++j)
+			{
+				const auto pWords = &pPayload[1 + RecordingCommandList::BarrierWords * j];
+				const auto pResource = static_cast<const Resource*>(commandList.GetObject(pWords[0]));
+				barriers.push_back({ pResource, static_cast<ResourceState>(pWords[1]),
+					static_cast<ResourceState>(pWords[2]), static_cast<BarrierFlag>(pWords[4]), command });
+			}
+		}
+
+		return barriers;
+	}
+
+	// Number of split transitions that end right after they begin, with no other command in
+	// between that they could overlap with.
+	uint32_t getNumEmptySplits(const vector<RecordedBarrier>& barriers)
+	{
+		uint32_t numEmptySplits = 0;
+		for (size_t i = 0; i < barriers.size(); ++i)
+		{
+			if (barriers[i].Flags != BarrierFlag::BEGIN_ONLY) continue;
+			for (auto j = i + 1; j < barriers.size(); ++j)
+			{
+				if (barriers[j].pResource != barriers[i].pResource || barriers[j].Flags != BarrierFlag::END_ONLY) continue;
+				if (barriers[j].Command <= barriers[i].Command + 1) ++numEmptySplits;
+				break;
+			}
+		}
+
+		return numEmptySplits;
+	}
+
+	// The barriers of PopulateCommandList() without async compute: the render target splits its
+	// transition for the copy around the filter, and the result is transitioned once after it.
+	void testFilterAndCopy()
+	{
+		MockResource renderTarget(ResourceState::PRESENT);
+		MockResource result(ResourceState::COPY_SOURCE);
+		RecordingCommandList commandList;
+		ResourceStateTracker stateTracker;
+		stateTracker.Reset();
+
+		stateTracker.BeginTransition(&renderTarget, ResourceState::COPY_DEST);
+		for (auto step = 0; step < 2; ++step)
+		{
+			stateTracker.Transition(&result, ResourceState::UNORDERED_ACCESS);
+			CHECK(stateTracker.Flush(&commandList) == (step == 0 ? 2u : 1u));
+			commandList.Dispatch(1, 1, 1);
+		}
+
+		stateTracker.Transition(&renderTarget, ResourceState::COPY_DEST);
+		stateTracker.Transition(&result, ResourceState::COPY_SOURCE);
+		CHECK(stateTracker.Flush(&commandList) == 2);
+		commandList.CopyResource(&renderTarget, &result);
+		stateTracker.Transition(&renderTarget, ResourceState::PRESENT);
+		CHECK(stateTracker.Flush(&commandList) == 1);
+
+		const auto barriers = getBarriers(commandList);
+		CHECK(barriers.size() == 6);
+		CHECK(getNumEmptySplits(barriers) == 0);
+
+		// Begun with the first step, ended before the copy
+		CHECK(barriers[0].pResource == &renderTarget && barriers[0].Flags == BarrierFlag::BEGIN_ONLY);
+		CHECK(barriers[0].Before == ResourceState::PRESENT && barriers[0].After == ResourceState::COPY_DEST);
+		CHECK(barriers[3].pResource == &renderTarget && barriers[3].Flags == BarrierFlag::END_ONLY);
+		CHECK(barriers[3].Command == barriers[0].Command + 4);
+
+		// A UAV barrier between the steps, and one plain transition of the result for the copy
+		CHECK(barriers[2].pResource == &result && barriers[2].Before == ResourceState::UNORDERED_ACCESS &&
+			barriers[2].After == ResourceState::UNORDERED_ACCESS);
+		CHECK(barriers[4].pResource == &result && barriers[4].Flags == BarrierFlag::NONE);
+		CHECK(barriers[4].Before == ResourceState::UNORDERED_ACCESS && barriers[4].After == ResourceState::COPY_SOURCE);
+		for (const auto& barrier : barriers) if (barrier.pResource == &result) CHECK(barrier.Flags == BarrierFlag::NONE);
+
+		CHECK(renderTarget.GetResourceState() == ResourceState::PRESENT);
+		CHECK(result.GetResourceState() == ResourceState::COPY_SOURCE);
+
+		const auto stats = stateTracker.GetStats();
+		CHECK(stats.NumBarriers == 6 && stats.NumSplit == 1 && stats.NumBatches == 4);
+		stateTracker.Reset();
+	}
+
+	// A split begun and flushed right before its end overlaps with nothing.
+	void testEmptySplit()
+	{
+		MockResource result(ResourceState::UNORDERED_ACCESS);
+		RecordingCommandList commandList;
+		ResourceStateTracker stateTracker;
+		stateTracker.Reset();
+
+		stateTracker.BeginTransition(&result, ResourceState::COPY_SOURCE);
+		stateTracker.Flush(&commandList);
+		stateTracker.Transition(&result, ResourceState::COPY_SOURCE);
+		stateTracker.Flush(&commandList);
+
+		const auto barriers = getBarriers(commandList);
+		CHECK(barriers.size() == 2);
+		CHECK(getNumEmptySplits(barriers) == 1);
+		stateTracker.Reset();
+	}
+
+	void testRedundantAndDiscard()
+	{
+		MockResource texture(ResourceState::NON_PIXEL_SHADER_RESOURCE);
+		RecordingCommandList commandList;
+		ResourceStateTracker stateTracker;
+		stateTracker.Reset();
+
+		// Requests for the current state record nothing.
+		stateTracker.Transition(&texture, ResourceState::NON_PIXEL_SHADER_RESOURCE);
+		CHECK(stateTracker.Flush(&commandList) == 0);
+		stateTracker.Transition(&texture, ResourceState::UNORDERED_ACCESS);
+		CHECK(stateTracker.Flush(&commandList) == 1);
+		CHECK(commandList.GetNumCommands() == 1);
+
+		const auto& log = stateTracker.GetLog();
+		CHECK(log.size() == 2);
+		CHECK(log[0].Type == ResourceStateTracker::EVENT_REDUNDANT);
+		CHECK(log[1].Type == ResourceStateTracker::EVENT_TRANSITION);
+
+		// The recording is dropped, and the state before it is restored.
+		CHECK(texture.GetResourceState() == ResourceState::UNORDERED_ACCESS);
+		stateTracker.Discard();
+		CHECK(texture.GetResourceState() == ResourceState::NON_PIXEL_SHADER_RESOURCE);
+		CHECK(stateTracker.GetLog().empty());
+	}
+}
+
+int main()
+{
+	testFilterAndCopy();
+	testEmptySplit();
+	testRedundantAndDiscard();
+
+	return GetTestResult();
+}
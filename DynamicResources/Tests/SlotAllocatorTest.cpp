@@ -0,0 +1,81 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include "SlotAllocator.h"
+#include "TestHarness.h"
+
+using namespace std;
+
+namespace
+{
+	void testHandles()
+	{
+		SlotAllocator allocator;
+		CHECK(!allocator.Init(0));
+		CHECK(allocator.Init(2));
+
+		const auto a = allocator.Allocate();
+		const auto b = allocator.Allocate();
+		CHECK(allocator.GetIndex(a) == 0 && allocator.GetIndex(b) == 1);
+		CHECK(allocator.Allocate() == SlotAllocator::InvalidHandle);
+
+		// A freed slot is stale at once, but only reused once its fence value has completed.
+		CHECK(allocator.Free(a, 1));
+		CHECK(!allocator.IsValid(a));
+		CHECK(!allocator.Free(a, 1));
+		CHECK(allocator.GetIndex(a) == UINT32_MAX);
+		CHECK(allocator.Allocate() == SlotAllocator::InvalidHandle);
+
+		allocator.Recycle(0);
+		CHECK(allocator.GetNumRetired() == 1);
+		allocator.Recycle(1);
+		CHECK(allocator.GetNumRetired() == 0);
+
+		const auto c = allocator.Allocate();
+		CHECK(allocator.GetIndex(c) == 0 && c != a);
+		CHECK(allocator.GetNumAllocated() == 2);
+	}
+
+	void testFragmentation()
+	{
+		SlotAllocator allocator;
+		CHECK(allocator.Init(8));
+
+		SlotAllocator::Handle handles[8];
+		for (auto& handle : handles) handle = allocator.Allocate();
+		CHECK(allocator.GetFragmentation() == 0.0f);
+
+		// Slots awaiting recycling cannot be filled yet, so they are no holes.
+		CHECK(allocator.Free(handles[1], 1));
+		CHECK(allocator.Free(handles[3], 1));
+		CHECK(allocator.Free(handles[7], 1));
+		CHECK(allocator.GetFragmentation() == 0.0f);
+
+		// Recycled, they are, up to the highest live slot.
+		allocator.Recycle(1);
+		CHECK(allocator.GetFragmentation() == 2.0f / 7.0f);
+
+		// Compaction moves slots 6 and 5 into 1 and 3; the vacated slots do not count as holes
+		// while the frames in flight may read them, so no compaction is triggered again.
+		vector<SlotAllocator::Relocation> relocations;
+		CHECK(allocator.Compact(2, relocations) == 2);
+		CHECK(relocations.size() == 2);
+		CHECK(allocator.GetIndex(relocations[0].To) == 1 && allocator.GetIndex(relocations[1].To) == 3);
+		CHECK(!allocator.IsValid(relocations[0].From) && !allocator.IsValid(relocations[1].From));
+		CHECK(allocator.GetFragmentation() == 0.0f);
+		CHECK(allocator.Compact(3, relocations) == 0);
+
+		allocator.Recycle(2);
+		CHECK(allocator.GetFragmentation() == 0.0f);
+		CHECK(allocator.GetNumAllocated() == 5);
+	}
+}
+
+int main()
+{
+	testHandles();
+	testFragmentation();
+
+	return GetTestResult();
+}
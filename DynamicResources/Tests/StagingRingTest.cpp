@@ -0,0 +1,101 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include "StagingRing.h"
+#include "TestHarness.h"
+
+namespace
+{
+	void testAllocate()
+	{
+		StagingRing ring;
+		uint64_t offset;
+		CHECK(!ring.Init(0));
+		CHECK(ring.Init(1024));
+
+		CHECK(!ring.Allocate(16, 3, offset));
+		CHECK(!ring.Allocate(16, 2048, offset));
+		CHECK(!ring.Allocate(1025, 1, offset));
+
+		CHECK(ring.Allocate(100, 4, offset) && offset == 0);
+		CHECK(ring.Allocate(100, 256, offset) && offset == 256);
+		CHECK(ring.GetUsedSize() == 356);
+		CHECK(ring.HasPendingAllocations());
+
+		// A full ring fails without side effects.
+		CHECK(ring.Allocate(512, 256, offset) && offset == 512);
+		CHECK(!ring.Allocate(1, 1, offset));
+		CHECK(ring.GetUsedSize() == 1024);
+
+		ring.Retire(1);
+		CHECK(!ring.HasPendingAllocations());
+		CHECK(ring.GetOldestFenceValue() == 1);
+		ring.Reclaim(0);
+		CHECK(ring.GetUsedSize() == 1024);
+		ring.Reclaim(1);
+		CHECK(ring.GetUsedSize() == 0);
+		CHECK(ring.GetOldestFenceValue() == 0);
+	}
+
+	void testWrap()
+	{
+		StagingRing ring;
+		uint64_t offset;
+		CHECK(ring.Init(1024));
+
+		CHECK(ring.Allocate(600, 1, offset) && offset == 0);
+		ring.Retire(1);
+		CHECK(ring.Allocate(300, 1, offset) && offset == 600);
+		ring.Retire(2);
+
+		// Skips to the start rather than straddling the end, once the space there is reclaimed.
+		CHECK(!ring.Allocate(200, 1, offset));
+		ring.Reclaim(1);
+		CHECK(ring.Allocate(200, 1, offset) && offset == 0);
+		ring.Retire(3);
+
+		// An empty ring takes an allocation of its whole capacity, wherever its tail is.
+		ring.Reclaim(3);
+		CHECK(ring.GetUsedSize() == 0);
+		CHECK(ring.Allocate(1024, 1, offset) && offset == 0);
+		CHECK(ring.GetUsedSize() == 1024);
+	}
+
+	void testFenceValueForSpace()
+	{
+		StagingRing ring;
+		uint64_t offset, fenceValue;
+		CHECK(ring.Init(1024));
+		CHECK(!ring.GetFenceValueForSpace(2048, 1, fenceValue));
+
+		CHECK(ring.GetFenceValueForSpace(1024, 1, fenceValue) && fenceValue == 0);
+		CHECK(ring.Allocate(256, 1, offset));
+		ring.Retire(5);
+		CHECK(ring.Allocate(256, 1, offset));
+		ring.Retire(6);
+		CHECK(ring.Allocate(256, 1, offset));
+		CHECK(ring.GetFenceValueForSpace(256, 1, fenceValue) && fenceValue == 0);
+
+		// The oldest batch holds enough space, then both do; the pending allocation holds the rest.
+		CHECK(ring.Allocate(256, 1, offset));
+		CHECK(ring.GetFenceValueForSpace(256, 1, fenceValue) && fenceValue == 5);
+		CHECK(ring.GetFenceValueForSpace(512, 1, fenceValue) && fenceValue == 6);
+		CHECK(!ring.GetFenceValueForSpace(768, 1, fenceValue));
+
+		// Once retired, the pending allocations may be waited for as well.
+		ring.Retire(7);
+		CHECK(ring.GetFenceValueForSpace(1024, 1, fenceValue) && fenceValue == 7);
+		ring.Reclaim(fenceValue);
+		CHECK(ring.Allocate(1024, 1, offset));
+	}
+}
+
+int main()
+{
+	testAllocate();
+	testWrap();
+	testFenceValueForSpace();
+
+	return GetTestResult();
+}
@@ -0,0 +1,33 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdio>
+
+// Minimal checks for the host tests; a failed check is reported and the test goes on,
+// so that one run lists all failures. main() returns GetTestResult().
+inline int& GetNumFailedChecks()
+{
+	static int numFailedChecks = 0;
+
+	return numFailedChecks;
+}
+
+#define CHECK(x) \
+	do \
+	{ \
+		if (!(x)) \
+		{ \
+			++GetNumFailedChecks(); \
+			fprintf(stderr, "%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #x); \
+		} \
+	} while (false)
+
+inline int GetTestResult()
+{
+	if (GetNumFailedChecks() > 0) fprintf(stderr, "%d check(s) failed\n", GetNumFailedChecks());
+
+	return GetNumFailedChecks() > 0 ? 1 : 0;
+}
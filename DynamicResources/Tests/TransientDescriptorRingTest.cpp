@@ -0,0 +1,125 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include "TransientDescriptorRing.h"
+#include "TestHarness.h"
+
+using namespace std;
+
+namespace
+{
+	void testBlocks()
+	{
+		TransientDescriptorRing ring;
+		TransientDescriptorRing::ThreadBlock block;
+		CHECK(!ring.Init(64, 4, 32));
+		CHECK(ring.Init(256, 2, 32));
+		CHECK(ring.GetRegionSize() == 128);
+		CHECK(ring.BeginFrame(0));
+
+		CHECK(ring.Allocate(block, 0) == TransientDescriptorRing::InvalidOffset);
+		CHECK(ring.Allocate(block, 4) == 0);
+		CHECK(ring.Allocate(block, 28) == 4);
+		CHECK(ring.Allocate(block, 1) == 32);
+
+		// Oversized requests are reserved on their own, and counted apart from the blocks.
+		CHECK(ring.Allocate(block, 40) == 64);
+		CHECK(ring.Allocate(block, 1) == 33);
+
+		auto stats = ring.GetStats();
+		CHECK(stats.NumAllocated == 74);
+		CHECK(stats.NumReserved == 104);
+		CHECK(stats.NumBlocks == 2);
+		CHECK(stats.NumOversized == 1);
+		CHECK(stats.NumOverflows == 0);
+
+		// Overflow of the region
+		CHECK(ring.Allocate(block, 64) == TransientDescriptorRing::InvalidOffset);
+		stats = ring.GetStats();
+		CHECK(stats.NumOversized == 1);
+		CHECK(stats.NumOverflows == 1);
+		CHECK(ring.GetStats().NumOverflows == 0);
+	}
+
+	void testFrames()
+	{
+		TransientDescriptorRing ring;
+		TransientDescriptorRing::ThreadBlock block;
+		CHECK(ring.Init(256, 2, 32));
+
+		CHECK(ring.BeginFrame(0));
+		CHECK(ring.Allocate(block, 1) == 0);
+		ring.EndFrame(1);
+
+		// The next frame takes the next region, and the block of the last frame is stale.
+		CHECK(ring.BeginFrame(0));
+		CHECK(ring.Allocate(block, 1) == 128);
+		ring.EndFrame(2);
+
+		// The first region is reused only once its frame has completed.
+		CHECK(!ring.BeginFrame(0));
+		CHECK(ring.BeginFrame(1));
+		CHECK(ring.Allocate(block, 1) == 0);
+		CHECK(ring.GetStats().NumBlocks == 1);
+		ring.EndFrame(3);
+	}
+
+	// Threads allocate concurrently; all allocations must be disjoint and within the region.
+	void testThreads()
+	{
+		const uint32_t numThreads = 8;
+		const uint32_t numAllocations = 64;
+
+		TransientDescriptorRing ring;
+		CHECK(ring.Init(2 * 16384, 2, 16));
+		CHECK(ring.BeginFrame(0));
+
+		vector<vector<pair<uint32_t, uint32_t>>> allocations(numThreads);
+		vector<thread> threads;
+		for (uint32_t t = 0; t < numThreads; ++t)
+		{
+			threads.emplace_back([&ring, &allocations, t]()
+			{
+				TransientDescriptorRing::ThreadBlock block;
+				for (uint32_t i = 0; i < numAllocations; ++i)
+				{
+					const auto count = 1 + (i * 7 + t) % 20;
+					const auto offset = ring.Allocate(block, count);
+					if (offset != TransientDescriptorRing::InvalidOffset) allocations[t].emplace_back(offset, count);
+				}
+			});
+		}
+		for (auto& thread : threads) thread.join();
+
+		vector<pair<uint32_t, uint32_t>> ranges;
+		uint32_t numAllocated = 0;
+		for (const auto& threadAllocations : allocations)
+		{
+			CHECK(threadAllocations.size() == numAllocations);
+			for (const auto& allocation : threadAllocations) numAllocated += allocation.second;
+			ranges.insert(ranges.end(), threadAllocations.begin(), threadAllocations.end());
+		}
+		sort(ranges.begin(), ranges.end());
+		for (size_t i = 1; i < ranges.size(); ++i)
+			CHECK(ranges[i - 1].first + ranges[i - 1].second <= ranges[i].first);
+		CHECK(ranges.back().first + ranges.back().second <= ring.GetRegionSize());
+
+		const auto stats = ring.GetStats();
+		CHECK(stats.NumAllocated == numAllocated);
+		CHECK(stats.NumOverflows == 0);
+		CHECK(stats.NumOversized > 0);
+	}
+}
+
+int main()
+{
+	testBlocks();
+	testFrames();
+	testThreads();
+
+	return GetTestResult();
+}
@@ -0,0 +1,42 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include "HostBenchmark.h"
+
+using namespace std;
+
+// Standalone runner of the host-side microbenchmarks, which the app also runs with -benchmark:
+//   HostBenchmark [-i image] [-o results.json] [-mintime seconds]
+int main(int argc, char* argv[])
+{
+	const char* imageFileName = "Assets/Sashimi.png";
+	const char* outFileName = "DynamicResources_benchmark.json";
+	HostBenchmark benchmark;
+
+	for (auto i = 1; i < argc; ++i)
+	{
+		const auto hasNextArgValue = i + 1 < argc;
+		if ((!strcmp(argv[i], "-i") || !strcmp(argv[i], "-image")) && hasNextArgValue) imageFileName = argv[++i];
+		else if (!strcmp(argv[i], "-o") && hasNextArgValue) outFileName = argv[++i];
+		else if (!strcmp(argv[i], "-mintime") && hasNextArgValue) benchmark.SetMinTime(atof(argv[++i]));
+		else
+		{
+			cerr << "Usage: " << argv[0] << " [-i image] [-o results.json] [-mintime seconds]" << endl;
+
+			return 2;
+		}
+	}
+
+	if (!benchmark.Run(imageFileName, outFileName))
+	{
+		cerr << "Failed to run the host benchmark" << endl;
+
+		return 1;
+	}
+
+	return 0;
+}
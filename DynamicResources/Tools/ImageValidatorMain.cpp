@@ -0,0 +1,37 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <cstring>
+#include <iostream>
+#include "ImageValidator.h"
+
+using namespace std;
+
+// Headless golden-image check of the CPU filter, which the app also runs with -validate:
+//   ImageValidator [-i image] [-goldens dir] [--record]
+// Returns 0 if every image passes. Missing goldens fail, unless --record writes them.
+int main(int argc, char* argv[])
+{
+	const char* imageFileName = "Assets/Sashimi.png";
+	const char* goldenDir = "Assets/Goldens";
+	auto isRecording = false;
+
+	for (auto i = 1; i < argc; ++i)
+	{
+		const auto hasNextArgValue = i + 1 < argc;
+		if ((!strcmp(argv[i], "-i") || !strcmp(argv[i], "-image")) && hasNextArgValue) imageFileName = argv[++i];
+		else if (!strcmp(argv[i], "-goldens") && hasNextArgValue) goldenDir = argv[++i];
+		else if (!strcmp(argv[i], "--record") || !strcmp(argv[i], "-record")) isRecording = true;
+		else
+		{
+			cerr << "Usage: " << argv[0] << " [-i image] [-goldens dir] [--record]" << endl;
+
+			return 2;
+		}
+	}
+
+	ImageValidator validator;
+
+	return validator.Run(imageFileName, goldenDir, isRecording) ? 0 : 1;
+}
@@ -33,6 +33,8 @@
 #include <sstream>
 #include <fstream>
 #include <iomanip>
+#include <chrono>
+#include <future>
 
 #if _HAS_CXX17
 #include <winrt/base.h>